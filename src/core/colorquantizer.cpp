@@ -1,159 +1,774 @@
 #include "colorquantizer.hpp"
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #include <qatomic.h>
 #include <qcolor.h>
 #include <qdatetime.h>
+#include <qdeadlinetimer.h>
 #include <qimage.h>
+#include <qimagereader.h>
 #include <qlist.h>
 #include <qlogging.h>
 #include <qloggingcategory.h>
-#include <qminmax.h>
 #include <qnamespace.h>
 #include <qnumeric.h>
 #include <qobject.h>
+#include <qqmlinfo.h>
 #include <qqmllist.h>
+#include <qquickitem.h>
+#include <qquickitemgrabresult.h>
+#include <qrandom.h>
 #include <qrgb.h>
+#include <qsemaphore.h>
+#include <qsharedpointer.h>
+#include <qsize.h>
 #include <qthreadpool.h>
 #include <qtmetamacros.h>
 #include <qtypes.h>
+#include <qurl.h>
 
+#include "colorquantizercache.hpp"
+#include "iconprovider.hpp"
 #include "logcat.hpp"
 
 namespace {
 QS_LOGGING_CATEGORY(logColorQuantizer, "quickshell.colorquantizer", QtWarningMsg);
+
+// Buckets smaller than this are cheaper to split than to hand to another thread.
+constexpr qsizetype PARALLEL_THRESHOLD = 16384;
+
+// Identifies cached results. The high byte is the algorithm and the low byte its revision,
+// which must be changed whenever the algorithm's output changes.
+constexpr quint32 MEDIAN_CUT_ALGORITHM = 0x002;
+constexpr quint32 OCTREE_ALGORITHM = 0x101;
+constexpr quint32 KMEANS_ALGORITHM = 0x201;
+
+constexpr qint32 MAX_COLORS = 256;
+constexpr qint32 MAX_COLOR_LEVELS = 8;
+
+// Shift of the channel with the largest range, preferring red then green on ties.
+// The loop is branchless so compilers can vectorize it.
+qint32 dominantChannelShift(const QRgb* begin, const QRgb* end) {
+	quint32 rMin = 255, gMin = 255, bMin = 255; // NOLINT
+	quint32 rMax = 0, gMax = 0, bMax = 0;       // NOLINT
+
+	for (const auto* pixel = begin; pixel != end; ++pixel) { // NOLINT
+		auto r = (*pixel >> 16) & 0xff;
+		auto g = (*pixel >> 8) & 0xff;
+		auto b = *pixel & 0xff;
+
+		rMin = std::min(rMin, r);
+		gMin = std::min(gMin, g);
+		bMin = std::min(bMin, b);
+		rMax = std::max(rMax, r);
+		gMax = std::max(gMax, g);
+		bMax = std::max(bMax, b);
+	}
+
+	auto rRange = rMax - rMin;
+	auto gRange = gMax - gMin;
+	auto bRange = bMax - bMin;
+
+	if (rRange >= gRange && rRange >= bRange) return 16;
+	else if (gRange >= bRange) return 8;
+	else return 0;
 }
 
-ColorQuantizerOperation::ColorQuantizerOperation(QUrl* source, qreal depth, qreal rescaleSize)
-    : source(source)
-    , maxDepth(depth)
-    , rescaleSize(rescaleSize) {
-	this->setAutoDelete(false);
+QColor averageColor(const QRgb* begin, const QRgb* end) {
+	quint64 totalR = 0, totalG = 0, totalB = 0; // NOLINT
+
+	for (const auto* pixel = begin; pixel != end; ++pixel) { // NOLINT
+		totalR += (*pixel >> 16) & 0xff;
+		totalG += (*pixel >> 8) & 0xff;
+		totalB += *pixel & 0xff;
+	}
+
+	auto count = static_cast<double>(end - begin);
+	return QColor(qRound(totalR / count), qRound(totalG / count), qRound(totalB / count));
 }
 
-void ColorQuantizerOperation::quantizeImage(const QAtomicInteger<bool>& shouldCancel) {
-	if (shouldCancel.loadAcquire() || this->source->isEmpty()) return;
+// The size an image should be sampled at, or an invalid size if it is small enough already.
+QSize rescaledSize(const QSize& size, qreal rescaleSize) {
+	if (rescaleSize <= 0 || (size.width() <= rescaleSize && size.height() <= rescaleSize)) {
+		return QSize();
+	}
 
-	this->colors.clear();
+	auto target = static_cast<int>(rescaleSize);
+	return size.scaled(target, target, Qt::KeepAspectRatio);
+}
 
-	auto image = QImage(this->source->toLocalFile());
-	if ((image.width() > this->rescaleSize || image.height() > this->rescaleSize)
-	    && this->rescaleSize > 0)
-	{
-		image = image.scaled(
-		    static_cast<int>(this->rescaleSize),
-		    static_cast<int>(this->rescaleSize),
-		    Qt::KeepAspectRatio,
-		    Qt::SmoothTransformation
-		);
+// Pixels are visited in interleaved passes, so any prefix of the visit order samples the
+// whole image evenly when the time limit runs out.
+constexpr qsizetype SAMPLE_STRIDE = 16;
+// Deadline and cancellation checks are amortized over this many pixels.
+constexpr qsizetype CHECK_INTERVAL = 4096;
+
+constexpr qint32 OCTREE_DEPTH = 8;
+// Bounds memory and reduction cost while inserting. Leaves are reduced to the requested
+// count once all pixels are inserted.
+constexpr qsizetype OCTREE_MAX_LEAVES = 4096;
+
+constexpr quint32 KMEANS_SEED = 0x51534b4d;
+constexpr qsizetype KMEANS_SEED_SAMPLES = 4096;
+constexpr qsizetype KMEANS_BATCH_SIZE = 1024;
+constexpr qint32 KMEANS_MAX_ITERATIONS = 200;
+// Mean squared center movement per batch, in Oklab units, below which clustering stops.
+constexpr float KMEANS_TOLERANCE = 1e-7f;
+constexpr qsizetype KMEANS_COUNT_SAMPLES = 65536;
+
+// Calls fn with pixel indexes in interleaved order until it has visited every pixel or limit
+// pixels. Returns false if stopped by the deadline or cancellation.
+template <typename F>
+bool forEachSample(
+    qsizetype size,
+    qsizetype limit,
+    const QDeadlineTimer& deadline,
+    const QAtomicInteger<bool>& shouldCancel,
+    F fn
+) {
+	qsizetype visited = 0;
+
+	for (qsizetype pass = 0; pass != SAMPLE_STRIDE; ++pass) {
+		for (auto i = pass; i < size; i += SAMPLE_STRIDE) {
+			if (visited == limit) return true;
+
+			if (visited % CHECK_INTERVAL == 0 && visited != 0
+			    && (shouldCancel.loadAcquire() || deadline.hasExpired()))
+			{
+				return false;
+			}
+
+			fn(i);
+			++visited;
+		}
+	}
+
+	return true;
+}
+
+class Octree {
+public:
+	Octree() { this->nodes.emplace_back(); }
+
+	void insert(QRgb pixel) {
+		auto r = qRed(pixel);
+		auto g = qGreen(pixel);
+		auto b = qBlue(pixel);
+
+		qint32 index = 0;
+		for (qint32 level = 0; level != OCTREE_DEPTH && !this->nodes[index].leaf; ++level) {
+			this->nodes[index].count++;
+
+			auto shift = 7 - level;
+			auto child = ((r >> shift) & 1) << 2 | ((g >> shift) & 1) << 1 | ((b >> shift) & 1);
+
+			auto next = this->nodes[index].children.at(child);
+			if (next == 0) {
+				if (!this->hasChildren(index)) this->reducible.at(level).push_back(index);
+
+				next = this->allocate();
+				this->nodes[index].children.at(child) = next;
+
+				if (level + 1 == OCTREE_DEPTH) {
+					this->nodes[next].leaf = true;
+					this->leaves++;
+				}
+			}
+
+			index = next;
+		}
+
+		auto& node = this->nodes[index];
+		node.count++;
+		node.r += r;
+		node.g += g;
+		node.b += b;
+
+		if (this->leaves > OCTREE_MAX_LEAVES) {
+			while (this->leaves > OCTREE_MAX_LEAVES && this->reduceOne(0)) {}
+		}
+	}
+
+	// Up to count leaf colors, most common first.
+	[[nodiscard]] QList<QColor> colors(qsizetype count) {
+		// Reducing a node merges all of its children, so tree reduction stops before it would
+		// produce fewer colors than requested, and the remaining leaves are merged one by one.
+		while (this->leaves > count && this->reduceOne(count)) {}
+
+		auto leaves = std::vector<Node>();
+		auto stack = std::vector<qint32> {0};
+
+		while (!stack.empty()) {
+			const auto& node = this->nodes[stack.back()];
+			stack.pop_back();
+
+			if (node.leaf) {
+				if (node.count != 0) leaves.push_back(node);
+				continue;
+			}
+
+			for (auto child: node.children) {
+				if (child != 0) stack.push_back(child);
+			}
+		}
+
+		while (static_cast<qsizetype>(leaves.size()) > count) {
+			auto smallest = std::ranges::min_element(leaves, [](const Node& a, const Node& b) {
+				return a.count < b.count;
+			});
+
+			auto merged = *smallest;
+			leaves.erase(smallest);
+
+			auto distance = [&merged](const Node& node) {
+				auto dr = merged.averageR() - node.averageR();
+				auto dg = merged.averageG() - node.averageG();
+				auto db = merged.averageB() - node.averageB();
+				return dr * dr + dg * dg + db * db;
+			};
+
+			auto& nearest = *std::ranges::min_element(leaves, [&](const Node& a, const Node& b) {
+				return distance(a) < distance(b);
+			});
+
+			nearest.count += merged.count;
+			nearest.r += merged.r;
+			nearest.g += merged.g;
+			nearest.b += merged.b;
+		}
+
+		std::ranges::stable_sort(leaves, [](const Node& a, const Node& b) {
+			return a.count > b.count;
+		});
+
+		auto colors = QList<QColor>();
+		colors.reserve(static_cast<qsizetype>(leaves.size()));
+
+		for (const auto& leaf: leaves) {
+			colors.append(
+			    QColor(qRound(leaf.averageR()), qRound(leaf.averageG()), qRound(leaf.averageB()))
+			);
+		}
+
+		return colors;
+	}
+
+private:
+	struct Node {
+		// Pixels in the subtree. Color sums are only kept by leaves.
+		quint64 count = 0;
+		quint64 r = 0;
+		quint64 g = 0;
+		quint64 b = 0;
+		// Index 0 is the root, which is never a child.
+		std::array<qint32, 8> children {};
+		bool leaf = false;
+
+		[[nodiscard]] double averageR() const { return static_cast<double>(this->r) / this->count; }
+		[[nodiscard]] double averageG() const { return static_cast<double>(this->g) / this->count; }
+		[[nodiscard]] double averageB() const { return static_cast<double>(this->b) / this->count; }
+	};
+
+	[[nodiscard]] bool hasChildren(qint32 index) const {
+		return std::ranges::any_of(this->nodes[index].children, [](qint32 c) { return c != 0; });
+	}
+
+	qint32 allocate() {
+		if (!this->freeNodes.empty()) {
+			auto index = this->freeNodes.back();
+			this->freeNodes.pop_back();
+			this->nodes[index] = Node();
+			return index;
+		}
+
+		this->nodes.emplace_back();
+		return static_cast<qint32>(this->nodes.size() - 1);
+	}
+
+	[[nodiscard]] qsizetype childCount(qint32 index) const {
+		return std::ranges::count_if(this->nodes[index].children, [](qint32 c) { return c != 0; });
+	}
+
+	// Merges a node on the deepest level that has children into a leaf. With a minimum leaf
+	// count, the least common node which leaves at least that many leaves is merged.
+	// All children of nodes on that level are leaves.
+	bool reduceOne(qsizetype minLeaves) {
+		auto level = this->reducible.rbegin();
+		while (level != this->reducible.rend() && level->empty()) ++level;
+		if (level == this->reducible.rend()) return false;
+
+		// While inserting, any node is merged as searching for the least common one would
+		// dominate insertion time.
+		auto smallest = minLeaves == 0 ? std::prev(level->end()) : level->end();
+		for (auto it = level->begin(); minLeaves != 0 && it != level->end(); ++it) {
+			if (this->leaves - this->childCount(*it) + 1 < minLeaves) continue;
+
+			if (smallest == level->end() || this->nodes[*it].count < this->nodes[*smallest].count) {
+				smallest = it;
+			}
+		}
+
+		if (smallest == level->end()) return false;
+
+		auto index = *smallest;
+		*smallest = level->back();
+		level->pop_back();
+
+		auto& node = this->nodes[index];
+		for (auto& child: node.children) {
+			if (child == 0) continue;
+
+			const auto& leaf = this->nodes[child];
+			node.r += leaf.r;
+			node.g += leaf.g;
+			node.b += leaf.b;
+
+			this->freeNodes.push_back(child);
+			this->leaves--;
+			child = 0;
+		}
+
+		node.leaf = true;
+		this->leaves++;
+		return true;
+	}
+
+	std::vector<Node> nodes;
+	std::vector<qint32> freeNodes;
+	// Nodes that have children, by level.
+	std::array<std::vector<qint32>, OCTREE_DEPTH> reducible;
+	qsizetype leaves = 0;
+};
+
+// Pixels or cluster centers in Oklab, stored as separate channels so distance loops vectorize.
+struct OklabPoints {
+	std::vector<float> l;
+	std::vector<float> a;
+	std::vector<float> b;
+
+	void reserve(size_t size) {
+		this->l.reserve(size);
+		this->a.reserve(size);
+		this->b.reserve(size);
+	}
+
+	void append(float l, float a, float b) {
+		this->l.push_back(l);
+		this->a.push_back(a);
+		this->b.push_back(b);
+	}
+
+	[[nodiscard]] size_t size() const { return this->l.size(); }
+};
+
+const std::array<float, 256>& srgbToLinearTable() {
+	static const auto table = []() {
+		auto table = std::array<float, 256>();
+
+		for (size_t i = 0; i != table.size(); ++i) {
+			auto c = static_cast<float>(i) / 255.0f;
+			table.at(i) = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		return table;
+	}();
+
+	return table;
+}
+
+// See https://bottosson.github.io/posts/oklab/
+void appendOklab(OklabPoints& points, QRgb pixel) {
+	const auto& linear = srgbToLinearTable();
+	auto r = linear.at(qRed(pixel));
+	auto g = linear.at(qGreen(pixel));
+	auto b = linear.at(qBlue(pixel));
+
+	auto l = std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+	auto m = std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+	auto s = std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+
+	points.append(
+	    0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+	    1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+	    0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s
+	);
+}
+
+QColor oklabToColor(float okL, float okA, float okB) {
+	auto l = okL + 0.3963377774f * okA + 0.2158037573f * okB;
+	auto m = okL - 0.1055613458f * okA - 0.0638541728f * okB;
+	auto s = okL - 0.0894841775f * okA - 1.2914855480f * okB;
+	l = l * l * l;
+	m = m * m * m;
+	s = s * s * s;
+
+	auto toSrgb = [](float c) {
+		c = std::clamp(c, 0.0f, 1.0f);
+		c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		return qRound(c * 255.0f);
+	};
+
+	return QColor(
+	    toSrgb(4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s),
+	    toSrgb(-1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s),
+	    toSrgb(-0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s)
+	);
+}
+
+// Index of the center closest to the point. Distances to all centers are computed in a
+// separate branchless loop so compilers can vectorize it.
+qsizetype nearestCenter(
+    const OklabPoints& centers,
+    std::vector<float>& distances,
+    float l,
+    float a,
+    float b
+) {
+	auto count = centers.size();
+	const auto* cl = centers.l.data();
+	const auto* ca = centers.a.data();
+	const auto* cb = centers.b.data();
+	auto* d = distances.data();
+
+	for (size_t i = 0; i != count; ++i) {
+		auto dl = cl[i] - l; // NOLINT
+		auto da = ca[i] - a; // NOLINT
+		auto db = cb[i] - b; // NOLINT
+		d[i] = dl * dl + da * da + db * db; // NOLINT
+	}
+
+	return std::ranges::min_element(distances.begin(), distances.begin() + count)
+	     - distances.begin();
+}
+
+// k-means++ seeding over the first samples of the visit order.
+OklabPoints seedCenters(const OklabPoints& points, qsizetype count, QRandomGenerator& random) {
+	auto samples = std::min(static_cast<qsizetype>(points.size()), KMEANS_SEED_SAMPLES);
+	auto centers = OklabPoints();
+	centers.reserve(count);
+
+	auto first = random.bounded(samples);
+	centers.append(points.l[first], points.a[first], points.b[first]);
+
+	auto distances = std::vector<double>(samples);
+	for (qsizetype i = 0; i != samples; ++i) {
+		auto dl = points.l[i] - centers.l[0];
+		auto da = points.a[i] - centers.a[0];
+		auto db = points.b[i] - centers.b[0];
+		distances[i] = dl * dl + da * da + db * db;
 	}
 
+	while (static_cast<qsizetype>(centers.size()) != count) {
+		auto total = std::accumulate(distances.begin(), distances.end(), 0.0);
+		// Every sample is already a center.
+		if (total <= 0) break;
+
+		auto target = random.generateDouble() * total;
+		qsizetype next = 0;
+		for (; next != samples - 1; ++next) {
+			target -= distances[next];
+			if (target < 0) break;
+		}
+
+		centers.append(points.l[next], points.a[next], points.b[next]);
+
+		for (qsizetype i = 0; i != samples; ++i) {
+			auto dl = points.l[i] - points.l[next];
+			auto da = points.a[i] - points.a[next];
+			auto db = points.b[i] - points.b[next];
+			distances[i] = std::min(distances[i], static_cast<double>(dl * dl + da * da + db * db));
+		}
+	}
+
+	return centers;
+}
+
+} // namespace
+
+ColorQuantizerOperation::ColorQuantizerOperation(
+    QUrl source,
+    QImage image,
+    ColorQuantizerSettings settings,
+    std::optional<ColorQuantizerKey> cacheKey
+)
+    : source(std::move(source))
+    , image(std::move(image))
+    , settings(settings)
+    , cacheKey(std::move(cacheKey)) {
+	this->setAutoDelete(false);
+}
+
+QImage ColorQuantizerOperation::loadImage() {
+	auto image = std::move(this->image);
+
 	if (image.isNull()) {
-		qCWarning(logColorQuantizer) << "Failed to load image from" << this->source->toString();
-		return;
+		auto reader = QImageReader(this->source.toLocalFile());
+
+		// Handlers that support it decode directly at a reduced size, such as JPEG through
+		// DCT scaling. QImageReader scales the full image for all others.
+		auto targetSize = rescaledSize(reader.size(), this->settings.rescaleSize);
+		if (targetSize.isValid()) reader.setScaledSize(targetSize);
+
+		image = reader.read();
+
+		if (image.isNull()) {
+			qCWarning(logColorQuantizer) << "Failed to load image from" << this->source.toString()
+			                             << reader.errorString();
+			return image;
+		}
+	}
+
+	// Covers in-memory images and readers that don't know the image size before decoding.
+	auto targetSize = rescaledSize(image.size(), this->settings.rescaleSize);
+	if (targetSize.isValid()) {
+		image = image.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 	}
 
-	QList<QColor> pixels;
+	return image;
+}
+
+void ColorQuantizerOperation::quantizeImage(
+    const QDeadlineTimer& deadline,
+    const QAtomicInteger<bool>& shouldCancel
+) {
+	if (shouldCancel.loadAcquire() || (this->source.isEmpty() && this->image.isNull())) return;
+
+	this->colors.clear();
+
+	auto image = this->loadImage();
+	if (image.isNull()) return;
+
+	// Scanlines of these formats hold the same unpremultiplied values as QImage::pixel().
+	if (image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_RGB32) {
+		image.convertTo(QImage::Format_ARGB32);
+	}
+
+	auto pixels = QList<QRgb>();
+	pixels.reserve(static_cast<qsizetype>(image.width()) * image.height());
+
 	for (int y = 0; y != image.height(); ++y) {
+		const auto* line = reinterpret_cast<const QRgb*>(image.constScanLine(y)); // NOLINT
 		for (int x = 0; x != image.width(); ++x) {
-			auto pixel = image.pixel(x, y);
-			if (qAlpha(pixel) == 0) continue;
-
-			pixels.append(QColor::fromRgb(pixel));
+			if (qAlpha(line[x]) != 0) pixels.append(line[x]);
 		}
 	}
 
 	auto startTime = QDateTime::currentDateTime();
 
-	this->colors = this->quantization(pixels, 0);
+	switch (this->settings.algorithm) {
+	case ColorQuantizerAlgorithm::MedianCut: {
+		// Each level of depth is a binary split, and partial levels are rounded up.
+		auto depth = this->settings.depth;
+		auto levels = depth > 0 ? static_cast<qint32>(std::ceil(depth)) : 0;
+		this->colors = ColorQuantizerOperation::quantize(pixels, levels, shouldCancel);
+		break;
+	}
+	case ColorQuantizerAlgorithm::Octree:
+		this->colors = ColorQuantizerOperation::quantizeOctree(
+		    pixels,
+		    ColorQuantizerOperation::colorCount(this->settings),
+		    deadline,
+		    shouldCancel
+		);
+		break;
+	case ColorQuantizerAlgorithm::KMeans:
+		this->colors = ColorQuantizerOperation::quantizeKMeans(
+		    pixels,
+		    ColorQuantizerOperation::colorCount(this->settings),
+		    deadline,
+		    shouldCancel
+		);
+		break;
+	}
+
+	this->timedOut = deadline.hasExpired();
 
 	auto endTime = QDateTime::currentDateTime();
 	auto milliseconds = startTime.msecsTo(endTime);
 	qCDebug(logColorQuantizer) << "Color Quantization took: " << milliseconds << "ms";
 }
 
+QList<QColor> ColorQuantizerOperation::quantize(
+    QList<QRgb>& pixels,
+    qint32 depth,
+    const QAtomicInteger<bool>& shouldCancel
+) {
+	return ColorQuantizerOperation::quantization(
+	    pixels.data(),
+	    pixels.data() + pixels.size(), // NOLINT
+	    depth,
+	    shouldCancel
+	);
+}
+
 QList<QColor> ColorQuantizerOperation::quantization(
-    QList<QColor>& rgbValues,
-    qreal depth,
+    QRgb* begin,
+    QRgb* end,
+    qint32 depth,
     const QAtomicInteger<bool>& shouldCancel
 ) {
-	if (shouldCancel.loadAcquire()) return QList<QColor>();
+	if (shouldCancel.loadAcquire() || begin == end) return QList<QColor>();
 
-	if (depth >= this->maxDepth || rgbValues.isEmpty()) {
-		if (rgbValues.isEmpty()) return QList<QColor>();
+	// A single pixel ends up as the only color of its subtree.
+	if (depth <= 0 || end - begin == 1) return QList<QColor>() << averageColor(begin, end);
 
-		auto totalR = 0;
-		auto totalG = 0;
-		auto totalB = 0;
+	auto shift = dominantChannelShift(begin, end);
+	auto* mid = begin + (end - begin) / 2; // NOLINT
 
-		for (const auto& color: rgbValues) {
-			if (shouldCancel.loadAcquire()) return QList<QColor>();
+	// Only the median needs to be in place, with smaller values before it and larger after.
+	std::nth_element(begin, mid, end, [shift](QRgb a, QRgb b) {
+		return ((a >> shift) & 0xff) < ((b >> shift) & 0xff);
+	});
 
-			totalR += color.red();
-			totalG += color.green();
-			totalB += color.blue();
-		}
+	auto left = QList<QColor>();
+	auto right = QList<QColor>();
 
-		auto avgColor = QColor(
-		    qRound(totalR / static_cast<double>(rgbValues.size())),
-		    qRound(totalG / static_cast<double>(rgbValues.size())),
-		    qRound(totalB / static_cast<double>(rgbValues.size()))
-		);
+	// The left half is split on another pool thread if one is idle. Threads are never
+	// waited on unless they are already running the task, so nested splits can't deadlock.
+	auto parallel = false;
+	auto leftDone = QSemaphore();
 
-		return QList<QColor>() << avgColor;
+	if (end - begin >= PARALLEL_THRESHOLD) {
+		parallel = QThreadPool::globalInstance()->tryStart([&]() {
+			left = ColorQuantizerOperation::quantization(begin, mid, depth - 1, shouldCancel);
+			leftDone.release();
+		});
 	}
 
-	auto dominantChannel = findBiggestColorRange(rgbValues);
-	std::ranges::sort(rgbValues, [dominantChannel](const auto& a, const auto& b) {
-		if (dominantChannel == 'r') return a.red() < b.red();
-		else if (dominantChannel == 'g') return a.green() < b.green();
-		return a.blue() < b.blue();
-	});
+	right = ColorQuantizerOperation::quantization(mid, end, depth - 1, shouldCancel);
+
+	if (parallel) leftDone.acquire();
+	else left = ColorQuantizerOperation::quantization(begin, mid, depth - 1, shouldCancel);
 
-	auto mid = rgbValues.size() / 2;
+	return left + right;
+}
 
-	auto leftHalf = rgbValues.mid(0, mid);
-	auto rightHalf = rgbValues.mid(mid);
+QList<QColor> ColorQuantizerOperation::quantizeOctree(
+    const QList<QRgb>& pixels,
+    qint32 count,
+    const QDeadlineTimer& deadline,
+    const QAtomicInteger<bool>& shouldCancel
+) {
+	if (count <= 0) return QList<QColor>();
 
-	QList<QColor> result;
-	result.append(this->quantization(leftHalf, depth + 1));
-	result.append(this->quantization(rightHalf, depth + 1));
+	auto octree = Octree();
+	auto complete = forEachSample(pixels.size(), pixels.size(), deadline, shouldCancel, [&](auto i) {
+		octree.insert(pixels.at(i));
+	});
 
-	return result;
+	if (!complete) {
+		if (shouldCancel.loadAcquire()) return QList<QColor>();
+		qCDebug(logColorQuantizer) << "Octree quantization ran out of time";
+	}
+
+	return octree.colors(count);
 }
 
-char ColorQuantizerOperation::findBiggestColorRange(const QList<QColor>& rgbValues) {
-	if (rgbValues.isEmpty()) return 'r';
+QList<QColor> ColorQuantizerOperation::quantizeKMeans(
+    const QList<QRgb>& pixels,
+    qint32 count,
+    const QDeadlineTimer& deadline,
+    const QAtomicInteger<bool>& shouldCancel
+) {
+	if (count <= 0 || pixels.isEmpty()) return QList<QColor>();
+
+	// Points are stored in visit order, so a partially converted image is an even sample.
+	auto points = OklabPoints();
+	points.reserve(pixels.size());
 
-	auto rMin = 255;
-	auto gMin = 255;
-	auto bMin = 255;
-	auto rMax = 0;
-	auto gMax = 0;
-	auto bMax = 0;
+	forEachSample(pixels.size(), pixels.size(), deadline, shouldCancel, [&](auto i) {
+		appendOklab(points, pixels.at(i));
+	});
+
+	if (shouldCancel.loadAcquire()) return QList<QColor>();
+
+	auto pointCount = static_cast<qsizetype>(points.size());
+	auto random = QRandomGenerator(KMEANS_SEED);
+	auto centers = seedCenters(points, count, random);
+	auto centerCount = centers.size();
+
+	// Mini-batch k-means: each batch moves the centers towards their assigned points with a
+	// per-center learning rate that decays as more points are assigned.
+	auto assigned = std::vector<quint64>(centerCount);
+	auto distances = std::vector<float>(centerCount);
+
+	for (qint32 iteration = 0; iteration != KMEANS_MAX_ITERATIONS; ++iteration) {
+		if (shouldCancel.loadAcquire()) return QList<QColor>();
+
+		if (deadline.hasExpired()) {
+			qCDebug(logColorQuantizer) << "K-means quantization ran out of time after" << iteration
+			                           << "iterations";
+			break;
+		}
 
-	for (const auto& color: rgbValues) {
-		rMin = qMin(rMin, color.red());
-		gMin = qMin(gMin, color.green());
-		bMin = qMin(bMin, color.blue());
+		auto movement = 0.0f;
 
-		rMax = qMax(rMax, color.red());
-		gMax = qMax(gMax, color.green());
-		bMax = qMax(bMax, color.blue());
+		for (qsizetype j = 0; j != KMEANS_BATCH_SIZE; ++j) {
+			auto i = random.bounded(pointCount);
+			auto l = points.l[i];
+			auto a = points.a[i];
+			auto b = points.b[i];
+
+			auto center = nearestCenter(centers, distances, l, a, b);
+			auto rate = 1.0f / static_cast<float>(++assigned[center]);
+
+			auto dl = (l - centers.l[center]) * rate;
+			auto da = (a - centers.a[center]) * rate;
+			auto db = (b - centers.b[center]) * rate;
+			centers.l[center] += dl;
+			centers.a[center] += da;
+			centers.b[center] += db;
+
+			movement += dl * dl + da * da + db * db;
+		}
+
+		if (movement / KMEANS_BATCH_SIZE < KMEANS_TOLERANCE) break;
 	}
 
-	auto rRange = rMax - rMin;
-	auto gRange = gMax - gMin;
-	auto bRange = bMax - bMin;
+	// Populations are only used for ordering, so a sample is enough for large images.
+	auto population = std::vector<quint64>(centerCount);
+	auto countPoint = [&](qsizetype i) {
+		population[nearestCenter(centers, distances, points.l[i], points.a[i], points.b[i])]++;
+	};
 
-	auto biggestRange = qMax(rRange, qMax(gRange, bRange));
-	if (biggestRange == rRange) {
-		return 'r';
-	} else if (biggestRange == gRange) {
-		return 'g';
-	} else {
-		return 'b';
+	auto counted = forEachSample(
+	    pointCount,
+	    KMEANS_COUNT_SAMPLES,
+	    QDeadlineTimer::Forever,
+	    shouldCancel,
+	    countPoint
+	);
+
+	if (!counted) return QList<QColor>();
+
+	auto order = std::vector<size_t>(centerCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::ranges::stable_sort(order, [&](size_t a, size_t b) {
+		return population[a] > population[b];
+	});
+
+	auto colors = QList<QColor>();
+	for (auto i: order) {
+		if (population[i] == 0) continue;
+		colors.append(oklabToColor(centers.l[i], centers.a[i], centers.b[i]));
 	}
+
+	return colors;
+}
+
+qint32 ColorQuantizerOperation::colorCount(const ColorQuantizerSettings& settings) {
+	if (settings.colorCount > 0) return std::min(settings.colorCount, MAX_COLORS);
+
+	auto levels = settings.depth > 0 ? static_cast<qint32>(std::ceil(settings.depth)) : 0;
+	return 1 << std::min(levels, MAX_COLOR_LEVELS);
 }
 
 void ColorQuantizerOperation::finishRun() {
@@ -167,10 +782,15 @@ void ColorQuantizerOperation::finished() {
 
 void ColorQuantizerOperation::run() {
 	if (!this->shouldCancel) {
-		this->quantizeImage();
+		auto deadline = this->settings.maxTimeMs > 0 ? QDeadlineTimer(this->settings.maxTimeMs)
+		                                             : QDeadlineTimer(QDeadlineTimer::Forever);
+
+		this->quantizeImage(deadline, this->shouldCancel);
 
 		if (this->shouldCancel.loadAcquire()) {
 			qCDebug(logColorQuantizer) << "Color quantization" << this << "cancelled";
+		} else if (this->cacheKey && !this->colors.isEmpty() && !this->timedOut) {
+			ColorQuantizerCache::instance()->store(*this->cacheKey, this->colors);
 		}
 	}
 
@@ -181,7 +801,7 @@ void ColorQuantizerOperation::tryCancel() { this->shouldCancel.storeRelease(true
 
 void ColorQuantizer::componentComplete() {
 	this->componentCompleted = true;
-	if (!this->mSource.isEmpty()) this->quantizeAsync();
+	if (!this->mSource.isEmpty() || this->mSourceItem) this->quantize();
 }
 
 void ColorQuantizer::setSource(const QUrl& source) {
@@ -189,7 +809,42 @@ void ColorQuantizer::setSource(const QUrl& source) {
 		this->mSource = source;
 		emit this->sourceChanged();
 
-		if (this->componentCompleted && !this->mSource.isEmpty()) this->quantizeAsync();
+		if (this->componentCompleted && !this->mSource.isEmpty() && !this->mSourceItem) {
+			this->quantize();
+		}
+	}
+}
+
+void ColorQuantizer::setSourceItem(QQuickItem* sourceItem) {
+	if (sourceItem == this->mSourceItem) return;
+
+	if (this->mSourceItem) QObject::disconnect(this->mSourceItem, nullptr, this, nullptr);
+	this->mSourceItem = sourceItem;
+
+	if (sourceItem) {
+		QObject::connect(
+		    sourceItem,
+		    &QObject::destroyed,
+		    this,
+		    &ColorQuantizer::onSourceItemDestroyed
+		);
+	}
+
+	emit this->sourceItemChanged();
+	if (this->componentCompleted) this->quantize();
+}
+
+void ColorQuantizer::onSourceItemDestroyed() {
+	this->mSourceItem = nullptr;
+	emit this->sourceItemChanged();
+}
+
+void ColorQuantizer::setAlgorithm(ColorQuantizerAlgorithm::Enum algorithm) {
+	if (this->mAlgorithm != algorithm) {
+		this->mAlgorithm = algorithm;
+		emit this->algorithmChanged();
+
+		if (this->componentCompleted) this->quantize();
 	}
 }
 
@@ -198,7 +853,25 @@ void ColorQuantizer::setDepth(qreal depth) {
 		this->mDepth = depth;
 		emit this->depthChanged();
 
-		if (this->componentCompleted) this->quantizeAsync();
+		if (this->componentCompleted) this->quantize();
+	}
+}
+
+void ColorQuantizer::setColorCount(qint32 colorCount) {
+	if (this->mColorCount != colorCount) {
+		this->mColorCount = colorCount;
+		emit this->colorCountChanged();
+
+		if (this->componentCompleted && this->mAlgorithm != ColorQuantizerAlgorithm::MedianCut) {
+			this->quantize();
+		}
+	}
+}
+
+void ColorQuantizer::setMaxTimeMs(qint32 maxTimeMs) {
+	if (this->mMaxTimeMs != maxTimeMs) {
+		this->mMaxTimeMs = maxTimeMs;
+		emit this->maxTimeMsChanged();
 	}
 }
 
@@ -207,22 +880,123 @@ void ColorQuantizer::setRescaleSize(int rescaleSize) {
 		this->mRescaleSize = rescaleSize;
 		emit this->rescaleSizeChanged();
 
-		if (this->componentCompleted) this->quantizeAsync();
+		if (this->componentCompleted) this->quantize();
 	}
 }
 
+void ColorQuantizer::update() {
+	if (this->componentCompleted) this->quantize();
+}
+
 void ColorQuantizer::operationFinished(const QList<QColor>& result) {
 	this->bColors = result;
 	this->liveOperation = nullptr;
 	emit this->colorsChanged();
 }
 
-void ColorQuantizer::quantizeAsync() {
+void ColorQuantizer::quantize() {
+	this->liveGrab.reset();
+
+	if (this->mSourceItem) {
+		this->quantizeItem();
+		return;
+	}
+
+	// Images from QsImageHandles and other providers are requested on the main thread,
+	// as providers are not required to be thread safe.
+	if (this->mSource.scheme() == "image") {
+		auto requestedSize = QSize();
+		if (this->mRescaleSize > 0) {
+			auto size = static_cast<int>(this->mRescaleSize);
+			requestedSize = QSize(size, size);
+		}
+
+		auto image = getEngineImage(qmlEngine(this), this->mSource, requestedSize);
+
+		if (image.isNull()) {
+			qmlWarning(this) << "Could not request image " << this->mSource;
+			this->cancelAsync();
+			this->bColors = QList<QColor>();
+		} else {
+			this->quantizeAsync(std::nullopt, image);
+		}
+
+		return;
+	}
+
+	auto algorithm = MEDIAN_CUT_ALGORITHM;
+	auto colorCount = 0;
+
+	switch (this->mAlgorithm) {
+	case ColorQuantizerAlgorithm::MedianCut: break;
+	case ColorQuantizerAlgorithm::Octree: algorithm = OCTREE_ALGORITHM; break;
+	case ColorQuantizerAlgorithm::KMeans: algorithm = KMEANS_ALGORITHM; break;
+	}
+
+	if (this->mAlgorithm != ColorQuantizerAlgorithm::MedianCut) {
+		colorCount = ColorQuantizerOperation::colorCount(this->settings());
+	}
+
+	auto cacheKey = ColorQuantizerCache::keyFor(
+	    this->mSource,
+	    this->mDepth,
+	    colorCount,
+	    this->mRescaleSize,
+	    algorithm
+	);
+
+	if (cacheKey) {
+		// Cached results are applied immediately, so they are visible on the first frame
+		// when set before the component completes.
+		if (auto colors = ColorQuantizerCache::instance()->lookup(*cacheKey)) {
+			qCDebug(logColorQuantizer) << "Using cached color quantization of" << this->mSource;
+			this->cancelAsync();
+			this->bColors = *colors;
+			return;
+		}
+	}
+
+	this->quantizeAsync(std::move(cacheKey));
+}
+
+void ColorQuantizer::quantizeItem() {
+	this->cancelAsync();
+
+	auto size = this->mSourceItem->size().toSize();
+	if (auto target = rescaledSize(size, this->mRescaleSize); target.isValid()) size = target;
+
+	if (size.isEmpty()) {
+		qmlWarning(this) << "Cannot quantize sourceItem " << this->mSourceItem
+		                 << " as it has no size.";
+		return;
+	}
+
+	// The item is rendered by the scene graph at the target size, so its contents are
+	// never read back at full resolution.
+	auto grab = this->mSourceItem->grabToImage(size);
+	if (!grab) {
+		qmlWarning(this) << "Cannot quantize sourceItem " << this->mSourceItem
+		                 << " as it is not visible in a window.";
+		return;
+	}
+
+	// Grab results are only kept alive by liveGrab, so replaced grabs are never quantized.
+	this->liveGrab = grab;
+	QObject::connect(grab.data(), &QQuickItemGrabResult::ready, this, [this]() {
+		this->quantizeAsync(std::nullopt, this->liveGrab->image());
+	});
+}
+
+void ColorQuantizer::quantizeAsync(std::optional<ColorQuantizerKey> cacheKey, QImage image) {
 	if (this->liveOperation) this->cancelAsync();
 
 	qCDebug(logColorQuantizer) << "Starting color quantization asynchronously";
-	this->liveOperation =
-	    new ColorQuantizerOperation(&this->mSource, this->mDepth, this->mRescaleSize);
+	this->liveOperation = new ColorQuantizerOperation(
+	    this->mSource,
+	    std::move(image),
+	    this->settings(),
+	    std::move(cacheKey)
+	);
 
 	QObject::connect(
 	    this->liveOperation,
@@ -237,9 +1011,19 @@ void ColorQuantizer::quantizeAsync() {
 void ColorQuantizer::cancelAsync() {
 	if (!this->liveOperation) return;
 
+	// The operation stops at its next cancellation check and deletes itself once finished,
+	// so the main thread never waits for it.
 	this->liveOperation->tryCancel();
-	QThreadPool::globalInstance()->waitForDone();
-
 	QObject::disconnect(this->liveOperation, nullptr, this, nullptr);
 	this->liveOperation = nullptr;
 }
+
+ColorQuantizerSettings ColorQuantizer::settings() const {
+	return ColorQuantizerSettings {
+	    .algorithm = this->mAlgorithm,
+	    .depth = this->mDepth,
+	    .colorCount = this->mColorCount,
+	    .rescaleSize = this->mRescaleSize,
+	    .maxTimeMs = this->mMaxTimeMs,
+	};
+}
@@ -1,26 +1,104 @@
 #pragma once
 
+#include <optional>
+
+#include <qatomic.h>
+#include <qcolor.h>
+#include <qdeadlinetimer.h>
+#include <qimage.h>
 #include <qlist.h>
 #include <qobject.h>
 #include <qproperty.h>
 #include <qqmlintegration.h>
 #include <qqmlparserstatus.h>
+#include <qquickitem.h>
+#include <qquickitemgrabresult.h>
+#include <qrgb.h>
 #include <qrunnable.h>
+#include <qsharedpointer.h>
 #include <qtmetamacros.h>
 #include <qtypes.h>
 #include <qurl.h>
 
+#include "colorquantizercache.hpp"
+
+///! Color quantization algorithm.
+/// See @@ColorQuantizer.algorithm.
+namespace ColorQuantizerAlgorithm { // NOLINT
+Q_NAMESPACE;
+QML_ELEMENT;
+
+enum Enum : quint8 {
+	/// Recursively splits the color space in half along its widest channel.
+	/// Produces 2ⁿ colors where n is @@ColorQuantizer.depth.
+	MedianCut = 0,
+	/// Merges similar colors in a tree of RGB space in a single pass over the image.
+	/// Fast regardless of the requested number of colors.
+	Octree = 1,
+	/// Clusters colors in the perceptual Oklab color space with mini-batch k-means.
+	/// Produces the most even palettes, at a higher cost than the other algorithms.
+	KMeans = 2,
+};
+Q_ENUM_NS(Enum);
+
+} // namespace ColorQuantizerAlgorithm
+
+struct ColorQuantizerSettings {
+	ColorQuantizerAlgorithm::Enum algorithm = ColorQuantizerAlgorithm::MedianCut;
+	qreal depth = 0;
+	// Used by algorithms other than median cut. Defaults to 2^depth if not positive.
+	qint32 colorCount = 0;
+	qreal rescaleSize = 0;
+	// Unlimited if not positive.
+	qint32 maxTimeMs = 0;
+};
+
 class ColorQuantizerOperation
     : public QObject
     , public QRunnable {
 	Q_OBJECT;
 
 public:
-	explicit ColorQuantizerOperation(QUrl* source, qreal depth, qreal rescaleSize);
+	// The image is quantized instead of the source file if it is not null.
+	explicit ColorQuantizerOperation(
+	    QUrl source,
+	    QImage image,
+	    ColorQuantizerSettings settings,
+	    std::optional<ColorQuantizerKey> cacheKey
+	);
 
 	void run() override;
 	void tryCancel();
 
+	// Median cut over packed pixels, which are reordered in place.
+	// Returns up to 2^depth colors, ordered from the low to the high end of each split.
+	static QList<QColor> quantize(
+	    QList<QRgb>& pixels,
+	    qint32 depth,
+	    const QAtomicInteger<bool>& shouldCancel = false
+	);
+
+	// Up to count colors from an octree reduced to at most count leaves, most common first.
+	// Pixels inserted before the deadline expires are used.
+	static QList<QColor> quantizeOctree(
+	    const QList<QRgb>& pixels,
+	    qint32 count,
+	    const QDeadlineTimer& deadline = QDeadlineTimer::Forever,
+	    const QAtomicInteger<bool>& shouldCancel = false
+	);
+
+	// Up to count Oklab k-means cluster centers, most common first. Clustering stops early
+	// at the deadline. Seeding is deterministic, so results only vary if the deadline expires.
+	static QList<QColor> quantizeKMeans(
+	    const QList<QRgb>& pixels,
+	    qint32 count,
+	    const QDeadlineTimer& deadline = QDeadlineTimer::Forever,
+	    const QAtomicInteger<bool>& shouldCancel = false
+	);
+
+	// The number of colors produced by algorithms other than median cut.
+	[[nodiscard]] static qint32 colorCount(const ColorQuantizerSettings& settings);
+
 signals:
 	void done(QList<QColor> colors);
 
@@ -28,29 +106,34 @@ private slots:
 	void finished();
 
 private:
-	static char findBiggestColorRange(const QList<QColor>& rgbValues);
+	void quantizeImage(const QDeadlineTimer& deadline, const QAtomicInteger<bool>& shouldCancel);
+	QImage loadImage();
 
-	void quantizeImage(const QAtomicInteger<bool>& shouldCancel = false);
-
-	QList<QColor> quantization(
-	    QList<QColor>& rgbValues,
-	    qreal depth,
-	    const QAtomicInteger<bool>& shouldCancel = false
-	);
+	static QList<QColor>
+	quantization(QRgb* begin, QRgb* end, qint32 depth, const QAtomicInteger<bool>& shouldCancel);
 
 	void finishRun();
 
 	QAtomicInteger<bool> shouldCancel = false;
 	QList<QColor> colors;
-	QUrl* source;
-	qreal maxDepth;
-	qreal rescaleSize;
+	QUrl source;
+	QImage image;
+	ColorQuantizerSettings settings;
+	std::optional<ColorQuantizerKey> cacheKey;
+	bool timedOut = false;
 };
 
 ///! Color Quantization Utility
 /// A color quantization utility used for getting prevalent colors in an image, by
 /// averaging out the image's color data recursively.
 ///
+/// Results for local images are cached until the image file changes, and cached
+/// colors are available as soon as the component is created.
+///
+/// Images are decoded directly at close to @@rescaleSize where the format supports it.
+/// In-memory images can be quantized by passing an `image://` url such as a tray icon,
+/// or by sampling an item like a ScreencopyView with @@sourceItem.
+///
 /// #### Example
 /// ```qml
 /// ColorQuantizer {
@@ -67,17 +150,39 @@ class ColorQuantizer
 	QML_ELEMENT;
 	Q_INTERFACES(QQmlParserStatus);
 	/// Access the colors resulting from the color quantization performed.
-	/// > [!NOTE] The amount of colors returned from the quantization is determined by
-	/// > the property depth, specifically 2ⁿ where n is the depth.
+	/// > [!NOTE] The amount of colors returned from median cut quantization is determined by
+	/// > the property depth, specifically 2ⁿ where n is the depth. Other algorithms return
+	/// > up to @@colorCount colors, ordered from most to least common.
 	Q_PROPERTY(QList<QColor> colors READ default NOTIFY colorsChanged BINDABLE bindableColors);
 
 	/// Path to the image you'd like to run the color quantization on.
 	Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged);
 
+	/// An item to quantize the rendered contents of instead of @@source, such as a
+	/// ScreencopyView. The item is rendered at @@rescaleSize, and is only sampled again
+	/// when a property of the quantizer changes or @@update() is called.
+	// clang-format off
+	Q_PROPERTY(QQuickItem* sourceItem READ sourceItem WRITE setSourceItem NOTIFY sourceItemChanged);
+	// clang-format on
+
+	/// The algorithm used to quantize the image. Defaults to `ColorQuantizerAlgorithm.MedianCut`.
+	// clang-format off
+	Q_PROPERTY(ColorQuantizerAlgorithm::Enum algorithm READ algorithm WRITE setAlgorithm NOTIFY algorithmChanged);
+	// clang-format on
+
 	/// Max depth for the color quantization. Each level of depth represents another
 	/// binary split of the color space
 	Q_PROPERTY(qreal depth READ depth WRITE setDepth NOTIFY depthChanged);
 
+	/// The number of colors to produce with algorithms other than median cut, up to 256.
+	/// Defaults to 2ⁿ where n is @@depth when 0.
+	Q_PROPERTY(qint32 colorCount READ colorCount WRITE setColorCount NOTIFY colorCountChanged);
+
+	/// The time in milliseconds octree and k-means quantization may take, including decoding
+	/// the image. Once it runs out, the colors found so far are used. Results limited by time
+	/// are not cached. Defaults to 0, which sets no limit.
+	Q_PROPERTY(qint32 maxTimeMs READ maxTimeMs WRITE setMaxTimeMs NOTIFY maxTimeMsChanged);
+
 	/// The size to rescale the image to, when rescaleSize is 0 then no scaling will be done.
 	/// > [!NOTE] Results from color quantization doesn't suffer much when rescaling, it's
 	/// > reccommended to rescale, otherwise the quantization process will take much longer.
@@ -94,30 +199,60 @@ public:
 	[[nodiscard]] QUrl source() const { return this->mSource; }
 	void setSource(const QUrl& source);
 
+	[[nodiscard]] QQuickItem* sourceItem() const { return this->mSourceItem; }
+	void setSourceItem(QQuickItem* sourceItem);
+
+	[[nodiscard]] ColorQuantizerAlgorithm::Enum algorithm() const { return this->mAlgorithm; }
+	void setAlgorithm(ColorQuantizerAlgorithm::Enum algorithm);
+
 	[[nodiscard]] qreal depth() const { return this->mDepth; }
 	void setDepth(qreal depth);
 
+	[[nodiscard]] qint32 colorCount() const { return this->mColorCount; }
+	void setColorCount(qint32 colorCount);
+
+	[[nodiscard]] qint32 maxTimeMs() const { return this->mMaxTimeMs; }
+	void setMaxTimeMs(qint32 maxTimeMs);
+
 	[[nodiscard]] qreal rescaleSize() const { return this->mRescaleSize; }
 	void setRescaleSize(int rescaleSize);
 
+	/// Quantize the source again, such as after a new frame was captured by @@sourceItem.
+	Q_INVOKABLE void update();
+
 signals:
 	void colorsChanged();
 	void sourceChanged();
+	void sourceItemChanged();
+	void algorithmChanged();
 	void depthChanged();
+	void colorCountChanged();
 	void rescaleSizeChanged();
+	void maxTimeMsChanged();
 
 public slots:
 	void operationFinished(const QList<QColor>& result);
 
+private slots:
+	void onSourceItemDestroyed();
+
 private:
-	void quantizeAsync();
+	void quantize();
+	void quantizeItem();
+	void quantizeAsync(std::optional<ColorQuantizerKey> cacheKey, QImage image = QImage());
 	void cancelAsync();
+	[[nodiscard]] ColorQuantizerSettings settings() const;
 
 	bool componentCompleted = false;
 	ColorQuantizerOperation* liveOperation = nullptr;
+	QSharedPointer<QQuickItemGrabResult> liveGrab;
 	QUrl mSource;
+	QQuickItem* mSourceItem = nullptr;
+	ColorQuantizerAlgorithm::Enum mAlgorithm = ColorQuantizerAlgorithm::MedianCut;
 	qreal mDepth = 0;
+	qint32 mColorCount = 0;
 	qreal mRescaleSize = 0;
+	qint32 mMaxTimeMs = 0;
 
 	Q_OBJECT_BINDABLE_PROPERTY(
 	    ColorQuantizer,
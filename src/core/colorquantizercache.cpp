@@ -0,0 +1,178 @@
+#include "colorquantizercache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <utility>
+
+#include <qcolor.h>
+#include <qdatastream.h>
+#include <qdatetime.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qlist.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qmutex.h>
+#include <qrgb.h>
+#include <qsavefile.h>
+#include <qstring.h>
+#include <qtypes.h>
+#include <qurl.h>
+
+#include "logcat.hpp"
+#include "paths.hpp"
+
+namespace {
+QS_LOGGING_CATEGORY(logColorQuantizerCache, "quickshell.colorquantizer.cache", QtWarningMsg);
+
+constexpr quint32 CACHE_MAGIC = 0x51534351; // QSCQ
+// Must be incremented whenever the serialized layout changes.
+constexpr quint32 CACHE_VERSION = 2;
+// Entries are a few dozen bytes, so this keeps the file small enough to rewrite on each store.
+constexpr qsizetype MAX_ENTRIES = 256;
+
+} // namespace
+
+ColorQuantizerCache::ColorQuantizerCache(QString path): path(std::move(path)) {}
+
+ColorQuantizerCache* ColorQuantizerCache::instance() {
+	static auto* instance = new ColorQuantizerCache( // NOLINT
+	    QsPaths::instance()->shellCacheDir().filePath("colorquantizer.cache")
+	);
+
+	return instance;
+}
+
+std::optional<ColorQuantizerKey> ColorQuantizerCache::keyFor(
+    const QUrl& source,
+    qreal depth,
+    qint32 colorCount,
+    qreal rescaleSize,
+    quint32 algorithm
+) {
+	if (!source.isLocalFile()) return std::nullopt;
+
+	auto path = source.toLocalFile();
+	auto info = QFileInfo(path);
+	if (!info.isFile()) return std::nullopt;
+
+	return ColorQuantizerKey {
+	    .path = path,
+	    .mtime = info.lastModified().toMSecsSinceEpoch(),
+	    .size = info.size(),
+	    .depth = depth > 0 ? static_cast<qint32>(std::ceil(depth)) : 0,
+	    .colorCount = std::max(colorCount, 0),
+	    .rescaleSize = rescaleSize > 0 ? static_cast<qint32>(rescaleSize) : 0,
+	    .algorithm = algorithm,
+	};
+}
+
+std::optional<QList<QColor>> ColorQuantizerCache::lookup(const ColorQuantizerKey& key) {
+	auto locker = QMutexLocker(&this->mutex);
+	this->loadEntries();
+
+	auto it = this->entries.find(key);
+	if (it == this->entries.end()) return std::nullopt;
+
+	it->lastUsed = ++this->useCounter;
+
+	auto colors = QList<QColor>();
+	colors.reserve(it->colors.size());
+	for (auto rgb: it->colors) colors.append(QColor(rgb));
+
+	return colors;
+}
+
+void ColorQuantizerCache::store(const ColorQuantizerKey& key, const QList<QColor>& colors) {
+	auto writeLocker = QMutexLocker(&this->writeMutex);
+	auto snapshot = QHash<ColorQuantizerKey, Entry>();
+
+	{
+		auto locker = QMutexLocker(&this->mutex);
+		this->loadEntries();
+
+		auto entry = Entry {.lastUsed = ++this->useCounter};
+		entry.colors.reserve(colors.size());
+		for (const auto& color: colors) entry.colors.append(color.rgb());
+
+		this->entries.insert(key, std::move(entry));
+		if (this->entries.size() > MAX_ENTRIES) this->evict();
+
+		snapshot = this->entries;
+	}
+
+	auto file = QSaveFile(this->path);
+	if (!file.open(QFile::WriteOnly)) {
+		qCWarning(logColorQuantizerCache) << "Could not open" << this->path << "for writing";
+		return;
+	}
+
+	auto stream = QDataStream(&file);
+	stream.setVersion(QDataStream::Qt_6_0);
+	stream << CACHE_MAGIC << CACHE_VERSION << static_cast<qint32>(snapshot.size());
+
+	for (auto it = snapshot.constBegin(); it != snapshot.constEnd(); ++it) {
+		const auto& entryKey = it.key();
+		stream << entryKey.path << entryKey.mtime << entryKey.size << entryKey.depth
+		       << entryKey.colorCount << entryKey.rescaleSize << entryKey.algorithm << it->lastUsed
+		       << it->colors;
+	}
+
+	if (!file.commit()) {
+		qCWarning(logColorQuantizerCache) << "Could not write color quantizer cache" << this->path;
+	}
+}
+
+void ColorQuantizerCache::loadEntries() {
+	if (this->entriesLoaded) return;
+	this->entriesLoaded = true;
+
+	auto file = QFile(this->path);
+	if (!file.open(QFile::ReadOnly)) return;
+
+	auto stream = QDataStream(&file);
+	stream.setVersion(QDataStream::Qt_6_0);
+
+	quint32 magic = 0;
+	quint32 version = 0;
+	qint32 count = 0;
+	stream >> magic >> version >> count;
+
+	if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+		qCDebug(logColorQuantizerCache) << "Ignoring color quantizer cache with unknown version"
+		                                << version;
+		return;
+	}
+
+	auto entries = QHash<ColorQuantizerKey, Entry>();
+	entries.reserve(std::clamp(count, 0, static_cast<qint32>(MAX_ENTRIES)));
+
+	for (qint32 i = 0; i != count && stream.status() == QDataStream::Ok; i++) {
+		auto key = ColorQuantizerKey();
+		auto entry = Entry();
+		stream >> key.path >> key.mtime >> key.size >> key.depth >> key.colorCount >> key.rescaleSize
+		    >> key.algorithm >> entry.lastUsed >> entry.colors;
+
+		this->useCounter = std::max(this->useCounter, entry.lastUsed);
+		entries.insert(std::move(key), std::move(entry));
+	}
+
+	if (stream.status() != QDataStream::Ok) {
+		qCWarning(logColorQuantizerCache) << "Color quantizer cache" << this->path << "is corrupt";
+		return;
+	}
+
+	this->entries = std::move(entries);
+	qCDebug(logColorQuantizerCache) << "Loaded" << this->entries.size() << "cached results from"
+	                                << this->path;
+}
+
+void ColorQuantizerCache::evict() {
+	auto keys = this->entries.keys();
+	std::ranges::sort(keys, [this](const ColorQuantizerKey& a, const ColorQuantizerKey& b) {
+		return this->entries.value(a).lastUsed < this->entries.value(b).lastUsed;
+	});
+
+	auto excess = this->entries.size() - MAX_ENTRIES;
+	for (qsizetype i = 0; i != excess; i++) this->entries.remove(keys.at(i));
+}
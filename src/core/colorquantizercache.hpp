@@ -0,0 +1,88 @@
+#pragma once
+
+#include <optional>
+
+#include <qcolor.h>
+#include <qhash.h>
+#include <qhashfunctions.h>
+#include <qlist.h>
+#include <qmutex.h>
+#include <qrgb.h>
+#include <qstring.h>
+#include <qtypes.h>
+#include <qurl.h>
+
+struct ColorQuantizerKey {
+	QString path;
+	qint64 mtime = 0;
+	qint64 size = 0;
+	qint32 depth = 0;
+	qint32 colorCount = 0;
+	qint32 rescaleSize = 0;
+	// Identifies the quantization algorithm, including revisions that change its output.
+	quint32 algorithm = 0;
+
+	[[nodiscard]] bool operator==(const ColorQuantizerKey& other) const = default;
+};
+
+inline size_t qHash(const ColorQuantizerKey& key, size_t seed = 0) noexcept {
+	return qHashMulti(
+	    seed,
+	    key.path,
+	    key.mtime,
+	    key.size,
+	    key.depth,
+	    key.colorCount,
+	    key.rescaleSize,
+	    key.algorithm
+	);
+}
+
+// Quantization results shared between all ColorQuantizers, and persisted to a single file
+// so the same image is not quantized again after a reload or restart.
+//
+// Entries are keyed by the source file's path, mtime and size, so replacing the image
+// misses the cache. The least recently used entries are dropped past a fixed entry count.
+class ColorQuantizerCache {
+public:
+	explicit ColorQuantizerCache(QString path);
+
+	// The shell's result cache, stored in the shell cache directory.
+	static ColorQuantizerCache* instance();
+
+	// The key for a local image file, or nothing if the source is not a readable local file.
+	// Depth, color count and rescale size are normalized the same way the quantizer
+	// applies them.
+	static std::optional<ColorQuantizerKey> keyFor(
+	    const QUrl& source,
+	    qreal depth,
+	    qint32 colorCount,
+	    qreal rescaleSize,
+	    quint32 algorithm
+	);
+
+	// Thread safe. The persisted results are read on first use.
+	std::optional<QList<QColor>> lookup(const ColorQuantizerKey& key);
+	// Thread safe. Writes the cache file on the calling thread.
+	void store(const ColorQuantizerKey& key, const QList<QColor>& colors);
+
+private:
+	struct Entry {
+		QList<QRgb> colors;
+		quint64 lastUsed = 0;
+	};
+
+	// Requires the mutex to be held.
+	void loadEntries();
+	void evict();
+
+	QString path;
+
+	QMutex mutex;
+	bool entriesLoaded = false;
+	QHash<ColorQuantizerKey, Entry> entries;
+	quint64 useCounter = 0;
+
+	// Serializes writers so an older snapshot can never replace a newer one.
+	QMutex writeMutex;
+};
@@ -3,6 +3,7 @@
 #include <utility>
 
 #include <qcontainerfwd.h>
+#include <qdatetime.h>
 #include <qdebug.h>
 #include <qdir.h>
 #include <qfile.h>
@@ -15,15 +16,20 @@
 #include <qpair.h>
 #include <qproperty.h>
 #include <qscopeguard.h>
+#include <qset.h>
 #include <qtenvironmentvariables.h>
 #include <qthreadpool.h>
 #include <qtmetamacros.h>
 #include <ranges>
 
 #include "../io/processcore.hpp"
+#include "desktopentrycache.hpp"
+#include "desktopentrymime.hpp"
 #include "desktopentrymonitor.hpp"
+#include "desktopentrysearch.hpp"
 #include "logcat.hpp"
 #include "model.hpp"
+#include "paths.hpp"
 #include "qmlglobal.hpp"
 
 namespace {
@@ -77,9 +83,7 @@ struct Locale {
 		static Locale* locale = nullptr; // NOLINT
 
 		if (locale == nullptr) {
-			auto lstr = qEnvironmentVariable("LC_MESSAGES");
-			if (lstr.isEmpty()) lstr = qEnvironmentVariable("LANG");
-			locale = new Locale(lstr);
+			locale = new Locale(DesktopEntry::localeName());
 		}
 
 		return *locale;
@@ -99,6 +103,16 @@ QDebug operator<<(QDebug debug, const Locale& locale) {
 	return debug;
 }
 
+const QString& DesktopEntry::localeName() {
+	static const auto name = []() {
+		auto lstr = qEnvironmentVariable("LC_MESSAGES");
+		if (lstr.isEmpty()) lstr = qEnvironmentVariable("LANG");
+		return lstr;
+	}();
+
+	return name;
+}
+
 ParsedDesktopEntryData DesktopEntry::parseText(const QString& id, const QString& text) {
 	ParsedDesktopEntryData data;
 	data.id = id;
@@ -132,6 +146,7 @@ ParsedDesktopEntryData DesktopEntry::parseText(const QString& id, const QString&
 				else if (key == "Terminal") data.terminal = value == "true";
 				else if (key == "Categories") data.categories = value.split(u';', Qt::SkipEmptyParts);
 				else if (key == "Keywords") data.keywords = value.split(u';', Qt::SkipEmptyParts);
+				else if (key == "MimeType") data.mimeTypes = value.split(u';', Qt::SkipEmptyParts);
 				else if (key == "Actions") actionOrder = value.split(u';', Qt::SkipEmptyParts);
 			}
 		} else if (groupName.startsWith("Desktop Action ")) {
@@ -346,40 +361,226 @@ void DesktopAction::execute() const {
 	DesktopEntry::doExec(this->bCommand.value(), this->entry->bWorkingDirectory.value());
 }
 
-DesktopEntryScanner::DesktopEntryScanner(DesktopEntryManager* manager): manager(manager) {
+const DesktopEntryFile* DesktopEntryScanState::effectiveFile(const QString& id) const {
+	auto candidates = QList<const DesktopEntryFile*>();
+
+	for (const auto& path: this->pathsById.value(id)) {
+		if (auto it = this->files.constFind(path); it != this->files.constEnd()) {
+			candidates.append(&it.value());
+		}
+	}
+
+	std::ranges::sort(candidates, [](const DesktopEntryFile* a, const DesktopEntryFile* b) {
+		if (a->priority != b->priority) return a->priority < b->priority;
+		return a->path > b->path;
+	});
+
+	for (const auto* file: candidates) {
+		if (file->data.hidden) return nullptr;
+		if (!file->data.name.isEmpty()) return file;
+	}
+
+	return nullptr;
+}
+
+QList<ParsedDesktopEntryData> DesktopEntryScanState::effectiveEntries() const {
+	auto entries = QList<ParsedDesktopEntryData>();
+	entries.reserve(this->pathsById.size());
+
+	for (auto it = this->pathsById.constBegin(); it != this->pathsById.constEnd(); ++it) {
+		if (const auto* file = this->effectiveFile(it.key())) entries.append(file->data);
+	}
+
+	return entries;
+}
+
+DesktopEntryScanner::DesktopEntryScanner(
+    DesktopEntryManager* manager,
+    DesktopEntryScanState state,
+    QStringList changedDirs
+)
+    : manager(manager)
+    , state(std::move(state))
+    , changedDirs(std::move(changedDirs)) {
 	this->setAutoDelete(true);
 }
 
 void DesktopEntryScanner::run() {
+	auto result = this->scan();
+
+	QMetaObject::invokeMethod(
+	    this->manager,
+	    [manager = this->manager, result = std::move(result)]() {
+		    manager->onScanCompleted(result);
+	    },
+	    Qt::QueuedConnection
+	);
+}
+
+DesktopEntryScanResult DesktopEntryScanner::scan() {
 	const auto& desktopPaths = DesktopEntryManager::desktopPaths();
-	auto scanResults = QList<ParsedDesktopEntryData>();
 
-	for (const auto& path: desktopPaths | std::views::reverse) {
-		auto file = QFileInfo(path);
-		if (!file.isDir()) continue;
+	struct ScanTarget {
+		QString path;
+		QString idPrefix;
+		qint32 priority;
+	};
+
+	// Map changed directories to the parts of the desktop paths they affect.
+	auto targets = QList<ScanTarget>();
+
+	for (const auto& changed: this->changedDirs) {
+		auto dir = QDir::cleanPath(changed);
+		auto dirPrefix = dir.endsWith('/') ? dir : dir + '/';
+
+		for (qint32 i = 0; i != desktopPaths.length(); i++) {
+			auto root = QDir::cleanPath(desktopPaths.at(i));
 
-		this->scanDirectory(QDir(path), QString(), scanResults);
+			if (dir == root || root.startsWith(dirPrefix)) {
+				targets.append({.path = root, .idPrefix = QString(), .priority = i});
+			} else if (dir.startsWith(root + '/')) {
+				auto idPrefix = dir.sliced(root.length() + 1).replace('/', '-');
+				targets.append({.path = dir, .idPrefix = idPrefix, .priority = i});
+			}
+		}
 	}
 
-	QMetaObject::invokeMethod(
-	    this->manager,
-	    "onScanCompleted",
-	    Qt::QueuedConnection,
-	    Q_ARG(QList<ParsedDesktopEntryData>, scanResults)
-	);
+	// Drop targets covered by another target.
+	std::ranges::sort(targets, [](const ScanTarget& a, const ScanTarget& b) {
+		if (a.priority != b.priority) return a.priority < b.priority;
+		return a.path < b.path;
+	});
+
+	auto last = std::ranges::unique(targets, [](const ScanTarget& a, const ScanTarget& b) {
+		return a.priority == b.priority && (b.path == a.path || b.path.startsWith(a.path + '/'));
+	});
+
+	targets.erase(last.begin(), last.end());
+
+	auto oldState = this->state;
+
+	for (const auto& target: targets) {
+		qCDebug(logDesktopEntry) << "Scanning" << target.path;
+
+		if (QFileInfo(target.path).isDir()) {
+			this->scanDirectory(QDir(target.path), target.idPrefix, target.priority);
+		} else if (target.idPrefix.isEmpty()) {
+			// Recorded so the cache is invalidated if the desktop path is created.
+			if (this->state.dirs.value(target.path) != -1) {
+				this->state.dirs.insert(target.path, -1);
+				this->stateChanged = true;
+			}
+		}
+
+		// Drop files and directories which no longer exist.
+		auto pathPrefix = target.path + '/';
+		auto& files = this->state.files;
+
+		for (auto it = files.begin(); it != files.end();) {
+			if (it->priority == target.priority && it.key().startsWith(pathPrefix)
+			    && !this->seenPaths.contains(it.key()))
+			{
+				qCDebug(logDesktopEntry) << "Desktop entry file" << it.key() << "was removed";
+				this->removeFile(it);
+			} else {
+				++it;
+			}
+		}
+
+		auto& dirs = this->state.dirs;
+
+		for (auto it = dirs.begin(); it != dirs.end();) {
+			if ((it.key() == target.path || it.key().startsWith(pathPrefix))
+			    && !this->seenDirs.contains(it.key()) && it.value() != -1)
+			{
+				it = dirs.erase(it);
+				this->stateChanged = true;
+			} else {
+				++it;
+			}
+		}
+	}
+
+	// Only report entries whose providing file changed.
+	auto result = DesktopEntryScanResult();
+
+	for (const auto& id: this->changedIds) {
+		const auto* oldFile = oldState.effectiveFile(id);
+		const auto* newFile = this->state.effectiveFile(id);
+
+		if (!newFile) {
+			if (oldFile) result.removed.append(id);
+		} else if (!oldFile || oldFile->path != newFile->path || oldFile->mtime != newFile->mtime
+		           || oldFile->size != newFile->size)
+		{
+			result.updated.append(newFile->data);
+		}
+	}
+
+	qCDebug(logDesktopEntry) << "Scan of" << targets.length() << "directories updated"
+	                         << result.updated.length() << "and removed" << result.removed.length()
+	                         << "entries";
+
+	auto mimeAppsChanged = false;
+	for (const auto& path: DesktopEntryMimeIndex::mimeAppsPaths()) {
+		auto info = QFileInfo(path);
+		auto mtime = info.isFile() ? info.lastModified().toMSecsSinceEpoch() : -1;
+
+		if (this->state.mimeApps.value(path, -2) != mtime) {
+			this->state.mimeApps.insert(path, mtime);
+			mimeAppsChanged = true;
+		}
+	}
+
+	auto entriesChanged = !result.updated.isEmpty() || !result.removed.isEmpty();
+
+	if (this->forceIndexes || entriesChanged || mimeAppsChanged) {
+		auto entries = this->state.effectiveEntries();
+
+		if (this->forceIndexes || entriesChanged) {
+			result.searchIndex = DesktopEntrySearchIndex::build(entries);
+		}
+
+		result.mimeIndex = DesktopEntryMimeIndex::build(entries);
+	}
+
+	if (!this->cachePath.isEmpty() && (this->forceCacheWrite || this->stateChanged)) {
+		DesktopEntryCache::save(this->cachePath, this->state);
+	}
+
+	result.state = std::move(this->state);
+	return result;
+}
+
+void DesktopEntryScanner::removeFile(QHash<QString, DesktopEntryFile>::iterator& it) {
+	this->changedIds.insert(it->id);
+	this->stateChanged = true;
+
+	auto& paths = this->state.pathsById[it->id];
+	paths.removeOne(it.key());
+	if (paths.isEmpty()) this->state.pathsById.remove(it->id);
+
+	it = this->state.files.erase(it);
 }
 
-void DesktopEntryScanner::scanDirectory(
-    const QDir& dir,
-    const QString& idPrefix,
-    QList<ParsedDesktopEntryData>& entries
-) {
+void DesktopEntryScanner::scanDirectory(const QDir& dir, const QString& idPrefix, qint32 priority) {
+	auto dirPath = dir.path();
+	auto dirMtime = DesktopEntryCache::dirMtime(dirPath);
+	this->seenDirs.insert(dirPath);
+
+	if (auto it = this->state.dirs.constFind(dirPath);
+	    it == this->state.dirs.constEnd() || it.value() != dirMtime)
+	{
+		this->state.dirs.insert(dirPath, dirMtime);
+		this->stateChanged = true;
+	}
+
 	auto dirEntries = dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
 
 	for (auto& entry: dirEntries) {
 		if (entry.isDir()) {
 			auto subdirPrefix = idPrefix.isEmpty() ? entry.fileName() : idPrefix + '-' + entry.fileName();
-			this->scanDirectory(QDir(entry.absoluteFilePath()), subdirPrefix, entries);
+			this->scanDirectory(QDir(entry.filePath()), subdirPrefix, priority);
 		} else if (entry.isFile()) {
 			auto path = entry.filePath();
 			if (!path.endsWith(".desktop")) {
@@ -387,23 +588,56 @@ void DesktopEntryScanner::scanDirectory(
 				continue;
 			}
 
+			auto basename = QFileInfo(entry.fileName()).completeBaseName();
+			auto id = idPrefix.isEmpty() ? basename : idPrefix + '-' + basename;
+			auto mtime = entry.lastModified().toMSecsSinceEpoch();
+			auto size = entry.size();
+
+			if (auto it = this->state.files.constFind(path); it != this->state.files.constEnd()
+			    && it->id == id && it->priority == priority && it->mtime == mtime && it->size == size)
+			{
+				this->seenPaths.insert(path);
+				continue;
+			}
+
 			auto file = QFile(path);
 			if (!file.open(QFile::ReadOnly)) {
 				qCDebug(logDesktopEntry) << "Could not open file" << path;
 				continue;
 			}
 
-			auto basename = QFileInfo(entry.fileName()).completeBaseName();
-			auto id = idPrefix.isEmpty() ? basename : idPrefix + '-' + basename;
+			qCDebug(logDesktopEntry) << "Parsing desktop entry file" << path;
 			auto content = QString::fromUtf8(file.readAll());
 
-			auto data = DesktopEntry::parseText(id, content);
-			entries.append(std::move(data));
+			if (auto it = this->state.files.find(path); it != this->state.files.end() && it->id != id) {
+				this->removeFile(it);
+			}
+
+			auto& paths = this->state.pathsById[id];
+			if (!paths.contains(path)) paths.append(path);
+
+			this->state.files.insert(
+			    path,
+			    DesktopEntryFile {
+			        .path = path,
+			        .id = id,
+			        .priority = priority,
+			        .mtime = mtime,
+			        .size = size,
+			        .data = DesktopEntry::parseText(id, content),
+			    }
+			);
+
+			this->seenPaths.insert(path);
+			this->changedIds.insert(id);
+			this->stateChanged = true;
 		}
 	}
 }
 
-DesktopEntryManager::DesktopEntryManager(): monitor(new DesktopEntryMonitor(this)) {
+DesktopEntryManager::DesktopEntryManager()
+    : monitor(new DesktopEntryMonitor(this))
+    , cachePath(QsPaths::instance()->shellCacheDir().filePath("desktopentries.cache")) {
 	QObject::connect(
 	    this->monitor,
 	    &DesktopEntryMonitor::desktopEntriesChanged,
@@ -411,22 +645,38 @@ DesktopEntryManager::DesktopEntryManager(): monitor(new DesktopEntryMonitor(this
 	    &DesktopEntryManager::handleFileChanges
 	);
 
-	DesktopEntryScanner(this).run();
+	this->scanInProgress = true;
+
+	if (this->loadCache()) {
+		// Entries are usable immediately. Files modified in place do not change their
+		// directory's mtime, so every file is still checked in the background, which
+		// also builds the search and MIME indexes.
+		auto entries = this->scanState.effectiveEntries();
+		this->onScanCompleted({.state = this->scanState, .updated = entries});
+		this->scanDesktopEntries();
+	} else {
+		auto scanner =
+		    DesktopEntryScanner(this, DesktopEntryScanState(), DesktopEntryManager::desktopPaths());
+		scanner.cachePath = this->cachePath;
+		scanner.forceCacheWrite = true;
+		scanner.forceIndexes = true;
+		this->onScanCompleted(scanner.scan());
+	}
 }
 
-void DesktopEntryManager::scanDesktopEntries() {
-	qCDebug(logDesktopEntry) << "Starting desktop entry scan";
+bool DesktopEntryManager::loadCache() {
+	auto state = DesktopEntryScanState();
+	if (!DesktopEntryCache::load(this->cachePath, state)) return false;
 
-	if (this->scanInProgress) {
-		qCDebug(logDesktopEntry) << "Scan already in progress, queuing another scan";
-		this->scanQueued = true;
-		return;
-	}
+	qCDebug(logDesktopEntry) << "Loaded" << state.files.size() << "desktop entry files from cache";
+	this->scanState = std::move(state);
+	this->cacheValid = true;
+	return true;
+}
 
-	this->scanInProgress = true;
-	this->scanQueued = false;
-	auto* scanner = new DesktopEntryScanner(this);
-	QThreadPool::globalInstance()->start(scanner);
+void DesktopEntryManager::scanDesktopEntries() {
+	qCDebug(logDesktopEntry) << "Starting full desktop entry scan";
+	this->handleFileChanges(DesktopEntryManager::desktopPaths());
 }
 
 DesktopEntryManager* DesktopEntryManager::instance() {
@@ -446,37 +696,58 @@ DesktopEntry* DesktopEntryManager::byId(const QString& id) {
 
 DesktopEntry* DesktopEntryManager::heuristicLookup(const QString& name) {
 	if (auto* entry = this->byId(name)) return entry;
+	if (auto* entry = this->startupClasses.value(name)) return entry;
+	return this->lowercaseStartupClasses.value(name.toLower());
+}
 
-	auto list = this->desktopEntries.values();
+ObjectModel<DesktopEntry>* DesktopEntryManager::applications() { return &this->mApplications; }
 
-	auto iter = std::ranges::find_if(list, [&](DesktopEntry* entry) {
-		return name == entry->bStartupClass.value();
-	});
+const DesktopEntryMimeIndex* DesktopEntryManager::mimeIndex() {
+	// Only built here if used before the first background scan completes.
+	if (!this->mMimeIndex) {
+		this->mMimeIndex = DesktopEntryMimeIndex::build(this->scanState.effectiveEntries());
+	}
 
-	if (iter != list.end()) return *iter;
+	return this->mMimeIndex.data();
+}
 
-	iter = std::ranges::find_if(list, [&](DesktopEntry* entry) {
-		return name.toLower() == entry->bStartupClass.value().toLower();
-	});
+DesktopEntry* DesktopEntryManager::defaultFor(const QString& mimeType) {
+	return this->desktopEntries.value(this->mimeIndex()->defaultFor(mimeType));
+}
 
-	if (iter != list.end()) return *iter;
-	return nullptr;
+QVector<DesktopEntry*> DesktopEntryManager::handlersFor(const QString& mimeType) {
+	auto handlers = QVector<DesktopEntry*>();
+
+	for (const auto& id: this->mimeIndex()->handlersFor(mimeType)) {
+		if (auto* entry = this->desktopEntries.value(id)) handlers.append(entry);
+	}
+
+	return handlers;
 }
 
-ObjectModel<DesktopEntry>* DesktopEntryManager::applications() { return &this->mApplications; }
+void DesktopEntryManager::handleFileChanges(const QStringList& changedDirs) {
+	qCDebug(logDesktopEntry) << "Directory changes detected in" << changedDirs;
 
-void DesktopEntryManager::handleFileChanges() {
-	qCDebug(logDesktopEntry) << "Directory change detected, performing full rescan";
+	for (const auto& dir: changedDirs) this->pendingDirs.insert(dir);
 
 	if (this->scanInProgress) {
-		qCDebug(logDesktopEntry) << "Scan already in progress, queuing another scan";
-		this->scanQueued = true;
+		qCDebug(logDesktopEntry) << "Scan already in progress, queuing changed directories";
 		return;
 	}
 
+	this->startScan();
+}
+
+void DesktopEntryManager::startScan() {
 	this->scanInProgress = true;
-	this->scanQueued = false;
-	auto* scanner = new DesktopEntryScanner(this);
+
+	auto changedDirs = QStringList(this->pendingDirs.begin(), this->pendingDirs.end());
+	this->pendingDirs.clear();
+
+	auto* scanner = new DesktopEntryScanner(this, this->scanState, changedDirs);
+	scanner->cachePath = this->cachePath;
+	scanner->forceCacheWrite = !this->cacheValid;
+	scanner->forceIndexes = !this->mSearchIndex;
 	QThreadPool::globalInstance()->start(scanner);
 }
 
@@ -502,90 +773,101 @@ const QStringList& DesktopEntryManager::desktopPaths() {
 	return paths;
 }
 
-void DesktopEntryManager::onScanCompleted(const QList<ParsedDesktopEntryData>& scanResults) {
+void DesktopEntryManager::onScanCompleted(DesktopEntryScanResult result) {
 	auto guard = qScopeGuard([this] {
 		this->scanInProgress = false;
-		if (this->scanQueued) {
-			this->scanQueued = false;
-			this->scanDesktopEntries();
-		}
+		if (!this->pendingDirs.isEmpty()) this->startScan();
 	});
 
-	auto oldEntries = this->desktopEntries;
-	auto newEntries = QHash<QString, DesktopEntry*>();
-	auto newLowercaseEntries = QHash<QString, DesktopEntry*>();
+	this->scanState = std::move(result.state);
+	this->cacheValid = true;
 
-	for (const auto& data: scanResults) {
-		auto lowerId = data.id.toLower();
+	auto indexChanged = !result.searchIndex.isNull();
+	if (indexChanged) this->mSearchIndex = std::move(result.searchIndex);
 
-		if (data.hidden) {
-			if (auto* victim = newEntries.take(data.id)) victim->deleteLater();
-			newLowercaseEntries.remove(lowerId);
+	auto mimeChanged = !result.mimeIndex.isNull();
+	if (mimeChanged) this->mMimeIndex = std::move(result.mimeIndex);
 
-			if (auto it = oldEntries.find(data.id); it != oldEntries.end()) {
-				it.value()->deleteLater();
-				oldEntries.erase(it);
-			}
+	if (result.updated.isEmpty() && result.removed.isEmpty()) {
+		if (indexChanged) emit this->searchIndexChanged();
+		if (mimeChanged) emit this->mimeAssociationsChanged();
+		return;
+	}
 
-			qCDebug(logDesktopEntry) << "Masking hidden desktop entry" << data.id;
-			continue;
+	auto removedEntries = QSet<DesktopEntry*>();
+	for (const auto& id: result.removed) {
+		if (auto* entry = this->desktopEntries.take(id)) {
+			qCDebug(logDesktopEntry) << "Removing desktop entry" << id;
+			removedEntries.insert(entry);
 		}
+	}
 
-		DesktopEntry* dentry = nullptr;
+	auto updatedEntries = QList<DesktopEntry*>();
+	for (const auto& data: result.updated) {
+		auto* entry = this->desktopEntries.value(data.id);
 
-		if (auto it = oldEntries.find(data.id); it != oldEntries.end()) {
-			dentry = it.value();
-			oldEntries.erase(it);
-			dentry->updateState(data);
+		if (entry) {
+			qCDebug(logDesktopEntry) << "Updating desktop entry" << data.id;
 		} else {
-			dentry = new DesktopEntry(data.id, this);
-			dentry->updateState(data);
+			qCDebug(logDesktopEntry) << "Found desktop entry" << data.id;
+			entry = new DesktopEntry(data.id, this);
+			this->desktopEntries.insert(data.id, entry);
 		}
 
-		if (!dentry->isValid()) {
-			qCDebug(logDesktopEntry) << "Skipping desktop entry" << data.id;
-			if (!oldEntries.contains(data.id)) {
-				dentry->deleteLater();
-			}
-			continue;
-		}
+		entry->updateState(data);
+		updatedEntries.append(entry);
+	}
 
-		qCDebug(logDesktopEntry) << "Found desktop entry" << data.id;
+	this->rebuildLookups();
 
-		auto conflictingId = newEntries.contains(data.id);
+	auto applications = this->mApplications.valueList();
+	applications.removeIf([&](DesktopEntry* entry) {
+		return entry->bNoDisplay || removedEntries.contains(entry);
+	});
 
-		if (conflictingId) {
-			qCDebug(logDesktopEntry) << "Replacing old entry for" << data.id;
-			if (auto* victim = newEntries.take(data.id)) victim->deleteLater();
-			newLowercaseEntries.remove(lowerId);
-		}
+	auto listed = QSet<DesktopEntry*>(applications.begin(), applications.end());
+	for (auto* entry: updatedEntries) {
+		if (!entry->bNoDisplay && !listed.contains(entry)) applications.append(entry);
+	}
+
+	this->mApplications.diffUpdate(applications);
+
+	emit this->applicationsChanged();
+	if (indexChanged) emit this->searchIndexChanged();
+	if (mimeChanged) emit this->mimeAssociationsChanged();
+
+	for (auto* e: removedEntries) e->deleteLater();
+}
+
+void DesktopEntryManager::rebuildLookups() {
+	this->lowercaseDesktopEntries.clear();
+	this->startupClasses.clear();
+	this->lowercaseStartupClasses.clear();
 
-		newEntries.insert(data.id, dentry);
+	for (auto* entry: this->desktopEntries) {
+		auto lowerId = entry->mId.toLower();
 
-		if (newLowercaseEntries.contains(lowerId)) {
+		if (this->lowercaseDesktopEntries.contains(lowerId)) {
 			qCInfo(logDesktopEntry).nospace()
 			    << "Multiple desktop entries have the same lowercased id " << lowerId
 			    << ". This can cause ambiguity when byId requests are not made with the correct case "
 			       "already.";
-
-			newLowercaseEntries.remove(lowerId);
 		}
 
-		newLowercaseEntries.insert(lowerId, dentry);
-	}
-
-	this->desktopEntries = newEntries;
-	this->lowercaseDesktopEntries = newLowercaseEntries;
+		this->lowercaseDesktopEntries.insert(lowerId, entry);
 
-	auto newApplications = QVector<DesktopEntry*>();
-	for (auto* entry: this->desktopEntries.values())
-		if (!entry->bNoDisplay) newApplications.append(entry);
+		const auto& startupClass = entry->bStartupClass.value();
+		if (startupClass.isEmpty()) continue;
 
-	this->mApplications.diffUpdate(newApplications);
-
-	emit this->applicationsChanged();
+		if (!this->startupClasses.contains(startupClass)) {
+			this->startupClasses.insert(startupClass, entry);
+		}
 
-	for (auto* e: oldEntries) e->deleteLater();
+		auto lowerClass = startupClass.toLower();
+		if (!this->lowercaseStartupClasses.contains(lowerClass)) {
+			this->lowercaseStartupClasses.insert(lowerClass, entry);
+		}
+	}
 }
 
 DesktopEntries::DesktopEntries() {
@@ -595,6 +877,13 @@ DesktopEntries::DesktopEntries() {
 	    this,
 	    &DesktopEntries::applicationsChanged
 	);
+
+	QObject::connect(
+	    DesktopEntryManager::instance(),
+	    &DesktopEntryManager::mimeAssociationsChanged,
+	    this,
+	    &DesktopEntries::mimeAssociationsChanged
+	);
 }
 
 DesktopEntry* DesktopEntries::byId(const QString& id) {
@@ -605,6 +894,14 @@ DesktopEntry* DesktopEntries::heuristicLookup(const QString& name) {
 	return DesktopEntryManager::instance()->heuristicLookup(name);
 }
 
+DesktopEntry* DesktopEntries::defaultFor(const QString& mimeType) {
+	return DesktopEntryManager::instance()->defaultFor(mimeType);
+}
+
+QVector<DesktopEntry*> DesktopEntries::handlersFor(const QString& mimeType) {
+	return DesktopEntryManager::instance()->handlersFor(mimeType);
+}
+
 ObjectModel<DesktopEntry>* DesktopEntries::applications() {
 	return DesktopEntryManager::instance()->applications();
 }
@@ -9,6 +9,8 @@
 #include <qproperty.h>
 #include <qqmlintegration.h>
 #include <qrunnable.h>
+#include <qset.h>
+#include <qsharedpointer.h>
 #include <qtmetamacros.h>
 
 #include "desktopentrymonitor.hpp"
@@ -16,7 +18,9 @@
 #include "model.hpp"
 
 class DesktopAction;
+class DesktopEntryMimeIndex;
 class DesktopEntryMonitor;
+class DesktopEntrySearchIndex;
 
 struct DesktopActionData {
 	QString id;
@@ -42,6 +46,7 @@ struct ParsedDesktopEntryData {
 	bool terminal = false;
 	QVector<QString> categories;
 	QVector<QString> keywords;
+	QVector<QString> mimeTypes;
 	QHash<QString, QString> entries;
 	QVector<DesktopActionData> actions;
 };
@@ -92,6 +97,8 @@ public:
 	explicit DesktopEntry(QString id, QObject* parent): QObject(parent), mId(std::move(id)) {}
 
 	static ParsedDesktopEntryData parseText(const QString& id, const QString& text);
+	// The locale localized keys are resolved with, from LC_MESSAGES or LANG.
+	static const QString& localeName();
 	void updateState(const ParsedDesktopEntryData& newState);
 
 	/// Run the application. Currently ignores @@runInTerminal and field codes.
@@ -236,17 +243,73 @@ private:
 
 class DesktopEntryManager;
 
+// A desktop entry file as of the last scan.
+struct DesktopEntryFile {
+	QString path;
+	QString id;
+	// Index of the desktop path the file was found in. Lower indices take precedence.
+	qint32 priority = 0;
+	qint64 mtime = 0;
+	qint64 size = 0;
+	ParsedDesktopEntryData data;
+};
+
+// Every scanned desktop entry file, kept between scans so unchanged files are not re-parsed.
+struct DesktopEntryScanState {
+	QHash<QString, DesktopEntryFile> files; // by path
+	QHash<QString, QStringList> pathsById;
+	// mtimes of every scanned directory, or -1 for desktop paths which do not exist.
+	QHash<QString, qint64> dirs;
+	// mtimes of mimeapps.list files, or -1 if they do not exist. Not cached.
+	QHash<QString, qint64> mimeApps;
+
+	// The file providing the entry for the given id, or null if it is missing or hidden.
+	[[nodiscard]] const DesktopEntryFile* effectiveFile(const QString& id) const;
+	[[nodiscard]] QList<ParsedDesktopEntryData> effectiveEntries() const;
+};
+
+struct DesktopEntryScanResult {
+	DesktopEntryScanState state;
+	// Entries which were added or changed.
+	QList<ParsedDesktopEntryData> updated;
+	// Ids of entries which were removed or hidden.
+	QStringList removed;
+	// Indexes are null if nothing changed and no index was requested.
+	QSharedPointer<const DesktopEntrySearchIndex> searchIndex;
+	QSharedPointer<const DesktopEntryMimeIndex> mimeIndex;
+};
+
 class DesktopEntryScanner: public QRunnable {
 public:
-	explicit DesktopEntryScanner(DesktopEntryManager* manager);
+	// Rescans the given directories, which may be desktop paths, directories inside them,
+	// or parents of them. mimeapps.list files are checked on every scan.
+	explicit DesktopEntryScanner(
+	    DesktopEntryManager* manager,
+	    DesktopEntryScanState state,
+	    QStringList changedDirs
+	);
 
 	void run() override;
-	// clang-format off
-	void scanDirectory(const QDir& dir, const QString& idPrefix, QList<ParsedDesktopEntryData>& entries);
-	// clang-format on
+	DesktopEntryScanResult scan();
+
+	// If not empty, the scan state is written to this path when it changes.
+	QString cachePath;
+	// Write the cache even if nothing changed.
+	bool forceCacheWrite = false;
+	// Build the search and MIME indexes even if nothing changed.
+	bool forceIndexes = false;
 
 private:
+	void scanDirectory(const QDir& dir, const QString& idPrefix, qint32 priority);
+	void removeFile(QHash<QString, DesktopEntryFile>::iterator& it);
+
 	DesktopEntryManager* manager;
+	DesktopEntryScanState state;
+	QStringList changedDirs;
+	QSet<QString> seenPaths;
+	QSet<QString> seenDirs;
+	QSet<QString> changedIds;
+	bool stateChanged = false;
 };
 
 class DesktopEntryManager: public QObject {
@@ -260,26 +323,48 @@ public:
 
 	[[nodiscard]] ObjectModel<DesktopEntry>* applications();
 
+	// Search index of the current applications. Null until the first scan completes.
+	[[nodiscard]] QSharedPointer<const DesktopEntrySearchIndex> searchIndex() const {
+		return this->mSearchIndex;
+	}
+
+	[[nodiscard]] DesktopEntry* defaultFor(const QString& mimeType);
+	[[nodiscard]] QVector<DesktopEntry*> handlersFor(const QString& mimeType);
+
 	static DesktopEntryManager* instance();
 
 	static const QStringList& desktopPaths();
 
 signals:
 	void applicationsChanged();
+	void searchIndexChanged();
+	void mimeAssociationsChanged();
 
 private slots:
-	void handleFileChanges();
-	void onScanCompleted(const QList<ParsedDesktopEntryData>& scanResults);
+	void handleFileChanges(const QStringList& changedDirs);
 
 private:
 	explicit DesktopEntryManager();
 
+	void startScan();
+	void onScanCompleted(DesktopEntryScanResult result);
+	void rebuildLookups();
+	[[nodiscard]] bool loadCache();
+	[[nodiscard]] const DesktopEntryMimeIndex* mimeIndex();
+
 	QHash<QString, DesktopEntry*> desktopEntries;
 	QHash<QString, DesktopEntry*> lowercaseDesktopEntries;
+	QHash<QString, DesktopEntry*> startupClasses;
+	QHash<QString, DesktopEntry*> lowercaseStartupClasses;
+	QSharedPointer<const DesktopEntrySearchIndex> mSearchIndex;
+	QSharedPointer<const DesktopEntryMimeIndex> mMimeIndex;
 	ObjectModel<DesktopEntry> mApplications {this};
 	DesktopEntryMonitor* monitor = nullptr;
+	DesktopEntryScanState scanState;
+	QSet<QString> pendingDirs;
+	QString cachePath;
+	bool cacheValid = false;
 	bool scanInProgress = false;
-	bool scanQueued = false;
 
 	friend class DesktopEntryScanner;
 };
@@ -311,9 +396,20 @@ public:
 	/// if no exact matches are found this function will try to guess - potentially incorrectly.
 	/// May return null.
 	Q_INVOKABLE [[nodiscard]] static DesktopEntry* heuristicLookup(const QString& name);
+	/// Look up the default application for a MIME type, such as `text/plain`, as configured
+	/// in `mimeapps.list`. If no default is configured, the most preferred application which
+	/// can open the type is returned. May return null.
+	///
+	/// Equivalent to `xdg-mime query default <mimeType>` without spawning a process.
+	Q_INVOKABLE [[nodiscard]] static DesktopEntry* defaultFor(const QString& mimeType);
+	/// Look up all applications which can open a MIME type, with the default first.
+	/// Includes NoDisplay entries, as many applications only open files through them.
+	Q_INVOKABLE [[nodiscard]] static QVector<DesktopEntry*> handlersFor(const QString& mimeType);
 
 	[[nodiscard]] static ObjectModel<DesktopEntry>* applications();
 
 signals:
 	void applicationsChanged();
+	/// Emitted when the results of @@defaultFor() or @@handlersFor() may have changed.
+	void mimeAssociationsChanged();
 };
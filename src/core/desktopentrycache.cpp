@@ -0,0 +1,174 @@
+#include "desktopentrycache.hpp"
+#include <algorithm>
+#include <utility>
+
+#include <qbytearray.h>
+#include <qcontainerfwd.h>
+#include <qdatastream.h>
+#include <qdatetime.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qsavefile.h>
+#include <qscopeguard.h>
+#include <qtypes.h>
+
+#include "desktopentry.hpp"
+#include "logcat.hpp"
+
+namespace {
+QS_LOGGING_CATEGORY(logDesktopEntryCache, "quickshell.desktopentry.cache", QtWarningMsg);
+
+constexpr quint32 CACHE_MAGIC = 0x51534445; // QSDE
+// Must be incremented whenever the serialized layout or parser output changes.
+constexpr quint32 CACHE_VERSION = 3;
+// The most files space is reserved for up front, so a corrupt count can't allocate much.
+constexpr qint32 MAX_RESERVED_FILES = 4096;
+} // namespace
+
+QDataStream& operator<<(QDataStream& stream, const DesktopActionData& data) {
+	stream << data.id << data.name << data.icon << data.execString << data.command << data.entries;
+	return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, DesktopActionData& data) {
+	stream >> data.id >> data.name >> data.icon >> data.execString >> data.command >> data.entries;
+	return stream;
+}
+
+QDataStream& operator<<(QDataStream& stream, const ParsedDesktopEntryData& data) {
+	stream << data.id << data.name << data.genericName << data.startupClass << data.noDisplay
+	       << data.hidden << data.comment << data.icon << data.execString << data.command
+	       << data.workingDirectory << data.terminal << data.categories << data.keywords
+	       << data.mimeTypes << data.entries << data.actions;
+	return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, ParsedDesktopEntryData& data) {
+	stream >> data.id >> data.name >> data.genericName >> data.startupClass >> data.noDisplay
+	    >> data.hidden >> data.comment >> data.icon >> data.execString >> data.command
+	    >> data.workingDirectory >> data.terminal >> data.categories >> data.keywords
+	    >> data.mimeTypes >> data.entries >> data.actions;
+	return stream;
+}
+
+bool DesktopEntryCache::load(const QString& path, DesktopEntryScanState& state) {
+	auto file = QFile(path);
+	if (!file.open(QFile::ReadOnly)) {
+		qCDebug(logDesktopEntryCache) << "No desktop entry cache at" << path;
+		return false;
+	}
+
+	auto size = file.size();
+	auto* map = file.map(0, size);
+	if (!map) {
+		qCWarning(logDesktopEntryCache) << "Could not map desktop entry cache" << path;
+		return false;
+	}
+
+	auto unmap = qScopeGuard([&] { file.unmap(map); });
+
+	// Deserialized strings are copied out of the mapping, so it can be dropped after reading.
+	auto data = QByteArray::fromRawData(reinterpret_cast<const char*>(map), size); // NOLINT
+	auto stream = QDataStream(data);
+	stream.setVersion(QDataStream::Qt_6_0);
+
+	quint32 magic = 0;
+	quint32 version = 0;
+	stream >> magic >> version;
+
+	if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+		qCDebug(logDesktopEntryCache) << "Ignoring desktop entry cache with unknown version" << version;
+		return false;
+	}
+
+	QString locale;
+	QStringList desktopPaths;
+	stream >> locale >> desktopPaths;
+
+	// Localized keys are resolved when parsing.
+	if (locale != DesktopEntry::localeName()) {
+		qCDebug(logDesktopEntryCache) << "Ignoring desktop entry cache for different locale" << locale;
+		return false;
+	}
+
+	if (desktopPaths != DesktopEntryManager::desktopPaths()) {
+		qCDebug(logDesktopEntryCache) << "Ignoring desktop entry cache for different desktop paths";
+		return false;
+	}
+
+	auto cached = DesktopEntryScanState();
+	stream >> cached.dirs;
+
+	for (auto it = cached.dirs.constBegin(); it != cached.dirs.constEnd(); ++it) {
+		if (DesktopEntryCache::dirMtime(it.key()) != it.value()) {
+			qCDebug(logDesktopEntryCache) << "Desktop entry cache is outdated as" << it.key()
+			                              << "has changed";
+			return false;
+		}
+	}
+
+	qint32 count = 0;
+	stream >> count;
+
+	if (count < 0) {
+		qCWarning(logDesktopEntryCache) << "Desktop entry cache" << path << "is corrupt";
+		return false;
+	}
+
+	cached.files.reserve(std::min(count, MAX_RESERVED_FILES));
+
+	for (qint32 i = 0; i != count && stream.status() == QDataStream::Ok; i++) {
+		auto entryFile = DesktopEntryFile();
+		stream >> entryFile.path >> entryFile.id >> entryFile.priority >> entryFile.mtime
+		    >> entryFile.size >> entryFile.data;
+
+		cached.pathsById[entryFile.id].append(entryFile.path);
+		cached.files.insert(entryFile.path, std::move(entryFile));
+	}
+
+	if (stream.status() != QDataStream::Ok) {
+		qCWarning(logDesktopEntryCache) << "Desktop entry cache" << path << "is corrupt";
+		return false;
+	}
+
+	state = std::move(cached);
+	return true;
+}
+
+bool DesktopEntryCache::save(const QString& path, const DesktopEntryScanState& state) {
+	auto file = QSaveFile(path);
+	if (!file.open(QFile::WriteOnly)) {
+		qCWarning(logDesktopEntryCache) << "Could not open desktop entry cache" << path
+		                                << "for writing";
+		return false;
+	}
+
+	auto stream = QDataStream(&file);
+	stream.setVersion(QDataStream::Qt_6_0);
+
+	stream << CACHE_MAGIC << CACHE_VERSION << DesktopEntry::localeName()
+	       << DesktopEntryManager::desktopPaths() << state.dirs;
+	stream << static_cast<qint32>(state.files.size());
+
+	for (const auto& entryFile: state.files) {
+		stream << entryFile.path << entryFile.id << entryFile.priority << entryFile.mtime
+		       << entryFile.size << entryFile.data;
+	}
+
+	if (!file.commit()) {
+		qCWarning(logDesktopEntryCache) << "Could not write desktop entry cache" << path;
+		return false;
+	}
+
+	qCDebug(logDesktopEntryCache) << "Wrote" << state.files.size() << "desktop entry files to"
+	                              << path;
+	return true;
+}
+
+qint64 DesktopEntryCache::dirMtime(const QString& path) {
+	auto info = QFileInfo(path);
+	if (!info.isDir()) return -1;
+	return info.lastModified().toMSecsSinceEpoch();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <qstring.h>
+#include <qtypes.h>
+
+#include "desktopentry.hpp"
+
+// Versioned on-disk copy of the desktop entry scan state, used to create entries at startup
+// without reading every desktop entry file.
+class DesktopEntryCache {
+public:
+	// Loads the cache if it was written for the current locale and desktop paths,
+	// and none of the scanned directories changed since.
+	static bool load(const QString& path, DesktopEntryScanState& state);
+	static bool save(const QString& path, const DesktopEntryScanState& state);
+
+	// The mtime of a directory in milliseconds, or -1 if it does not exist.
+	static qint64 dirMtime(const QString& path);
+};
@@ -0,0 +1,201 @@
+#include "desktopentrymime.hpp"
+
+#include <qcontainerfwd.h>
+#include <qfile.h>
+#include <qhash.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qmimedatabase.h>
+#include <qmimetype.h>
+#include <qnamespace.h>
+#include <qset.h>
+#include <qsharedpointer.h>
+#include <qtenvironmentvariables.h>
+
+#include "desktopentry.hpp"
+#include "logcat.hpp"
+
+namespace {
+QS_LOGGING_CATEGORY(logDesktopEntryMime, "quickshell.desktopentry.mime", QtWarningMsg);
+
+struct MimeAppsList {
+	QHash<QString, QStringList> defaults;
+	QHash<QString, QStringList> added;
+	QHash<QString, QStringList> removed;
+};
+
+QString canonicalMimeType(const QMimeDatabase& db, const QString& name) {
+	auto type = db.mimeTypeForName(name);
+	return type.isValid() ? type.name() : name;
+}
+
+MimeAppsList parseMimeApps(const QString& path, const QMimeDatabase& db) {
+	auto list = MimeAppsList();
+
+	auto file = QFile(path);
+	if (!file.open(QFile::ReadOnly)) return list;
+
+	qCDebug(logDesktopEntryMime) << "Reading" << path;
+
+	QHash<QString, QStringList>* section = nullptr;
+
+	for (const auto& rawLine: QString::fromUtf8(file.readAll()).split(u'\n', Qt::SkipEmptyParts)) {
+		auto line = rawLine.trimmed();
+		if (line.isEmpty() || line.startsWith(u'#')) continue;
+
+		if (line.startsWith(u'[') && line.endsWith(u']')) {
+			auto name = line.sliced(1, line.length() - 2);
+			if (name == "Default Applications") section = &list.defaults;
+			else if (name == "Added Associations") section = &list.added;
+			else if (name == "Removed Associations") section = &list.removed;
+			else section = nullptr;
+			continue;
+		}
+
+		if (!section) continue;
+
+		auto splitIdx = line.indexOf(u'=');
+		if (splitIdx == -1) continue;
+
+		auto mimeType = canonicalMimeType(db, line.sliced(0, splitIdx).trimmed());
+		auto& ids = (*section)[mimeType];
+
+		for (const auto& desktopFile: line.sliced(splitIdx + 1).split(u';', Qt::SkipEmptyParts)) {
+			auto id = desktopFile.trimmed();
+			if (id.endsWith(".desktop")) id.chop(8);
+			if (!id.isEmpty()) ids.append(id);
+		}
+	}
+
+	return list;
+}
+
+} // namespace
+
+QSharedPointer<const DesktopEntryMimeIndex>
+DesktopEntryMimeIndex::build(const QList<ParsedDesktopEntryData>& entries) {
+	auto index = QSharedPointer<DesktopEntryMimeIndex>::create();
+	auto db = QMimeDatabase();
+
+	auto installed = QSet<QString>();
+	auto claims = QHash<QString, QStringList>();
+
+	for (const auto& entry: entries) {
+		installed.insert(entry.id);
+
+		for (const auto& mimeType: entry.mimeTypes) {
+			claims[canonicalMimeType(db, mimeType)].append(entry.id);
+		}
+	}
+
+	auto added = QHash<QString, QStringList>();
+	auto removed = QHash<QString, QSet<QString>>();
+
+	// Files are processed most important first. Removals only affect associations
+	// from less important files and desktop entries.
+	for (const auto& path: DesktopEntryMimeIndex::mimeAppsPaths()) {
+		auto list = parseMimeApps(path, db);
+
+		for (const auto& [mimeType, ids]: list.added.asKeyValueRange()) {
+			const auto& removedIds = removed.value(mimeType);
+			auto& addedIds = added[mimeType];
+
+			for (const auto& id: ids) {
+				if (installed.contains(id) && !removedIds.contains(id) && !addedIds.contains(id)) {
+					addedIds.append(id);
+				}
+			}
+		}
+
+		for (const auto& [mimeType, ids]: list.removed.asKeyValueRange()) {
+			auto& removedIds = removed[mimeType];
+			for (const auto& id: ids) removedIds.insert(id);
+		}
+
+		for (const auto& [mimeType, ids]: list.defaults.asKeyValueRange()) {
+			if (index->defaults.contains(mimeType)) continue;
+
+			for (const auto& id: ids) {
+				if (installed.contains(id)) {
+					index->defaults.insert(mimeType, id);
+					break;
+				}
+			}
+		}
+	}
+
+	// Entry order is not meaningful, so sort claims for stable results.
+	for (auto& ids: claims) ids.sort();
+
+	auto mimeTypes = QSet<QString>();
+	for (const auto& mimeType: added.keys()) mimeTypes.insert(mimeType);
+	for (const auto& mimeType: claims.keys()) mimeTypes.insert(mimeType);
+	for (const auto& mimeType: index->defaults.keys()) mimeTypes.insert(mimeType);
+
+	for (const auto& mimeType: mimeTypes) {
+		const auto& removedIds = removed.value(mimeType);
+		auto handlers = added.value(mimeType);
+
+		for (const auto& id: claims.value(mimeType)) {
+			if (!removedIds.contains(id) && !handlers.contains(id)) handlers.append(id);
+		}
+
+		// The default is always listed first, even if it does not claim the type.
+		if (auto defaultId = index->defaults.value(mimeType); !defaultId.isEmpty()) {
+			handlers.removeOne(defaultId);
+			handlers.prepend(defaultId);
+		} else if (!handlers.isEmpty()) {
+			index->defaults.insert(mimeType, handlers.first());
+		}
+
+		if (!handlers.isEmpty()) index->handlers.insert(mimeType, handlers);
+	}
+
+	qCDebug(logDesktopEntryMime) << "Built MIME index of" << index->handlers.size() << "types";
+	return index;
+}
+
+QString DesktopEntryMimeIndex::resolve(const QString& mimeType) const {
+	if (this->handlers.contains(mimeType)) return mimeType;
+	return canonicalMimeType(QMimeDatabase(), mimeType);
+}
+
+QString DesktopEntryMimeIndex::defaultFor(const QString& mimeType) const {
+	return this->defaults.value(this->resolve(mimeType));
+}
+
+QStringList DesktopEntryMimeIndex::handlersFor(const QString& mimeType) const {
+	return this->handlers.value(this->resolve(mimeType));
+}
+
+const QStringList& DesktopEntryMimeIndex::mimeAppsPaths() {
+	static const auto paths = []() {
+		auto dirs = QStringList();
+
+		auto configHome = qEnvironmentVariable("XDG_CONFIG_HOME");
+		if (configHome.isEmpty() && qEnvironmentVariableIsSet("HOME"))
+			configHome = qEnvironmentVariable("HOME") + "/.config";
+		if (!configHome.isEmpty()) dirs.append(configHome);
+
+		auto configDirs = qEnvironmentVariable("XDG_CONFIG_DIRS");
+		if (configDirs.isEmpty()) configDirs = "/etc/xdg";
+		dirs.append(configDirs.split(u':', Qt::SkipEmptyParts));
+
+		dirs.append(DesktopEntryManager::desktopPaths());
+
+		auto desktops = qEnvironmentVariable("XDG_CURRENT_DESKTOP").toLower();
+
+		auto paths = QStringList();
+		for (const auto& dir: dirs) {
+			for (const auto& desktop: desktops.split(u':', Qt::SkipEmptyParts)) {
+				paths.append(dir + '/' + desktop + "-mimeapps.list");
+			}
+
+			paths.append(dir + "/mimeapps.list");
+		}
+
+		return paths;
+	}();
+
+	return paths;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <qcontainerfwd.h>
+#include <qhash.h>
+#include <qsharedpointer.h>
+#include <qstring.h>
+
+#include "desktopentry.hpp"
+
+// Immutable index of MIME type associations, following the
+// [MIME applications associations specification].
+// Built off the main thread by DesktopEntryScanner from the `MimeType` keys of
+// desktop entries and all `mimeapps.list` files.
+//
+// [MIME applications associations specification]: https://specifications.freedesktop.org/mime-apps-spec/latest/
+class DesktopEntryMimeIndex {
+public:
+	// Builds an index from the effective (non hidden, deduplicated) desktop entries.
+	static QSharedPointer<const DesktopEntryMimeIndex>
+	build(const QList<ParsedDesktopEntryData>& entries);
+
+	// Id of the default application for the given MIME type, or an empty string.
+	[[nodiscard]] QString defaultFor(const QString& mimeType) const;
+	// Ids of all applications for the given MIME type, default first.
+	[[nodiscard]] QStringList handlersFor(const QString& mimeType) const;
+
+	// mimeapps.list paths, most important first.
+	static const QStringList& mimeAppsPaths();
+
+private:
+	[[nodiscard]] QString resolve(const QString& mimeType) const;
+
+	QHash<QString, QString> defaults;
+	QHash<QString, QStringList> handlers;
+};
@@ -1,16 +1,31 @@
 #include "desktopentrymonitor.hpp"
+#include <algorithm>
 
 #include <qdir.h>
+#include <qelapsedtimer.h>
 #include <qfileinfo.h>
-#include <qfilesystemwatcher.h>
 #include <qobject.h>
+#include <qset.h>
 #include <qstring.h>
 #include <qtmetamacros.h>
 
 #include "desktopentry.hpp"
+#include "desktopentrymime.hpp"
+#include "filewatch.hpp"
 
 namespace {
-void addPathAndParents(QFileSystemWatcher& watcher, const QString& path) {
+bool isInDesktopPath(const QString& path) {
+	return std::ranges::any_of(DesktopEntryManager::desktopPaths(), [&](const QString& root) {
+		return path == root || path.startsWith(root + '/');
+	});
+}
+
+// Changes are emitted once no change has been seen for DEBOUNCE_MS, or DEBOUNCE_MAX_MS
+// after the first change of a burst, such as a package manager installing many files.
+constexpr qint32 DEBOUNCE_MS = 100;
+constexpr qint64 DEBOUNCE_MAX_MS = 1000;
+
+void addPathAndParents(FileWatch& watcher, const QString& path) {
 	watcher.addPath(path);
 
 	auto p = QFileInfo(path).absolutePath();
@@ -25,14 +40,20 @@ void addPathAndParents(QFileSystemWatcher& watcher, const QString& path) {
 
 DesktopEntryMonitor::DesktopEntryMonitor(QObject* parent): QObject(parent) {
 	this->debounceTimer.setSingleShot(true);
-	this->debounceTimer.setInterval(100);
+	this->debounceTimer.setInterval(DEBOUNCE_MS);
 
 	QObject::connect(
 	    &this->watcher,
-	    &QFileSystemWatcher::directoryChanged,
+	    &FileWatch::directoryChanged,
 	    this,
 	    &DesktopEntryMonitor::onDirectoryChanged
 	);
+	QObject::connect(
+	    &this->watcher,
+	    &FileWatch::fileChanged,
+	    this,
+	    &DesktopEntryMonitor::onFileChanged
+	);
 	QObject::connect(
 	    &this->debounceTimer,
 	    &QTimer::timeout,
@@ -49,6 +70,15 @@ void DesktopEntryMonitor::startMonitoring() {
 		addPathAndParents(this->watcher, path);
 		this->scanAndWatch(path);
 	}
+
+	// mimeapps.list files in desktop paths are covered by the directory watches above.
+	for (const auto& path: DesktopEntryMimeIndex::mimeAppsPaths()) {
+		auto dir = QFileInfo(path).path();
+		if (isInDesktopPath(dir)) continue;
+
+		if (QFileInfo(dir).isDir()) this->watcher.addPath(dir);
+		if (QFileInfo(path).isFile()) this->watcher.addPath(path);
+	}
 }
 
 void DesktopEntryMonitor::scanAndWatch(const QString& dirPath) {
@@ -61,8 +91,60 @@ void DesktopEntryMonitor::scanAndWatch(const QString& dirPath) {
 	for (const auto& subdir: subdirs) this->watcher.addPath(subdir.absoluteFilePath());
 }
 
-void DesktopEntryMonitor::onDirectoryChanged(const QString& /*path*/) {
-	this->debounceTimer.start();
+void DesktopEntryMonitor::onDirectoryChanged(const QString& path) {
+	auto changed = false;
+
+	for (const auto& root: DesktopEntryManager::desktopPaths()) {
+		if (path == root || path.startsWith(root + '/')) {
+			// Watch subdirectories created since the last change.
+			this->scanAndWatch(path);
+			changed = true;
+			break;
+		} else if (root.startsWith(path + '/') && !this->watcher.isWatched(root)
+		           && QDir(root).exists())
+		{
+			// Parents are only watched to find newly created desktop paths.
+			addPathAndParents(this->watcher, root);
+			this->scanAndWatch(root);
+			this->changedDirs.insert(root);
+		}
+	}
+
+	if (!changed) {
+		// Config directories are watched for replaced or created mimeapps.list files.
+		for (const auto& mimeApps: DesktopEntryMimeIndex::mimeAppsPaths()) {
+			if (QFileInfo(mimeApps).path() != path) continue;
+
+			changed = true;
+			if (QFileInfo(mimeApps).isFile()) this->watcher.addPath(mimeApps);
+		}
+	}
+
+	if (changed) this->changedDirs.insert(path);
+	this->queueChanges();
+}
+
+void DesktopEntryMonitor::onFileChanged(const QString& path) {
+	// Files replaced by a rename are dropped from the watcher.
+	if (QFileInfo(path).isFile()) this->watcher.addPath(path);
+
+	this->changedDirs.insert(path);
+	this->queueChanges();
+}
+
+void DesktopEntryMonitor::queueChanges() {
+	if (this->changedDirs.isEmpty()) return;
+
+	if (!this->debounceTimer.isActive()) {
+		this->burstTimer.start();
+		this->debounceTimer.start();
+	} else if (this->burstTimer.elapsed() < DEBOUNCE_MAX_MS) {
+		this->debounceTimer.start();
+	}
 }
 
-void DesktopEntryMonitor::processChanges() { emit this->desktopEntriesChanged(); }
\ No newline at end of file
+void DesktopEntryMonitor::processChanges() {
+	auto changedDirs = QStringList(this->changedDirs.begin(), this->changedDirs.end());
+	this->changedDirs.clear();
+	emit this->desktopEntriesChanged(changedDirs);
+}
\ No newline at end of file
@@ -1,10 +1,13 @@
 #pragma once
 
-#include <qfilesystemwatcher.h>
+#include <qelapsedtimer.h>
 #include <qobject.h>
+#include <qset.h>
 #include <qstringlist.h>
 #include <qtimer.h>
 
+#include "filewatch.hpp"
+
 class DesktopEntryMonitor: public QObject {
 	Q_OBJECT
 
@@ -17,16 +20,22 @@ public:
 	DesktopEntryMonitor& operator=(DesktopEntryMonitor&&) = delete;
 
 signals:
-	void desktopEntriesChanged();
+	// Emitted once a burst of changes settles, with every directory that changed.
+	// May also contain changed mimeapps.list files.
+	void desktopEntriesChanged(const QStringList& changedDirs);
 
 private slots:
 	void onDirectoryChanged(const QString& path);
+	void onFileChanged(const QString& path);
 	void processChanges();
 
 private:
 	void startMonitoring();
 	void scanAndWatch(const QString& dirPath);
+	void queueChanges();
 
-	QFileSystemWatcher watcher;
+	FileWatch watcher;
 	QTimer debounceTimer;
+	QElapsedTimer burstTimer;
+	QSet<QString> changedDirs;
 };
@@ -0,0 +1,513 @@
+#include "desktopentrysearch.hpp"
+#include <algorithm>
+#include <utility>
+
+#include <qatomic.h>
+#include <qcontainerfwd.h>
+#include <qfileinfo.h>
+#include <qhash.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qnamespace.h>
+#include <qobject.h>
+#include <qobjectdefs.h>
+#include <qpair.h>
+#include <qsharedpointer.h>
+#include <qthreadpool.h>
+#include <qtmetamacros.h>
+#include <qtypes.h>
+
+#include "desktopentry.hpp"
+#include "logcat.hpp"
+
+namespace {
+QS_LOGGING_CATEGORY(logDesktopEntrySearch, "quickshell.desktopentry.search", QtWarningMsg);
+
+// Scoring constants, following fzf's defaults.
+constexpr qint32 SCORE_MATCH = 16;
+constexpr qint32 SCORE_GAP_START = -3;
+constexpr qint32 SCORE_GAP_EXTENSION = -1;
+constexpr qint32 BONUS_BOUNDARY = SCORE_MATCH / 2;
+constexpr qint32 BONUS_BOUNDARY_WHITE = BONUS_BOUNDARY + 2;
+constexpr qint32 BONUS_BOUNDARY_DELIMITER = BONUS_BOUNDARY + 1;
+constexpr qint32 BONUS_NON_WORD = SCORE_MATCH / 2;
+constexpr qint32 BONUS_CAMEL_123 = BONUS_BOUNDARY + SCORE_GAP_EXTENSION;
+constexpr qint32 BONUS_CONSECUTIVE = -(SCORE_GAP_START + SCORE_GAP_EXTENSION);
+constexpr qint32 BONUS_FIRST_CHAR_MULTIPLIER = 2;
+
+// Field weights. Scores are multiplied by these before comparing fields.
+constexpr qint32 WEIGHT_NAME = 4;
+constexpr qint32 WEIGHT_KEYWORD = 3;
+constexpr qint32 WEIGHT_GENERIC_NAME = 3;
+constexpr qint32 WEIGHT_EXEC = 2;
+
+enum class CharClass : quint8 {
+	White,
+	NonWord,
+	Delimiter,
+	Lower,
+	Upper,
+	Letter,
+	Number,
+};
+
+CharClass charClass(QChar c) {
+	if (c.isSpace()) return CharClass::White;
+	if (c.isLower()) return CharClass::Lower;
+	if (c.isUpper()) return CharClass::Upper;
+	if (c.isDigit()) return CharClass::Number;
+	if (c.isLetter()) return CharClass::Letter;
+
+	switch (c.unicode()) {
+	case '/':
+	case ',':
+	case ':':
+	case ';':
+	case '|': return CharClass::Delimiter;
+	default: return CharClass::NonWord;
+	}
+}
+
+qint32 bonusFor(CharClass prev, CharClass cur) {
+	if (cur > CharClass::Delimiter) {
+		switch (prev) {
+		case CharClass::White: return BONUS_BOUNDARY_WHITE;
+		case CharClass::Delimiter: return BONUS_BOUNDARY_DELIMITER;
+		case CharClass::NonWord: return BONUS_BOUNDARY;
+		default: break;
+		}
+	}
+
+	if ((prev == CharClass::Lower && cur == CharClass::Upper)
+	    || (prev != CharClass::Number && cur == CharClass::Number))
+	{
+		return BONUS_CAMEL_123;
+	}
+
+	switch (cur) {
+	case CharClass::NonWord:
+	case CharClass::Delimiter: return BONUS_NON_WORD;
+	case CharClass::White: return BONUS_BOUNDARY_WHITE;
+	default: return 0;
+	}
+}
+
+// Characters are folded into a 64 bit set, used to skip fields that cannot match.
+quint64 charBit(QChar c) {
+	auto u = c.unicode();
+	if (u >= 'a' && u <= 'z') return quint64(1) << (u - 'a');
+	if (u >= '0' && u <= '9') return quint64(1) << (26 + u - '0');
+	return quint64(1) << (36 + u % 28);
+}
+
+quint64 charMask(QStringView text) {
+	quint64 mask = 0;
+	for (auto c: text) mask |= charBit(c);
+	return mask;
+}
+
+QString execName(const QList<QString>& command) {
+	for (const auto& arg: command) {
+		// skip env wrappers such as `env FOO=bar app`
+		if (arg == QStringLiteral("env") || arg.endsWith(QStringLiteral("/env"))) continue;
+		if (arg.contains('=')) continue;
+		return QFileInfo(arg).fileName();
+	}
+
+	return QString();
+}
+
+} // namespace
+
+QSharedPointer<const DesktopEntrySearchIndex>
+DesktopEntrySearchIndex::build(const QList<ParsedDesktopEntryData>& scanResults) {
+	auto index = QSharedPointer<DesktopEntrySearchIndex>::create();
+
+	// Later scan results override earlier ones, matching DesktopEntryManager::onScanCompleted.
+	auto byId = QHash<QString, const ParsedDesktopEntryData*>();
+	for (const auto& data: scanResults) {
+		if (data.hidden) byId.remove(data.id);
+		else if (!data.name.isEmpty()) byId.insert(data.id, &data);
+	}
+
+	index->entries.reserve(byId.size());
+
+	for (const auto* data: byId) {
+		if (data->noDisplay) continue;
+
+		auto entry = Entry();
+		entry.id = data->id;
+		entry.sortName = data->name.toLower();
+
+		index->addField(entry, data->name, WEIGHT_NAME);
+		index->addField(entry, data->genericName, WEIGHT_GENERIC_NAME);
+		for (const auto& keyword: data->keywords) index->addField(entry, keyword, WEIGHT_KEYWORD);
+		index->addField(entry, execName(data->command), WEIGHT_EXEC);
+
+		index->entries.append(std::move(entry));
+	}
+
+	index->nameOrder.reserve(index->entries.size());
+	for (qint32 i = 0; i != index->entries.size(); i++) index->nameOrder.append(i);
+
+	std::ranges::sort(index->nameOrder, [&](qint32 a, qint32 b) {
+		return index->lessThan(a, b);
+	});
+
+	qCDebug(logDesktopEntrySearch) << "Built search index of" << index->entries.size() << "entries";
+	return index;
+}
+
+void DesktopEntrySearchIndex::addField(Entry& entry, const QString& text, qint32 weight) {
+	if (text.isEmpty()) return;
+
+	auto field = Field();
+	field.text = text.toLower();
+	field.mask = charMask(field.text);
+	field.weight = weight;
+
+	// Case folding rarely changes the length of a string, in which case bonuses are
+	// computed on the folded text, losing camel case boundaries.
+	const auto& source = field.text.length() == text.length() ? text : field.text;
+
+	field.bonus.resize(source.length());
+	auto prev = CharClass::White;
+	for (auto i = 0; i != source.length(); i++) {
+		auto cur = charClass(source.at(i));
+		field.bonus[i] = static_cast<char>(bonusFor(prev, cur));
+		prev = cur;
+	}
+
+	entry.mask |= field.mask;
+	entry.fields.append(std::move(field));
+}
+
+qint32 DesktopEntrySearchIndex::matchField(const Field& field, QStringView token) {
+	const auto& text = field.text;
+	auto textLen = text.length();
+	auto tokenLen = token.length();
+	if (tokenLen > textLen) return -1;
+
+	// Find the first occurrence of the token as a subsequence...
+	qsizetype start = -1;
+	qsizetype end = -1;
+	qsizetype ti = 0;
+
+	for (qsizetype i = 0; i != textLen; i++) {
+		if (text.at(i) != token.at(ti)) continue;
+		if (start == -1) start = i;
+
+		if (++ti == tokenLen) {
+			end = i + 1;
+			break;
+		}
+	}
+
+	if (end == -1) return -1;
+
+	// ...then walk back from its end to find the shortest match ending there.
+	ti = tokenLen - 1;
+	for (auto i = end - 1; i >= start; i--) {
+		if (text.at(i) != token.at(ti)) continue;
+
+		if (ti == 0) {
+			start = i;
+			break;
+		}
+
+		ti--;
+	}
+
+	qint32 score = 0;
+	qint32 consecutive = 0;
+	qint32 firstBonus = 0;
+	bool inGap = false;
+	ti = 0;
+
+	for (auto i = start; i != end; i++) {
+		if (ti != tokenLen && text.at(i) == token.at(ti)) {
+			qint32 bonus = field.bonus.at(i);
+			score += SCORE_MATCH;
+
+			if (consecutive == 0) {
+				firstBonus = bonus;
+			} else {
+				if (bonus >= BONUS_BOUNDARY && bonus > firstBonus) firstBonus = bonus;
+				bonus = std::max({bonus, firstBonus, BONUS_CONSECUTIVE});
+			}
+
+			score += ti == 0 ? bonus * BONUS_FIRST_CHAR_MULTIPLIER : bonus;
+			inGap = false;
+			consecutive++;
+			ti++;
+		} else {
+			score += inGap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+			inGap = true;
+			consecutive = 0;
+			firstBonus = 0;
+		}
+	}
+
+	return std::max(score, 0) * field.weight;
+}
+
+bool DesktopEntrySearchIndex::lessThan(qint32 left, qint32 right) const {
+	const auto& a = this->entries.at(left);
+	const auto& b = this->entries.at(right);
+
+	if (auto cmp = a.sortName.compare(b.sortName); cmp != 0) return cmp < 0;
+	return a.id < b.id;
+}
+
+DesktopEntrySearchResult DesktopEntrySearchIndex::query(
+    const QString& query,
+    qsizetype limit,
+    const QList<qint32>* candidates,
+    const QAtomicInteger<bool>& shouldCancel
+) const {
+	auto result = DesktopEntrySearchResult();
+	auto lowerQuery = query.toLower();
+	auto tokens = QStringView(lowerQuery).split(' ', Qt::SkipEmptyParts);
+
+	if (tokens.isEmpty()) {
+		auto count = limit == 0 ? this->nameOrder.size() : std::min(limit, this->nameOrder.size());
+		for (qsizetype i = 0; i != count; i++) {
+			result.ids.append(this->entries.at(this->nameOrder.at(i)).id);
+		}
+
+		result.matches = this->nameOrder;
+		return result;
+	}
+
+	auto tokenMasks = QList<quint64>();
+	quint64 queryMask = 0;
+	for (const auto& token: tokens) {
+		auto mask = charMask(token);
+		tokenMasks.append(mask);
+		queryMask |= mask;
+	}
+
+	auto scored = QList<QPair<qint32, qint32>>(); // score, entry
+	auto count = candidates ? candidates->size() : this->entries.size();
+
+	for (qsizetype i = 0; i != count; i++) {
+		if ((i & 0xff) == 0 && shouldCancel.loadAcquire()) return DesktopEntrySearchResult();
+
+		auto entryIndex = candidates ? candidates->at(i) : static_cast<qint32>(i);
+		const auto& entry = this->entries.at(entryIndex);
+		if ((queryMask & ~entry.mask) != 0) continue;
+
+		qint32 total = 0;
+
+		for (auto ti = 0; ti != tokens.length(); ti++) {
+			const auto& token = tokens.at(ti);
+			auto tokenMask = tokenMasks.at(ti);
+			qint32 best = -1;
+
+			for (const auto& field: entry.fields) {
+				if ((tokenMask & ~field.mask) != 0) continue;
+				best = std::max(best, DesktopEntrySearchIndex::matchField(field, token));
+			}
+
+			if (best == -1) {
+				total = -1;
+				break;
+			}
+
+			total += best;
+		}
+
+		if (total == -1) continue;
+		scored.append({total, entryIndex});
+		result.matches.append(entryIndex);
+	}
+
+	auto cmp = [this](const QPair<qint32, qint32>& a, const QPair<qint32, qint32>& b) {
+		if (a.first != b.first) return a.first > b.first;
+
+		// prefer shorter names on ties, as more of the name was matched
+		auto aLen = this->entries.at(a.second).sortName.length();
+		auto bLen = this->entries.at(b.second).sortName.length();
+		if (aLen != bLen) return aLen < bLen;
+
+		return this->lessThan(a.second, b.second);
+	};
+
+	if (limit != 0 && limit < scored.size()) {
+		std::partial_sort(scored.begin(), scored.begin() + limit, scored.end(), cmp);
+		scored.resize(limit);
+	} else {
+		std::ranges::sort(scored, cmp);
+	}
+
+	result.ids.reserve(scored.size());
+	for (const auto& [score, entryIndex]: scored) {
+		result.ids.append(this->entries.at(entryIndex).id);
+	}
+
+	return result;
+}
+
+DesktopEntrySearchJob::DesktopEntrySearchJob(
+    QSharedPointer<const DesktopEntrySearchIndex> index,
+    QString query,
+    qint32 limit,
+    QList<qint32> candidates,
+    bool narrow
+)
+    : index(std::move(index))
+    , query(std::move(query))
+    , limit(limit)
+    , candidates(std::move(candidates))
+    , narrow(narrow) {
+	this->setAutoDelete(false);
+}
+
+void DesktopEntrySearchJob::run() {
+	if (!this->shouldCancel.loadAcquire()) {
+		this->result = this->index->query(
+		    this->query,
+		    this->limit,
+		    this->narrow ? &this->candidates : nullptr,
+		    this->shouldCancel
+		);
+	}
+
+	QMetaObject::invokeMethod(this, &DesktopEntrySearchJob::finished, Qt::QueuedConnection);
+}
+
+void DesktopEntrySearchJob::tryCancel() { this->shouldCancel.storeRelease(true); }
+
+void DesktopEntrySearchJob::finished() {
+	emit this->done();
+	// Deleted on the main thread after done(), as with FileViewOperation.
+	delete this;
+}
+
+DesktopEntrySearch::DesktopEntrySearch(QObject* parent): QObject(parent) {
+	QObject::connect(
+	    DesktopEntryManager::instance(),
+	    &DesktopEntryManager::searchIndexChanged,
+	    this,
+	    &DesktopEntrySearch::onIndexChanged
+	);
+
+	this->scheduleSearch();
+}
+
+DesktopEntrySearch::~DesktopEntrySearch() {
+	if (this->mJob) {
+		this->mJob->tryCancel();
+		QObject::disconnect(this->mJob, nullptr, this, nullptr);
+	}
+}
+
+void DesktopEntrySearch::setQuery(const QString& query) {
+	if (query == this->mQuery) return;
+	this->mQuery = query;
+	emit this->queryChanged();
+	this->scheduleSearch();
+}
+
+void DesktopEntrySearch::setLimit(qint32 limit) {
+	limit = std::max(limit, 0);
+	if (limit == this->mLimit) return;
+	this->mLimit = limit;
+	emit this->limitChanged();
+	this->scheduleSearch();
+}
+
+void DesktopEntrySearch::setBusy(bool busy) {
+	if (busy == this->mBusy) return;
+	this->mBusy = busy;
+	emit this->busyChanged();
+}
+
+void DesktopEntrySearch::onIndexChanged() {
+	// Entries removed by the rescan are deleted shortly after this signal,
+	// so they must be dropped now instead of when the new search completes.
+	auto* manager = DesktopEntryManager::instance();
+	auto entries = this->mResults.valueList();
+	auto removed = entries.removeIf([&](DesktopEntry* entry) {
+		return manager->byId(entry->mId) != entry;
+	});
+
+	if (removed != 0) this->mResults.diffUpdate(entries);
+
+	this->scheduleSearch();
+}
+
+void DesktopEntrySearch::scheduleSearch() {
+	this->setBusy(true);
+
+	// Coalesces property changes made in the same event loop iteration,
+	// such as setting both the query and limit on creation.
+	if (this->mSearchQueued) return;
+	this->mSearchQueued = true;
+	QMetaObject::invokeMethod(this, &DesktopEntrySearch::startSearch, Qt::QueuedConnection);
+}
+
+void DesktopEntrySearch::startSearch() {
+	this->mSearchQueued = false;
+
+	if (this->mJob) {
+		// Results of the running search are outdated. Restart once it returns.
+		this->mJob->tryCancel();
+		this->mRestartPending = true;
+		return;
+	}
+
+	auto index = DesktopEntryManager::instance()->searchIndex();
+
+	if (!index) {
+		// Searched once the first scan completes.
+		this->mResults.diffUpdate({});
+		this->setBusy(false);
+		return;
+	}
+
+	// A match for a query is also a match for any prefix of it, so the previous
+	// matches can be reused as candidates while typing.
+	auto narrow = index == this->mLastIndex && this->mQuery.startsWith(this->mLastQuery);
+
+	qCDebug(logDesktopEntrySearch) << "Starting search for" << this->mQuery << "narrowed:" << narrow;
+
+	this->mJob = new DesktopEntrySearchJob(
+	    index,
+	    this->mQuery,
+	    this->mLimit,
+	    narrow ? this->mLastMatches : QList<qint32>(),
+	    narrow
+	);
+
+	QObject::connect(this->mJob, &DesktopEntrySearchJob::done, this, &DesktopEntrySearch::onJobDone);
+	QThreadPool::globalInstance()->start(this->mJob);
+}
+
+void DesktopEntrySearch::onJobDone() {
+	auto* job = this->mJob;
+	if (this->sender() != job) return;
+	this->mJob = nullptr;
+
+	if (this->mRestartPending) {
+		this->mRestartPending = false;
+		this->startSearch();
+		return;
+	}
+
+	this->mLastIndex = job->index;
+	this->mLastQuery = job->query;
+	this->mLastMatches = std::move(job->result.matches);
+
+	auto* manager = DesktopEntryManager::instance();
+	auto entries = QList<DesktopEntry*>();
+	entries.reserve(job->result.ids.size());
+
+	for (const auto& id: job->result.ids) {
+		// The index may be older than the manager's entries if a rescan finished mid search.
+		if (auto* entry = manager->byId(id); entry && entry->mId == id) entries.append(entry);
+	}
+
+	this->mResults.diffUpdate(entries);
+	this->setBusy(false);
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <qatomic.h>
+#include <qcontainerfwd.h>
+#include <qobject.h>
+#include <qqmlintegration.h>
+#include <qrunnable.h>
+#include <qsharedpointer.h>
+#include <qtmetamacros.h>
+#include <qtypes.h>
+
+#include "desktopentry.hpp"
+#include "doc.hpp"
+#include "model.hpp"
+
+struct DesktopEntrySearchResult {
+	// Ids of the best matches, best first.
+	QList<QString> ids;
+	// Index positions of every match, including ones past the limit. Used to narrow
+	// the candidates of a following query which extends this one.
+	QList<qint32> matches;
+};
+
+// Immutable fuzzy search index over visible desktop entries.
+// Built off the main thread by DesktopEntryScanner and shared with search jobs.
+class DesktopEntrySearchIndex {
+public:
+	// Builds an index from raw scan results, applying the same override and masking
+	// rules as DesktopEntryManager.
+	static QSharedPointer<const DesktopEntrySearchIndex>
+	build(const QList<ParsedDesktopEntryData>& scanResults);
+
+	// Returns matches for each whitespace separated token of the query, ranked by score.
+	// If candidates is non null, only the given entries are considered.
+	// An empty query matches all entries, sorted by name. A limit of 0 returns all matches.
+	[[nodiscard]] DesktopEntrySearchResult query(
+	    const QString& query,
+	    qsizetype limit,
+	    const QList<qint32>* candidates = nullptr,
+	    const QAtomicInteger<bool>& shouldCancel = false
+	) const;
+
+	[[nodiscard]] qsizetype size() const { return this->entries.size(); }
+
+private:
+	struct Field {
+		QString text; // lowercased
+		QByteArray bonus;
+		quint64 mask = 0;
+		qint32 weight = 0;
+	};
+
+	struct Entry {
+		QString id;
+		QString sortName;
+		QList<Field> fields;
+		quint64 mask = 0;
+	};
+
+	void addField(Entry& entry, const QString& text, qint32 weight);
+	[[nodiscard]] static qint32 matchField(const Field& field, QStringView token);
+	[[nodiscard]] bool lessThan(qint32 left, qint32 right) const;
+
+	QList<Entry> entries;
+	QList<qint32> nameOrder;
+};
+
+class DesktopEntrySearchJob
+    : public QObject
+    , public QRunnable {
+	Q_OBJECT;
+
+public:
+	explicit DesktopEntrySearchJob(
+	    QSharedPointer<const DesktopEntrySearchIndex> index,
+	    QString query,
+	    qint32 limit,
+	    QList<qint32> candidates,
+	    bool narrow
+	);
+
+	void run() override;
+	void tryCancel();
+
+	QSharedPointer<const DesktopEntrySearchIndex> index;
+	QString query;
+	qint32 limit;
+	QList<qint32> candidates;
+	bool narrow;
+	DesktopEntrySearchResult result;
+
+signals:
+	void done();
+
+private slots:
+	void finished();
+
+private:
+	QAtomicInteger<bool> shouldCancel = false;
+};
+
+///! Fuzzy search over desktop entries.
+/// Ranked fuzzy search over @@DesktopEntries.applications, matching against each
+/// entry's name, generic name, keywords and executable name.
+///
+/// Matching is similar to [fzf]: the characters of each word in the @@query must appear
+/// in order in one of the searched fields, with matches at word boundaries and consecutive
+/// matches ranking higher. Searches run on a background thread against an index built
+/// while scanning desktop entries, so typing does not block the UI.
+///
+/// ### Example
+/// ```qml
+/// @@QtQuick.ListView {
+///   model: DesktopEntrySearch {
+///     query: searchField.text
+///     limit: 20
+///   }.results
+///
+///   delegate: // ...
+/// }
+/// ```
+///
+/// [fzf]: https://github.com/junegunn/fzf
+class DesktopEntrySearch: public QObject {
+	Q_OBJECT;
+	/// The search string. If empty, all applications are listed, sorted by name.
+	Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged);
+	/// The maximum number of results. Defaults to 0, meaning no limit.
+	Q_PROPERTY(qint32 limit READ limit WRITE setLimit NOTIFY limitChanged);
+	/// Matching applications, best match first. Updated once a search completes.
+	QSDOC_TYPE_OVERRIDE(ObjectModel<DesktopEntry>*);
+	Q_PROPERTY(UntypedObjectModel* results READ results CONSTANT);
+	/// True while a search is running and @@results is not up to date with @@query.
+	Q_PROPERTY(bool busy READ busy NOTIFY busyChanged);
+	QML_ELEMENT;
+
+public:
+	explicit DesktopEntrySearch(QObject* parent = nullptr);
+	~DesktopEntrySearch() override;
+	Q_DISABLE_COPY_MOVE(DesktopEntrySearch);
+
+	[[nodiscard]] QString query() const { return this->mQuery; }
+	void setQuery(const QString& query);
+
+	[[nodiscard]] qint32 limit() const { return this->mLimit; }
+	void setLimit(qint32 limit);
+
+	[[nodiscard]] ObjectModel<DesktopEntry>* results() { return &this->mResults; }
+	[[nodiscard]] bool busy() const { return this->mBusy; }
+
+signals:
+	void queryChanged();
+	void limitChanged();
+	void busyChanged();
+
+private slots:
+	void onIndexChanged();
+	void onJobDone();
+
+private:
+	void scheduleSearch();
+	void startSearch();
+	void setBusy(bool busy);
+
+	QString mQuery;
+	qint32 mLimit = 0;
+	ObjectModel<DesktopEntry> mResults {this};
+	bool mBusy = false;
+	bool mSearchQueued = false;
+	bool mRestartPending = false;
+	DesktopEntrySearchJob* mJob = nullptr;
+
+	// State of the last completed search, used to narrow searches as the query is typed.
+	QSharedPointer<const DesktopEntrySearchIndex> mLastIndex;
+	QString mLastQuery;
+	QList<qint32> mLastMatches;
+};
@@ -0,0 +1,160 @@
+#include "filewatch.hpp"
+#include <utility>
+
+#include <qfilesystemwatcher.h>
+#include <qlist.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qobject.h>
+#include <qpointer.h>
+#include <qset.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qtypes.h>
+
+#include "logcat.hpp"
+
+namespace {
+QS_LOGGING_CATEGORY(logFileWatch, "quickshell.filewatch", QtWarningMsg);
+}
+
+FileWatchService::FileWatchService() {
+	QObject::connect(
+	    &this->watcher,
+	    &QFileSystemWatcher::fileChanged,
+	    this,
+	    &FileWatchService::onFileChanged
+	);
+
+	QObject::connect(
+	    &this->watcher,
+	    &QFileSystemWatcher::directoryChanged,
+	    this,
+	    &FileWatchService::onDirectoryChanged
+	);
+}
+
+FileWatchService* FileWatchService::instance() {
+	static auto* instance = new FileWatchService(); // NOLINT
+	return instance;
+}
+
+bool FileWatchService::isWatched(const QString& path) const {
+	return this->subscribers.contains(path);
+}
+
+qsizetype FileWatchService::subscriberCount(const QString& path) const {
+	return this->subscribers.value(path).size();
+}
+
+bool FileWatchService::subscribe(FileWatch* watch, const QString& path) {
+	auto it = this->subscribers.find(path);
+
+	if (it == this->subscribers.end()) {
+		// The path lists are implicitly shared, so only their sizes are compared.
+		auto fileCount = this->watcher.files().size();
+		if (!this->watcher.addPath(path)) return false;
+		if (this->watcher.files().size() == fileCount) this->directories.insert(path);
+
+		qCDebug(logFileWatch) << "Watching" << path;
+		it = this->subscribers.insert(path, {});
+	}
+
+	it->append(watch);
+	return true;
+}
+
+void FileWatchService::unsubscribe(FileWatch* watch, const QString& path) {
+	auto it = this->subscribers.find(path);
+	if (it == this->subscribers.end()) return;
+
+	it->removeOne(watch);
+
+	if (it->isEmpty()) {
+		qCDebug(logFileWatch) << "No longer watching" << path;
+		this->subscribers.erase(it);
+		this->directories.remove(path);
+		this->watcher.removePath(path);
+	}
+}
+
+QList<QPointer<FileWatch>> FileWatchService::takeSubscribers(const QString& path, bool dropped) {
+	auto it = this->subscribers.find(path);
+	if (it == this->subscribers.end()) return {};
+
+	// Handlers may add or remove subscriptions, including destroying other subscribers.
+	auto watches = QList<QPointer<FileWatch>>();
+	watches.reserve(it->size());
+	for (auto* watch: std::as_const(*it)) watches.append(watch);
+
+	if (dropped) {
+		qCDebug(logFileWatch) << "Watch for" << path << "was dropped";
+		for (auto* watch: std::as_const(*it)) watch->paths.remove(path);
+		this->subscribers.erase(it);
+		this->directories.remove(path);
+	}
+
+	return watches;
+}
+
+bool FileWatchService::isDropped(const QString& path, bool directory) const {
+	// The watcher drops paths that were removed or replaced before emitting the change.
+	// If nothing was dropped it has as many paths as are subscribed to. Otherwise only
+	// some of the paths in a batch of changes may have been dropped.
+	auto watched = directory ? this->watcher.directories() : this->watcher.files();
+	auto subscribed = directory ? this->directories.size()
+	                            : this->subscribers.size() - this->directories.size();
+
+	return watched.size() < subscribed && !watched.contains(path);
+}
+
+void FileWatchService::onFileChanged(const QString& path) {
+	auto dropped = this->isDropped(path, false);
+
+	for (auto& watch: this->takeSubscribers(path, dropped)) {
+		if (watch && (dropped || watch->isWatched(path))) emit watch->fileChanged(path);
+	}
+}
+
+void FileWatchService::onDirectoryChanged(const QString& path) {
+	auto dropped = this->isDropped(path, true);
+
+	for (auto& watch: this->takeSubscribers(path, dropped)) {
+		if (watch && (dropped || watch->isWatched(path))) emit watch->directoryChanged(path);
+	}
+}
+
+FileWatch::~FileWatch() { this->removeAllPaths(); }
+
+bool FileWatch::addPath(const QString& path) {
+	if (this->paths.contains(path)) return true;
+	if (!FileWatchService::instance()->subscribe(this, path)) return false;
+
+	this->paths.insert(path);
+	return true;
+}
+
+void FileWatch::removePath(const QString& path) {
+	if (this->paths.remove(path)) FileWatchService::instance()->unsubscribe(this, path);
+}
+
+void FileWatch::setPaths(const QStringList& paths) {
+	auto oldPaths = this->paths;
+	auto newPaths = QSet<QString>(paths.begin(), paths.end());
+
+	for (const auto& path: paths) this->addPath(path);
+
+	for (const auto& path: oldPaths) {
+		if (!newPaths.contains(path)) this->removePath(path);
+	}
+}
+
+void FileWatch::removeAllPaths() {
+	auto* service = FileWatchService::instance();
+	for (const auto& path: this->paths) service->unsubscribe(this, path);
+	this->paths.clear();
+}
+
+bool FileWatch::isWatched(const QString& path) const { return this->paths.contains(path); }
+
+bool FileWatch::isEmpty() const { return this->paths.isEmpty(); }
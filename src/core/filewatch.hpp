@@ -0,0 +1,85 @@
+#pragma once
+
+#include <qfilesystemwatcher.h>
+#include <qhash.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qpointer.h>
+#include <qset.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qtclasshelpermacros.h>
+#include <qtmetamacros.h>
+#include <qtypes.h>
+
+class FileWatch;
+
+// Process wide file watcher shared by every FileWatch, so each path is only watched once
+// no matter how many objects are interested in it.
+//
+// Must only be used from the main thread.
+class FileWatchService: public QObject {
+	Q_OBJECT;
+
+public:
+	static FileWatchService* instance();
+
+	[[nodiscard]] bool isWatched(const QString& path) const;
+	// The number of FileWatches subscribed to the path.
+	[[nodiscard]] qsizetype subscriberCount(const QString& path) const;
+
+private slots:
+	void onFileChanged(const QString& path);
+	void onDirectoryChanged(const QString& path);
+
+private:
+	explicit FileWatchService();
+
+	bool subscribe(FileWatch* watch, const QString& path);
+	void unsubscribe(FileWatch* watch, const QString& path);
+	// Returns the subscribers of the path, which are unsubscribed if the watch was dropped.
+	QList<QPointer<FileWatch>> takeSubscribers(const QString& path, bool dropped);
+
+	// Whether the watcher dropped a path, which is only searched for if it has fewer paths
+	// of that kind than are subscribed to.
+	[[nodiscard]] bool isDropped(const QString& path, bool directory) const;
+
+	QFileSystemWatcher watcher;
+	QHash<QString, QList<FileWatch*>> subscribers;
+	// Subscribed paths which were watched as directories.
+	QSet<QString> directories;
+
+	friend class FileWatch;
+};
+
+// A set of watched files and directories, with the same semantics as QFileSystemWatcher.
+//
+// Watches for paths removed or replaced on disk are dropped before the change is emitted,
+// after which the path may be added again.
+class FileWatch: public QObject {
+	Q_OBJECT;
+
+public:
+	explicit FileWatch(QObject* parent = nullptr): QObject(parent) {}
+	~FileWatch() override;
+	Q_DISABLE_COPY_MOVE(FileWatch);
+
+	// Returns false if the path could not be watched, such as if it does not exist.
+	bool addPath(const QString& path);
+	void removePath(const QString& path);
+	// Replaces the watched paths, without unwatching paths in both sets.
+	void setPaths(const QStringList& paths);
+	void removeAllPaths();
+
+	[[nodiscard]] bool isWatched(const QString& path) const;
+	[[nodiscard]] bool isEmpty() const;
+
+signals:
+	void fileChanged(const QString& path);
+	void directoryChanged(const QString& path);
+
+private:
+	QSet<QString> paths;
+
+	friend class FileWatchService;
+};
@@ -7,7 +7,6 @@
 #include <qdebug.h>
 #include <qdir.h>
 #include <qfileinfo.h>
-#include <qfilesystemwatcher.h>
 #include <qhash.h>
 #include <qlist.h>
 #include <qlogging.h>
@@ -21,6 +20,7 @@
 #include <qtmetamacros.h>
 
 #include "build.hpp"
+#include "filewatch.hpp"
 #include "iconimageprovider.hpp"
 #include "imageprovider.hpp"
 #include "incubator.hpp"
@@ -172,7 +172,7 @@ void EngineGeneration::postReload() {
 void EngineGeneration::setWatchingFiles(bool watching) {
 	if (watching) {
 		if (this->watcher == nullptr) {
-			this->watcher = new QFileSystemWatcher();
+			this->watcher = new FileWatch();
 
 			const auto files = {
 				this->scanner.scannedFiles,
@@ -192,14 +192,14 @@ void EngineGeneration::setWatchingFiles(bool watching) {
 
 			QObject::connect(
 			    this->watcher,
-			    &QFileSystemWatcher::fileChanged,
+			    &FileWatch::fileChanged,
 			    this,
 			    &EngineGeneration::onFileChanged
 			);
 
 			QObject::connect(
 			    this->watcher,
-			    &QFileSystemWatcher::directoryChanged,
+			    &FileWatch::directoryChanged,
 			    this,
 			    &EngineGeneration::onDirectoryChanged
 			);
@@ -232,7 +232,7 @@ bool EngineGeneration::setExtraWatchedFiles(const QVector<QString>& files) {
 
 void EngineGeneration::onFileChanged(const QString& name) {
 	if (this->watcher == nullptr) return;
-	if (!this->watcher->files().contains(name)) {
+	if (!this->watcher->isWatched(name)) {
 		this->deletedWatchedFiles.push_back(name);
 	} else {
 		// some editors (e.g vscode) perform file saving in two steps: truncate + write
@@ -2,7 +2,6 @@
 
 #include <qcontainerfwd.h>
 #include <qdir.h>
-#include <qfilesystemwatcher.h>
 #include <qhash.h>
 #include <qlist.h>
 #include <qobject.h>
@@ -12,6 +11,7 @@
 #include <qquickwindow.h>
 #include <qtclasshelpermacros.h>
 
+#include "filewatch.hpp"
 #include "incubator.hpp"
 #include "qsintercept.hpp"
 #include "scan.hpp"
@@ -62,7 +62,7 @@ public:
 	QQmlEngine* engine = nullptr;
 	QObject* root = nullptr;
 	SingletonRegistry singletonRegistry;
-	QFileSystemWatcher* watcher = nullptr;
+	FileWatch* watcher = nullptr;
 	QVector<QString> deletedWatchedFiles;
 	QVector<QString> extraWatchedFiles;
 	QsIncubationController incubationController;
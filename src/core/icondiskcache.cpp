@@ -0,0 +1,209 @@
+#include "icondiskcache.hpp"
+#include <algorithm>
+#include <utility>
+
+#include <qbytearray.h>
+#include <qcryptographichash.h>
+#include <qdatetime.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qfiledevice.h>
+#include <qfileinfo.h>
+#include <qimage.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qmutex.h>
+#include <qsavefile.h>
+#include <qsize.h>
+#include <qstring.h>
+#include <qtenvironmentvariables.h>
+#include <qtypes.h>
+
+#include "logcat.hpp"
+#include "paths.hpp"
+
+namespace {
+QS_LOGGING_CATEGORY(logIconDiskCache, "quickshell.iconimage.diskcache", QtWarningMsg);
+
+constexpr quint32 ICON_MAGIC = 0x51534943; // QSIC
+// Must be incremented whenever the file layout changes.
+constexpr quint32 ICON_VERSION = 1;
+constexpr qint32 ICON_MAX_SIZE = 4096;
+
+constexpr qint64 DEFAULT_BUDGET_MIB = 64;
+// Eviction frees space down to this percentage of the budget, so it doesn't run on every store.
+constexpr qint64 EVICT_TARGET_PERCENT = 75;
+// Use times are only written back to the file mtime at this granularity.
+constexpr qint64 TOUCH_INTERVAL_SECS = 60 * 60;
+
+struct IconFileHeader {
+	quint32 magic = ICON_MAGIC;
+	quint32 version = ICON_VERSION;
+	qint32 width = 0;
+	qint32 height = 0;
+	qint32 bytesPerLine = 0;
+	qint32 reserved = 0;
+};
+
+} // namespace
+
+IconDiskCache::IconDiskCache(QString dir, qint64 budget): dir(std::move(dir)), budget(budget) {}
+
+IconDiskCache* IconDiskCache::instance() {
+	static auto* instance = []() -> IconDiskCache* {
+		if (!qEnvironmentVariableIsSet("QS_ICON_DISK_CACHE")) return nullptr;
+
+		auto ok = false;
+		auto budget = qint64(qEnvironmentVariableIntValue("QS_ICON_DISK_CACHE", &ok));
+		if (!ok || budget <= 0) budget = DEFAULT_BUDGET_MIB;
+
+		auto dir = QsPaths::instance()->shellCacheDir().filePath("icons");
+		qCDebug(logIconDiskCache) << "Caching icons in" << dir << "with a budget of" << budget << "MiB";
+
+		return new IconDiskCache(dir, budget * 1024 * 1024); // NOLINT
+	}();
+
+	return instance;
+}
+
+QString IconDiskCache::entryName(const QString& path, const QSize& size) {
+	auto info = QFileInfo(path);
+	if (!info.isFile()) return QString();
+
+	auto key = QString("%1\n%2\n%3x%4")
+	               .arg(path)
+	               .arg(info.lastModified().toMSecsSinceEpoch())
+	               .arg(size.width())
+	               .arg(size.height());
+
+	auto hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1);
+	return QString::fromLatin1(hash.toHex()) + ".qsi";
+}
+
+QImage IconDiskCache::load(const QString& path, const QSize& size) {
+	auto name = IconDiskCache::entryName(path, size);
+	if (name.isEmpty()) return QImage();
+
+	auto file = QFile(this->dir + '/' + name);
+	if (!file.open(QFile::ReadOnly)) return QImage();
+
+	auto header = IconFileHeader();
+	auto* headerData = reinterpret_cast<char*>(&header); // NOLINT
+	if (file.read(headerData, sizeof(header)) != sizeof(header) || header.magic != ICON_MAGIC
+	    || header.version != ICON_VERSION || header.width <= 0 || header.width > ICON_MAX_SIZE
+	    || header.height <= 0 || header.height > ICON_MAX_SIZE)
+	{
+		qCDebug(logIconDiskCache) << "Ignoring cached icon with unknown header" << file.fileName();
+		return QImage();
+	}
+
+	auto image = QImage(header.width, header.height, QImage::Format_ARGB32_Premultiplied);
+	if (image.isNull() || image.bytesPerLine() != header.bytesPerLine
+	    || file.size() != qint64(sizeof(header)) + image.sizeInBytes())
+	{
+		qCWarning(logIconDiskCache) << "Ignoring corrupt cached icon" << file.fileName();
+		return QImage();
+	}
+
+	auto* bits = reinterpret_cast<char*>(image.bits()); // NOLINT
+	if (file.read(bits, image.sizeInBytes()) != image.sizeInBytes()) return QImage();
+
+	auto now = QDateTime::currentDateTimeUtc();
+	if (file.fileTime(QFileDevice::FileModificationTime).secsTo(now) > TOUCH_INTERVAL_SECS) {
+		file.setFileTime(now, QFileDevice::FileModificationTime);
+	}
+
+	{
+		auto locker = QMutexLocker(&this->mutex);
+		if (auto it = this->entries.find(name); it != this->entries.end()) it->lastUsed = now;
+	}
+
+	return image;
+}
+
+void IconDiskCache::store(const QString& path, const QSize& size, const QImage& image) {
+	auto name = IconDiskCache::entryName(path, size);
+	if (name.isEmpty() || image.isNull()) return;
+
+	auto converted = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+	auto header = IconFileHeader();
+	header.width = converted.width();
+	header.height = converted.height();
+	header.bytesPerLine = static_cast<qint32>(converted.bytesPerLine());
+
+	{
+		// Loading entries creates the directory.
+		auto locker = QMutexLocker(&this->mutex);
+		this->loadEntries();
+	}
+
+	auto file = QSaveFile(this->dir + '/' + name);
+	if (!file.open(QFile::WriteOnly)) {
+		qCWarning(logIconDiskCache) << "Could not open" << file.fileName() << "for writing";
+		return;
+	}
+
+	const auto* headerData = reinterpret_cast<const char*>(&header);         // NOLINT
+	const auto* bits = reinterpret_cast<const char*>(converted.constBits()); // NOLINT
+	file.write(headerData, sizeof(header));
+	file.write(bits, converted.sizeInBytes());
+
+	if (!file.commit()) {
+		qCWarning(logIconDiskCache) << "Could not write cached icon" << file.fileName();
+		return;
+	}
+
+	auto fileSize = qint64(sizeof(header)) + converted.sizeInBytes();
+
+	auto locker = QMutexLocker(&this->mutex);
+	auto& entry = this->entries[name];
+	this->totalSize += fileSize - entry.size;
+	entry.size = fileSize;
+	entry.lastUsed = QDateTime::currentDateTimeUtc();
+
+	if (this->totalSize > this->budget) this->evict();
+}
+
+qint64 IconDiskCache::diskUsage() {
+	auto locker = QMutexLocker(&this->mutex);
+	this->loadEntries();
+	return this->totalSize;
+}
+
+void IconDiskCache::loadEntries() {
+	if (this->entriesLoaded) return;
+	this->entriesLoaded = true;
+
+	auto dir = QDir(this->dir);
+	if (!dir.mkpath(".")) {
+		qCWarning(logIconDiskCache) << "Could not create icon cache directory" << this->dir;
+		return;
+	}
+
+	for (const auto& info: dir.entryInfoList({"*.qsi"}, QDir::Files)) {
+		this->entries.insert(info.fileName(), {.size = info.size(), .lastUsed = info.lastModified()});
+		this->totalSize += info.size();
+	}
+}
+
+void IconDiskCache::evict() {
+	auto names = this->entries.keys();
+	std::ranges::sort(names, [this](const QString& a, const QString& b) {
+		return this->entries.value(a).lastUsed < this->entries.value(b).lastUsed;
+	});
+
+	auto target = this->budget * EVICT_TARGET_PERCENT / 100;
+	auto removed = 0;
+
+	for (const auto& name: names) {
+		if (this->totalSize <= target) break;
+
+		QFile::remove(this->dir + '/' + name);
+		this->totalSize -= this->entries.take(name).size;
+		removed++;
+	}
+
+	qCDebug(logIconDiskCache) << "Evicted" << removed << "cached icons, using" << this->totalSize
+	                          << "bytes";
+}
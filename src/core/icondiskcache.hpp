@@ -0,0 +1,50 @@
+#pragma once
+
+#include <qdatetime.h>
+#include <qhash.h>
+#include <qimage.h>
+#include <qmutex.h>
+#include <qsize.h>
+#include <qstring.h>
+#include <qtypes.h>
+
+// Persistent cache of rasterized vector icons, stored as uncompressed premultiplied ARGB32
+// so loading an icon is a single read into the image buffer.
+//
+// Entries are keyed by source path, source mtime and size, and the least recently used
+// entries are removed once the cache grows past its disk budget.
+class IconDiskCache {
+public:
+	explicit IconDiskCache(QString dir, qint64 budget);
+
+	// The shell's icon cache, or null unless enabled with `QS_ICON_DISK_CACHE`.
+	// The variable may be set to the disk budget in MiB.
+	static IconDiskCache* instance();
+
+	// Thread safe. Returns a null image on a miss.
+	QImage load(const QString& path, const QSize& size);
+	// Thread safe.
+	void store(const QString& path, const QSize& size, const QImage& image);
+
+	[[nodiscard]] qint64 diskUsage();
+
+private:
+	struct Entry {
+		qint64 size = 0;
+		QDateTime lastUsed;
+	};
+
+	// Requires the mutex to be held.
+	void loadEntries();
+	void evict();
+
+	[[nodiscard]] static QString entryName(const QString& path, const QSize& size);
+
+	QString dir;
+	qint64 budget;
+
+	QMutex mutex;
+	bool entriesLoaded = false;
+	QHash<QString, Entry> entries;
+	qint64 totalSize = 0;
+};
@@ -1,68 +1,312 @@
 #include "iconimageprovider.hpp"
 #include <algorithm>
+#include <utility>
 
+#include <qbytearray.h>
+#include <qcache.h>
 #include <qcolor.h>
-#include <qicon.h>
+#include <qdir.h>
+#include <qhash.h>
+#include <qhashfunctions.h>
+#include <qimage.h>
+#include <qimageiohandler.h>
+#include <qimagereader.h>
+#include <qlist.h>
 #include <qlogging.h>
+#include <qmutex.h>
+#include <qnamespace.h>
+#include <qobject.h>
 #include <qpainter.h>
 #include <qpixmap.h>
+#include <qquickimageprovider.h>
 #include <qsize.h>
 #include <qstring.h>
+#include <qthread.h>
+#include <qthreadpool.h>
 
-QPixmap
-IconImageProvider::requestPixmap(const QString& id, QSize* size, const QSize& requestedSize) {
-	QString iconName;
+#include "icondiskcache.hpp"
+#include "icontheme.hpp"
+
+namespace {
+
+constexpr qsizetype ICON_CACHE_BYTES = 64ll * 1024 * 1024;
+constexpr qint32 ICON_DECODE_THREADS = 4;
+
+struct IconRequest {
+	QString name;
 	QString fallbackName;
 	QString path;
+	QSize size;
+};
+
+IconRequest parseRequest(const QString& id, const QSize& requestedSize) {
+	auto request = IconRequest();
 
 	auto splitIdx = id.indexOf("?path=");
 	if (splitIdx != -1) {
-		iconName = id.sliced(0, splitIdx);
-		path = id.sliced(splitIdx + 6);
-		path = QString("/%1/%2").arg(path, iconName.sliced(iconName.lastIndexOf('/') + 1));
+		request.name = id.sliced(0, splitIdx);
+		auto path = id.sliced(splitIdx + 6);
+		request.path =
+		    QString("/%1/%2").arg(path, request.name.sliced(request.name.lastIndexOf('/') + 1));
 	} else {
 		splitIdx = id.indexOf("?fallback=");
 		if (splitIdx != -1) {
-			iconName = id.sliced(0, splitIdx);
-			fallbackName = id.sliced(splitIdx + 10);
+			request.name = id.sliced(0, splitIdx);
+			request.fallbackName = id.sliced(splitIdx + 10);
 		} else {
-			iconName = id;
+			request.name = id;
 		}
 	}
 
-	auto icon = QIcon::fromTheme(iconName);
-	if (icon.isNull() && !fallbackName.isEmpty()) icon = QIcon::fromTheme(fallbackName);
-	if (icon.isNull() && !path.isEmpty()) icon = QPixmap(path);
+	request.size = requestedSize.isValid() ? requestedSize : QSize(100, 100);
+	if (request.size.width() == 0 || request.size.height() == 0) request.size = QSize(2, 2);
+
+	return request;
+}
+
+// Resolves a request to the file it should be loaded from, or an empty string.
+QString resolveRequest(const IconRequest& request) {
+	if (QDir::isAbsolutePath(request.name)) return request.name;
+
+	auto* themes = IconThemeManager::instance();
+	auto iconSize = std::max(request.size.width(), request.size.height());
+
+	auto path = themes->iconPath(request.name, iconSize);
+	if (path.isEmpty() && !request.fallbackName.isEmpty()) {
+		path = themes->iconPath(request.fallbackName, iconSize);
+	}
+
+	if (path.isEmpty()) path = request.path;
+	return path;
+}
+
+// Vector images are rendered to fit the requested size. Raster images are only scaled down,
+// matching QIcon.
+QImage readIcon(const QString& path, const QSize& size) {
+	auto reader = QImageReader(path);
+	auto sourceSize = reader.size();
+
+	auto format = reader.format();
+	auto scalable = format == "svg" || format == "svgz";
+
+	if (sourceSize.isValid()
+	    && (scalable || sourceSize.width() > size.width() || sourceSize.height() > size.height()))
+	{
+		auto targetSize = sourceSize.scaled(size, Qt::KeepAspectRatio);
+		if (reader.supportsOption(QImageIOHandler::ScaledSize)) reader.setScaledSize(targetSize);
+
+		auto image = reader.read();
+		if (!image.isNull() && image.size() != targetSize) {
+			image = image.scaled(targetSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		}
+
+		return image;
+	}
+
+	return reader.read();
+}
 
-	auto targetSize = requestedSize.isValid() ? requestedSize : QSize(100, 100);
-	if (targetSize.width() == 0 || targetSize.height() == 0) targetSize = QSize(2, 2);
-	auto pixmap = icon.pixmap(targetSize.width(), targetSize.height());
+QImage decodeIcon(const QString& path, const QSize& size) {
+	// Raster icons decode about as fast as they could be read from the disk cache.
+	auto* diskCache =
+	    path.endsWith(".svg") || path.endsWith(".svgz") ? IconDiskCache::instance() : nullptr;
+
+	if (diskCache) {
+		auto image = diskCache->load(path, size);
+		if (!image.isNull()) return image;
+	}
+
+	auto image = readIcon(path, size);
+	if (diskCache && !image.isNull()) diskCache->store(path, size, image);
+
+	return image;
+}
+
+// The resolved file path is part of the key, so a theme change never returns stale images.
+// Device pixel ratios are already applied to the requested size by QtQuick.
+struct IconImageKey {
+	QString path;
+	QSize size;
+
+	[[nodiscard]] bool operator==(const IconImageKey& other) const = default;
+};
+
+size_t qHash(const IconImageKey& key, size_t seed = 0) noexcept {
+	return qHashMulti(seed, key.path, key.size.width(), key.size.height());
+}
+
+class IconImageResponse: public QQuickImageResponse {
+public:
+	[[nodiscard]] QQuickTextureFactory* textureFactory() const override {
+		return QQuickTextureFactory::textureFactoryForImage(this->image);
+	}
+
+	// May be called from any thread. Finished is always queued, as QtQuick connects to it
+	// after requestImageResponse returns.
+	void finish(QImage image) {
+		this->image = std::move(image);
+		QMetaObject::invokeMethod(this, &QQuickImageResponse::finished, Qt::QueuedConnection);
+	}
+
+private:
+	QImage image;
+};
+
+class IconImageCache {
+public:
+	static IconImageCache* instance() {
+		static auto* instance = new IconImageCache(); // NOLINT
+		return instance;
+	}
+
+	// Finishes the response with a cached image, or after the image is decoded on the pool.
+	void load(const IconImageKey& key, IconImageResponse* response) {
+		auto locker = QMutexLocker(&this->mutex);
+
+		if (auto* image = this->images.object(key)) {
+			response->finish(*image);
+			return;
+		}
+
+		// Requests for an icon that is already being decoded wait for the same decode.
+		auto pending = this->pending.find(key);
+		if (pending != this->pending.end()) {
+			pending->append(response);
+			return;
+		}
+
+		this->pending.insert(key, {response});
+		this->pool.start([this, key]() { this->decode(key); });
+	}
+
+	// Decodes the image on the calling thread if it is not cached.
+	QImage loadSync(const IconImageKey& key) {
+		{
+			auto locker = QMutexLocker(&this->mutex);
+			if (auto* image = this->images.object(key)) return *image;
+		}
+
+		auto image = decodeIcon(key.path, key.size);
+		if (!image.isNull()) this->insert(key, image);
+		return image;
+	}
+
+	void clear() {
+		auto locker = QMutexLocker(&this->mutex);
+		this->images.clear();
+	}
+
+private:
+	IconImageCache() {
+		this->images.setMaxCost(ICON_CACHE_BYTES);
+		this->pool.setMaxThreadCount(std::min(QThread::idealThreadCount(), ICON_DECODE_THREADS));
+
+		// Icon files may have been replaced in place.
+		auto* themes = IconThemeManager::instance();
+		QObject::connect(themes, &IconThemeManager::iconThemeChanged, themes, [this]() {
+			this->clear();
+		});
+	}
+
+	void insert(const IconImageKey& key, const QImage& image) {
+		auto locker = QMutexLocker(&this->mutex);
+		this->images.insert(key, new QImage(image), image.sizeInBytes());
+	}
+
+	void decode(const IconImageKey& key) {
+		auto image = decodeIcon(key.path, key.size);
+		if (!image.isNull()) this->insert(key, image);
+
+		auto responses = QList<IconImageResponse*>();
+
+		{
+			auto locker = QMutexLocker(&this->mutex);
+			responses = this->pending.take(key);
+		}
+
+		if (image.isNull()) {
+			qWarning() << "Could not load icon" << key.path << "at size" << key.size;
+			image = IconImageProvider::missingImage(key.size);
+		}
+
+		for (auto* response: responses) response->finish(image);
+	}
+
+	QMutex mutex;
+	QCache<IconImageKey, QImage> images;
+	QHash<IconImageKey, QList<IconImageResponse*>> pending;
+	QThreadPool pool;
+};
+
+} // namespace
+
+IconImageProvider::IconImageProvider() {
+	// These are created here as they must be initialized on the main thread, while requests
+	// are made from QtQuick's image loader thread.
+	IconThemeManager::instance();
+	IconImageCache::instance();
+	IconDiskCache::instance();
+}
+
+QQuickImageResponse*
+IconImageProvider::requestImageResponse(const QString& id, const QSize& requestedSize) {
+	auto request = parseRequest(id, requestedSize);
+	auto path = resolveRequest(request);
+	auto* response = new IconImageResponse();
+
+	if (path.isEmpty()) {
+		qWarning() << "Could not load icon" << id << "at size" << request.size << "from request";
+		response->finish(IconImageProvider::missingImage(request.size));
+	} else {
+		IconImageCache::instance()->load({.path = path, .size = request.size}, response);
+	}
+
+	return response;
+}
+
+QPixmap
+IconImageProvider::requestPixmap(const QString& id, QSize* size, const QSize& requestedSize) {
+	auto request = parseRequest(id, requestedSize);
+	auto path = resolveRequest(request);
+
+	auto image = QImage();
+	if (!path.isEmpty()) {
+		image = IconImageCache::instance()->loadSync({.path = path, .size = request.size});
+	}
+
+	auto pixmap = QPixmap::fromImage(image);
 
 	if (pixmap.isNull()) {
-		qWarning() << "Could not load icon" << id << "at size" << targetSize << "from request";
-		pixmap = IconImageProvider::missingPixmap(targetSize);
+		qWarning() << "Could not load icon" << id << "at size" << request.size << "from request";
+		pixmap = IconImageProvider::missingPixmap(request.size);
 	}
 
 	if (size != nullptr) *size = pixmap.size();
 	return pixmap;
 }
 
-QPixmap IconImageProvider::missingPixmap(const QSize& size) {
+QImage IconImageProvider::missingImage(const QSize& size) {
 	auto width = size.width() % 2 == 0 ? size.width() : size.width() + 1;
 	auto height = size.height() % 2 == 0 ? size.height() : size.height() + 1;
 	width = std::max(width, 2);
 	height = std::max(height, 2);
 
-	auto pixmap = QPixmap(width, height);
-	pixmap.fill(QColorConstants::Black);
-	auto painter = QPainter(&pixmap);
+	auto image = QImage(width, height, QImage::Format_RGB32);
+	image.fill(QColorConstants::Black);
+	auto painter = QPainter(&image);
 
 	auto halfWidth = width / 2;
 	auto halfHeight = height / 2;
 	auto purple = QColor(0xd900d8);
 	painter.fillRect(halfWidth, 0, halfWidth, halfHeight, purple);
 	painter.fillRect(0, halfHeight, halfWidth, halfHeight, purple);
-	return pixmap;
+	painter.end();
+
+	return image;
+}
+
+QPixmap IconImageProvider::missingPixmap(const QSize& size) {
+	return QPixmap::fromImage(IconImageProvider::missingImage(size));
 }
 
 QString IconImageProvider::requestString(
@@ -1,14 +1,24 @@
 #pragma once
 
+#include <qimage.h>
 #include <qpixmap.h>
 #include <qquickimageprovider.h>
+#include <qsize.h>
+#include <qstring.h>
 
-class IconImageProvider: public QQuickImageProvider {
+// Loads system icons on a dedicated thread pool. Decoded icons are shared between all
+// engine generations through a byte budgeted LRU cache, and concurrent requests for the
+// same icon at the same size are decoded once.
+class IconImageProvider: public QQuickAsyncImageProvider {
 public:
-	explicit IconImageProvider(): QQuickImageProvider(QQuickImageProvider::Pixmap) {}
+	explicit IconImageProvider();
 
+	QQuickImageResponse* requestImageResponse(const QString& id, const QSize& requestedSize) override;
+
+	// Synchronous variant for consumers that can't wait for a response, such as platform menus.
 	QPixmap requestPixmap(const QString& id, QSize* size, const QSize& requestedSize) override;
 
+	static QImage missingImage(const QSize& size);
 	static QPixmap missingPixmap(const QSize& size);
 
 	static QString requestString(
@@ -3,6 +3,7 @@
 
 #include <qicon.h>
 #include <qiconengine.h>
+#include <qimage.h>
 #include <qlogging.h>
 #include <qobject.h>
 #include <qpixmap.h>
@@ -11,8 +12,25 @@
 #include <qrect.h>
 #include <qsize.h>
 #include <qstring.h>
+#include <qurl.h>
 
 #include "generation.hpp"
+#include "iconimageprovider.hpp"
+
+namespace {
+
+QQuickImageProvider* findProvider(QQmlEngine* engine, const QUrl& url, QString& id) {
+	id = url.path();
+	if (!id.isEmpty()) id = id.sliced(1);
+	return qobject_cast<QQuickImageProvider*>(engine->imageProvider(url.authority()));
+}
+
+// The icon provider is asynchronous, but also answers synchronous pixmap requests.
+bool supportsPixmapRequests(QQuickImageProvider* provider) {
+	return provider->imageType() == QQmlImageProviderBase::Pixmap
+	    || dynamic_cast<IconImageProvider*>(provider) != nullptr;
+}
+} // namespace
 
 // QMenu re-calls pixmap() every time the mouse moves so its important to cache it.
 class PixmapCacheIconEngine: public QIconEngine {
@@ -49,7 +67,7 @@ public:
 	    , id(std::move(id)) {}
 
 	QPixmap createPixmap(const QSize& size) override {
-		if (this->provider->imageType() == QQmlImageProviderBase::Pixmap) {
+		if (supportsPixmapRequests(this->provider)) {
 			return this->provider->requestPixmap(this->id, nullptr, size);
 		} else if (this->provider->imageType() == QQmlImageProviderBase::Image) {
 			auto image = this->provider->requestImage(this->id, nullptr, size);
@@ -74,18 +92,15 @@ QIcon getEngineImageAsIcon(QQmlEngine* engine, const QUrl& url) {
 
 	auto scheme = url.scheme();
 	if (scheme == "image") {
-		auto providerName = url.authority();
-		auto path = url.path();
-		if (!path.isEmpty()) path = path.sliced(1);
-
-		auto* provider = qobject_cast<QQuickImageProvider*>(engine->imageProvider(providerName));
+		auto path = QString();
+		auto* provider = findProvider(engine, url, path);
 
 		if (provider == nullptr) {
 			qWarning() << "iconByUrl failed: no provider found for" << url;
 			return QIcon();
 		}
 
-		if (provider->imageType() == QQmlImageProviderBase::Pixmap
+		if (supportsPixmapRequests(provider)
 		    || provider->imageType() == QQmlImageProviderBase::Image)
 		{
 			return QIcon(new ImageProviderIconEngine(provider, path));
@@ -103,3 +118,22 @@ QIcon getCurrentEngineImageAsIcon(const QUrl& url) {
 	if (!generation) return QIcon();
 	return getEngineImageAsIcon(generation->engine, url);
 }
+
+QImage getEngineImage(QQmlEngine* engine, const QUrl& url, const QSize& requestedSize) {
+	if (!engine || url.scheme() != "image") return QImage();
+
+	auto id = QString();
+	auto* provider = findProvider(engine, url, id);
+
+	if (provider == nullptr) {
+		qWarning() << "No image provider found for" << url;
+		return QImage();
+	} else if (supportsPixmapRequests(provider)) {
+		return provider->requestPixmap(id, nullptr, requestedSize).toImage();
+	} else if (provider->imageType() == QQmlImageProviderBase::Image) {
+		return provider->requestImage(id, nullptr, requestedSize);
+	} else {
+		qWarning() << "Image provider for" << url << "does not support synchronous requests";
+		return QImage();
+	}
+}
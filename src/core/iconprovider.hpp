@@ -1,8 +1,14 @@
 #pragma once
 
 #include <qicon.h>
+#include <qimage.h>
 #include <qqmlengine.h>
+#include <qsize.h>
 #include <qurl.h>
 
 QIcon getEngineImageAsIcon(QQmlEngine* engine, const QUrl& url);
 QIcon getCurrentEngineImageAsIcon(const QUrl& url);
+
+// Requests an image from one of the engine's synchronous image providers.
+// Returns a null image for other urls or providers.
+QImage getEngineImage(QQmlEngine* engine, const QUrl& url, const QSize& requestedSize);
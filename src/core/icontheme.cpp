@@ -0,0 +1,639 @@
+#include "icontheme.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <qcontainerfwd.h>
+#include <qdir.h>
+#include <qdiriterator.h>
+#include <qendian.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qhash.h>
+#include <qicon.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qmutex.h>
+#include <qnamespace.h>
+#include <qobject.h>
+#include <qset.h>
+#include <qsharedpointer.h>
+#include <qstring.h>
+#include <qthread.h>
+#include <qtmetamacros.h>
+
+#include "filewatch.hpp"
+#include "logcat.hpp"
+
+namespace {
+QS_LOGGING_CATEGORY(logIconTheme, "quickshell.icontheme", QtWarningMsg);
+
+constexpr qint32 DEBOUNCE_MS = 100;
+constexpr qsizetype LOOKUP_CACHE_LIMIT = 4096;
+
+// Suffix flags, matching the ones used by icon-theme.cache.
+enum IconSuffix : quint16 {
+	SuffixXpm = 1,
+	SuffixSvg = 2,
+	SuffixPng = 4,
+};
+
+IconSuffix suffixFlag(QStringView fileName) {
+	if (fileName.endsWith(u".png")) return SuffixPng;
+	if (fileName.endsWith(u".svg")) return SuffixSvg;
+	if (fileName.endsWith(u".xpm")) return SuffixXpm;
+	return IconSuffix(0);
+}
+
+// The spec prefers png, then svg, then xpm when a directory has multiple files for an icon.
+QString suffixString(quint16 flags) {
+	if (flags & SuffixPng) return QStringLiteral(".png");
+	if (flags & SuffixSvg) return QStringLiteral(".svg");
+	if (flags & SuffixXpm) return QStringLiteral(".xpm");
+	return QString();
+}
+
+struct IconThemeDir {
+	enum Type : quint8 {
+		Fixed,
+		Scalable,
+		Threshold,
+	};
+
+	QString path;
+	qint32 size = 0;
+	qint32 scale = 1;
+	qint32 minSize = 0;
+	qint32 maxSize = 0;
+	qint32 threshold = 2;
+	Type type = Threshold;
+
+	[[nodiscard]] bool matchesSize(qint32 size, qint32 scale) const {
+		if (this->scale != scale) return false;
+
+		switch (this->type) {
+		case Fixed: return this->size == size;
+		case Scalable: return this->minSize <= size && size <= this->maxSize;
+		case Threshold:
+			return this->size - this->threshold <= size && size <= this->size + this->threshold;
+		}
+
+		return false;
+	}
+
+	[[nodiscard]] qint32 sizeDistance(qint32 size, qint32 scale) const {
+		auto scaled = size * scale;
+
+		switch (this->type) {
+		case Fixed: return std::abs(this->size * this->scale - scaled);
+		case Scalable:
+			if (scaled < this->minSize * this->scale) return this->minSize * this->scale - scaled;
+			if (scaled > this->maxSize * this->scale) return scaled - this->maxSize * this->scale;
+			return 0;
+		case Threshold:
+			if (scaled < (this->size - this->threshold) * this->scale) {
+				return this->minSize * this->scale - scaled;
+			}
+			if (scaled > (this->size + this->threshold) * this->scale) {
+				return scaled - this->maxSize * this->scale;
+			}
+			return 0;
+		}
+
+		return 0;
+	}
+};
+
+struct IconImage {
+	qint32 dir = -1;
+	quint16 flags = 0;
+};
+
+// Memory mapped GTK icon-theme.cache. All values are big endian.
+//
+// Header: u16 major, u16 minor, u32 hash offset, u32 directory list offset
+// Directory list: u32 count, u32 string offset[count]
+// Hash: u32 bucket count, u32 icon offset[bucket count]
+// Icon: u32 chain offset, u32 name offset, u32 image list offset
+// Image list: u32 count, { u16 directory index, u16 flags, u32 image data offset }[count]
+class GtkIconCache {
+public:
+	// Opens the cache of a theme directory, if one exists and is not older than the directory.
+	static std::unique_ptr<GtkIconCache> open(const QString& themeDir) {
+		auto info = QFileInfo(themeDir + "/icon-theme.cache");
+		if (!info.isFile()) return nullptr;
+
+		if (info.lastModified() < QFileInfo(themeDir).lastModified()) {
+			qCDebug(logIconTheme) << "Ignoring outdated icon cache" << info.filePath();
+			return nullptr;
+		}
+
+		auto cache = std::make_unique<GtkIconCache>();
+		cache->file.setFileName(info.filePath());
+		if (!cache->file.open(QFile::ReadOnly)) return nullptr;
+
+		cache->size = cache->file.size();
+		cache->data = cache->file.map(0, cache->size);
+
+		if (!cache->data || !cache->validate()) {
+			qCWarning(logIconTheme) << "Ignoring invalid icon cache" << info.filePath();
+			return nullptr;
+		}
+
+		return cache;
+	}
+
+	[[nodiscard]] QStringList directories() const {
+		auto dirListOffset = this->read32(8);
+		auto count = this->read32(dirListOffset);
+
+		auto dirs = QStringList();
+		dirs.reserve(count);
+
+		for (quint32 i = 0; i != count; i++) {
+			dirs.append(QString::fromUtf8(this->string(this->read32(dirListOffset + 4 + i * 4))));
+		}
+
+		return dirs;
+	}
+
+	[[nodiscard]] QList<IconImage> images(const QByteArray& name) const {
+		auto hashOffset = this->read32(4);
+		auto bucketCount = this->read32(hashOffset);
+
+		auto bucket = GtkIconCache::hash(name) % bucketCount;
+		auto iconOffset = this->read32(hashOffset + 4 + bucket * 4);
+
+		// Corrupt caches may contain chain cycles, which are broken by the step limit.
+		for (auto steps = this->size / 12; iconOffset != NONE && steps != 0; steps--) {
+			if (!this->inBounds(iconOffset, 12)) break;
+
+			auto iconName = this->string(this->read32(iconOffset + 4));
+
+			if (iconName.size() == name.size()
+			    && std::memcmp(iconName.data(), name.data(), name.size()) == 0)
+			{
+				auto listOffset = this->read32(iconOffset + 8);
+				if (!this->inBounds(listOffset, 4)) break;
+
+				auto count = this->read32(listOffset);
+				if (!this->inBounds(listOffset + 4, quint64(count) * 8)) break;
+
+				auto images = QList<IconImage>();
+				images.reserve(count);
+
+				for (quint32 i = 0; i != count; i++) {
+					auto imageOffset = listOffset + 4 + i * 8;
+					images.append({.dir = this->read16(imageOffset), .flags = this->read16(imageOffset + 2)});
+				}
+
+				return images;
+			}
+
+			iconOffset = this->read32(iconOffset);
+		}
+
+		return {};
+	}
+
+	// Same as GTK's icon_name_hash, which hashes signed chars.
+	static quint32 hash(const QByteArray& name) {
+		auto hash = quint32(0);
+		for (auto c: name) hash = (hash << 5) - hash + quint32(static_cast<signed char>(c));
+		return hash;
+	}
+
+private:
+	static constexpr quint32 NONE = 0xffffffff;
+
+	[[nodiscard]] bool validate() const {
+		if (!this->inBounds(0, 12) || this->read16(0) != 1) return false;
+
+		auto hashOffset = this->read32(4);
+		if (!this->inBounds(hashOffset, 4)) return false;
+		auto bucketCount = this->read32(hashOffset);
+		if (bucketCount == 0 || !this->inBounds(hashOffset + 4, quint64(bucketCount) * 4)) {
+			return false;
+		}
+
+		auto dirListOffset = this->read32(8);
+		if (!this->inBounds(dirListOffset, 4)) return false;
+		auto dirCount = this->read32(dirListOffset);
+		return this->inBounds(dirListOffset + 4, quint64(dirCount) * 4);
+	}
+
+	[[nodiscard]] bool inBounds(quint64 offset, quint64 length) const {
+		return offset + length <= quint64(this->size);
+	}
+
+	// Offsets must be bounds checked by the caller, except for 32 bit reads which return
+	// NONE when out of bounds.
+	[[nodiscard]] quint16 read16(quint32 offset) const {
+		return qFromBigEndian<quint16>(this->data + offset);
+	}
+
+	[[nodiscard]] quint32 read32(quint32 offset) const {
+		if (!this->inBounds(offset, 4)) return NONE;
+		return qFromBigEndian<quint32>(this->data + offset);
+	}
+
+	[[nodiscard]] QByteArrayView string(quint32 offset) const {
+		if (offset >= this->size) return QByteArrayView();
+
+		const auto* str = reinterpret_cast<const char*>(this->data + offset); // NOLINT
+		auto length = qstrnlen(str, this->size - offset);
+		if (qint64(length) == this->size - offset) return QByteArrayView(); // unterminated
+
+		return QByteArrayView(str, qsizetype(length));
+	}
+
+	QFile file;
+	const uchar* data = nullptr;
+	qint64 size = 0;
+};
+
+// Parses the parts of an index.theme file relevant to lookups.
+bool parseIndexTheme(const QString& path, QStringList& inherits, QList<IconThemeDir>& dirs) {
+	auto file = QFile(path);
+	if (!file.open(QFile::ReadOnly)) return false;
+
+	auto groups = QHash<QString, QHash<QString, QString>>();
+	auto group = QString();
+
+	for (const auto& rawLine: QString::fromUtf8(file.readAll()).split(u'\n', Qt::SkipEmptyParts)) {
+		auto line = rawLine.trimmed();
+		if (line.isEmpty() || line.startsWith(u'#')) continue;
+
+		if (line.startsWith(u'[') && line.endsWith(u']')) {
+			group = line.sliced(1, line.length() - 2);
+			continue;
+		}
+
+		if (group.isEmpty()) continue;
+
+		auto splitIdx = line.indexOf(u'=');
+		if (splitIdx == -1) continue;
+
+		groups[group].insert(line.sliced(0, splitIdx).trimmed(), line.sliced(splitIdx + 1).trimmed());
+	}
+
+	const auto& theme = groups.value("Icon Theme");
+
+	for (const auto& parent: theme.value("Inherits").split(u',', Qt::SkipEmptyParts)) {
+		inherits.append(parent.trimmed());
+	}
+
+	// ScaledDirectories is a KDE extension, listing directories hidden from older implementations.
+	auto dirNames = theme.value("Directories").split(u',', Qt::SkipEmptyParts);
+	dirNames.append(theme.value("ScaledDirectories").split(u',', Qt::SkipEmptyParts));
+
+	auto seen = QSet<QString>();
+
+	for (const auto& rawName: dirNames) {
+		auto name = rawName.trimmed();
+		if (seen.contains(name)) continue;
+		seen.insert(name);
+
+		const auto& dirGroup = groups.value(name);
+
+		auto dir = IconThemeDir();
+		dir.path = name;
+		dir.size = dirGroup.value("Size").toInt();
+		if (dir.size <= 0) continue;
+
+		dir.scale = std::max(dirGroup.value("Scale", "1").toInt(), 1);
+		dir.minSize = dirGroup.value("MinSize", QString::number(dir.size)).toInt();
+		dir.maxSize = dirGroup.value("MaxSize", QString::number(dir.size)).toInt();
+		dir.threshold = dirGroup.value("Threshold", "2").toInt();
+
+		auto type = dirGroup.value("Type", "Threshold");
+		if (type == "Fixed") dir.type = IconThemeDir::Fixed;
+		else if (type == "Scalable") dir.type = IconThemeDir::Scalable;
+		else dir.type = IconThemeDir::Threshold;
+
+		dirs.append(dir);
+	}
+
+	return true;
+}
+
+} // namespace
+
+// One base directory of a theme, such as /usr/share/icons/<theme>.
+class IconThemeBase {
+public:
+	IconThemeBase(QString path, const QList<IconThemeDir>& dirs): path(std::move(path)) {
+		this->cache = GtkIconCache::open(this->path);
+
+		if (this->cache) {
+			auto cacheDirs = this->cache->directories();
+			this->cacheDirs.reserve(cacheDirs.length());
+
+			for (const auto& cacheDir: cacheDirs) {
+				auto it = std::ranges::find(dirs, cacheDir, &IconThemeDir::path);
+				this->cacheDirs.append(it == dirs.end() ? -1 : qint32(it - dirs.begin()));
+			}
+
+			return;
+		}
+
+		for (qint32 i = 0; i != dirs.length(); i++) {
+			auto iter = QDirIterator(this->path + '/' + dirs.at(i).path, QDir::Files);
+
+			while (iter.hasNext()) {
+				iter.next();
+				auto fileName = iter.fileName();
+
+				auto flag = suffixFlag(fileName);
+				if (flag == 0) continue;
+
+				auto& images = this->icons[fileName.first(fileName.length() - 4)];
+
+				if (!images.isEmpty() && images.last().dir == i) images.last().flags |= flag;
+				else images.append({.dir = i, .flags = flag});
+			}
+		}
+	}
+
+	[[nodiscard]] QList<IconImage> images(const QString& name, const QByteArray& utf8) const {
+		if (!this->cache) return this->icons.value(name);
+
+		auto images = QList<IconImage>();
+
+		for (auto image: this->cache->images(utf8)) {
+			image.dir = this->cacheDirs.value(image.dir, -1);
+			if (image.dir != -1) images.append(image);
+		}
+
+		return images;
+	}
+
+	QString path;
+	std::unique_ptr<GtkIconCache> cache;
+	// Maps cache directory indexes to theme directory indexes, or -1 if not in the theme.
+	QList<qint32> cacheDirs;
+	// Only used without a cache.
+	QHash<QString, QList<IconImage>> icons;
+};
+
+class IconThemeData {
+public:
+	[[nodiscard]] QString lookup(const QString& name, qint32 size, qint32 scale) const {
+		auto utf8 = name.toUtf8();
+
+		// Exact matches win in directory order, then the smallest distance wins in directory order.
+		const IconThemeBase* bestBase = nullptr;
+		auto best = IconImage();
+		auto bestDistance = std::numeric_limits<qint32>::max();
+
+		for (const auto& base: this->bases) {
+			for (const auto& image: base.images(name, utf8)) {
+				if (suffixString(image.flags).isEmpty()) continue;
+
+				const auto& dir = this->dirs.at(image.dir);
+				auto distance = dir.matchesSize(size, scale) ? -1 : dir.sizeDistance(size, scale);
+
+				if (distance < bestDistance || (distance == bestDistance && image.dir < best.dir)) {
+					bestBase = &base;
+					best = image;
+					bestDistance = distance;
+				}
+			}
+		}
+
+		if (!bestBase) return QString();
+		return bestBase->path + '/' + this->dirs.at(best.dir).path + '/' + name
+		     + suffixString(best.flags);
+	}
+
+	QString name;
+	QList<IconThemeDir> dirs;
+	std::vector<IconThemeBase> bases;
+};
+
+IconThemeIndex::IconThemeIndex() = default;
+IconThemeIndex::~IconThemeIndex() = default;
+
+QSharedPointer<const IconThemeIndex> IconThemeIndex::build(
+    const QString& themeName,
+    const QStringList& searchPaths,
+    const QStringList& fallbackPaths
+) {
+	auto index = QSharedPointer<IconThemeIndex>(new IconThemeIndex());
+	index->mThemeName = themeName;
+
+	for (const auto& path: searchPaths) {
+		if (QFileInfo(path).isDir()) index->mWatchPaths.append(path);
+	}
+
+	// hicolor is always searched after all other themes.
+	auto visited = QSet<QString>({QStringLiteral("hicolor")});
+
+	std::function<void(const QString&)> addTheme = [&](const QString& name) {
+		if (name.isEmpty() || visited.contains(name)) return;
+		visited.insert(name);
+
+		auto basePaths = QStringList();
+		auto inherits = QStringList();
+		auto dirs = QList<IconThemeDir>();
+		auto found = false;
+
+		for (const auto& searchPath: searchPaths) {
+			auto basePath = searchPath + '/' + name;
+			if (!QFileInfo(basePath).isDir()) continue;
+
+			basePaths.append(basePath);
+			if (!found) found = parseIndexTheme(basePath + "/index.theme", inherits, dirs);
+		}
+
+		if (!found) {
+			qCDebug(logIconTheme) << "Icon theme" << name << "not found in" << searchPaths;
+			return;
+		}
+
+		auto& theme = index->themes.emplace_back();
+		theme.name = name;
+		theme.dirs = dirs;
+
+		for (const auto& basePath: basePaths) {
+			const auto& base = theme.bases.emplace_back(basePath, theme.dirs);
+			index->mWatchPaths.append(basePath);
+
+			// Changes to cached themes are only picked up when the cache is regenerated.
+			if (!base.cache) {
+				for (const auto& dir: theme.dirs) {
+					auto path = basePath + '/' + dir.path;
+					if (QFileInfo(path).isDir()) index->mWatchPaths.append(path);
+				}
+			}
+
+			qCDebug(logIconTheme) << "Indexed icon theme" << name << "at" << basePath
+			                      << (base.cache ? "from icon cache" : "from directory listing");
+		}
+
+		for (const auto& parent: inherits) addTheme(parent);
+	};
+
+	addTheme(themeName);
+	visited.remove("hicolor");
+	addTheme("hicolor");
+
+	for (const auto& path: fallbackPaths) {
+		if (!QFileInfo(path).isDir()) continue;
+		index->mWatchPaths.append(path);
+
+		auto icons = QHash<QString, QString>();
+		auto iter = QDirIterator(path, QDir::Files);
+
+		while (iter.hasNext()) {
+			iter.next();
+			auto fileName = iter.fileName();
+
+			auto flag = suffixFlag(fileName);
+			if (flag == 0) continue;
+
+			auto name = fileName.first(fileName.length() - 4);
+			auto existing = icons.value(name);
+			if (!existing.isEmpty() && suffixFlag(existing) > flag) continue;
+
+			icons.insert(name, iter.filePath());
+		}
+
+		for (auto it = icons.cbegin(); it != icons.cend(); ++it) {
+			if (!index->fallbackIcons.contains(it.key())) index->fallbackIcons.insert(it.key(), *it);
+		}
+	}
+
+	return index;
+}
+
+QString IconThemeIndex::lookup(const QString& name, qint32 size, qint32 scale) const {
+	if (name.isEmpty()) return QString();
+	auto iconName = name;
+
+	while (true) {
+		for (const auto& theme: this->themes) {
+			auto path = theme.lookup(iconName, size, scale);
+			if (!path.isEmpty()) return path;
+		}
+
+		auto path = this->fallbackIcons.value(iconName);
+		if (!path.isEmpty()) return path;
+
+		// Like GTK and Qt, fall back to less specific names, e.g. a-b-c, a-b, a.
+		auto dashIdx = iconName.lastIndexOf(u'-');
+		if (dashIdx <= 0) return QString();
+		iconName.truncate(dashIdx);
+	}
+}
+
+IconThemeManager::IconThemeManager() {
+	this->debounceTimer.setSingleShot(true);
+	this->debounceTimer.setInterval(DEBOUNCE_MS);
+
+	QObject::connect(
+	    &this->watcher,
+	    &FileWatch::directoryChanged,
+	    this,
+	    &IconThemeManager::onDirectoryChanged
+	);
+
+	QObject::connect(
+	    &this->debounceTimer,
+	    &QTimer::timeout,
+	    this,
+	    &IconThemeManager::invalidate
+	);
+
+	this->loadThemeSettings();
+}
+
+IconThemeManager* IconThemeManager::instance() {
+	static auto* instance = new IconThemeManager(); // NOLINT
+	return instance;
+}
+
+QString IconThemeManager::iconPath(const QString& name, qint32 size, qint32 scale) {
+	// Other threads pick up the new theme once a lookup on the manager's thread notices it.
+	if (QThread::currentThread() == this->thread()) this->checkThemeName();
+
+	auto key = IconLookupKey {.name = name, .size = size, .scale = scale};
+	auto locker = QMutexLocker(&this->mutex);
+
+	auto index = this->index();
+	if (auto it = this->lookupCache.constFind(key); it != this->lookupCache.cend()) return *it;
+
+	auto path = index->lookup(name, size, scale);
+
+	if (this->lookupCache.size() >= LOOKUP_CACHE_LIMIT) this->lookupCache.clear();
+	this->lookupCache.insert(key, path);
+
+	return path;
+}
+
+bool IconThemeManager::hasIcon(const QString& name) {
+	if (QDir::isAbsolutePath(name)) return QFileInfo(name).isFile();
+	// Any icon that exists resolves at some size.
+	return !this->iconPath(name, 48).isEmpty();
+}
+
+QSharedPointer<const IconThemeIndex> IconThemeManager::index() {
+	if (!this->mIndex) {
+		this->mIndex = IconThemeIndex::build(this->themeName, this->searchPaths, this->fallbackPaths);
+		this->lookupCache.clear();
+
+		QMetaObject::invokeMethod(
+		    this,
+		    [this, paths = this->mIndex->watchPaths()]() { this->updateWatches(paths); },
+		    Qt::QueuedConnection
+		);
+	}
+
+	return this->mIndex;
+}
+
+void IconThemeManager::loadThemeSettings() {
+	this->configuredThemeName = QIcon::themeName();
+	this->themeName = this->configuredThemeName;
+	if (this->themeName.isEmpty()) this->themeName = QIcon::fallbackThemeName();
+	if (this->themeName.isEmpty()) this->themeName = QStringLiteral("hicolor");
+
+	this->searchPaths = QIcon::themeSearchPaths();
+	this->fallbackPaths = QIcon::fallbackSearchPaths();
+}
+
+void IconThemeManager::updateWatches(const QStringList& paths) {
+	// Qt resource paths are included in the default search paths but can't be watched.
+	auto watchable = paths;
+	watchable.removeIf([](const QString& path) { return path.startsWith(u':'); });
+	this->watcher.setPaths(watchable);
+}
+
+void IconThemeManager::checkThemeName() {
+	// Only written on this thread, so it can be read without the mutex.
+	if (QIcon::themeName() == this->configuredThemeName) return;
+
+	qCDebug(logIconTheme) << "Icon theme changed to" << QIcon::themeName();
+	this->invalidate();
+}
+
+void IconThemeManager::onDirectoryChanged() { this->debounceTimer.start(); }
+
+void IconThemeManager::invalidate() {
+	{
+		auto locker = QMutexLocker(&this->mutex);
+		this->loadThemeSettings();
+		if (!this->mIndex) return;
+
+		qCDebug(logIconTheme) << "Icon theme changed, invalidating index";
+		this->mIndex.reset();
+		this->lookupCache.clear();
+	}
+
+	emit this->iconThemeChanged();
+}
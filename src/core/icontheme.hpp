@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+
+#include <qcontainerfwd.h>
+#include <qhash.h>
+#include <qhashfunctions.h>
+#include <qmutex.h>
+#include <qobject.h>
+#include <qsharedpointer.h>
+#include <qstring.h>
+#include <qtimer.h>
+#include <qtmetamacros.h>
+
+#include "filewatch.hpp"
+
+class IconThemeData;
+
+// Immutable index of an icon theme and every theme it inherits from, following the
+// [Icon Theme Specification].
+//
+// Theme directories with an up to date GTK `icon-theme.cache` are read through the cache,
+// and all other directories are listed once while building, so lookups never touch the disk.
+//
+// [Icon Theme Specification]: https://specifications.freedesktop.org/icon-theme-spec/latest/
+class IconThemeIndex {
+public:
+	static QSharedPointer<const IconThemeIndex> build(
+	    const QString& themeName,
+	    const QStringList& searchPaths,
+	    const QStringList& fallbackPaths
+	);
+
+	~IconThemeIndex();
+	Q_DISABLE_COPY_MOVE(IconThemeIndex);
+
+	// Path of the icon file closest to the given size, or an empty string if the icon
+	// does not exist in the theme, its parents, or the fallback paths.
+	[[nodiscard]] QString lookup(const QString& name, qint32 size, qint32 scale) const;
+
+	[[nodiscard]] QString themeName() const { return this->mThemeName; }
+	// Directories which invalidate the index when changed.
+	[[nodiscard]] const QStringList& watchPaths() const { return this->mWatchPaths; }
+
+private:
+	IconThemeIndex();
+
+	QString mThemeName;
+	// Inheritance chain in lookup order, always ending with hicolor.
+	std::vector<IconThemeData> themes;
+	QHash<QString, QString> fallbackIcons;
+	QStringList mWatchPaths;
+};
+
+struct IconLookupKey {
+	QString name;
+	qint32 size = 0;
+	qint32 scale = 1;
+
+	[[nodiscard]] bool operator==(const IconLookupKey& other) const = default;
+};
+
+inline size_t qHash(const IconLookupKey& key, size_t seed = 0) noexcept {
+	return qHashMulti(seed, key.name, key.size, key.scale);
+}
+
+// Resolves icon names against the current icon theme. Lookups are answered from an
+// IconThemeIndex that is rebuilt lazily after the theme or its directories change.
+// The instance must first be created on the main thread.
+class IconThemeManager: public QObject {
+	Q_OBJECT;
+
+public:
+	static IconThemeManager* instance();
+
+	// Path of the icon file closest to the given size, or an empty string. Thread safe.
+	QString iconPath(const QString& name, qint32 size, qint32 scale = 1);
+	// Thread safe.
+	bool hasIcon(const QString& name);
+
+signals:
+	void iconThemeChanged();
+
+private slots:
+	void onDirectoryChanged();
+	void invalidate();
+
+private:
+	explicit IconThemeManager();
+
+	// Requires the mutex to be held.
+	QSharedPointer<const IconThemeIndex> index();
+	// Requires the mutex to be held, and must be called on the manager's thread.
+	void loadThemeSettings();
+	// Invalidates the index if QIcon's theme was changed at runtime, such as by the
+	// platform theme. Must be called on the manager's thread, without the mutex held.
+	void checkThemeName();
+	void updateWatches(const QStringList& paths);
+
+	QMutex mutex;
+	QSharedPointer<const IconThemeIndex> mIndex;
+	QHash<IconLookupKey, QString> lookupCache;
+
+	// QIcon's theme settings are not thread safe, so they are copied on the manager's thread
+	// for indexes built by image provider threads.
+	QString themeName;
+	// QIcon::themeName() as of the last load, before falling back to other themes.
+	QString configuredThemeName;
+	QStringList searchPaths;
+	QStringList fallbackPaths;
+
+	FileWatch watcher;
+	QTimer debounceTimer;
+};
@@ -0,0 +1,201 @@
+#include "listdiff.hpp"
+#include <algorithm>
+#include <iterator>
+
+#include <qcontainerfwd.h>
+#include <qlist.h>
+#include <qtypes.h>
+
+namespace {
+
+// Fenwick tree counting which old rows are still sitting at their original position.
+class RowTree {
+public:
+	explicit RowTree(const QList<bool>& present): tree(present.length() + 1, 0) {
+		auto size = present.length();
+
+		for (qsizetype i = 1; i <= size; i++) {
+			if (present.at(i - 1)) this->tree[i] += 1;
+
+			auto parent = i + (i & -i);
+			if (parent <= size) this->tree[parent] += this->tree[i];
+		}
+	}
+
+	void remove(qsizetype oldIndex) {
+		for (auto i = oldIndex + 1; i < this->tree.length(); i += i & -i) {
+			this->tree[i] -= 1;
+		}
+	}
+
+	[[nodiscard]] qsizetype countBefore(qsizetype oldIndex) const {
+		qsizetype count = 0;
+
+		for (auto i = oldIndex; i > 0; i -= i & -i) {
+			count += this->tree.at(i);
+		}
+
+		return count;
+	}
+
+private:
+	QList<qsizetype> tree;
+};
+
+} // namespace
+
+QList<ListDiffOperation> computeListDiff(const QList<qsizetype>& oldForNew, qsizetype oldLength) {
+	const auto newLen = oldForNew.length();
+
+	auto operations = QList<ListDiffOperation>();
+	auto present = QList<bool>(oldLength, false);
+
+	for (auto oldIndex: oldForNew) {
+		if (oldIndex != -1) present[oldIndex] = true;
+	}
+
+	// The longest run of matched entries that is already in order stays in place,
+	// and every other matched entry is moved around it.
+	auto stable = QList<qsizetype>();    // new indices, ascending
+	auto stableOld = QList<qsizetype>(); // matching old indices, also ascending
+	auto isStable = QList<bool>(newLen, false);
+
+	{
+		auto tails = QList<qsizetype>();
+		auto prev = QList<qsizetype>(newLen, -1);
+
+		for (qsizetype i = 0; i != newLen; i++) {
+			auto oldIndex = oldForNew.at(i);
+			if (oldIndex == -1) continue;
+
+			auto tailIter = std::lower_bound(
+			    tails.begin(),
+			    tails.end(),
+			    oldIndex,
+			    [&](qsizetype tail, qsizetype old) { return oldForNew.at(tail) < old; }
+			);
+
+			auto length = std::distance(tails.begin(), tailIter);
+			if (length != 0) prev[i] = tails.at(length - 1);
+
+			if (tailIter == tails.end()) tails.append(i);
+			else *tailIter = i;
+		}
+
+		for (auto i = tails.isEmpty() ? -1 : tails.last(); i != -1; i = prev.at(i)) {
+			isStable[i] = true;
+			stable.append(i);
+		}
+
+		std::reverse(stable.begin(), stable.end());
+
+		stableOld.reserve(stable.length());
+		for (auto i: stable) stableOld.append(oldForNew.at(i));
+	}
+
+	qsizetype removed = 0;
+	for (qsizetype i = 0; i != oldLength;) {
+		if (present.at(i)) {
+			++i;
+			continue;
+		}
+
+		auto start = i;
+		do {
+			++i;
+		} while (i != oldLength && !present.at(i));
+
+		operations.append({
+		    .operation = ListDiffOperation::Remove,
+		    .index = start - removed,
+		    .length = i - start,
+		});
+
+		removed += i - start;
+	}
+
+	// New entries are placed back to front. Once every entry from `placed` onward is in
+	// its final relative order, the row of any entry can be derived from the tree.
+	auto tree = RowTree(present);
+	auto placed = newLen;
+
+	auto firstStableFrom = [&](qsizetype newIndex) {
+		return std::distance(
+		    stable.cbegin(),
+		    std::lower_bound(stable.cbegin(), stable.cend(), newIndex)
+		);
+	};
+
+	// Row the entry at new index `placed - 1` should be inserted or moved in front of.
+	auto anchorRow = [&]() {
+		auto s = firstStableFrom(placed);
+		return tree.countBefore(s == stable.length() ? oldLength : stableOld.at(s));
+	};
+
+	// Row of an old entry that has not been placed yet.
+	auto unplacedRow = [&](qsizetype oldIndex) {
+		auto prevStable = std::distance(
+		                      stableOld.cbegin(),
+		                      std::lower_bound(stableOld.cbegin(), stableOld.cend(), oldIndex)
+		                  )
+		                - 1;
+
+		auto s = firstStableFrom(placed);
+		auto row = tree.countBefore(oldIndex);
+
+		// Entries already moved in front of stable entries preceding this one.
+		if (prevStable >= s) row += stable.at(prevStable) - placed - prevStable + s;
+		return row;
+	};
+
+	while (placed != 0) {
+		auto last = placed - 1;
+
+		if (isStable.at(last)) {
+			placed = last;
+			continue;
+		}
+
+		auto first = last;
+		auto target = anchorRow();
+
+		if (oldForNew.at(last) == -1) {
+			while (first != 0 && oldForNew.at(first - 1) == -1) {
+				--first;
+			}
+
+			operations.append({
+			    .operation = ListDiffOperation::Insert,
+			    .index = target,
+			    .length = last - first + 1,
+			    .target = first,
+			});
+		} else {
+			// Capture a whole sequence of entries that is contiguous in both lists as one move.
+			auto srcLast = unplacedRow(oldForNew.at(last));
+			auto srcFirst = srcLast;
+
+			while (first != 0 && oldForNew.at(first - 1) != -1 && !isStable.at(first - 1)
+			       && unplacedRow(oldForNew.at(first - 1)) == srcFirst - 1)
+			{
+				--first;
+				--srcFirst;
+			}
+
+			operations.append({
+			    .operation = ListDiffOperation::Move,
+			    .index = srcFirst,
+			    .length = srcLast - srcFirst + 1,
+			    .target = target,
+			});
+
+			for (auto i = first; i <= last; i++) {
+				tree.remove(oldForNew.at(i));
+			}
+		}
+
+		placed = first;
+	}
+
+	return operations;
+}
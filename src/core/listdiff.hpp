@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+
+#include <qcontainerfwd.h>
+#include <qlist.h>
+#include <qtypes.h>
+
+// A single range operation produced by computeListDiff.
+// Row indices are relative to the list as it is after all prior operations.
+struct ListDiffOperation {
+	enum Enum : quint8 {
+		Remove,
+		Insert,
+		Move,
+	};
+
+	Enum operation;
+	qsizetype index = 0;
+	qsizetype length = 0;
+	// Insert: index of the first inserted entry in the new list.
+	// Move: row the range is moved in front of, as passed to beginMoveRows.
+	qsizetype target = 0;
+};
+
+// Computes range operations transforming a list into a new one, given the index of the
+// matching old entry for each new entry, or -1 if it has no match.
+//
+// The longest already ordered sequence of matched entries is left in place, so only
+// entries outside of it are moved. Removals come first, followed by insertions and
+// moves ordered from the end of the list.
+QList<ListDiffOperation> computeListDiff(const QList<qsizetype>& oldForNew, qsizetype oldLength);
+
+// Moves `length` entries starting at `index` in front of the entry at `target`,
+// matching the semantics of QAbstractItemModel::beginMoveRows.
+template <typename T>
+void moveListRange(QList<T>& list, qsizetype index, qsizetype length, qsizetype target) {
+	auto begin = list.begin();
+
+	if (target > index) std::rotate(begin + index, begin + index + length, begin + target);
+	else std::rotate(begin + target, begin + index, begin + index + length);
+}
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <functional>
 
 #include <QtCore/qtmetamacros.h>
 #include <qabstractitemmodel.h>
 #include <qcontainerfwd.h>
+#include <qhash.h>
+#include <qlist.h>
 #include <qobject.h>
 #include <qqmlintegration.h>
 #include <qqmllist.h>
@@ -13,6 +16,7 @@
 #include <qvariant.h>
 
 #include "doc.hpp"
+#include "listdiff.hpp"
 
 ///! View into a list of objets
 /// Typed view into a list of objects.
@@ -79,7 +83,6 @@ public:
 	explicit ObjectModel(QObject* parent): UntypedObjectModel(parent) {}
 
 	[[nodiscard]] const QList<T*>& valueList() const { return this->mValuesList; }
-	[[nodiscard]] QList<T*>& valueList() { return this->mValuesList; }
 
 	void insertObject(T* object, qsizetype index = -1) {
 		auto iindex = index == -1 ? this->mValuesList.length() : index;
@@ -88,6 +91,7 @@ public:
 		auto intIndex = static_cast<qint32>(iindex);
 		this->beginInsertRows(QModelIndex(), intIndex, intIndex);
 		this->mValuesList.insert(iindex, object);
+		this->mValuesValid = false;
 		this->endInsertRows();
 
 		emit this->valuesChanged();
@@ -95,7 +99,7 @@ public:
 	}
 
 	void insertObjectSorted(T* object, const std::function<bool(T*, T*)>& compare) {
-		auto& list = this->valueList();
+		const auto& list = this->valueList();
 		auto iter = list.begin();
 
 		while (iter != list.end()) {
@@ -122,31 +126,102 @@ public:
 		auto intIndex = static_cast<qint32>(index);
 		this->beginRemoveRows(QModelIndex(), intIndex, intIndex);
 		this->mValuesList.removeAt(index);
+		this->mValuesValid = false;
 		this->endRemoveRows();
 
 		emit this->valuesChanged();
 		emit this->objectRemovedPost(object, index);
 	}
 
+	void clear() {
+		if (this->mValuesList.isEmpty()) return;
+
+		this->beginResetModel();
+		this->mValuesList.clear();
+		this->mValuesValid = false;
+		this->endResetModel();
+
+		emit this->valuesChanged();
+	}
+
 	// Assumes only one instance of a specific value
 	void diffUpdate(const QList<T*>& newValues) {
-		for (qsizetype i = 0; i < this->mValuesList.length();) {
-			if (newValues.contains(this->mValuesList.at(i))) i++;
-			else this->removeAt(i);
+		auto oldIndexOf = QHash<const T*, qsizetype>();
+		oldIndexOf.reserve(this->mValuesList.length());
+
+		for (qsizetype i = 0; i != this->mValuesList.length(); i++) {
+			oldIndexOf.insert(this->mValuesList.at(i), i);
 		}
 
-		qsizetype oi = 0;
-		for (auto* object: newValues) {
-			if (this->mValuesList.length() == oi || this->mValuesList.at(oi) != object) {
-				// object may already be present further down (reorder case);
-				// drop the old row first so the same pointer is not inserted twice.
-				auto old = this->mValuesList.indexOf(object, oi);
-				if (old != -1) this->removeAt(old);
-				this->insertObject(object, oi);
-			}
+		auto oldForNew = QList<qsizetype>(newValues.length(), -1);
+
+		for (qsizetype i = 0; i != newValues.length(); i++) {
+			auto iter = oldIndexOf.find(newValues.at(i));
+			if (iter == oldIndexOf.end()) continue;
+
+			oldForNew[i] = iter.value();
+			oldIndexOf.erase(iter);
+		}
 
-			oi++;
+		auto operations = computeListDiff(oldForNew, this->mValuesList.length());
+		if (operations.isEmpty()) return;
+
+		for (const auto& op: operations) {
+			auto first = static_cast<qint32>(op.index);
+			auto last = static_cast<qint32>(op.index + op.length - 1);
+
+			switch (op.operation) {
+			case ListDiffOperation::Remove: {
+				auto removed = this->mValuesList.sliced(op.index, op.length);
+
+				for (qsizetype i = 0; i != op.length; i++) {
+					emit this->objectRemovedPre(removed.at(i), op.index + i);
+				}
+
+				this->beginRemoveRows(QModelIndex(), first, last);
+				this->mValuesList.remove(op.index, op.length);
+				this->mValuesValid = false;
+				this->endRemoveRows();
+
+				for (qsizetype i = 0; i != op.length; i++) {
+					emit this->objectRemovedPost(removed.at(i), op.index + i);
+				}
+			} break;
+			case ListDiffOperation::Insert: {
+				auto inserted = newValues.sliced(op.target, op.length);
+
+				for (qsizetype i = 0; i != op.length; i++) {
+					emit this->objectInsertedPre(inserted.at(i), op.index + i);
+				}
+
+				this->beginInsertRows(QModelIndex(), first, last);
+				this->mValuesList.insert(op.index, op.length, nullptr);
+				std::copy(inserted.begin(), inserted.end(), this->mValuesList.begin() + op.index);
+				this->mValuesValid = false;
+				this->endInsertRows();
+
+				for (qsizetype i = 0; i != op.length; i++) {
+					emit this->objectInsertedPost(inserted.at(i), op.index + i);
+				}
+			} break;
+			case ListDiffOperation::Move:
+				if (this->beginMoveRows(
+				        QModelIndex(),
+				        first,
+				        last,
+				        QModelIndex(),
+				        static_cast<qint32>(op.target)
+				    ))
+				{
+					moveListRange(this->mValuesList, op.index, op.length, op.target);
+					this->mValuesValid = false;
+					this->endMoveRows();
+				}
+				break;
+			}
 		}
+
+		emit this->valuesChanged();
 	}
 
 	static ObjectModel<T>* emptyInstance() {
@@ -170,13 +245,23 @@ public:
 	}
 
 	[[nodiscard]] QList<QObject*> values() override {
-		QList<QObject*> result;
-		result.reserve(this->mValuesList.size());
-		for (auto* item: this->mValuesList)
-			result.append(reinterpret_cast<QObject*>(item));
-		return result;
+		// Rebuilt only after a mutation. Returned copies share data with the cache.
+		if (!this->mValuesValid) {
+			this->mValues.clear();
+			this->mValues.reserve(this->mValuesList.size());
+
+			for (auto* item: this->mValuesList) {
+				this->mValues.append(reinterpret_cast<QObject*>(item));
+			}
+
+			this->mValuesValid = true;
+		}
+
+		return this->mValues;
 	}
 
 private:
 	QList<T*> mValuesList;
+	QList<QObject*> mValues;
+	bool mValuesValid = false;
 };
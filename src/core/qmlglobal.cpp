@@ -6,12 +6,10 @@
 #include <qcoreapplication.h>
 #include <qdir.h>
 #include <qguiapplication.h>
-#include <qicon.h>
 #include <qjsengine.h>
 #include <qlist.h>
 #include <qlogging.h>
 #include <qobject.h>
-#include <qprocess.h>
 #include <qqmlcontext.h>
 #include <qqmlengine.h>
 #include <qqmllist.h>
@@ -26,6 +24,7 @@
 #include "../io/processcore.hpp"
 #include "generation.hpp"
 #include "iconimageprovider.hpp"
+#include "icontheme.hpp"
 #include "instanceinfo.hpp"
 #include "paths.hpp"
 #include "qmlscreen.hpp"
@@ -297,27 +296,7 @@ void QuickshellGlobal::execDetached(const qs::io::process::ProcessContext& conte
 		return;
 	}
 
-	const auto& cmd = context.command.first();
-	auto args = context.command.sliced(1);
-
-	QProcess process;
-	qs::io::process::setupProcessEnvironment(&process, context.clearEnvironment, context.environment);
-
-	if (!context.workingDirectory.isEmpty()) {
-		process.setWorkingDirectory(context.workingDirectory);
-	}
-
-	process.setProgram(cmd);
-	process.setArguments(args);
-
-	process.setStandardInputFile(QProcess::nullDevice());
-
-	if (context.unbindStdout) {
-		process.setStandardOutputFile(QProcess::nullDevice());
-		process.setStandardErrorFile(QProcess::nullDevice());
-	}
-
-	process.startDetached();
+	qs::io::process::spawnDetached(context);
 }
 
 QString QuickshellGlobal::iconPath(const QString& icon) {
@@ -325,7 +304,7 @@ QString QuickshellGlobal::iconPath(const QString& icon) {
 }
 
 QString QuickshellGlobal::iconPath(const QString& icon, bool check) {
-	if (check && QIcon::fromTheme(icon).isNull()) return "";
+	if (check && !IconThemeManager::instance()->hasIcon(icon)) return "";
 	return IconImageProvider::requestString(icon);
 }
 
@@ -333,7 +312,9 @@ QString QuickshellGlobal::iconPath(const QString& icon, const QString& fallback)
 	return IconImageProvider::requestString(icon, "", fallback);
 }
 
-bool QuickshellGlobal::hasThemeIcon(const QString& icon) { return QIcon::hasThemeIcon(icon); }
+bool QuickshellGlobal::hasThemeIcon(const QString& icon) {
+	return IconThemeManager::instance()->hasIcon(icon);
+}
 
 bool QuickshellGlobal::hasVersion(qint32 major, qint32 minor, const QStringList& features) {
 	return qs::scan::env::PreprocEnv::hasVersion(major, minor, features);
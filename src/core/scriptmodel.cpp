@@ -1,161 +1,180 @@
 #include "scriptmodel.hpp"
 #include <algorithm>
-#include <iterator>
 
 #include <qscopeguard.h>
 
 #include <qabstractitemmodel.h>
 #include <qcontainerfwd.h>
+#include <qhash.h>
+#include <qhashfunctions.h>
 #include <qlist.h>
+#include <qmetatype.h>
 #include <qnamespace.h>
+#include <qobject.h>
 #include <qtmetamacros.h>
-#include <qtversionchecks.h>
 #include <qtypes.h>
+#include <qurl.h>
 #include <qvariant.h>
 
+#include "listdiff.hpp"
+
+namespace {
+
+// Must agree with QVariant::operator== for the types QML places in a list.
+// Types not handled here share a bucket and fall back to equality checks.
+size_t hashVariant(const QVariant& value) {
+	auto type = value.metaType();
+	if (!type.isValid()) return 0;
+
+	if (type.flags().testFlag(QMetaType::PointerToQObject)) {
+		return qHash(value.value<QObject*>());
+	}
+
+	switch (type.id()) {
+	case QMetaType::QString: return qHash(value.toString());
+	case QMetaType::QChar: return qHash(value.toChar());
+	case QMetaType::QUrl: return qHash(value.toUrl());
+	case QMetaType::Bool:
+	case QMetaType::Int:
+	case QMetaType::UInt:
+	case QMetaType::Long:
+	case QMetaType::ULong:
+	case QMetaType::LongLong:
+	case QMetaType::ULongLong:
+	case QMetaType::Float:
+	case QMetaType::Double: return qHash(value.toDouble());
+	case QMetaType::QVariantList: {
+		size_t hash = 0;
+		for (const auto& entry: value.toList()) {
+			hash = qHashMulti(hash, hashVariant(entry));
+		}
+
+		return hash;
+	}
+	case QMetaType::QVariantMap: {
+		size_t hash = 0;
+		auto map = value.toMap();
+
+		for (auto iter = map.constBegin(); iter != map.constEnd(); ++iter) {
+			hash = qHashMulti(hash, iter.key(), hashVariant(iter.value()));
+		}
+
+		return hash;
+	}
+	default: return qHash(type.id());
+	}
+}
+
+// Comparison key for a model value, hashed once up front so the diff does not
+// have to compare every value with every other value.
+struct DiffKey {
+	QVariant value;
+	size_t hash = 0;
+
+	[[nodiscard]] bool operator==(const DiffKey& other) const {
+		return this->hash == other.hash && this->value == other.value;
+	}
+};
+
+size_t qHash(const DiffKey& key, size_t seed = 0) { return ::qHash(key.hash, seed); }
+
+} // namespace
+
 void ScriptModel::updateValuesUnique(const QVariantList& newValues) {
 	this->hasActiveIterators = true;
 	auto guard = qScopeGuard([this] { this->hasActiveIterators = false; });
 	this->mValues.reserve(newValues.size());
 
-	auto iter = this->mValues.begin();
-	auto newIter = newValues.begin();
-
-	// TODO: cache this
 	auto getCmpKey = [this](const QVariant& v) {
-		if (v.canConvert<QVariantMap>()) {
+		auto key = v;
+
+		if (!this->cmpKey.isEmpty() && v.canConvert<QVariantMap>()) {
 			auto vMap = v.value<QVariantMap>();
 			if (vMap.contains(this->cmpKey)) {
-				return vMap.value(this->cmpKey);
+				key = vMap.value(this->cmpKey);
 			}
 		}
 
-		return v;
+		return DiffKey {.value = key, .hash = hashVariant(key)};
 	};
 
-	auto variantCmp = [&, this](const QVariant& a, const QVariant& b) {
-		if (!this->cmpKey.isEmpty()) return getCmpKey(a) == getCmpKey(b);
-		else return a == b;
-	};
+	const auto oldLen = this->mValues.length();
+	const auto newLen = newValues.length();
 
-	auto eqPredicate = [&](const QVariant& b) {
-		return [&](const QVariant& a) { return variantCmp(a, b); };
-	};
+	// Pair each old value with the first unclaimed new value sharing its key.
+	// Anything left unpaired is removed (old) or inserted (new).
+	auto newIndexOf = QHash<DiffKey, qsizetype>();
+	newIndexOf.reserve(newLen);
+
+	for (auto i = newLen - 1; i >= 0; i--) {
+		newIndexOf.insert(getCmpKey(newValues.at(i)), i);
+	}
 
-	while (true) {
-		if (newIter == newValues.end()) {
-			if (iter == this->mValues.end()) break;
+	auto oldForNew = QList<qsizetype>(newLen, -1);
 
-			auto startIndex = static_cast<qint32>(newValues.length());
-			auto endIndex = static_cast<qint32>(this->mValues.length() - 1);
+	for (qsizetype i = 0; i != oldLen; i++) {
+		auto newIndex = newIndexOf.value(getCmpKey(this->mValues.at(i)), -1);
+		if (newIndex != -1 && oldForNew.at(newIndex) == -1) oldForNew[newIndex] = i;
+	}
 
-			this->beginRemoveRows(QModelIndex(), startIndex, endIndex);
-			this->mValues.erase(iter, this->mValues.end());
-			this->endRemoveRows();
+	for (const auto& op: computeListDiff(oldForNew, oldLen)) {
+		auto first = static_cast<qint32>(op.index);
+		auto last = static_cast<qint32>(op.index + op.length - 1);
 
+		switch (op.operation) {
+		case ListDiffOperation::Remove:
+			this->beginRemoveRows(QModelIndex(), first, last);
+			this->mValues.remove(op.index, op.length);
+			this->endRemoveRows();
 			break;
-		} else if (iter == this->mValues.end()) {
-			// Prior branch ensures length is at least 1.
-			auto startIndex = static_cast<qint32>(this->mValues.length());
-			auto endIndex = static_cast<qint32>(newValues.length() - 1);
-
-			this->beginInsertRows(QModelIndex(), startIndex, endIndex);
-			this->mValues.append(newValues.sliced(startIndex));
+		case ListDiffOperation::Insert:
+			this->beginInsertRows(QModelIndex(), first, last);
+			this->mValues.insert(op.index, op.length, QVariant());
+			std::copy(
+			    newValues.begin() + op.target,
+			    newValues.begin() + op.target + op.length,
+			    this->mValues.begin() + op.index
+			);
 			this->endInsertRows();
-
 			break;
-		} else if (!variantCmp(*newIter, *iter)) {
-			auto oldIter = std::find_if(iter, this->mValues.end(), eqPredicate(*newIter));
-
-			if (oldIter != this->mValues.end()) {
-				if (std::find_if(newIter, newValues.end(), eqPredicate(*iter)) == newValues.end()) {
-					// Remove any entries we would otherwise move around that aren't in the new list.
-					auto startIter = iter;
-
-					do {
-						++iter;
-					} while (iter != this->mValues.end()
-					         && std::find_if(newIter, newValues.end(), eqPredicate(*iter))
-					                == newValues.end());
-
-					auto index = static_cast<qint32>(std::distance(this->mValues.begin(), iter));
-					auto startIndex = static_cast<qint32>(std::distance(this->mValues.begin(), startIter));
-
-					this->beginRemoveRows(QModelIndex(), startIndex, index - 1);
-					iter = this->mValues.erase(startIter, iter);
-					this->endRemoveRows();
-				} else {
-					// Advance iters to capture a whole move sequence as a single operation if possible.
-					auto oldStartIter = oldIter;
-					do {
-						++oldIter;
-						++newIter;
-					} while (oldIter != this->mValues.end() && newIter != newValues.end()
-					         && variantCmp(*oldIter, *newIter));
-
-					auto index = static_cast<qint32>(std::distance(this->mValues.begin(), iter));
-					auto oldStartIndex =
-					    static_cast<qint32>(std::distance(this->mValues.begin(), oldStartIter));
-					auto oldIndex = static_cast<qint32>(std::distance(this->mValues.begin(), oldIter));
-					auto len = oldIndex - oldStartIndex;
-
-					this->beginMoveRows(QModelIndex(), oldStartIndex, oldIndex - 1, QModelIndex(), index);
-
-					// While it is possible to optimize this further, it is currently not worth the time.
-					for (auto i = 0; i != len; i++) {
-						this->mValues.move(oldStartIndex + i, index + i);
-					}
-
-					iter = this->mValues.begin() + (index + len);
-					this->endMoveRows();
-				}
-			} else {
-				auto startNewIter = newIter;
-
-				do {
-					newIter++;
-				} while (newIter != newValues.end()
-				         && std::find_if(iter, this->mValues.end(), eqPredicate(*newIter))
-				                == this->mValues.end());
-
-				auto index = static_cast<qint32>(std::distance(this->mValues.begin(), iter));
-				auto newIndex = static_cast<qint32>(std::distance(newValues.begin(), newIter));
-				auto startNewIndex = static_cast<qint32>(std::distance(newValues.begin(), startNewIter));
-				auto len = newIndex - startNewIndex;
-
-				this->beginInsertRows(QModelIndex(), index, index + len - 1);
-#if QT_VERSION <= QT_VERSION_CHECK(6, 8, 0)
-				this->mValues.resize(this->mValues.length() + len);
-#else
-				this->mValues.resizeForOverwrite(this->mValues.length() + len);
-#endif
-				iter = this->mValues.begin() + index; // invalidated
-				std::move_backward(iter, this->mValues.end() - len, this->mValues.end());
-				iter = std::copy(startNewIter, newIter, iter);
-				this->endInsertRows();
+		case ListDiffOperation::Move:
+			if (this->beginMoveRows(
+			        QModelIndex(),
+			        first,
+			        last,
+			        QModelIndex(),
+			        static_cast<qint32>(op.target)
+			    ))
+			{
+				moveListRange(this->mValues, op.index, op.length, op.target);
+				this->endMoveRows();
 			}
-		} else if (*newIter != *iter) {
-			auto first = static_cast<qint32>(std::distance(this->mValues.begin(), iter));
-			auto index = first;
-
-			do {
-				this->mValues.replace(index, *newIter);
-				++iter;
-				++newIter;
-				++index;
-			} while (iter != this->mValues.end() && newIter != newValues.end() && *newIter != *iter);
-
-			this->dataChanged(
-			    this->index(first, 0, QModelIndex()),
-			    this->index(index - 1, 0, QModelIndex()),
-			    {Qt::UserRole}
-			);
-		} else {
-			++iter;
-			++newIter;
+			break;
 		}
 	}
 
+	// Values paired by objectProp may still differ from their replacement.
+	if (this->cmpKey.isEmpty()) return;
+
+	for (qsizetype i = 0; i != newLen;) {
+		if (this->mValues.at(i) == newValues.at(i)) {
+			++i;
+			continue;
+		}
+
+		auto first = i;
+
+		do {
+			this->mValues.replace(i, newValues.at(i));
+			++i;
+		} while (i != newLen && this->mValues.at(i) != newValues.at(i));
+
+		emit this->dataChanged(
+		    this->index(static_cast<qint32>(first), 0, QModelIndex()),
+		    this->index(static_cast<qint32>(i - 1), 0, QModelIndex()),
+		    {Qt::UserRole}
+		);
+	}
 }
 
 void ScriptModel::setValues(const QVariantList& newValues) {
@@ -167,7 +186,9 @@ void ScriptModel::setValues(const QVariantList& newValues) {
 void ScriptModel::setObjectProp(const QString& objectProp) {
 	if (objectProp == this->cmpKey) return;
 	this->cmpKey = objectProp;
-	this->updateValuesUnique(this->mValues);
+	// Copied as the diff reads from newValues while modifying mValues.
+	auto values = this->mValues;
+	this->updateValuesUnique(values);
 	emit this->objectPropChanged();
 }
 
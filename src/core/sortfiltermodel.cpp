@@ -0,0 +1,613 @@
+#include "sortfiltermodel.hpp"
+#include <algorithm>
+#include <utility>
+
+#include <qabstractitemmodel.h>
+#include <qcontainerfwd.h>
+#include <qhash.h>
+#include <qlist.h>
+#include <qmetaobject.h>
+#include <qnamespace.h>
+#include <qobject.h>
+#include <qobjectdefs.h>
+#include <qpointer.h>
+#include <qtmetamacros.h>
+#include <qtypes.h>
+#include <qvariant.h>
+
+#include "listdiff.hpp"
+
+namespace {
+
+// Missing keys sort last. Values that cannot be ordered against each other
+// are grouped by type to keep the ordering consistent.
+qint32 compareKeys(const QVariant& a, const QVariant& b, Qt::CaseSensitivity cs) {
+	if (!a.isValid() || !b.isValid()) return static_cast<qint32>(b.isValid()) - a.isValid();
+
+	if (a.metaType().id() == QMetaType::QString && b.metaType().id() == QMetaType::QString) {
+		return QString::compare(a.toString(), b.toString(), cs);
+	}
+
+	auto order = QVariant::compare(a, b);
+	if (order == QPartialOrdering::Less) return -1;
+	if (order == QPartialOrdering::Greater) return 1;
+	if (order == QPartialOrdering::Equivalent) return 0;
+	return a.metaType().id() - b.metaType().id();
+}
+
+} // namespace
+
+qint32 SortFilterModel::rowCount(const QModelIndex& parent) const {
+	if (parent != QModelIndex()) return 0;
+	return static_cast<qint32>(this->mMapping.length());
+}
+
+QVariant SortFilterModel::data(const QModelIndex& index, qint32 role) const {
+	if (!this->mSource || !index.isValid() || index.row() >= this->mMapping.length()) {
+		return QVariant();
+	}
+	return this->mSource->data(this->mSource->index(this->mMapping.at(index.row()), 0), role);
+}
+
+QHash<int, QByteArray> SortFilterModel::roleNames() const {
+	if (!this->mSource) return {{Qt::UserRole, "modelData"}};
+	return this->mSource->roleNames();
+}
+
+qint32 SortFilterModel::mapFromSource(qint32 sourceRow) const {
+	if (sourceRow < 0 || sourceRow >= this->mRows.length()) return -1;
+
+	if (!this->mProxyRowsValid) {
+		this->mProxyRows.fill(-1, this->mRows.length());
+
+		for (auto i = 0; i != this->mMapping.length(); i++) {
+			this->mProxyRows[this->mMapping.at(i)] = i;
+		}
+
+		this->mProxyRowsValid = true;
+	}
+
+	return this->mProxyRows.at(sourceRow);
+}
+
+qint32 SortFilterModel::mapToSource(qint32 row) const {
+	if (row < 0 || row >= this->mMapping.length()) return -1;
+	return this->mMapping.at(row);
+}
+
+void SortFilterModel::setModel(QAbstractItemModel* model) {
+	if (model == this->mSource) return;
+
+	if (this->mSource) QObject::disconnect(this->mSource, nullptr, this, nullptr);
+	this->mSource = model;
+
+	if (model) {
+		// clang-format off
+		QObject::connect(model, &QObject::destroyed, this, &SortFilterModel::onSourceDestroyed);
+		QObject::connect(model, &QAbstractItemModel::modelReset, this, &SortFilterModel::onSourceReset);
+		QObject::connect(model, &QAbstractItemModel::layoutChanged, this, &SortFilterModel::onSourceReset);
+		QObject::connect(model, &QAbstractItemModel::rowsInserted, this, &SortFilterModel::onRowsInserted);
+		QObject::connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &SortFilterModel::onRowsAboutToBeRemoved);
+		QObject::connect(model, &QAbstractItemModel::rowsRemoved, this, &SortFilterModel::onRowsRemoved);
+		QObject::connect(model, &QAbstractItemModel::rowsMoved, this, &SortFilterModel::onRowsMoved);
+		QObject::connect(model, &QAbstractItemModel::dataChanged, this, &SortFilterModel::onDataChanged);
+		// clang-format on
+	}
+
+	this->onSourceReset();
+	emit this->modelChanged();
+}
+
+void SortFilterModel::setSortProperty(const QString& sortProperty) {
+	if (sortProperty == this->mSortProperty) return;
+	this->mSortProperty = sortProperty;
+	this->refresh(true);
+	emit this->sortPropertyChanged();
+}
+
+void SortFilterModel::setSortOrder(Qt::SortOrder sortOrder) {
+	if (sortOrder == this->mSortOrder) return;
+	this->mSortOrder = sortOrder;
+	this->refresh(false);
+	emit this->sortOrderChanged();
+}
+
+void SortFilterModel::setFilterProperty(const QString& filterProperty) {
+	if (filterProperty == this->mFilterProperty) return;
+	this->mFilterProperty = filterProperty;
+	this->refresh(true);
+	emit this->filterPropertyChanged();
+}
+
+void SortFilterModel::setFilterValue(const QVariant& filterValue) {
+	if (filterValue == this->mFilterValue) return;
+	this->mFilterValue = filterValue;
+	this->refresh(false);
+	emit this->filterValueChanged();
+}
+
+void SortFilterModel::setSearchProperties(const QStringList& searchProperties) {
+	if (searchProperties == this->mSearchProperties) return;
+	this->mSearchProperties = searchProperties;
+	this->refresh(!this->mSearchText.isEmpty());
+	emit this->searchPropertiesChanged();
+}
+
+void SortFilterModel::setSearchText(const QString& searchText) {
+	if (searchText == this->mSearchText) return;
+	// Search properties are only watched while searching.
+	auto rewatch = searchText.isEmpty() != this->mSearchText.isEmpty();
+	this->mSearchText = searchText;
+	this->refresh(rewatch);
+	emit this->searchTextChanged();
+}
+
+void SortFilterModel::setCaseSensitivity(Qt::CaseSensitivity caseSensitivity) {
+	if (caseSensitivity == this->mCaseSensitivity) return;
+	this->mCaseSensitivity = caseSensitivity;
+	this->refresh(false);
+	emit this->caseSensitivityChanged();
+}
+
+QVariantList SortFilterModel::values() {
+	if (!this->mValuesValid) {
+		this->mValues.clear();
+		this->mValues.reserve(this->mMapping.length());
+
+		for (auto sourceRow: this->mMapping) {
+			this->mValues.append(
+			    this->mSource->data(this->mSource->index(sourceRow, 0), this->mDataRole)
+			);
+		}
+
+		this->mValuesValid = true;
+	}
+
+	return this->mValues;
+}
+
+void SortFilterModel::onSourceDestroyed() {
+	this->mSource = nullptr;
+	this->onSourceReset();
+	emit this->modelChanged();
+}
+
+void SortFilterModel::onSourceReset() {
+	this->beginResetModel();
+	this->rebuild();
+	this->endResetModel();
+	this->markChanged();
+}
+
+void SortFilterModel::onRowsInserted(const QModelIndex& parent, qint32 first, qint32 last) {
+	if (parent.isValid()) return;
+	auto count = last - first + 1;
+
+	for (auto& sourceRow: this->mMapping) {
+		if (sourceRow >= first) sourceRow += count;
+	}
+
+	this->mRows.insert(first, count, SourceRow());
+	this->invalidateRows();
+
+	for (auto i = first; i <= last; i++) {
+		this->replaceRow(i);
+		if (this->mRows.at(i).accepted) this->insertRow(i);
+	}
+}
+
+void SortFilterModel::onRowsAboutToBeRemoved(const QModelIndex& parent, qint32 first, qint32 last) {
+	if (parent.isValid()) return;
+
+	for (auto i = first; i <= last; i++) {
+		if (auto* object = this->mRows.at(i).object.data()) this->unwatchObject(object);
+	}
+
+	auto removed = [&](qint32 sourceRow) { return sourceRow >= first && sourceRow <= last; };
+
+	for (auto i = this->mMapping.length() - 1; i >= 0; i--) {
+		if (!removed(this->mMapping.at(i))) continue;
+
+		auto start = i;
+		while (start != 0 && removed(this->mMapping.at(start - 1))) {
+			--start;
+		}
+
+		this->beginRemoveRows(QModelIndex(), static_cast<qint32>(start), static_cast<qint32>(i));
+		this->mMapping.remove(start, i - start + 1);
+		this->invalidateRows();
+		this->endRemoveRows();
+
+		this->mRemovePending = true;
+		i = start;
+	}
+}
+
+void SortFilterModel::onRowsRemoved(const QModelIndex& parent, qint32 first, qint32 last) {
+	if (parent.isValid()) return;
+	auto count = last - first + 1;
+
+	this->mRows.remove(first, count);
+
+	for (auto& sourceRow: this->mMapping) {
+		if (sourceRow > last) sourceRow -= count;
+	}
+
+	this->invalidateRows();
+
+	if (this->mRemovePending) {
+		this->mRemovePending = false;
+		this->markChanged();
+	}
+}
+
+void SortFilterModel::onRowsMoved(
+    const QModelIndex& sourceParent,
+    qint32 sourceStart,
+    qint32 sourceEnd,
+    const QModelIndex& destParent,
+    qint32 destRow
+) {
+	if (sourceParent.isValid() || destParent.isValid()) return;
+	auto count = sourceEnd - sourceStart + 1;
+
+	auto remap = [&](qint32 row) {
+		if (row >= sourceStart && row <= sourceEnd) {
+			auto moved = row - sourceStart + destRow;
+			return destRow > sourceEnd ? moved - count : moved;
+		} else if (destRow > sourceEnd && row > sourceEnd && row < destRow) {
+			return row - count;
+		} else if (destRow < sourceStart && row >= destRow && row < sourceStart) {
+			return row + count;
+		} else {
+			return row;
+		}
+	};
+
+	moveListRange(this->mRows, sourceStart, count, destRow);
+
+	for (auto& sourceRow: this->mMapping) {
+		sourceRow = remap(sourceRow);
+	}
+
+	this->invalidateRows();
+
+	// Ties and unsorted models follow the source order.
+	this->refresh(false);
+}
+
+void SortFilterModel::onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+	if (topLeft.parent().isValid()) return;
+
+	for (auto i = topLeft.row(); i <= bottomRight.row(); i++) {
+		auto wasVisible = this->mapFromSource(i) != -1;
+		this->updateRow(i);
+
+		// updateRow only signals position and visibility changes.
+		auto row = this->mapFromSource(i);
+		if (wasVisible && row != -1) {
+			emit this->dataChanged(this->index(row), this->index(row));
+			this->markChanged();
+		}
+	}
+}
+
+void SortFilterModel::onObjectPropertyChanged() {
+	if (!this->mObjectRowsValid) {
+		this->mObjectRows.clear();
+
+		for (auto i = 0; i != this->mRows.length(); i++) {
+			if (auto* object = this->mRows.at(i).object.data()) this->mObjectRows.insert(object, i);
+		}
+
+		this->mObjectRowsValid = true;
+	}
+
+	// Copied, as updateRow may invalidate the index.
+	for (auto sourceRow: this->mObjectRows.values(this->sender())) {
+		this->updateRow(sourceRow);
+	}
+}
+
+void SortFilterModel::onObjectDestroyed(QObject* object) {
+	this->mWatchCounts.remove(object);
+	this->mObjectRowsValid = false;
+}
+
+void SortFilterModel::rebuild() {
+	for (const auto& row: this->mRows) {
+		if (row.object) this->unwatchObject(row.object);
+	}
+
+	this->mRows.clear();
+	this->mMapping.clear();
+	this->invalidateRows();
+	this->mSourceRoles.clear();
+	this->mDataRole = Qt::UserRole;
+
+	if (!this->mSource) return;
+
+	auto roles = this->mSource->roleNames();
+	for (auto iter = roles.constBegin(); iter != roles.constEnd(); ++iter) {
+		auto name = QString::fromUtf8(iter.value());
+		this->mSourceRoles.insert(name, iter.key());
+		if (name == QStringLiteral("modelData")) this->mDataRole = iter.key();
+	}
+
+	auto count = this->mSource->rowCount();
+	this->mRows.resize(count);
+
+	for (auto i = 0; i != count; i++) {
+		this->replaceRow(i);
+		if (this->mRows.at(i).accepted) this->mMapping.append(i);
+	}
+
+	std::sort(this->mMapping.begin(), this->mMapping.end(), [this](qint32 a, qint32 b) {
+		return this->lessThan(a, b);
+	});
+
+	this->invalidateRows();
+}
+
+// Moves entries to their new position instead of resetting the model so views keep
+// their delegates.
+void SortFilterModel::refresh(bool rewatch) {
+	if (!this->mSource) return;
+	if (rewatch) this->rewatchObjects();
+
+	auto oldRowOf = QList<qsizetype>(this->mRows.length(), -1);
+	for (auto i = 0; i != this->mMapping.length(); i++) {
+		oldRowOf[this->mMapping.at(i)] = i;
+	}
+
+	auto newMapping = QList<qint32>();
+
+	for (auto i = 0; i != this->mRows.length(); i++) {
+		this->replaceRow(i);
+		if (this->mRows.at(i).accepted) newMapping.append(i);
+	}
+
+	this->mObjectRowsValid = false;
+
+	std::sort(newMapping.begin(), newMapping.end(), [this](qint32 a, qint32 b) {
+		return this->lessThan(a, b);
+	});
+
+	auto oldForNew = QList<qsizetype>(newMapping.length(), -1);
+	for (auto i = 0; i != newMapping.length(); i++) {
+		oldForNew[i] = oldRowOf.at(newMapping.at(i));
+	}
+
+	auto operations = computeListDiff(oldForNew, this->mMapping.length());
+	if (operations.isEmpty()) return;
+
+	for (const auto& op: operations) {
+		auto first = static_cast<qint32>(op.index);
+		auto last = static_cast<qint32>(op.index + op.length - 1);
+
+		switch (op.operation) {
+		case ListDiffOperation::Remove:
+			this->beginRemoveRows(QModelIndex(), first, last);
+			this->mMapping.remove(op.index, op.length);
+			this->mProxyRowsValid = false;
+			this->endRemoveRows();
+			break;
+		case ListDiffOperation::Insert:
+			this->beginInsertRows(QModelIndex(), first, last);
+			this->mMapping.insert(op.index, op.length, -1);
+			std::copy(
+			    newMapping.begin() + op.target,
+			    newMapping.begin() + op.target + op.length,
+			    this->mMapping.begin() + op.index
+			);
+			this->mProxyRowsValid = false;
+			this->endInsertRows();
+			break;
+		case ListDiffOperation::Move:
+			if (this->beginMoveRows(
+			        QModelIndex(),
+			        first,
+			        last,
+			        QModelIndex(),
+			        static_cast<qint32>(op.target)
+			    ))
+			{
+				moveListRange(this->mMapping, op.index, op.length, op.target);
+				this->mProxyRowsValid = false;
+				this->endMoveRows();
+			}
+			break;
+		}
+	}
+
+	this->markChanged();
+}
+
+void SortFilterModel::updateRow(qint32 sourceRow) {
+	auto row = this->mapFromSource(sourceRow);
+	this->replaceRow(sourceRow);
+
+	if (!this->mRows.at(sourceRow).accepted) {
+		if (row == -1) return;
+
+		this->beginRemoveRows(QModelIndex(), row, row);
+		this->mMapping.removeAt(row);
+		this->mProxyRowsValid = false;
+		this->endRemoveRows();
+		this->markChanged();
+	} else if (row == -1) {
+		this->insertRow(sourceRow);
+	} else {
+		// Find the position among all other rows, which are still in order.
+		auto begin = this->mMapping.cbegin();
+		auto end = this->mMapping.cend();
+		auto less = [this](qint32 a, qint32 b) { return this->lessThan(a, b); };
+
+		auto target = std::distance(begin, std::lower_bound(begin, begin + row, sourceRow, less));
+		if (target == row) {
+			target = std::distance(begin, std::lower_bound(begin + row + 1, end, sourceRow, less)) - 1;
+		}
+
+		if (target == row) return;
+
+		auto dest = static_cast<qint32>(target > row ? target + 1 : target);
+		if (this->beginMoveRows(QModelIndex(), row, row, QModelIndex(), dest)) {
+			this->mMapping.move(row, target);
+			this->mProxyRowsValid = false;
+			this->endMoveRows();
+			this->markChanged();
+		}
+	}
+}
+
+void SortFilterModel::insertRow(qint32 sourceRow) {
+	auto less = [this](qint32 a, qint32 b) { return this->lessThan(a, b); };
+	auto iter = std::lower_bound(this->mMapping.cbegin(), this->mMapping.cend(), sourceRow, less);
+	auto row = static_cast<qint32>(std::distance(this->mMapping.cbegin(), iter));
+
+	this->beginInsertRows(QModelIndex(), row, row);
+	this->mMapping.insert(row, sourceRow);
+	this->mProxyRowsValid = false;
+	this->endInsertRows();
+	this->markChanged();
+}
+
+void SortFilterModel::markChanged() {
+	this->mValuesValid = false;
+	emit this->valuesChanged();
+}
+
+void SortFilterModel::invalidateRows() {
+	this->mProxyRowsValid = false;
+	this->mObjectRowsValid = false;
+}
+
+SortFilterModel::SourceRow SortFilterModel::computeRow(qint32 sourceRow) const {
+	auto value = this->mSource->data(this->mSource->index(sourceRow, 0), this->mDataRole);
+
+	auto row = SourceRow();
+	row.object = value.value<QObject*>();
+
+	if (!this->mSortProperty.isEmpty()) {
+		row.sortKey = this->readKey(sourceRow, value, this->mSortProperty);
+	}
+
+	row.accepted = this->accepts(sourceRow, value);
+	return row;
+}
+
+void SortFilterModel::replaceRow(qint32 sourceRow) {
+	auto row = this->computeRow(sourceRow);
+	auto& current = this->mRows[sourceRow];
+
+	if (row.object != current.object) {
+		if (current.object) this->unwatchObject(current.object);
+		if (row.object) this->watchObject(row.object);
+		this->mObjectRowsValid = false;
+	}
+
+	current = std::move(row);
+}
+
+QVariant
+SortFilterModel::readKey(qint32 sourceRow, const QVariant& value, const QString& name) const {
+	if (name.isEmpty()) return value;
+
+	auto role = this->mSourceRoles.value(name, -1);
+	if (role != -1) {
+		return this->mSource->data(this->mSource->index(sourceRow, 0), role);
+	}
+
+	if (auto* object = value.value<QObject*>()) {
+		return object->property(name.toUtf8().constData());
+	}
+
+	if (value.canConvert<QVariantMap>()) {
+		return value.value<QVariantMap>().value(name);
+	}
+
+	return QVariant();
+}
+
+bool SortFilterModel::accepts(qint32 sourceRow, const QVariant& value) const {
+	if (!this->mFilterProperty.isEmpty() && this->mFilterValue.isValid()) {
+		if (this->readKey(sourceRow, value, this->mFilterProperty) != this->mFilterValue) return false;
+	}
+
+	if (this->mSearchText.isEmpty()) return true;
+
+	auto matches = [&](const QString& name) {
+		return this->readKey(sourceRow, value, name)
+		    .toString()
+		    .contains(this->mSearchText, this->mCaseSensitivity);
+	};
+
+	if (this->mSearchProperties.isEmpty()) return matches(QString());
+	return std::ranges::any_of(this->mSearchProperties, matches);
+}
+
+bool SortFilterModel::lessThan(qint32 left, qint32 right) const {
+	if (!this->mSortProperty.isEmpty()) {
+		auto cmp = compareKeys(
+		    this->mRows.at(left).sortKey,
+		    this->mRows.at(right).sortKey,
+		    this->mCaseSensitivity
+		);
+
+		if (cmp != 0) return this->mSortOrder == Qt::AscendingOrder ? cmp < 0 : cmp > 0;
+	}
+
+	return left < right;
+}
+
+void SortFilterModel::watchObject(QObject* object) {
+	if (this->mWatchCounts[object]++ != 0) return;
+
+	QObject::connect(object, &QObject::destroyed, this, &SortFilterModel::onObjectDestroyed);
+	this->connectProperties(object);
+}
+
+void SortFilterModel::unwatchObject(QObject* object) {
+	auto iter = this->mWatchCounts.find(object);
+	if (iter == this->mWatchCounts.end() || --iter.value() != 0) return;
+
+	this->mWatchCounts.erase(iter);
+	QObject::disconnect(object, nullptr, this, nullptr);
+}
+
+void SortFilterModel::rewatchObjects() {
+	for (auto* object: this->mWatchCounts.keys()) {
+		QObject::disconnect(object, nullptr, this, nullptr);
+		QObject::connect(object, &QObject::destroyed, this, &SortFilterModel::onObjectDestroyed);
+		this->connectProperties(object);
+	}
+}
+
+void SortFilterModel::connectProperties(QObject* object) {
+	static const auto slotIndex =
+	    SortFilterModel::staticMetaObject.indexOfSlot("onObjectPropertyChanged()");
+
+	const auto* meta = object->metaObject();
+
+	auto watch = [&](const QString& name) {
+		if (name.isEmpty() || this->mSourceRoles.contains(name)) return;
+
+		auto index = meta->indexOfProperty(name.toUtf8().constData());
+		if (index == -1) return;
+
+		auto property = meta->property(index);
+		if (!property.hasNotifySignal()) return;
+
+		QMetaObject::connect(
+		    object,
+		    property.notifySignalIndex(),
+		    this,
+		    slotIndex,
+		    Qt::UniqueConnection
+		);
+	};
+
+	watch(this->mSortProperty);
+	watch(this->mFilterProperty);
+	if (!this->mSearchText.isEmpty()) std::ranges::for_each(this->mSearchProperties, watch);
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <qabstractitemmodel.h>
+#include <qcontainerfwd.h>
+#include <qnamespace.h>
+#include <qobject.h>
+#include <qpointer.h>
+#include <qqmlintegration.h>
+#include <qtmetamacros.h>
+#include <qtypes.h>
+#include <qvariant.h>
+
+///! Sorted and filtered view of another model
+/// SortFilterModel is a QML [Data Model] presenting the entries of an @@ObjectModel,
+/// @@ScriptModel or any other list model sorted and filtered by their properties,
+/// without running javascript for every entry.
+///
+/// Entries are matched by their properties, or by the roles of the source model if a role
+/// with the given name exists. When the source model's entries are objects, changes to the
+/// watched properties are tracked and only the affected entry is moved, inserted or removed.
+///
+/// ### Example
+/// ```qml
+/// @@QtQuick.ListView {
+///   model: SortFilterModel {
+///     model: DesktopEntries.applications
+///     sortProperty: "name"
+///     searchProperties: [ "name", "genericName" ]
+///     searchText: searchField.text
+///   }
+///
+///   delegate: // ...
+/// }
+/// ```
+///
+/// This replaces the following pattern, which re-filters and re-sorts the whole list
+/// on every change:
+/// ```qml
+/// ScriptModel {
+///   values: [...DesktopEntries.applications.values]
+///     .filter(e => e.name.toLowerCase().includes(searchField.text.toLowerCase()))
+///     .sort((a, b) => a.name.localeCompare(b.name))
+/// }
+/// ```
+///
+/// [Data Model]: https://doc.qt.io/qt-6/qtquick-modelviewsdata-modelview.html#qml-data-models
+class SortFilterModel: public QAbstractListModel {
+	Q_OBJECT;
+	/// The model to sort and filter. Usually an @@ObjectModel or @@ScriptModel.
+	Q_PROPERTY(QAbstractItemModel* model READ model WRITE setModel NOTIFY modelChanged);
+	/// The property entries are sorted by. Defaults to `""`, which keeps the source model's order.
+	Q_PROPERTY(QString sortProperty READ sortProperty WRITE setSortProperty NOTIFY sortPropertyChanged);
+	/// The direction entries are sorted in. Defaults to `Qt.AscendingOrder`.
+	///
+	/// Entries that compare equal always keep the source model's order.
+	Q_PROPERTY(Qt::SortOrder sortOrder READ sortOrder WRITE setSortOrder NOTIFY sortOrderChanged);
+	/// The property compared against @@filterValue. Defaults to `""`, meaning no filter.
+	Q_PROPERTY(QString filterProperty READ filterProperty WRITE setFilterProperty NOTIFY filterPropertyChanged);
+	/// If set, only entries with @@filterProperty equal to this value are shown.
+	Q_PROPERTY(QVariant filterValue READ filterValue WRITE setFilterValue NOTIFY filterValueChanged);
+	/// The properties searched for @@searchText. If empty, the entries themselves are searched.
+	Q_PROPERTY(QStringList searchProperties READ searchProperties WRITE setSearchProperties NOTIFY searchPropertiesChanged);
+	/// If not empty, only entries with at least one of @@searchProperties containing this
+	/// string are shown.
+	Q_PROPERTY(QString searchText READ searchText WRITE setSearchText NOTIFY searchTextChanged);
+	/// Case sensitivity of @@searchText matching and string sorting. Defaults to `Qt.CaseInsensitive`.
+	Q_PROPERTY(Qt::CaseSensitivity caseSensitivity READ caseSensitivity WRITE setCaseSensitivity NOTIFY caseSensitivityChanged);
+	/// The entries of the model after sorting and filtering, as a list.
+	Q_PROPERTY(QVariantList values READ values NOTIFY valuesChanged);
+	QML_ELEMENT;
+
+public:
+	explicit SortFilterModel(QObject* parent = nullptr): QAbstractListModel(parent) {}
+
+	[[nodiscard]] qint32 rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	[[nodiscard]] QVariant data(const QModelIndex& index, qint32 role) const override;
+	[[nodiscard]] QHash<int, QByteArray> roleNames() const override;
+
+	/// Returns the row of the given source model row in this model, or -1 if it is filtered out.
+	Q_INVOKABLE [[nodiscard]] qint32 mapFromSource(qint32 sourceRow) const;
+	/// Returns the source model row of the given row.
+	Q_INVOKABLE [[nodiscard]] qint32 mapToSource(qint32 row) const;
+
+	[[nodiscard]] QAbstractItemModel* model() const { return this->mSource; }
+	void setModel(QAbstractItemModel* model);
+
+	[[nodiscard]] QString sortProperty() const { return this->mSortProperty; }
+	void setSortProperty(const QString& sortProperty);
+
+	[[nodiscard]] Qt::SortOrder sortOrder() const { return this->mSortOrder; }
+	void setSortOrder(Qt::SortOrder sortOrder);
+
+	[[nodiscard]] QString filterProperty() const { return this->mFilterProperty; }
+	void setFilterProperty(const QString& filterProperty);
+
+	[[nodiscard]] QVariant filterValue() const { return this->mFilterValue; }
+	void setFilterValue(const QVariant& filterValue);
+
+	[[nodiscard]] QStringList searchProperties() const { return this->mSearchProperties; }
+	void setSearchProperties(const QStringList& searchProperties);
+
+	[[nodiscard]] QString searchText() const { return this->mSearchText; }
+	void setSearchText(const QString& searchText);
+
+	[[nodiscard]] Qt::CaseSensitivity caseSensitivity() const { return this->mCaseSensitivity; }
+	void setCaseSensitivity(Qt::CaseSensitivity caseSensitivity);
+
+	[[nodiscard]] QVariantList values();
+
+signals:
+	void modelChanged();
+	void sortPropertyChanged();
+	void sortOrderChanged();
+	void filterPropertyChanged();
+	void filterValueChanged();
+	void searchPropertiesChanged();
+	void searchTextChanged();
+	void caseSensitivityChanged();
+	void valuesChanged();
+
+private slots:
+	void onSourceDestroyed();
+	void onSourceReset();
+	void onRowsInserted(const QModelIndex& parent, qint32 first, qint32 last);
+	void onRowsAboutToBeRemoved(const QModelIndex& parent, qint32 first, qint32 last);
+	void onRowsRemoved(const QModelIndex& parent, qint32 first, qint32 last);
+	void onRowsMoved(
+	    const QModelIndex& sourceParent,
+	    qint32 sourceStart,
+	    qint32 sourceEnd,
+	    const QModelIndex& destParent,
+	    qint32 destRow
+	);
+	void onDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+	void onObjectPropertyChanged();
+	void onObjectDestroyed(QObject* object);
+
+private:
+	// Cached state of a single source model row.
+	struct SourceRow {
+		QPointer<QObject> object;
+		QVariant sortKey;
+		bool accepted = false;
+	};
+
+	void rebuild();
+	// Recomputes every row. Watched objects are only reconnected if rewatch is set, which is
+	// required when the set of watched properties changes.
+	void refresh(bool rewatch);
+	void updateRow(qint32 sourceRow);
+	void insertRow(qint32 sourceRow);
+	void markChanged();
+	void invalidateRows();
+
+	[[nodiscard]] SourceRow computeRow(qint32 sourceRow) const;
+	// Recomputes a row, moving its watch if the row's object changed.
+	void replaceRow(qint32 sourceRow);
+	[[nodiscard]] QVariant readKey(qint32 sourceRow, const QVariant& value, const QString& name) const;
+	[[nodiscard]] bool accepts(qint32 sourceRow, const QVariant& value) const;
+	[[nodiscard]] bool lessThan(qint32 left, qint32 right) const;
+	void watchObject(QObject* object);
+	void unwatchObject(QObject* object);
+	void rewatchObjects();
+	void connectProperties(QObject* object);
+
+	QAbstractItemModel* mSource = nullptr;
+	QString mSortProperty;
+	Qt::SortOrder mSortOrder = Qt::AscendingOrder;
+	QString mFilterProperty;
+	QVariant mFilterValue;
+	QStringList mSearchProperties;
+	QString mSearchText;
+	Qt::CaseSensitivity mCaseSensitivity = Qt::CaseInsensitive;
+
+	QHash<QString, qint32> mSourceRoles;
+	qint32 mDataRole = Qt::UserRole;
+	QList<SourceRow> mRows;   // indexed by source row
+	QList<qint32> mMapping;   // source row of each row
+	// Inverse of mMapping and source rows of each watched object, rebuilt on first use
+	// after the rows change.
+	mutable QList<qint32> mProxyRows;
+	mutable bool mProxyRowsValid = false;
+	QMultiHash<const QObject*, qint32> mObjectRows;
+	bool mObjectRowsValid = false;
+	// Objects may be shared between rows, and are only unwatched once no row uses them.
+	QHash<QObject*, qint32> mWatchCounts;
+	QVariantList mValues;
+	bool mValuesValid = false;
+	bool mRemovePending = false;
+};
@@ -0,0 +1,255 @@
+#include "colorquantizer.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+#include <qatomic.h>
+#include <qcolor.h>
+#include <qdeadlinetimer.h>
+#include <qlist.h>
+#include <qnumeric.h>
+#include <qobject.h>
+#include <qrandom.h>
+#include <qrgb.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../colorquantizer.hpp"
+
+namespace {
+
+// The previous QColor based implementation, kept to compare performance against.
+QList<QColor> referenceQuantization(QList<QColor>& rgbValues, qint32 depth) {
+	if (rgbValues.isEmpty()) return QList<QColor>();
+
+	if (depth <= 0) {
+		auto totalR = 0;
+		auto totalG = 0;
+		auto totalB = 0;
+
+		for (const auto& color: rgbValues) {
+			totalR += color.red();
+			totalG += color.green();
+			totalB += color.blue();
+		}
+
+		return QList<QColor>() << QColor(
+		           qRound(totalR / static_cast<double>(rgbValues.size())),
+		           qRound(totalG / static_cast<double>(rgbValues.size())),
+		           qRound(totalB / static_cast<double>(rgbValues.size()))
+		       );
+	}
+
+	auto rMin = 255, gMin = 255, bMin = 255; // NOLINT
+	auto rMax = 0, gMax = 0, bMax = 0;       // NOLINT
+
+	for (const auto& color: rgbValues) {
+		rMin = std::min(rMin, color.red());
+		gMin = std::min(gMin, color.green());
+		bMin = std::min(bMin, color.blue());
+		rMax = std::max(rMax, color.red());
+		gMax = std::max(gMax, color.green());
+		bMax = std::max(bMax, color.blue());
+	}
+
+	auto biggestRange = std::max({rMax - rMin, gMax - gMin, bMax - bMin});
+	auto channel = biggestRange == rMax - rMin ? 'r' : biggestRange == gMax - gMin ? 'g' : 'b';
+
+	std::ranges::sort(rgbValues, [channel](const auto& a, const auto& b) {
+		if (channel == 'r') return a.red() < b.red();
+		else if (channel == 'g') return a.green() < b.green();
+		return a.blue() < b.blue();
+	});
+
+	auto mid = rgbValues.size() / 2;
+	auto leftHalf = rgbValues.mid(0, mid);
+	auto rightHalf = rgbValues.mid(mid);
+
+	return referenceQuantization(leftHalf, depth - 1) + referenceQuantization(rightHalf, depth - 1);
+}
+
+QList<QRgb> testPixels(qsizetype count) {
+	auto random = QRandomGenerator(42); // NOLINT
+	auto pixels = QList<QRgb>();
+	pixels.reserve(count);
+
+	// A few noisy gradients, roughly like a photo.
+	for (qsizetype i = 0; i != count; i++) {
+		auto t = static_cast<qint32>(i * 255 / count);
+		auto noise = static_cast<qint32>(random.bounded(32));
+
+		switch (i % 3) {
+		case 0: pixels.append(qRgb(t, 40 + noise, 200 - t / 2)); break;
+		case 1: pixels.append(qRgb(220 - noise, t / 2, 60 + noise)); break;
+		default: pixels.append(qRgb(noise * 4, 255 - t, t / 3)); break;
+		}
+	}
+
+	return pixels;
+}
+
+// Clusters of noisy colors, with population decreasing in cluster order.
+QList<QRgb> clusterPixels(const QList<QRgb>& centers) {
+	auto random = QRandomGenerator(7); // NOLINT
+	auto pixels = QList<QRgb>();
+
+	for (qsizetype i = 0; i != centers.size(); i++) {
+		auto center = centers.at(i);
+
+		for (auto j = 0; j != 1000 * (centers.size() - i); j++) {
+			auto noise = [&](qint32 c) { return std::clamp(c + random.bounded(-3, 4), 0, 255); };
+			pixels.append(qRgb(noise(qRed(center)), noise(qGreen(center)), noise(qBlue(center))));
+		}
+	}
+
+	return pixels;
+}
+
+bool similarColor(const QColor& a, QRgb b) {
+	return std::abs(a.red() - qRed(b)) <= 4 && std::abs(a.green() - qGreen(b)) <= 4
+	    && std::abs(a.blue() - qBlue(b)) <= 4;
+}
+
+QList<QColor> toColors(const QList<QRgb>& pixels) {
+	auto colors = QList<QColor>();
+	colors.reserve(pixels.size());
+	for (auto pixel: pixels) colors.append(QColor::fromRgb(pixel));
+	return colors;
+}
+
+} // namespace
+
+void TestColorQuantizer::splits() {
+	auto pixels = QList<QRgb>();
+	for (auto i = 0; i != 8; i++) {
+		pixels << qRgb(10, 0, 0) << qRgb(50, 200, 0) << qRgb(100, 0, 200) << qRgb(250, 100, 100);
+	}
+
+	// red has the largest range, then green on the low half and red again on the high half
+	auto colors = ColorQuantizerOperation::quantize(pixels, 2);
+	QCOMPARE(
+	    colors,
+	    QList<QColor>(
+	        {QColor(10, 0, 0), QColor(50, 200, 0), QColor(100, 0, 200), QColor(250, 100, 100)}
+	    )
+	);
+
+	auto average = ColorQuantizerOperation::quantize(pixels, 0);
+	QCOMPARE(average, QList<QColor>({QColor(103, 75, 75)}));
+}
+
+void TestColorQuantizer::edgeCases() {
+	auto empty = QList<QRgb>();
+	QCOMPARE(ColorQuantizerOperation::quantize(empty, 3), QList<QColor>());
+
+	auto single = QList<QRgb>({qRgb(1, 2, 3)});
+	QCOMPARE(ColorQuantizerOperation::quantize(single, 3), QList<QColor>({QColor(1, 2, 3)}));
+
+	auto three = QList<QRgb>({qRgb(0, 0, 0), qRgb(100, 0, 0), qRgb(200, 0, 0)});
+	QCOMPARE(
+	    ColorQuantizerOperation::quantize(three, 2),
+	    QList<QColor>({QColor(0, 0, 0), QColor(100, 0, 0), QColor(200, 0, 0)})
+	);
+
+	auto cancel = QAtomicInteger<bool>(true);
+	auto pixels = testPixels(1000);
+	QCOMPARE(ColorQuantizerOperation::quantize(pixels, 3, cancel), QList<QColor>());
+}
+
+void TestColorQuantizer::octree() {
+	auto centers = QList<QRgb>({qRgb(200, 30, 30), qRgb(30, 200, 30), qRgb(30, 30, 200)});
+	auto pixels = clusterPixels(centers);
+
+	auto colors = ColorQuantizerOperation::quantizeOctree(pixels, 3);
+	QCOMPARE(colors.length(), 3);
+	for (auto i = 0; i != 3; i++) {
+		QVERIFY2(similarColor(colors.at(i), centers.at(i)), qPrintable(colors.at(i).name()));
+	}
+
+	// never more colors than requested, even with many distinct colors
+	auto noisy = testPixels(10000);
+	QCOMPARE(ColorQuantizerOperation::quantizeOctree(noisy, 20).length(), 20);
+	QCOMPARE(ColorQuantizerOperation::quantizeOctree(noisy, 0), QList<QColor>());
+
+	auto single = QList<QRgb>({qRgb(1, 2, 3)});
+	QCOMPARE(ColorQuantizerOperation::quantizeOctree(single, 4), QList<QColor>({QColor(1, 2, 3)}));
+}
+
+void TestColorQuantizer::kmeans() {
+	auto centers = QList<QRgb>(
+	    {qRgb(200, 30, 30), qRgb(30, 200, 30), qRgb(30, 30, 200), qRgb(240, 240, 240)}
+	);
+	auto pixels = clusterPixels(centers);
+
+	auto colors = ColorQuantizerOperation::quantizeKMeans(pixels, 4);
+	QCOMPARE(colors.length(), 4);
+	for (auto i = 0; i != 4; i++) {
+		QVERIFY2(similarColor(colors.at(i), centers.at(i)), qPrintable(colors.at(i).name()));
+	}
+
+	// seeding is deterministic
+	QCOMPARE(ColorQuantizerOperation::quantizeKMeans(pixels, 4), colors);
+
+	// fewer distinct colors than requested
+	auto two = QList<QRgb>({qRgb(255, 0, 0), qRgb(0, 0, 255), qRgb(255, 0, 0)});
+	colors = ColorQuantizerOperation::quantizeKMeans(two, 8);
+	QCOMPARE(colors, QList<QColor>({QColor(255, 0, 0), QColor(0, 0, 255)}));
+}
+
+void TestColorQuantizer::timeLimit() {
+	auto pixels = testPixels(1920 * 1080);
+	auto expired = QDeadlineTimer(0);
+
+	// expired deadlines still produce colors from the pixels sampled so far
+	QVERIFY(!ColorQuantizerOperation::quantizeOctree(pixels, 16, expired).isEmpty());
+	QVERIFY(!ColorQuantizerOperation::quantizeKMeans(pixels, 16, expired).isEmpty());
+
+	auto cancel = QAtomicInteger<bool>(true);
+	QCOMPARE(
+	    ColorQuantizerOperation::quantizeOctree(pixels, 16, QDeadlineTimer::Forever, cancel),
+	    QList<QColor>()
+	);
+	QCOMPARE(
+	    ColorQuantizerOperation::quantizeKMeans(pixels, 16, QDeadlineTimer::Forever, cancel),
+	    QList<QColor>()
+	);
+}
+
+void TestColorQuantizer::benchmarkReference() {
+	auto pixels = toColors(testPixels(1920 * 1080 / 4));
+
+	QBENCHMARK {
+		auto copy = pixels;
+		auto colors = referenceQuantization(copy, 4);
+		QCOMPARE(colors.length(), 16);
+	}
+}
+
+void TestColorQuantizer::benchmark() {
+	auto pixels = testPixels(1920 * 1080 / 4);
+
+	QBENCHMARK {
+		auto copy = pixels;
+		auto colors = ColorQuantizerOperation::quantize(copy, 4);
+		QCOMPARE(colors.length(), 16);
+	}
+}
+
+void TestColorQuantizer::benchmarkOctree() {
+	auto pixels = testPixels(1920 * 1080 / 4);
+
+	QBENCHMARK {
+		auto colors = ColorQuantizerOperation::quantizeOctree(pixels, 16);
+		QCOMPARE(colors.length(), 16);
+	}
+}
+
+void TestColorQuantizer::benchmarkKMeans() {
+	auto pixels = testPixels(1920 * 1080 / 4);
+
+	QBENCHMARK {
+		auto colors = ColorQuantizerOperation::quantizeKMeans(pixels, 16);
+		QCOMPARE(colors.length(), 16);
+	}
+}
+
+QTEST_MAIN(TestColorQuantizer);
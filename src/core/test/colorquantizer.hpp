@@ -0,0 +1,19 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtmetamacros.h>
+
+class TestColorQuantizer: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void splits();
+	static void edgeCases();
+	static void octree();
+	static void kmeans();
+	static void timeLimit();
+	static void benchmarkReference();
+	static void benchmark();
+	static void benchmarkOctree();
+	static void benchmarkKMeans();
+};
@@ -0,0 +1,115 @@
+#include "colorquantizercache.hpp"
+#include <memory>
+
+#include <qbytearray.h>
+#include <qcolor.h>
+#include <qdatetime.h>
+#include <qfile.h>
+#include <qfiledevice.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qtypes.h>
+#include <qurl.h>
+
+#include "../colorquantizercache.hpp"
+
+namespace {
+
+QString writeSource(const QString& path, const QByteArray& content = "image") {
+	auto file = QFile(path);
+	if (!file.open(QFile::WriteOnly)) return QString();
+	file.write(content);
+	return path;
+}
+
+ColorQuantizerKey testKey(qint32 index) {
+	return ColorQuantizerKey {.path = QString("/image%1.png").arg(index), .depth = 3};
+}
+
+} // namespace
+
+void TestColorQuantizerCache::init() {
+	this->dir = std::make_unique<QTemporaryDir>();
+	QVERIFY(this->dir->isValid());
+}
+
+void TestColorQuantizerCache::keys() {
+	auto source = QUrl::fromLocalFile(writeSource(this->dir->filePath("image.png")));
+
+	QVERIFY(!ColorQuantizerCache::keyFor(QUrl("qrc:/image.png"), 3, 0, 64, 1));
+	QVERIFY(!ColorQuantizerCache::keyFor(QUrl::fromLocalFile("/nonexistent.png"), 3, 0, 64, 1));
+
+	auto key = ColorQuantizerCache::keyFor(source, 2.5, 0, 64.5, 1);
+	QVERIFY(key);
+	QCOMPARE(key->path, source.toLocalFile());
+	QCOMPARE(key->size, qint64(5));
+	QCOMPARE(key->depth, 3);
+	QCOMPARE(key->colorCount, 0);
+	QCOMPARE(key->rescaleSize, 64);
+
+	QCOMPARE(ColorQuantizerCache::keyFor(source, -1, 0, -1, 1)->depth, 0);
+	QCOMPARE(ColorQuantizerCache::keyFor(source, -1, 0, -1, 1)->rescaleSize, 0);
+	QCOMPARE(ColorQuantizerCache::keyFor(source, -1, -5, -1, 1)->colorCount, 0);
+	QVERIFY(*ColorQuantizerCache::keyFor(source, 2.5, 12, 64.5, 1) != *key);
+	QVERIFY(*ColorQuantizerCache::keyFor(source, 3, 0, 64, 2) != *key);
+
+	// replacing the image changes the key
+	auto file = QFile(source.toLocalFile());
+	QVERIFY(file.open(QFile::ReadWrite));
+	file.setFileTime(
+	    QDateTime::currentDateTimeUtc().addSecs(-60),
+	    QFileDevice::FileModificationTime
+	);
+	file.close();
+
+	QVERIFY(*ColorQuantizerCache::keyFor(source, 2.5, 0, 64.5, 1) != *key);
+}
+
+void TestColorQuantizerCache::roundtrip() {
+	auto path = this->dir->filePath("colorquantizer.cache");
+	auto colors = QList<QColor> {QColor(10, 20, 30), QColor(200, 100, 0)};
+
+	auto cache = ColorQuantizerCache(path);
+	QVERIFY(!cache.lookup(testKey(0)));
+
+	cache.store(testKey(0), colors);
+	QCOMPARE(cache.lookup(testKey(0)).value_or(QList<QColor>()), colors);
+	QVERIFY(!cache.lookup(testKey(1)));
+
+	// results persist across instances
+	auto reopened = ColorQuantizerCache(path);
+	QCOMPARE(reopened.lookup(testKey(0)).value_or(QList<QColor>()), colors);
+
+	// corrupt files are ignored
+	writeSource(path, "garbage");
+	auto corrupt = ColorQuantizerCache(path);
+	QVERIFY(!corrupt.lookup(testKey(0)));
+}
+
+void TestColorQuantizerCache::eviction() {
+	auto path = this->dir->filePath("colorquantizer.cache");
+	auto colors = QList<QColor> {QColor(10, 20, 30)};
+
+	auto cache = ColorQuantizerCache(path);
+	for (auto i = 0; i != 256; i++) cache.store(testKey(i), colors);
+
+	// the first entry is now the most recently used
+	QVERIFY(cache.lookup(testKey(0)));
+	cache.store(testKey(256), colors);
+
+	QVERIFY(cache.lookup(testKey(0)));
+	QVERIFY(!cache.lookup(testKey(1)));
+	QVERIFY(cache.lookup(testKey(256)));
+
+	// use order persists across instances
+	auto reopened = ColorQuantizerCache(path);
+	QVERIFY(reopened.lookup(testKey(2)));
+	reopened.store(testKey(257), colors);
+	QVERIFY(reopened.lookup(testKey(2)));
+	QVERIFY(!reopened.lookup(testKey(3)));
+}
+
+QTEST_MAIN(TestColorQuantizerCache);
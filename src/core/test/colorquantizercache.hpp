@@ -0,0 +1,20 @@
+#pragma once
+
+#include <memory>
+
+#include <qobject.h>
+#include <qtemporarydir.h>
+#include <qtmetamacros.h>
+
+class TestColorQuantizerCache: public QObject {
+	Q_OBJECT;
+
+private slots:
+	void init();
+	void keys();
+	void roundtrip();
+	void eviction();
+
+private:
+	std::unique_ptr<QTemporaryDir> dir;
+};
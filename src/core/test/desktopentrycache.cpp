@@ -0,0 +1,163 @@
+#include "desktopentrycache.hpp"
+#include <algorithm>
+
+#include <qbytearray.h>
+#include <qcontainerfwd.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qobject.h>
+#include <qstring.h>
+#include <qtenvironmentvariables.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../desktopentry.hpp"
+#include "../desktopentrycache.hpp"
+
+namespace {
+
+void writeFile(const QString& path, const QByteArray& content) {
+	QDir().mkpath(QFileInfo(path).path());
+	auto file = QFile(path);
+	QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+	file.write(content);
+}
+
+QByteArray readFile(const QString& path) {
+	auto file = QFile(path);
+	if (!file.open(QFile::ReadOnly)) return QByteArray();
+	return file.readAll();
+}
+
+// QDataStream's encoding of a string's characters.
+QByteArray utf16(const QString& string) {
+	auto bytes = QByteArray();
+	for (auto c: string) bytes.append(static_cast<char>(c.unicode() >> 8)).append(c.toLatin1());
+	return bytes;
+}
+
+} // namespace
+
+void TestDesktopEntryCache::initTestCase() {
+	QVERIFY(this->dir.isValid());
+
+	// desktopPaths() and the locale are computed once, so the environment must be set first.
+	qputenv("LC_MESSAGES", "de_DE.UTF-8");
+	qputenv("XDG_CONFIG_HOME", this->dir.filePath("config").toUtf8());
+	qputenv("XDG_CONFIG_DIRS", this->dir.filePath("etc").toUtf8());
+	qputenv("XDG_DATA_HOME", this->dir.filePath("data").toUtf8());
+	qputenv("XDG_DATA_DIRS", this->dir.filePath("share").toUtf8());
+
+	writeFile(
+	    this->dir.filePath("data/applications/files.desktop"),
+	    "[Desktop Entry]\nType=Application\nName=Files\nName[de]=Dateien\nExec=files\n"
+	);
+	writeFile(
+	    this->dir.filePath("share/applications/sub/editor.desktop"),
+	    "[Desktop Entry]\nType=Application\nName=Editor\nKeywords=text;code;\nExec=editor %F\n"
+	);
+
+	QCOMPARE(DesktopEntry::localeName(), QStringLiteral("de_DE.UTF-8"));
+}
+
+QString TestDesktopEntryCache::writeCache() {
+	auto path = this->dir.filePath("desktopentries.cache");
+
+	auto scanner =
+	    DesktopEntryScanner(nullptr, DesktopEntryScanState(), DesktopEntryManager::desktopPaths());
+	scanner.cachePath = path;
+	scanner.forceCacheWrite = true;
+	scanner.scan();
+
+	return path;
+}
+
+void TestDesktopEntryCache::roundTrip() {
+	auto path = this->writeCache();
+
+	auto state = DesktopEntryScanState();
+	QVERIFY(DesktopEntryCache::load(path, state));
+	QCOMPARE(state.files.size(), 2);
+	QCOMPARE(state.pathsById.size(), 2);
+
+	const auto* files = state.effectiveFile("files");
+	QVERIFY(files);
+	QCOMPARE(files->data.name, QStringLiteral("Dateien"));
+	QCOMPARE(files->priority, 0);
+
+	const auto* editor = state.effectiveFile("sub-editor");
+	QVERIFY(editor);
+	QCOMPARE(editor->path, this->dir.filePath("share/applications/sub/editor.desktop"));
+	QCOMPARE(editor->priority, 1);
+	QCOMPARE(editor->data.keywords, QStringList({"text", "code"}));
+	QCOMPARE(editor->mtime, QFileInfo(editor->path).lastModified().toMSecsSinceEpoch());
+}
+
+void TestDesktopEntryCache::outdated() {
+	auto path = this->writeCache();
+	auto state = DesktopEntryScanState();
+	QVERIFY(DesktopEntryCache::load(path, state));
+
+	// changing a scanned directory's mtime invalidates the cache
+	QTest::qWait(20);
+	writeFile(this->dir.filePath("share/applications/sub/new.desktop"), "[Desktop Entry]\n");
+	QVERIFY(!DesktopEntryCache::load(path, state));
+
+	path = this->writeCache();
+	QVERIFY(DesktopEntryCache::load(path, state));
+
+	QTest::qWait(20);
+	QVERIFY(QFile::remove(this->dir.filePath("share/applications/sub/new.desktop")));
+	QVERIFY(!DesktopEntryCache::load(path, state));
+}
+
+void TestDesktopEntryCache::locale() {
+	auto path = this->writeCache();
+	auto content = readFile(path);
+
+	// a cache written with a different locale has names in the wrong language
+	auto index = content.indexOf(utf16("de_DE"));
+	QVERIFY(index != -1);
+	content.replace(index, 10, utf16("fr_FR"));
+	writeFile(path, content);
+
+	auto state = DesktopEntryScanState();
+	QVERIFY(!DesktopEntryCache::load(path, state));
+	QVERIFY(state.files.isEmpty());
+}
+
+void TestDesktopEntryCache::corrupt() {
+	auto path = this->writeCache();
+	auto content = readFile(path);
+	auto state = DesktopEntryScanState();
+
+	writeFile(path, content.first(content.size() - 16));
+	QVERIFY(!DesktopEntryCache::load(path, state));
+
+	writeFile(path, QByteArray(content.size(), '\xff'));
+	QVERIFY(!DesktopEntryCache::load(path, state));
+
+	writeFile(path, QByteArray());
+	QVERIFY(!DesktopEntryCache::load(path, state));
+
+	// the file count precedes the length of the first file's path
+	auto first = std::min(
+	    content.indexOf(utf16(this->dir.filePath("data/applications/files.desktop"))),
+	    content.indexOf(utf16(this->dir.filePath("share/applications/sub/editor.desktop")))
+	);
+	auto countIndex = first - 8;
+	QCOMPARE(content.sliced(countIndex, 4), QByteArray("\0\0\0\2", 4));
+
+	// negative and oversized counts are rejected
+	writeFile(path, QByteArray(content).replace(countIndex, 4, "\xff\xff\xff\xff"));
+	QVERIFY(!DesktopEntryCache::load(path, state));
+
+	writeFile(path, QByteArray(content).replace(countIndex, 4, "\x7f\xff\xff\xff"));
+	QVERIFY(!DesktopEntryCache::load(path, state));
+
+	QVERIFY(!DesktopEntryCache::load(this->dir.filePath("missing.cache"), state));
+	QVERIFY(state.files.isEmpty());
+}
+
+QTEST_MAIN(TestDesktopEntryCache);
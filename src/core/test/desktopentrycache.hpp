@@ -0,0 +1,21 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtemporarydir.h>
+#include <qtmetamacros.h>
+
+class TestDesktopEntryCache: public QObject {
+	Q_OBJECT;
+
+private slots:
+	void initTestCase();
+	void roundTrip();
+	void outdated();
+	void locale();
+	void corrupt();
+
+private:
+	[[nodiscard]] QString writeCache();
+
+	QTemporaryDir dir;
+};
@@ -0,0 +1,118 @@
+#include "desktopentrymime.hpp"
+
+#include <qbytearray.h>
+#include <qcontainerfwd.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qstring.h>
+#include <qtenvironmentvariables.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../desktopentry.hpp"
+#include "../desktopentrymime.hpp"
+
+namespace {
+
+ParsedDesktopEntryData entry(const QString& id, const QStringList& mimeTypes) {
+	auto data = ParsedDesktopEntryData();
+	data.id = id;
+	data.name = id;
+	data.mimeTypes = mimeTypes;
+	return data;
+}
+
+QList<ParsedDesktopEntryData> testEntries() {
+	return {
+	    entry("org.gnome.TextEditor", {"text/plain"}),
+	    entry("nvim", {"text/plain", "text/x-csrc"}),
+	    entry("firefox", {"text/html", "x-scheme-handler/https"}),
+	    entry("chromium", {"text/html", "x-scheme-handler/https"}),
+	    entry("imv", {"image/png"}),
+	};
+}
+
+void writeFile(const QString& path, const QByteArray& content) {
+	QDir().mkpath(QFileInfo(path).path());
+	auto file = QFile(path);
+	QVERIFY(file.open(QFile::WriteOnly));
+	file.write(content);
+}
+
+} // namespace
+
+void TestDesktopEntryMime::initTestCase() {
+	QVERIFY(this->dir.isValid());
+
+	// mimeAppsPaths() is computed once, so the environment must be set before any test.
+	qputenv("XDG_CONFIG_HOME", this->dir.filePath("config").toUtf8());
+	qputenv("XDG_CONFIG_DIRS", this->dir.filePath("etc").toUtf8());
+	qputenv("XDG_DATA_HOME", this->dir.filePath("data").toUtf8());
+	qputenv("XDG_DATA_DIRS", this->dir.filePath("share").toUtf8());
+	qputenv("XDG_CURRENT_DESKTOP", "Test");
+
+	writeFile(
+	    this->dir.filePath("config/mimeapps.list"),
+	    "[Default Applications]\n"
+	    "text/html=missing.desktop;chromium.desktop\n"
+	    "[Added Associations]\n"
+	    "image/png=firefox.desktop;\n"
+	    "[Removed Associations]\n"
+	    "text/x-csrc=nvim.desktop\n"
+	);
+
+	writeFile(
+	    this->dir.filePath("config/test-mimeapps.list"),
+	    "[Default Applications]\n"
+	    "image/png=imv.desktop\n"
+	);
+
+	writeFile(
+	    this->dir.filePath("share/applications/mimeapps.list"),
+	    "[Default Applications]\n"
+	    "text/html=firefox.desktop\n"
+	    "text/plain=nvim.desktop\n"
+	    "[Added Associations]\n"
+	    "text/x-csrc=nvim.desktop;org.gnome.TextEditor.desktop\n"
+	);
+}
+
+void TestDesktopEntryMime::claims() {
+	auto index = DesktopEntryMimeIndex::build(testEntries());
+
+	QCOMPARE(
+	    index->handlersFor("x-scheme-handler/https"),
+	    QStringList({"chromium", "firefox"})
+	);
+	QCOMPARE(index->defaultFor("x-scheme-handler/https"), QString("chromium"));
+	QCOMPARE(index->defaultFor("application/x-unknown"), QString());
+	QCOMPARE(index->handlersFor("application/x-unknown"), QStringList());
+}
+
+void TestDesktopEntryMime::mimeApps() {
+	auto index = DesktopEntryMimeIndex::build(testEntries());
+
+	// uninstalled defaults are skipped, and more important files win
+	QCOMPARE(index->defaultFor("text/html"), QString("chromium"));
+	QCOMPARE(index->handlersFor("text/html"), QStringList({"chromium", "firefox"}));
+
+	// defaults from less important files apply if not overridden
+	QCOMPARE(index->defaultFor("text/plain"), QString("nvim"));
+	QCOMPARE(index->handlersFor("text/plain"), QStringList({"nvim", "org.gnome.TextEditor"}));
+
+	// removals apply to less important files and desktop entries
+	QCOMPARE(index->handlersFor("text/x-csrc"), QStringList({"org.gnome.TextEditor"}));
+}
+
+void TestDesktopEntryMime::desktopSpecific() {
+	auto index = DesktopEntryMimeIndex::build(testEntries());
+
+	// $desktop-mimeapps.list is more important than mimeapps.list in the same directory
+	QCOMPARE(index->defaultFor("image/png"), QString("imv"));
+	QCOMPARE(index->handlersFor("image/png"), QStringList({"imv", "firefox"}));
+}
+
+QTEST_MAIN(TestDesktopEntryMime);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtemporarydir.h>
+#include <qtmetamacros.h>
+
+class TestDesktopEntryMime: public QObject {
+	Q_OBJECT;
+
+private slots:
+	void initTestCase();
+	void claims();
+	void mimeApps();
+	void desktopSpecific();
+
+private:
+	QTemporaryDir dir;
+};
@@ -0,0 +1,171 @@
+#include "desktopentryscan.hpp"
+
+#include <qbytearray.h>
+#include <qcontainerfwd.h>
+#include <qdatetime.h>
+#include <qdir.h>
+#include <qelapsedtimer.h>
+#include <qfile.h>
+#include <qfiledevice.h>
+#include <qfileinfo.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qsignalspy.h>
+#include <qstring.h>
+#include <qtenvironmentvariables.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../desktopentry.hpp"
+#include "../desktopentrymonitor.hpp"
+
+namespace {
+
+void writeEntry(const QString& path, const QString& name) {
+	QDir().mkpath(QFileInfo(path).path());
+	auto file = QFile(path);
+	QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+	file.write("[Desktop Entry]\nType=Application\nName=" + name.toUtf8() + "\nExec=true\n");
+}
+
+DesktopEntryScanResult rescan(DesktopEntryScanState& state, const QStringList& dirs) {
+	auto scanner = DesktopEntryScanner(nullptr, state, dirs);
+	auto result = scanner.scan();
+	state = result.state;
+	return result;
+}
+
+QStringList updatedIds(const DesktopEntryScanResult& result) {
+	auto ids = QStringList();
+	for (const auto& entry: result.updated) ids.append(entry.id);
+	ids.sort();
+	return ids;
+}
+
+} // namespace
+
+void TestDesktopEntryScan::initTestCase() {
+	QVERIFY(this->dir.isValid());
+
+	// desktopPaths() is computed once, so the environment must be set before any test.
+	qputenv("XDG_CONFIG_HOME", this->dir.filePath("config").toUtf8());
+	qputenv("XDG_CONFIG_DIRS", this->dir.filePath("etc").toUtf8());
+	qputenv("XDG_DATA_HOME", this->dir.filePath("data").toUtf8());
+	qputenv("XDG_DATA_DIRS", this->dir.filePath("share").toUtf8());
+
+	QVERIFY(QDir().mkpath(this->dir.filePath("data/applications")));
+	QVERIFY(QDir().mkpath(this->dir.filePath("share/applications")));
+
+	QCOMPARE(
+	    DesktopEntryManager::desktopPaths(),
+	    QStringList(
+	        {this->dir.filePath("data/applications"), this->dir.filePath("share/applications")}
+	    )
+	);
+}
+
+void TestDesktopEntryScan::incremental() {
+	auto apps = this->dir.filePath("data/applications");
+	writeEntry(apps + "/a.desktop", "A");
+	writeEntry(apps + "/b.desktop", "B");
+
+	auto state = DesktopEntryScanState();
+	auto result = rescan(state, DesktopEntryManager::desktopPaths());
+	QCOMPARE(updatedIds(result), QStringList({"a", "b"}));
+	QVERIFY(result.removed.isEmpty());
+
+	// unchanged files are not reported
+	result = rescan(state, {apps});
+	QVERIFY(result.updated.isEmpty());
+	QVERIFY(result.removed.isEmpty());
+
+	// files with the same mtime and size are not re-parsed
+	auto bPath = apps + "/b.desktop";
+	auto bMtime = QFileInfo(bPath).lastModified();
+	writeEntry(bPath, "C");
+	auto bFile = QFile(bPath);
+	QVERIFY(bFile.open(QFile::ReadWrite));
+	QVERIFY(bFile.setFileTime(bMtime, QFileDevice::FileModificationTime));
+	bFile.close();
+
+	result = rescan(state, {apps});
+	QVERIFY(result.updated.isEmpty());
+	QCOMPARE(state.files.value(bPath).data.name, QStringLiteral("B"));
+
+	// only the modified entry is re-parsed
+	writeEntry(apps + "/a.desktop", "A modified");
+	result = rescan(state, {apps});
+	QCOMPARE(updatedIds(result), QStringList({"a"}));
+	QCOMPARE(result.updated.first().name, QStringLiteral("A modified"));
+
+	writeEntry(apps + "/c.desktop", "C");
+	result = rescan(state, {apps});
+	QCOMPARE(updatedIds(result), QStringList({"c"}));
+
+	QVERIFY(QFile::remove(bPath));
+	result = rescan(state, {apps});
+	QVERIFY(result.updated.isEmpty());
+	QCOMPARE(result.removed, QStringList({"b"}));
+	QVERIFY(!state.files.contains(bPath));
+	QCOMPARE(state.files.size(), 2);
+}
+
+void TestDesktopEntryScan::subdirectory() {
+	auto apps = this->dir.filePath("share/applications");
+	writeEntry(apps + "/top.desktop", "Top");
+
+	auto state = DesktopEntryScanState();
+	auto result = rescan(state, {apps});
+	QCOMPARE(updatedIds(result), QStringList({"top"}));
+
+	// scanning a subdirectory does not look at files outside of it
+	writeEntry(apps + "/top.desktop", "Top modified");
+	writeEntry(apps + "/sub/x.desktop", "X");
+
+	result = rescan(state, {apps + "/sub"});
+	QCOMPARE(updatedIds(result), QStringList({"sub-x"}));
+	QCOMPARE(state.files.value(apps + "/top.desktop").data.name, QStringLiteral("Top"));
+
+	QVERIFY(QDir(apps + "/sub").removeRecursively());
+	result = rescan(state, {apps + "/sub"});
+	QCOMPARE(result.removed, QStringList({"sub-x"}));
+	QVERIFY(state.files.contains(apps + "/top.desktop"));
+}
+
+void TestDesktopEntryScan::monitorDebounce() {
+	auto apps = this->dir.filePath("data/applications");
+	auto monitor = DesktopEntryMonitor();
+	auto spy = QSignalSpy(&monitor, &DesktopEntryMonitor::desktopEntriesChanged);
+
+	// a burst of changes is delivered once
+	for (auto i = 0; i != 5; i++) {
+		writeEntry(apps + QString("/debounce%1.desktop").arg(i), "Debounce");
+		QTest::qWait(10);
+	}
+
+	QTRY_COMPARE(spy.count(), 1);
+	QVERIFY(spy.first().first().toStringList().contains(apps));
+
+	QTest::qWait(300);
+	QCOMPARE(spy.count(), 1);
+}
+
+void TestDesktopEntryScan::monitorBurst() {
+	auto apps = this->dir.filePath("share/applications");
+	auto monitor = DesktopEntryMonitor();
+	auto spy = QSignalSpy(&monitor, &DesktopEntryMonitor::desktopEntriesChanged);
+
+	// changes which never settle are still delivered about once a second
+	auto timer = QElapsedTimer();
+	timer.start();
+
+	for (auto i = 0; timer.elapsed() < 1500; i++) {
+		writeEntry(apps + QString("/burst%1.desktop").arg(i), "Burst");
+		QTest::qWait(50);
+	}
+
+	QCOMPARE(spy.count(), 1);
+	QTRY_COMPARE(spy.count(), 2);
+}
+
+QTEST_MAIN(TestDesktopEntryScan);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtemporarydir.h>
+#include <qtmetamacros.h>
+
+class TestDesktopEntryScan: public QObject {
+	Q_OBJECT;
+
+private slots:
+	void initTestCase();
+	void incremental();
+	void subdirectory();
+	void monitorDebounce();
+	void monitorBurst();
+
+private:
+	QTemporaryDir dir;
+};
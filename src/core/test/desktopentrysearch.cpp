@@ -0,0 +1,191 @@
+#include "desktopentrysearch.hpp"
+
+#include <qcontainerfwd.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../desktopentry.hpp"
+#include "../desktopentrysearch.hpp"
+
+namespace {
+
+ParsedDesktopEntryData entry(
+    const QString& id,
+    const QString& name,
+    const QString& genericName = QString(),
+    const QStringList& command = QStringList(),
+    const QStringList& keywords = QStringList()
+) {
+	auto data = ParsedDesktopEntryData();
+	data.id = id;
+	data.name = name;
+	data.genericName = genericName;
+	data.command = command;
+	data.keywords = keywords;
+	return data;
+}
+
+QList<ParsedDesktopEntryData> testEntries() {
+	return {
+	    entry("firefox", "Firefox", "Web Browser", {"firefox", "%u"}, {"internet", "www"}),
+	    entry(
+	        "org.gnome.Nautilus",
+	        "Files",
+	        "File Manager",
+	        {"env", "GTK_THEME=Adwaita", "/usr/bin/nautilus", "--new-window"},
+	        {"folder", "explorer"}
+	    ),
+	    entry("foot", "Foot", "Terminal", {"foot"}),
+	    entry("Alacritty", "Alacritty", "Terminal", {"alacritty"}, {"shell", "prompt"}),
+	};
+}
+
+// A corpus roughly the size of a desktop with many applications installed.
+QList<ParsedDesktopEntryData> benchmarkEntries() {
+	auto entries = QList<ParsedDesktopEntryData>();
+	const auto words = QStringList(
+	    {"Web", "Browser", "Terminal", "Editor", "Image", "Viewer", "Music", "Player", "Settings"}
+	);
+
+	for (auto i = 0; i != 2500; i++) {
+		auto name = words.at(i % words.length()) + ' ' + words.at((i / 7) % words.length()) + ' '
+		          + QString::number(i);
+
+		entries.append(entry(
+		    QString("org.example.App%1").arg(i),
+		    name,
+		    words.at((i / 3) % words.length()),
+		    {QString("/usr/bin/app-%1").arg(i)},
+		    {"utility", words.at((i / 11) % words.length())}
+		));
+	}
+
+	return entries;
+}
+
+} // namespace
+
+void TestDesktopEntrySearch::ranking() {
+	auto index = DesktopEntrySearchIndex::build(testEntries());
+
+	// consecutive matches at the start of a word beat scattered matches
+	QCOMPARE(index->query("fo", 0).ids.first(), QString("foot"));
+	QCOMPARE(index->query("ff", 0).ids, QStringList({"firefox"}));
+
+	auto terminal = index->query("term", 0).ids;
+	QCOMPARE(terminal.length(), 2);
+	QVERIFY(terminal.contains("foot"));
+	QVERIFY(terminal.contains("Alacritty"));
+
+	QCOMPARE(index->query("fox", 0).ids, QStringList({"firefox"}));
+	QCOMPARE(index->query("FIRE", 0).ids, QStringList({"firefox"}));
+	QCOMPARE(index->query("xyz", 0).ids, QStringList());
+
+	auto limited = index->query("t", 1);
+	QCOMPARE(limited.ids.length(), 1);
+	QCOMPARE(limited.matches.length(), 4);
+}
+
+void TestDesktopEntrySearch::fields() {
+	auto index = DesktopEntrySearchIndex::build(testEntries());
+
+	QCOMPARE(index->query("explorer", 0).ids, QStringList({"org.gnome.Nautilus"}));
+	QCOMPARE(index->query("nautilus", 0).ids, QStringList({"org.gnome.Nautilus"}));
+	QCOMPARE(index->query("browser", 0).ids, QStringList({"firefox"}));
+
+	// every word must match, but not necessarily in the same field
+	QCOMPARE(index->query("fi ma", 0).ids, QStringList({"org.gnome.Nautilus"}));
+	QCOMPARE(index->query("terminal shell", 0).ids, QStringList({"Alacritty"}));
+
+	// env wrappers are skipped when indexing the executable
+	QCOMPARE(index->query("adwaita", 0).ids, QStringList());
+}
+
+void TestDesktopEntrySearch::masking() {
+	auto entries = testEntries();
+
+	auto hidden = entry("firefox", "Firefox");
+	hidden.hidden = true;
+	entries.append(hidden);
+
+	auto noDisplay = entry("foot", "Foot");
+	noDisplay.noDisplay = true;
+	entries.append(noDisplay);
+
+	entries.append(entry("Alacritty", "Alacritty Terminal"));
+	entries.append(entry("invalid", ""));
+
+	auto index = DesktopEntrySearchIndex::build(entries);
+
+	QCOMPARE(index->size(), 2);
+	QCOMPARE(index->query("fire", 0).ids, QStringList());
+	QCOMPARE(index->query("foot", 0).ids, QStringList());
+	// the overriding entry has no keywords
+	QCOMPARE(index->query("shell", 0).ids, QStringList());
+	QCOMPARE(index->query("alaterm", 0).ids, QStringList({"Alacritty"}));
+}
+
+void TestDesktopEntrySearch::emptyQuery() {
+	auto index = DesktopEntrySearchIndex::build(testEntries());
+
+	auto all = index->query("", 0);
+	QCOMPARE(all.ids, QStringList({"Alacritty", "org.gnome.Nautilus", "firefox", "foot"}));
+	QCOMPARE(all.matches.length(), 4);
+
+	QCOMPARE(index->query("  ", 2).ids, QStringList({"Alacritty", "org.gnome.Nautilus"}));
+}
+
+void TestDesktopEntrySearch::narrowing() {
+	auto index = DesktopEntrySearchIndex::build(testEntries());
+
+	auto previous = index->query("", 0).matches;
+
+	for (const auto* query: {"f", "fi", "fil", "file", "file ", "file m"}) {
+		auto full = index->query(query, 0);
+		auto narrowed = index->query(query, 0, &previous);
+
+		QCOMPARE(narrowed.ids, full.ids);
+		previous = narrowed.matches;
+	}
+}
+
+void TestDesktopEntrySearch::benchmark() {
+	auto index = DesktopEntrySearchIndex::build(benchmarkEntries());
+	QCOMPARE(index->size(), 2500);
+
+	QBENCHMARK {
+		auto result = index->query("te ed", 20);
+		QVERIFY(!result.ids.isEmpty());
+	}
+}
+
+void TestDesktopEntrySearch::benchmarkKeystrokes_data() {
+	QTest::addColumn<bool>("narrow");
+	QTest::newRow("full") << false;
+	QTest::newRow("narrowed") << true;
+}
+
+// Typing a query one character at a time, as a launcher does. Each iteration
+// covers every keystroke, so the per-keystroke latency is the result divided by 9.
+void TestDesktopEntrySearch::benchmarkKeystrokes() {
+	QFETCH(bool, narrow);
+
+	auto index = DesktopEntrySearchIndex::build(benchmarkEntries());
+	const auto query = QString("music pla");
+
+	QBENCHMARK {
+		auto previous = index->query("", 0).matches;
+
+		for (auto i = 1; i <= query.length(); i++) {
+			auto result = index->query(query.first(i), 20, narrow ? &previous : nullptr);
+			previous = result.matches;
+		}
+
+		QVERIFY(!previous.isEmpty());
+	}
+}
+
+QTEST_MAIN(TestDesktopEntrySearch);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtmetamacros.h>
+
+class TestDesktopEntrySearch: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void ranking();
+	static void fields();
+	static void masking();
+	static void emptyQuery();
+	static void narrowing();
+	static void benchmark();
+	static void benchmarkKeystrokes_data(); // NOLINT
+	static void benchmarkKeystrokes();
+};
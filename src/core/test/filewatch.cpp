@@ -0,0 +1,145 @@
+#include "filewatch.hpp"
+
+#include <qbytearray.h>
+#include <qfile.h>
+#include <qsignalspy.h>
+#include <qstring.h>
+#include <qtemporarydir.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qtypes.h>
+
+#include "../filewatch.hpp"
+
+namespace {
+
+void writeFile(const QString& path, const QByteArray& data) {
+	auto file = QFile(path);
+	QVERIFY(file.open(QFile::WriteOnly));
+	QCOMPARE(file.write(data), data.length());
+}
+
+} // namespace
+
+void TestFileWatch::sharing() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("file");
+	writeFile(path, "a");
+
+	auto* service = FileWatchService::instance();
+
+	{
+		auto a = FileWatch();
+		auto b = FileWatch();
+
+		QVERIFY(a.addPath(path));
+		QVERIFY(a.addPath(path));
+		QVERIFY(b.addPath(path));
+		QVERIFY(b.addPath(dir.path()));
+		QCOMPARE(service->subscriberCount(path), qsizetype(2));
+		QCOMPARE(service->subscriberCount(dir.path()), qsizetype(1));
+
+		a.removePath(path);
+		QVERIFY(!a.isWatched(path));
+		QCOMPARE(service->subscriberCount(path), qsizetype(1));
+
+		// paths in both sets are not unwatched in between
+		b.setPaths({path});
+		QVERIFY(b.isWatched(path));
+		QVERIFY(!service->isWatched(dir.path()));
+
+		QVERIFY(!a.addPath(dir.filePath("nonexistent")));
+		QVERIFY(a.isEmpty());
+	}
+
+	QVERIFY(!service->isWatched(path));
+}
+
+void TestFileWatch::dispatch() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("file");
+	auto other = dir.filePath("other");
+	writeFile(path, "a");
+	writeFile(other, "a");
+
+	auto a = FileWatch();
+	auto b = FileWatch();
+	a.addPath(path);
+	b.addPath(path);
+	b.addPath(other);
+
+	auto aSpy = QSignalSpy(&a, &FileWatch::fileChanged);
+	auto bSpy = QSignalSpy(&b, &FileWatch::fileChanged);
+
+	writeFile(path, "b");
+	QVERIFY(aSpy.wait(1000));
+	if (bSpy.isEmpty()) QVERIFY(bSpy.wait(1000));
+	QCOMPARE(aSpy.at(0).at(0).toString(), path);
+	QCOMPARE(bSpy.at(0).at(0).toString(), path);
+
+	aSpy.clear();
+	bSpy.clear();
+
+	writeFile(other, "b");
+	QTRY_VERIFY_WITH_TIMEOUT(bSpy.contains({other}), 1000);
+	QVERIFY(!aSpy.contains({other}));
+}
+
+void TestFileWatch::dropped() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("file");
+	writeFile(path, "a");
+
+	auto a = FileWatch();
+	auto b = FileWatch();
+	a.addPath(path);
+	b.addPath(path);
+
+	auto aSpy = QSignalSpy(&a, &FileWatch::fileChanged);
+	auto bSpy = QSignalSpy(&b, &FileWatch::fileChanged);
+
+	QVERIFY(QFile::remove(path));
+	QTRY_VERIFY_WITH_TIMEOUT(!aSpy.isEmpty() && !bSpy.isEmpty(), 1000);
+
+	QVERIFY(!a.isWatched(path));
+	QVERIFY(!b.isWatched(path));
+	QVERIFY(!FileWatchService::instance()->isWatched(path));
+
+	// the path can be watched again once it exists
+	writeFile(path, "b");
+	QVERIFY(a.addPath(path));
+	QCOMPARE(FileWatchService::instance()->subscriberCount(path), qsizetype(1));
+}
+
+void TestFileWatch::droppedBatch() {
+	auto dir = QTemporaryDir();
+	auto removed = dir.filePath("removed");
+	auto modified = dir.filePath("modified");
+	writeFile(removed, "a");
+	writeFile(modified, "a");
+
+	auto watch = FileWatch();
+	watch.addPath(removed);
+	watch.addPath(modified);
+	watch.addPath(dir.path());
+
+	auto fileSpy = QSignalSpy(&watch, &FileWatch::fileChanged);
+	auto dirSpy = QSignalSpy(&watch, &FileWatch::directoryChanged);
+
+	// delivered in one batch, where only one of the changed files is dropped
+	writeFile(modified, "b");
+	QVERIFY(QFile::remove(removed));
+	QTRY_VERIFY_WITH_TIMEOUT(fileSpy.contains({removed}) && fileSpy.contains({modified}), 1000);
+	QTRY_VERIFY_WITH_TIMEOUT(!dirSpy.isEmpty(), 1000);
+
+	QVERIFY(!watch.isWatched(removed));
+	QVERIFY(watch.isWatched(modified));
+	QVERIFY(watch.isWatched(dir.path()));
+	QVERIFY(FileWatchService::instance()->isWatched(modified));
+
+	fileSpy.clear();
+	writeFile(modified, "c");
+	QTRY_VERIFY_WITH_TIMEOUT(fileSpy.contains({modified}), 1000);
+}
+
+QTEST_MAIN(TestFileWatch);
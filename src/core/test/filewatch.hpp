@@ -0,0 +1,14 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtmetamacros.h>
+
+class TestFileWatch: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void sharing();
+	static void dispatch();
+	static void dropped();
+	static void droppedBatch();
+};
@@ -0,0 +1,101 @@
+#include "icondiskcache.hpp"
+#include <memory>
+
+#include <qcolor.h>
+#include <qdatetime.h>
+#include <qfile.h>
+#include <qfiledevice.h>
+#include <qimage.h>
+#include <qobject.h>
+#include <qsize.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../icondiskcache.hpp"
+
+namespace {
+
+QString writeSource(const QString& path) {
+	auto file = QFile(path);
+	if (!file.open(QFile::WriteOnly)) return QString();
+	file.write("<svg/>");
+	return path;
+}
+
+QImage testImage(const QColor& color) {
+	auto image = QImage(16, 16, QImage::Format_ARGB32_Premultiplied);
+	image.fill(color);
+	image.setPixelColor(3, 5, QColor(10, 20, 30, 128));
+	return image;
+}
+
+} // namespace
+
+void TestIconDiskCache::init() {
+	this->dir = std::make_unique<QTemporaryDir>();
+	QVERIFY(this->dir->isValid());
+}
+
+void TestIconDiskCache::roundtrip() {
+	auto cache = IconDiskCache(this->dir->filePath("cache"), 1024 * 1024);
+	auto source = writeSource(this->dir->filePath("icon.svg"));
+
+	QVERIFY(cache.load(source, QSize(16, 16)).isNull());
+
+	auto image = testImage(Qt::red);
+	cache.store(source, QSize(16, 16), image);
+	QCOMPARE(cache.load(source, QSize(16, 16)), image);
+
+	// different sizes are separate entries
+	QVERIFY(cache.load(source, QSize(32, 32)).isNull());
+
+	// entries persist across instances
+	auto reopened = IconDiskCache(this->dir->filePath("cache"), 1024 * 1024);
+	QCOMPARE(reopened.load(source, QSize(16, 16)), image);
+	QVERIFY(reopened.diskUsage() > image.sizeInBytes());
+}
+
+void TestIconDiskCache::invalidation() {
+	auto cache = IconDiskCache(this->dir->filePath("cache"), 1024 * 1024);
+	auto source = writeSource(this->dir->filePath("icon.svg"));
+
+	cache.store(source, QSize(16, 16), testImage(Qt::red));
+	QVERIFY(!cache.load(source, QSize(16, 16)).isNull());
+
+	auto file = QFile(source);
+	QVERIFY(file.open(QFile::ReadWrite));
+	QVERIFY(file.setFileTime(
+	    QDateTime::currentDateTime().addSecs(60),
+	    QFileDevice::FileModificationTime
+	));
+	file.close();
+
+	QVERIFY(cache.load(source, QSize(16, 16)).isNull());
+	QVERIFY(cache.load(this->dir->filePath("missing.svg"), QSize(16, 16)).isNull());
+}
+
+void TestIconDiskCache::eviction() {
+	// Each entry is a 1KiB image plus its header, so the budget fits two entries but not three.
+	auto cache = IconDiskCache(this->dir->filePath("cache"), 3000);
+
+	auto a = writeSource(this->dir->filePath("a.svg"));
+	auto b = writeSource(this->dir->filePath("b.svg"));
+	auto c = writeSource(this->dir->filePath("c.svg"));
+
+	cache.store(a, QSize(16, 16), testImage(Qt::red));
+	QTest::qWait(5);
+	cache.store(b, QSize(16, 16), testImage(Qt::green));
+	QTest::qWait(5);
+	// a is used more recently than b
+	QVERIFY(!cache.load(a, QSize(16, 16)).isNull());
+	QTest::qWait(5);
+	cache.store(c, QSize(16, 16), testImage(Qt::blue));
+
+	QVERIFY(cache.diskUsage() <= 3000);
+	QVERIFY(!cache.load(a, QSize(16, 16)).isNull());
+	QVERIFY(cache.load(b, QSize(16, 16)).isNull());
+	QVERIFY(!cache.load(c, QSize(16, 16)).isNull());
+}
+
+QTEST_MAIN(TestIconDiskCache);
@@ -0,0 +1,260 @@
+#include "icontheme.hpp"
+
+#include <qbytearray.h>
+#include <qcontainerfwd.h>
+#include <qdatetime.h>
+#include <qdir.h>
+#include <qendian.h>
+#include <qfile.h>
+#include <qfileinfo.h>
+#include <qicon.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qsignalspy.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../icontheme.hpp"
+
+namespace {
+
+void writeFile(const QString& path, const QByteArray& content = QByteArray()) {
+	QDir().mkpath(QFileInfo(path).path());
+	auto file = QFile(path);
+	QVERIFY(file.open(QFile::WriteOnly));
+	file.write(content);
+}
+
+struct CacheIcon {
+	QByteArray name;
+	quint16 dir;
+	quint16 flags;
+};
+
+// Writes a minimal GTK icon-theme.cache with one image per icon.
+QByteArray buildGtkCache(const QList<QByteArray>& dirs, const QList<CacheIcon>& icons) {
+	auto data = QByteArray(12, 0);
+
+	auto append16 = [&](quint16 value) {
+		auto be = qToBigEndian(value);
+		data.append(reinterpret_cast<const char*>(&be), 2); // NOLINT
+	};
+
+	auto append32 = [&](quint32 value) {
+		auto be = qToBigEndian(value);
+		data.append(reinterpret_cast<const char*>(&be), 4); // NOLINT
+	};
+
+	auto set32 = [&](qsizetype offset, quint32 value) { qToBigEndian(value, data.data() + offset); };
+
+	auto appendString = [&](const QByteArray& string) {
+		auto offset = quint32(data.size());
+		data.append(string);
+		data.append('\0');
+		return offset;
+	};
+
+	qToBigEndian(quint16(1), data.data());
+
+	auto dirListOffset = data.size();
+	set32(8, dirListOffset);
+	append32(dirs.length());
+	for (qsizetype i = 0; i != dirs.length(); i++) append32(0);
+	for (qsizetype i = 0; i != dirs.length(); i++) {
+		set32(dirListOffset + 4 + i * 4, appendString(dirs.at(i)));
+	}
+
+	const quint32 bucketCount = 3;
+	auto hashOffset = data.size();
+	set32(4, hashOffset);
+	append32(bucketCount);
+	for (quint32 i = 0; i != bucketCount; i++) append32(0xffffffff);
+
+	for (const auto& icon: icons) {
+		auto hash = quint32(0);
+		for (auto c: icon.name) hash = (hash << 5) - hash + quint32(static_cast<signed char>(c));
+		auto bucketOffset = hashOffset + 4 + (hash % bucketCount) * 4;
+
+		auto iconOffset = data.size();
+		append32(qFromBigEndian<quint32>(data.constData() + bucketOffset));
+		append32(0);
+		append32(0);
+		set32(bucketOffset, iconOffset);
+
+		set32(iconOffset + 4, appendString(icon.name));
+
+		set32(iconOffset + 8, data.size());
+		append32(1);
+		append16(icon.dir);
+		append16(icon.flags);
+		append32(0);
+	}
+
+	return data;
+}
+
+} // namespace
+
+void TestIconTheme::initTestCase() {
+	QVERIFY(this->dir.isValid());
+	auto icons = this->dir.filePath("icons");
+
+	writeFile(
+	    icons + "/Test/index.theme",
+	    "[Icon Theme]\n"
+	    "Name=Test\n"
+	    "Inherits=Parent,hicolor\n"
+	    "Directories=16x16/apps,48x48/apps,scalable/apps\n"
+	    "ScaledDirectories=48x48@2/apps\n"
+	    "\n"
+	    "[16x16/apps]\n"
+	    "Size=16\n"
+	    "Type=Fixed\n"
+	    "\n"
+	    "[48x48/apps]\n"
+	    "Size=48\n"
+	    "\n"
+	    "[48x48@2/apps]\n"
+	    "Size=48\n"
+	    "Scale=2\n"
+	    "\n"
+	    "[scalable/apps]\n"
+	    "Size=48\n"
+	    "MinSize=16\n"
+	    "MaxSize=256\n"
+	    "Type=Scalable\n"
+	);
+
+	writeFile(icons + "/Test/16x16/apps/foo.png");
+	writeFile(icons + "/Test/48x48/apps/foo.png");
+	writeFile(icons + "/Test/48x48/apps/foo.svg");
+	writeFile(icons + "/Test/48x48@2/apps/foo.png");
+	writeFile(icons + "/Test/scalable/apps/bar.svg");
+	writeFile(icons + "/Test/48x48/apps/bar-symbolic.png");
+
+	writeFile(
+	    icons + "/Parent/index.theme",
+	    "[Icon Theme]\n"
+	    "Directories=32x32/apps\n"
+	    "\n"
+	    "[32x32/apps]\n"
+	    "Size=32\n"
+	    "Type=Fixed\n"
+	);
+
+	// Files that are not in the cache are not found, as with GTK.
+	writeFile(icons + "/Parent/32x32/apps/uncached.png");
+
+	writeFile(
+	    icons + "/Parent/icon-theme.cache",
+	    buildGtkCache(
+	        {"32x32/apps", "unlisted"},
+	        {
+	            {.name = "baz", .dir = 0, .flags = 4},
+	            {.name = "foo", .dir = 0, .flags = 4},
+	            {.name = "ghost", .dir = 1, .flags = 4},
+	            {.name = "vector", .dir = 0, .flags = 2},
+	        }
+	    )
+	);
+
+	auto cacheFile = QFile(icons + "/Parent/icon-theme.cache");
+	QVERIFY(cacheFile.open(QFile::ReadWrite));
+	QVERIFY(cacheFile.setFileTime(
+	    QDateTime::currentDateTime().addSecs(60),
+	    QFileDevice::FileModificationTime
+	));
+
+	writeFile(
+	    icons + "/hicolor/index.theme",
+	    "[Icon Theme]\n"
+	    "Directories=48x48/apps\n"
+	    "\n"
+	    "[48x48/apps]\n"
+	    "Size=48\n"
+	);
+
+	writeFile(icons + "/hicolor/48x48/apps/qux.png");
+	writeFile(this->dir.filePath("pixmaps/pix.xpm"));
+	writeFile(this->dir.filePath("pixmaps/qux.png"));
+}
+
+void TestIconTheme::sizes() {
+	auto icons = this->dir.filePath("icons");
+	auto index = IconThemeIndex::build("Test", {icons}, {});
+
+	QCOMPARE(index->lookup("foo", 16, 1), icons + "/Test/16x16/apps/foo.png");
+	// png is preferred over svg in the same directory
+	QCOMPARE(index->lookup("foo", 48, 1), icons + "/Test/48x48/apps/foo.png");
+	// threshold directories match within 2px by default
+	QCOMPARE(index->lookup("foo", 50, 1), icons + "/Test/48x48/apps/foo.png");
+	QCOMPARE(index->lookup("foo", 48, 2), icons + "/Test/48x48@2/apps/foo.png");
+
+	// closest by distance: 16 is 8 away from 24, and 48 is 24 away
+	QCOMPARE(index->lookup("foo", 24, 1), icons + "/Test/16x16/apps/foo.png");
+	QCOMPARE(index->lookup("foo", 40, 1), icons + "/Test/48x48/apps/foo.png");
+
+	QCOMPARE(index->lookup("bar", 200, 1), icons + "/Test/scalable/apps/bar.svg");
+	QCOMPARE(index->lookup("bar", 512, 1), icons + "/Test/scalable/apps/bar.svg");
+}
+
+void TestIconTheme::inheritance() {
+	auto icons = this->dir.filePath("icons");
+	auto index = IconThemeIndex::build("Test", {icons}, {});
+
+	// the child theme wins even when the parent has a closer size
+	QCOMPARE(index->lookup("foo", 32, 1), icons + "/Test/16x16/apps/foo.png");
+
+	QCOMPARE(index->lookup("baz", 32, 1), icons + "/Parent/32x32/apps/baz.png");
+	QCOMPARE(index->lookup("qux", 48, 1), icons + "/hicolor/48x48/apps/qux.png");
+	QCOMPARE(index->lookup("missing", 48, 1), QString());
+
+	auto hicolor = IconThemeIndex::build("DoesNotExist", {icons}, {});
+	QCOMPARE(hicolor->lookup("qux", 48, 1), icons + "/hicolor/48x48/apps/qux.png");
+	QCOMPARE(hicolor->lookup("foo", 48, 1), QString());
+}
+
+void TestIconTheme::gtkCache() {
+	auto icons = this->dir.filePath("icons");
+	auto index = IconThemeIndex::build("Parent", {icons}, {});
+
+	QCOMPARE(index->lookup("baz", 32, 1), icons + "/Parent/32x32/apps/baz.png");
+	QCOMPARE(index->lookup("vector", 32, 1), icons + "/Parent/32x32/apps/vector.svg");
+	QCOMPARE(index->lookup("uncached", 32, 1), QString());
+	// directories not listed in index.theme are ignored
+	QCOMPARE(index->lookup("ghost", 32, 1), QString());
+}
+
+void TestIconTheme::fallbacks() {
+	auto icons = this->dir.filePath("icons");
+	auto pixmaps = this->dir.filePath("pixmaps");
+	auto index = IconThemeIndex::build("Test", {icons}, {pixmaps});
+
+	QCOMPARE(index->lookup("pix", 48, 1), pixmaps + "/pix.xpm");
+	// themes are searched before fallback paths
+	QCOMPARE(index->lookup("qux", 48, 1), icons + "/hicolor/48x48/apps/qux.png");
+
+	// less specific names are used when nothing matches
+	QCOMPARE(index->lookup("baz-symbolic", 32, 1), icons + "/Parent/32x32/apps/baz.png");
+	QCOMPARE(index->lookup("bar-symbolic", 48, 1), icons + "/Test/48x48/apps/bar-symbolic.png");
+	QCOMPARE(index->lookup("pix-extra", 48, 1), pixmaps + "/pix.xpm");
+}
+
+void TestIconTheme::themeChange() {
+	auto icons = this->dir.filePath("icons");
+	QIcon::setThemeSearchPaths({icons});
+	QIcon::setFallbackSearchPaths({});
+	QIcon::setThemeName("Test");
+
+	auto* manager = IconThemeManager::instance();
+	auto spy = QSignalSpy(manager, &IconThemeManager::iconThemeChanged);
+	QCOMPARE(manager->iconPath("foo", 32), icons + "/Test/16x16/apps/foo.png");
+
+	// runtime theme changes, such as from the platform theme, invalidate the index
+	QIcon::setThemeName("Parent");
+	QCOMPARE(manager->iconPath("foo", 32), icons + "/Parent/32x32/apps/foo.png");
+	QCOMPARE(spy.count(), 1);
+}
+
+QTEST_MAIN(TestIconTheme);
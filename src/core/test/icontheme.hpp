@@ -0,0 +1,20 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtemporarydir.h>
+#include <qtmetamacros.h>
+
+class TestIconTheme: public QObject {
+	Q_OBJECT;
+
+private slots:
+	void initTestCase();
+	void sizes();
+	void inheritance();
+	void gtkCache();
+	void fallbacks();
+	void themeChange();
+
+private:
+	QTemporaryDir dir;
+};
@@ -1,7 +1,10 @@
 #include "objectmodel.hpp"
 
+#include <qabstractitemmodel.h>
+#include <qabstractitemmodeltester.h>
 #include <qlist.h>
 #include <qobject.h>
+#include <qsignalspy.h>
 #include <qtest.h>
 #include <qtestcase.h>
 
@@ -39,4 +42,79 @@ void TestObjectModel::diffUpdateReorder() {
 	QCOMPARE(model.valueList(), (QList<QObject*> {&a, &b, &c, &d}));
 }
 
+void TestObjectModel::diffUpdateBatched() {
+	QObject a, b, c, d, e, f, g;
+
+	auto model = ObjectModel<QObject>(nullptr);
+	auto modelTester = QAbstractItemModelTester(&model);
+	model.diffUpdate({&a, &b, &c, &d, &e});
+
+	auto valuesSpy = QSignalSpy(&model, &UntypedObjectModel::valuesChanged);
+	auto removeSpy = QSignalSpy(&model, &QAbstractItemModel::rowsRemoved);
+	auto insertSpy = QSignalSpy(&model, &QAbstractItemModel::rowsInserted);
+	auto moveSpy = QSignalSpy(&model, &QAbstractItemModel::rowsMoved);
+	auto objectRemovedSpy = QSignalSpy(&model, &UntypedObjectModel::objectRemovedPost);
+
+	// b and c are dropped together, f and g inserted together, and a moved to the end.
+	model.diffUpdate({&d, &f, &g, &e, &a});
+	QCOMPARE(model.valueList(), (QList<QObject*> {&d, &f, &g, &e, &a}));
+
+	QCOMPARE(valuesSpy.count(), 1);
+	QCOMPARE(removeSpy.count(), 1);
+	QCOMPARE(insertSpy.count(), 1);
+	QCOMPARE(moveSpy.count(), 1);
+	QCOMPARE(objectRemovedSpy.count(), 2);
+
+	// no changes, no signals
+	model.diffUpdate({&d, &f, &g, &e, &a});
+	QCOMPARE(valuesSpy.count(), 1);
+}
+
+void TestObjectModel::valuesCached() {
+	QObject a, b;
+
+	auto model = ObjectModel<QObject>(nullptr);
+	model.insertObject(&a);
+
+	auto values1 = model.values();
+	auto values2 = model.values();
+	QCOMPARE(values1, QList<QObject*> {&a});
+	QVERIFY(values1.isSharedWith(values2));
+
+	model.insertObject(&b);
+	auto values3 = model.values();
+	QCOMPARE(values3, (QList<QObject*> {&a, &b}));
+	QVERIFY(!values3.isSharedWith(values1));
+	QCOMPARE(values1, QList<QObject*> {&a});
+}
+
+void TestObjectModel::valuesDuringSignals() {
+	QObject a, b, c;
+
+	auto model = ObjectModel<QObject>(nullptr);
+	model.insertObject(&a);
+	QCOMPARE(model.values(), QList<QObject*> {&a});
+
+	// values read from handlers must reflect the change being signaled
+	auto insertedValues = QList<QList<QObject*>>();
+	QObject::connect(&model, &QAbstractItemModel::rowsInserted, &model, [&]() {
+		insertedValues.append(model.values());
+	});
+
+	auto removedValues = QList<QList<QObject*>>();
+	QObject::connect(&model, &UntypedObjectModel::objectRemovedPost, &model, [&]() {
+		removedValues.append(model.values());
+	});
+
+	model.diffUpdate({&b, &c});
+	QCOMPARE(removedValues, QList<QList<QObject*>> {QList<QObject*>()});
+	QCOMPARE(insertedValues, QList<QList<QObject*>> {(QList<QObject*> {&b, &c})});
+	QCOMPARE(model.values(), (QList<QObject*> {&b, &c}));
+
+	insertedValues.clear();
+	model.insertObject(&a, 1);
+	QCOMPARE(insertedValues, QList<QList<QObject*>> {(QList<QObject*> {&b, &a, &c})});
+	QCOMPARE(model.values(), (QList<QObject*> {&b, &a, &c}));
+}
+
 QTEST_MAIN(TestObjectModel);
@@ -9,4 +9,7 @@ class TestObjectModel: public QObject {
 private slots:
 	static void diffUpdateInsertRemove();
 	static void diffUpdateReorder();
+	static void diffUpdateBatched();
+	static void valuesCached();
+	static void valuesDuringSignals();
 };
@@ -1,4 +1,5 @@
 #include "scriptmodel.hpp"
+#include <algorithm>
 
 #include <qabstractitemmodel.h>
 #include <qabstractitemmodeltester.h>
@@ -7,11 +8,13 @@
 #include <qlist.h>
 #include <qlogging.h>
 #include <qobject.h>
+#include <qrandom.h>
 #include <qsignalspy.h>
 #include <qstring.h>
 #include <qtest.h>
 #include <qtestcase.h>
 #include <qtypes.h>
+#include <qvariant.h>
 
 #include "../scriptmodel.hpp"
 
@@ -80,36 +83,53 @@ void TestScriptModel::unique_data() {
 	QTest::addRow("move_single") << "ABCDEFG" << "AFBCDEG"
 	                             << OpList({{ModelOperation::Move, 5, 1, 1}});
 
+	// Only rows outside the longest already ordered sequence are moved.
 	QTest::addRow("move_range") << "ABCDEFG" << "ADEFBCG"
-	                            << OpList({{ModelOperation::Move, 3, 3, 1}});
+	                            << OpList({{ModelOperation::Move, 1, 2, 6}});
 
 	// beginning to end is the same operation
 	QTest::addRow("move_end_to_beginning")
 	    << "ABCDEFG" << "EFGABCD" << OpList({{ModelOperation::Move, 4, 3, 0}});
 
 	QTest::addRow("move_overlapping")
-	    << "ABCDEFG" << "ABDEFCG" << OpList({{ModelOperation::Move, 3, 3, 2}});
+	    << "ABCDEFG" << "ABDEFCG" << OpList({{ModelOperation::Move, 2, 1, 6}});
 
-	// Ensure iterators arent skipping anything at the end of operations by performing
-	// multiple back to back.
+	QTest::addRow("reverse") << "ABCDE" << "EDCBA"
+	                         << OpList({
+	                                {ModelOperation::Move, 1, 1, 0}, // BACDE
+	                                {ModelOperation::Move, 2, 1, 0}, // CBADE
+	                                {ModelOperation::Move, 3, 1, 0}, // DCBAE
+	                                {ModelOperation::Move, 4, 1, 0}, // EDCBA
+	                            });
+
+	// Ensure row positions stay correct across multiple back to back operations.
+	// Removals are always performed first, followed by insertions and moves from the end.
 
 	QTest::addRow("insert_state_ok") << "ABCDEFG" << "ABXXEFG"
 	                                 << OpList({
-	                                        {ModelOperation::Insert, 2, 2}, // ABXXCDEFG
-	                                        {ModelOperation::Remove, 4, 2}, // ABXXEFG
+	                                        {ModelOperation::Remove, 2, 2}, // ABEFG
+	                                        {ModelOperation::Insert, 2, 2}, // ABXXEFG
 	                                    });
 
 	QTest::addRow("remove_state_ok") << "ABCDEFG" << "ABFGE"
 	                                 << OpList({
 	                                        {ModelOperation::Remove, 2, 2},  // ABEFG
-	                                        {ModelOperation::Move, 3, 2, 2}, // ABFGE
+	                                        {ModelOperation::Move, 2, 1, 5}, // ABFGE
 	                                    });
 
 	QTest::addRow("move_state_ok") << "ABCDEFG" << "ABEFXYCDG"
 	                               << OpList({
-	                                      {ModelOperation::Move, 4, 2, 2}, // ABEFCDG
-	                                      {ModelOperation::Insert, 4, 2},  // ABEFXYCDG
+	                                      {ModelOperation::Insert, 2, 2},  // ABXYCDEFG
+	                                      {ModelOperation::Move, 6, 2, 2}, // ABEFXYCDG
 	                                  });
+
+	QTest::addRow("replace_ends") << "ABCDEFG" << "XBCDEFY"
+	                              << OpList({
+	                                     {ModelOperation::Remove, 0, 1}, // BCDEFG
+	                                     {ModelOperation::Remove, 5, 1}, // BCDEF
+	                                     {ModelOperation::Insert, 5, 1}, // BCDEFY
+	                                     {ModelOperation::Insert, 0, 1}, // XBCDEFY
+	                                 });
 }
 
 void TestScriptModel::unique() {
@@ -178,4 +198,50 @@ void TestScriptModel::unique() {
 	QCOMPARE_EQ(actualOperations, operations);
 }
 
+void TestScriptModel::benchmark_data() {
+	QTest::addColumn<qint32>("count");
+	QTest::addColumn<bool>("objects");
+
+	QTest::addRow("values_1000") << 1000 << false;
+	QTest::addRow("values_5000") << 5000 << false;
+	QTest::addRow("objects_1000") << 1000 << true;
+	QTest::addRow("objects_5000") << 5000 << true;
+}
+
+void TestScriptModel::benchmark() {
+	QFETCH(const qint32, count);
+	QFETCH(const bool, objects);
+
+	auto makeValue = [&](qint32 id) -> QVariant {
+		if (objects) return QVariantMap {{"id", id}, {"name", QString::number(id)}};
+		else return QString::number(id);
+	};
+
+	QVariantList oldlist;
+	QVariantList newlist;
+
+	for (auto i = 0; i != count; i++) {
+		oldlist.append(makeValue(i));
+	}
+
+	// Shuffled, with a tenth of the entries removed and as many new ones inserted.
+	auto random = QRandomGenerator(count);
+	newlist = oldlist;
+	std::shuffle(newlist.begin(), newlist.end(), random);
+
+	for (auto i = 0; i != count / 10; i++) {
+		newlist[random.bounded(count)] = makeValue(count + i);
+	}
+
+	auto model = ScriptModel();
+	if (objects) model.setObjectProp("id");
+
+	QBENCHMARK {
+		model.setValues(oldlist);
+		model.setValues(newlist);
+	}
+
+	QCOMPARE_EQ(model.values(), newlist);
+}
+
 QTEST_MAIN(TestScriptModel);
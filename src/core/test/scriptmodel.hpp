@@ -34,4 +34,6 @@ class TestScriptModel: public QObject {
 private slots:
 	static void unique_data(); // NOLINT
 	static void unique();
+	static void benchmark_data(); // NOLINT
+	static void benchmark();
 };
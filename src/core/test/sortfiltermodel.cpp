@@ -0,0 +1,234 @@
+#include "sortfiltermodel.hpp"
+
+#include <qabstractitemmodel.h>
+#include <qabstractitemmodeltester.h>
+#include <qcontainerfwd.h>
+#include <qlist.h>
+#include <qnamespace.h>
+#include <qobject.h>
+#include <qsignalspy.h>
+#include <qstandarditemmodel.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qvariant.h>
+
+#include "../model.hpp"
+#include "../scriptmodel.hpp"
+#include "../sortfiltermodel.hpp"
+
+namespace {
+
+QStringList names(SortFilterModel& model) {
+	QStringList result;
+
+	for (const auto& value: model.values()) {
+		if (auto* entry = qobject_cast<SortFilterEntry*>(value.value<QObject*>())) result.append(entry->name);
+		else result.append(value.toMap().value("name").toString());
+	}
+
+	return result;
+}
+
+} // namespace
+
+void TestSortFilterModel::scriptModelSource() {
+	auto source = ScriptModel();
+	source.setValues({
+	    QVariantMap {{"name", "delta"}, {"group", 1}},
+	    QVariantMap {{"name", "Alpha"}, {"group", 2}},
+	    QVariantMap {{"name", "charlie"}, {"group", 1}},
+	    QVariantMap {{"name", "bravo"}, {"group", 2}},
+	});
+
+	auto model = SortFilterModel();
+	auto modelTester = QAbstractItemModelTester(&model);
+	model.setModel(&source);
+	QCOMPARE(names(model), QStringList({"delta", "Alpha", "charlie", "bravo"}));
+
+	model.setSortProperty("name");
+	QCOMPARE(names(model), QStringList({"Alpha", "bravo", "charlie", "delta"}));
+
+	model.setSortOrder(Qt::DescendingOrder);
+	QCOMPARE(names(model), QStringList({"delta", "charlie", "bravo", "Alpha"}));
+
+	model.setFilterProperty("group");
+	model.setFilterValue(2);
+	QCOMPARE(names(model), QStringList({"bravo", "Alpha"}));
+
+	model.setFilterValue(QVariant());
+	model.setSearchProperties({"name"});
+	model.setSearchText("A");
+	QCOMPARE(names(model), QStringList({"delta", "charlie", "bravo", "Alpha"}));
+
+	model.setCaseSensitivity(Qt::CaseSensitive);
+	QCOMPARE(names(model), QStringList({"Alpha"}));
+}
+
+void TestSortFilterModel::objectModelSource() {
+	auto a = SortFilterEntry("a", 1);
+	auto b = SortFilterEntry("b", 2);
+	auto c = SortFilterEntry("c", 1);
+
+	auto source = ObjectModel<SortFilterEntry>(nullptr);
+	source.diffUpdate({&c, &a, &b});
+
+	auto model = SortFilterModel();
+	auto modelTester = QAbstractItemModelTester(&model);
+	model.setSortProperty("name");
+	model.setFilterProperty("group");
+	model.setFilterValue(1);
+	model.setModel(&source);
+
+	QCOMPARE(names(model), QStringList({"a", "c"}));
+	QCOMPARE(model.mapToSource(0), 1);
+	QCOMPARE(model.mapFromSource(2), -1);
+}
+
+void TestSortFilterModel::propertyChanges() {
+	auto a = SortFilterEntry("a", 1);
+	auto b = SortFilterEntry("b", 1);
+	auto c = SortFilterEntry("c", 1);
+	auto d = SortFilterEntry("d", 2);
+
+	auto source = ObjectModel<SortFilterEntry>(nullptr);
+	source.diffUpdate({&a, &b, &c, &d});
+
+	auto model = SortFilterModel();
+	auto modelTester = QAbstractItemModelTester(&model);
+	model.setSortProperty("name");
+	model.setFilterProperty("group");
+	model.setFilterValue(1);
+	model.setModel(&source);
+	QCOMPARE(names(model), QStringList({"a", "b", "c"}));
+
+	auto moveSpy = QSignalSpy(&model, &QAbstractItemModel::rowsMoved);
+	auto insertSpy = QSignalSpy(&model, &QAbstractItemModel::rowsInserted);
+	auto removeSpy = QSignalSpy(&model, &QAbstractItemModel::rowsRemoved);
+	auto resetSpy = QSignalSpy(&model, &QAbstractItemModel::modelReset);
+
+	a.setName("e");
+	QCOMPARE(names(model), QStringList({"b", "c", "e"}));
+	QCOMPARE(moveSpy.count(), 1);
+
+	// still in order, no move
+	b.setName("ba");
+	QCOMPARE(moveSpy.count(), 1);
+
+	d.setGroup(1);
+	QCOMPARE(names(model), QStringList({"ba", "c", "d", "e"}));
+	QCOMPARE(insertSpy.count(), 1);
+
+	c.setGroup(2);
+	QCOMPARE(names(model), QStringList({"ba", "d", "e"}));
+	QCOMPARE(removeSpy.count(), 1);
+
+	QCOMPARE(resetSpy.count(), 0);
+}
+
+void TestSortFilterModel::sourceChanges() {
+	auto a = SortFilterEntry("a");
+	auto b = SortFilterEntry("b");
+	auto c = SortFilterEntry("c");
+	auto d = SortFilterEntry("d");
+
+	auto source = ObjectModel<SortFilterEntry>(nullptr);
+	source.diffUpdate({&d, &b});
+
+	auto model = SortFilterModel();
+	auto modelTester = QAbstractItemModelTester(&model);
+	model.setModel(&source);
+	QCOMPARE(names(model), QStringList({"d", "b"}));
+
+	// unsorted models follow the source order
+	source.diffUpdate({&a, &b, &c, &d});
+	QCOMPARE(names(model), QStringList({"a", "b", "c", "d"}));
+
+	model.setSortProperty("name");
+	model.setSortOrder(Qt::DescendingOrder);
+	QCOMPARE(names(model), QStringList({"d", "c", "b", "a"}));
+
+	source.diffUpdate({&c, &a});
+	QCOMPARE(names(model), QStringList({"c", "a"}));
+
+	b.setName("z");
+	source.diffUpdate({&c, &b, &a});
+	QCOMPARE(names(model), QStringList({"z", "c", "a"}));
+}
+
+void TestSortFilterModel::sharedObjects() {
+	auto a = SortFilterEntry("a");
+	auto b = SortFilterEntry("b");
+
+	// the same object in more than one row
+	auto source = QStandardItemModel();
+	for (auto* entry: {&a, &b, &a}) {
+		auto* item = new QStandardItem();
+		item->setData(QVariant::fromValue(static_cast<QObject*>(entry)), Qt::UserRole);
+		source.appendRow(item);
+	}
+
+	auto model = SortFilterModel();
+	auto modelTester = QAbstractItemModelTester(&model);
+	model.setSortProperty("name");
+	model.setModel(&source);
+	QCOMPARE(names(model), QStringList({"a", "a", "b"}));
+
+	// removing one row keeps tracking the object for the other
+	source.removeRow(0);
+	QCOMPARE(names(model), QStringList({"a", "b"}));
+	QCOMPARE(model.mapFromSource(1), 0);
+
+	a.setName("c");
+	QCOMPARE(names(model), QStringList({"b", "c"}));
+	QCOMPARE(model.mapFromSource(1), 1);
+
+	b.setName("d");
+	QCOMPARE(names(model), QStringList({"c", "d"}));
+	QCOMPARE(model.mapFromSource(0), 1);
+	QCOMPARE(model.mapFromSource(1), 0);
+}
+
+void TestSortFilterModel::watchedProperties() {
+	auto a = SortFilterEntry("a", 2);
+	auto b = SortFilterEntry("b", 1);
+
+	auto source = ObjectModel<SortFilterEntry>(nullptr);
+	source.diffUpdate({&a, &b});
+
+	auto model = SortFilterModel();
+	auto modelTester = QAbstractItemModelTester(&model);
+	model.setSearchProperties({"name"});
+	model.setModel(&source);
+
+	// search properties are watched once searching starts
+	model.setSearchText("a");
+	QCOMPARE(names(model), QStringList({"a"}));
+
+	b.setName("ba");
+	QCOMPARE(names(model), QStringList({"a", "ba"}));
+
+	// and while the search text changes
+	model.setSearchText("b");
+	QCOMPARE(names(model), QStringList({"ba"}));
+
+	a.setName("ab");
+	QCOMPARE(names(model), QStringList({"ab", "ba"}));
+
+	// changing the sort property watches the new one
+	model.setSortProperty("group");
+	QCOMPARE(names(model), QStringList({"ba", "ab"}));
+
+	b.setGroup(3);
+	QCOMPARE(names(model), QStringList({"ab", "ba"}));
+
+	// searching again after clearing the search text
+	model.setSearchText("");
+	model.setSearchText("c");
+	QCOMPARE(names(model), QStringList());
+
+	a.setName("c");
+	QCOMPARE(names(model), QStringList({"c"}));
+}
+
+QTEST_MAIN(TestSortFilterModel);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <utility>
+
+#include <qobject.h>
+#include <qstring.h>
+#include <qtmetamacros.h>
+#include <qtypes.h>
+
+class SortFilterEntry: public QObject {
+	Q_OBJECT;
+	Q_PROPERTY(QString name MEMBER name NOTIFY nameChanged);
+	Q_PROPERTY(qint32 group MEMBER group NOTIFY groupChanged);
+
+public:
+	explicit SortFilterEntry(QString name, qint32 group = 0)
+	    : name(std::move(name))
+	    , group(group) {}
+
+	void setName(const QString& name) {
+		this->name = name;
+		emit this->nameChanged();
+	}
+
+	void setGroup(qint32 group) {
+		this->group = group;
+		emit this->groupChanged();
+	}
+
+	QString name;
+	qint32 group = 0;
+
+signals:
+	void nameChanged();
+	void groupChanged();
+};
+
+class TestSortFilterModel: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void scriptModelSource();
+	static void objectModelSource();
+	static void propertyChanges();
+	static void sourceChanges();
+	static void sharedObjects();
+	static void watchedProperties();
+};
@@ -5,12 +5,16 @@ FileViewInternal {
 	property bool blockLoading: this.__blockLoading;
 	property bool blockAllReads: this.__blockAllReads;
 	property bool printErrors: this.__printErrors;
+	property bool tail: this.__tail;
+	property bool memoryMap: this.__memoryMap;
 	property string path: this.__path;
 
 	onPreloadChanged: this.__preload = preload;
 	onBlockLoadingChanged: this.__blockLoading = this.blockLoading;
 	onBlockAllReadsChanged: this.__blockAllReads = this.blockAllReads;
 	onPrintErrorsChanged: this.__printErrors = this.printErrors;
+	onTailChanged: this.__tail = this.tail;
+	onMemoryMapChanged: this.__memoryMap = this.memoryMap;
 
 	// Unfortunately path can't be kept as an empty string until the file loads
 	// without using QQmlPropertyValueInterceptor which is private. If we lean fully
@@ -19,6 +23,8 @@ FileViewInternal {
 	onPathChanged: {
 		if (!this.preload) this.__preload = false;
 		this.__printErrors = this.printErrors;
+		this.__tail = this.tail;
+		this.__memoryMap = this.memoryMap;
 		this.__path = this.path;
 		if (this.preload) this.__preload = true;
 	}
@@ -34,6 +40,8 @@ FileViewInternal {
 		this.__blockLoading = this.blockLoading;
 		this.__blockAllReads = this.blockAllReads;
 		this.__printErrors = this.printErrors;
+		this.__tail = this.tail;
+		this.__memoryMap = this.memoryMap;
 		this.__path = this.path;
 		const text = this.__text;
 		if (this.preload) this.__preload = true;
@@ -45,6 +53,8 @@ FileViewInternal {
 		this.__blockLoading = this.blockLoading;
 		this.__blockAllReads = this.blockAllReads;
 		this.__printErrors = this.printErrors;
+		this.__tail = this.tail;
+		this.__memoryMap = this.memoryMap;
 		this.__path = this.path;
 		const data = this.__data;
 		if (this.preload) this.__preload = true;
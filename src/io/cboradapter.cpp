@@ -0,0 +1,260 @@
+#include "cboradapter.hpp"
+
+#include <qbytearray.h>
+#include <qcborcommon.h>
+#include <qcborstreamreader.h>
+#include <qcborstreamwriter.h>
+#include <qcborvalue.h>
+#include <qjsonvalue.h>
+#include <qjsvalue.h>
+#include <qmetaobject.h>
+#include <qmetatype.h>
+#include <qobject.h>
+#include <qqmlengine.h>
+#include <qqmlinfo.h>
+#include <qqmllist.h>
+#include <qstring.h>
+#include <qvariant.h>
+
+#include "jsonadapter.hpp"
+
+namespace qs::io {
+
+namespace {
+
+// Reads a string item, or skips the item and returns a null string if it is not one.
+QString readString(QCborStreamReader& reader) {
+	if (!reader.isString()) {
+		reader.next();
+		return QString();
+	}
+
+	auto string = QString();
+	auto chunk = reader.readString();
+
+	while (chunk.status == QCborStreamReader::Ok) {
+		string += chunk.data;
+		chunk = reader.readString();
+	}
+
+	return string;
+}
+
+// Matches the values written by JsonAdapter, so files can be converted between the two.
+QCborValue toCbor(const QVariant& value) {
+	return QCborValue::fromJsonValue(QJsonValue::fromVariant(value));
+}
+
+} // namespace
+
+void CborAdapter::deserializeAdapter(const QByteArray& data) {
+	if (data.isEmpty()) return;
+
+	auto reader = QCborStreamReader(data);
+
+	if (!reader.isMap()) {
+		if (reader.lastError() != QCborError::NoError) {
+			qmlWarning(this) << "Failed to deserialize cbor: " << reader.lastError().toString();
+		} else {
+			qmlWarning(this) << "Failed to deserialize cbor: not a map";
+		}
+
+		return;
+	}
+
+	// Skipping the document validates it without decoding any values,
+	// so a corrupt file is not partially applied.
+	reader.next();
+
+	if (reader.lastError() != QCborError::NoError) {
+		qmlWarning(this) << "Failed to deserialize cbor: " << reader.lastError().toString();
+		return;
+	}
+
+	reader.reset();
+
+	this->beginDeserialize();
+	this->readRec(reader, this, &CborAdapter::staticMetaObject);
+	this->endDeserialize();
+}
+
+void CborAdapter::readRec(QCborStreamReader& reader, QObject* obj, const QMetaObject* base) {
+	const auto* metaObject = obj->metaObject();
+
+	reader.enterContainer();
+
+	while (reader.hasNext()) {
+		auto name = readString(reader).toUtf8();
+		auto index = name.isEmpty() ? -1 : metaObject->indexOfProperty(name.constData());
+
+		if (index < base->propertyOffset()) {
+			reader.next();
+			continue;
+		}
+
+		this->readProperty(reader, obj, metaObject->property(index));
+	}
+
+	reader.leaveContainer();
+}
+
+void CborAdapter::readProperty(QCborStreamReader& reader, QObject* obj, const QMetaProperty& prop) {
+	if (prop.metaType() == QMetaType::fromType<QVariant>()) {
+		auto variant = QCborValue::fromCbor(reader).toVariant();
+		auto oldValue = prop.read(obj).value<QJSValue>();
+
+		// Calling prop.write with a new QJSValue will cause a property update
+		// even if content is identical.
+		if (variant != oldValue.toVariant()) {
+			auto jsValue = qmlEngine(this)->fromVariant<QJSValue>(variant);
+			prop.write(obj, QVariant::fromValue(jsValue));
+		}
+	} else if (QMetaType::canView(prop.metaType(), QMetaType::fromType<JsonObject*>())) {
+		if (reader.isMap()) {
+			auto* currentValue = prop.read(obj).view<JsonObject*>();
+			auto isNew = currentValue == nullptr;
+
+			// metaObject->metaType removes the pointer
+			currentValue =
+			    this->deserializedObject(currentValue, prop.metaType().metaObject()->metaType());
+
+			this->readRec(reader, currentValue, &JsonObject::staticMetaObject);
+
+			if (isNew) prop.write(obj, QVariant::fromValue(currentValue));
+		} else if (reader.isNull()) {
+			reader.next();
+			prop.write(obj, QVariant::fromValue(nullptr));
+		} else {
+			qmlWarning(this) << "Failed to deserialize property " << prop.name()
+			                 << " as object. Got cbor type " << reader.type();
+			reader.next();
+		}
+	} else if (QMetaType::canConvert(
+	               prop.metaType(),
+	               QMetaType::fromType<QQmlListProperty<JsonObject>>()
+	           ))
+	{
+		auto pval = prop.read(obj);
+
+		if (!pval.canConvert<QQmlListProperty<JsonObject>>()) {
+			qmlWarning(this) << "Failed to deserialize property " << prop.name()
+			                 << ": property is a list<JsonObject> but contains null.";
+			reader.next();
+			return;
+		}
+
+		if (!reader.isArray()) {
+			qmlWarning(this) << "Failed to deserialize property " << prop.name()
+			                 << ": expected an array but got cbor type " << reader.type();
+			reader.next();
+			return;
+		}
+
+		auto lp = pval.value<QQmlListProperty<JsonObject>>();
+		auto lpCount = lp.count(&lp);
+
+		// Each member is decoded straight into its object as it is read.
+		reader.enterContainer();
+
+		auto i = 0;
+		for (; reader.hasNext(); i++) {
+			JsonObject* currentValue = nullptr;
+			auto isNew = i >= lpCount;
+
+			if (reader.isMap()) {
+				// FIXME: should be the type inside the QQmlListProperty but how can we get that?
+				currentValue = this->deserializedObject(
+				    isNew ? nullptr : lp.at(&lp, i),
+				    QMetaType::fromType<JsonObject>()
+				);
+
+				this->readRec(reader, currentValue, &JsonObject::staticMetaObject);
+			} else {
+				if (!reader.isNull()) {
+					qmlWarning(this) << "Failed to deserialize property" << prop.name()
+					                 << ": Member of object array is not an object: cbor type "
+					                 << reader.type();
+				}
+
+				reader.next();
+			}
+
+			if (isNew) {
+				lp.append(&lp, currentValue);
+			}
+		}
+
+		reader.leaveContainer();
+
+		for (; i < lpCount; i++) {
+			lp.removeLast(&lp);
+		}
+	} else {
+		auto variant = QCborValue::fromCbor(reader).toVariant();
+		auto typeName = variant.typeName();
+
+		if (variant.convert(prop.metaType())) {
+			prop.write(obj, variant);
+		} else {
+			qmlWarning(this) << "Failed to deserialize property " << prop.name() << ": expected "
+			                 << prop.metaType().name() << " but got " << typeName;
+		}
+	}
+}
+
+QByteArray CborAdapter::serializeAdapter() {
+	auto data = QByteArray();
+	auto writer = QCborStreamWriter(&data);
+	this->writeRec(writer, this, &CborAdapter::staticMetaObject);
+	return data;
+}
+
+void CborAdapter::writeRec(QCborStreamWriter& writer, const QObject* obj, const QMetaObject* base)
+    const {
+	const auto* metaObject = obj->metaObject();
+
+	auto count = 0;
+	for (auto i = base->propertyOffset(); i != metaObject->propertyCount(); i++) {
+		const auto prop = metaObject->property(i);
+		if (prop.isReadable() && prop.hasNotifySignal()) count++;
+	}
+
+	writer.startMap(count);
+
+	for (auto i = base->propertyOffset(); i != metaObject->propertyCount(); i++) {
+		const auto prop = metaObject->property(i);
+		if (!prop.isReadable() || !prop.hasNotifySignal()) continue;
+
+		writer.append(QLatin1StringView(prop.name()));
+
+		auto val = prop.read(obj);
+		if (val.canView<JsonObject*>()) {
+			auto* pobj = val.view<JsonObject*>();
+
+			if (pobj) this->writeRec(writer, pobj, &JsonObject::staticMetaObject);
+			else writer.append(nullptr);
+		} else if (val.canConvert<QQmlListProperty<JsonObject>>()) {
+			auto listVal = val.value<QQmlListProperty<JsonObject>>();
+
+			auto len = listVal.count(&listVal);
+			writer.startArray(len);
+
+			for (auto i = 0; i != len; i++) {
+				auto* pobj = listVal.at(&listVal, i);
+
+				if (pobj) this->writeRec(writer, pobj, &JsonObject::staticMetaObject);
+				else writer.append(nullptr);
+			}
+
+			writer.endArray();
+		} else if (val.canConvert<QJSValue>()) {
+			toCbor(val.value<QJSValue>().toVariant()).toCbor(writer);
+		} else {
+			toCbor(val).toCbor(writer);
+		}
+	}
+
+	writer.endMap();
+}
+
+} // namespace qs::io
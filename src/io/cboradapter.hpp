@@ -0,0 +1,53 @@
+#pragma once
+
+#include <qbytearray.h>
+#include <qcborstreamreader.h>
+#include <qcborstreamwriter.h>
+#include <qmetaobject.h>
+#include <qobject.h>
+#include <qqmlintegration.h>
+#include <qtmetamacros.h>
+
+#include "jsonadapter.hpp"
+
+namespace qs::io {
+
+///! FileView adapter for accessing CBOR files.
+/// CborAdapter is a @@FileView adapter that works the same way as @@JsonAdapter, but stores
+/// its properties as [CBOR](https://cbor.io), a compact binary encoding of JSON-like data.
+///
+/// CBOR files are smaller and faster to load and save than JSON, at the cost of not being
+/// human readable, which makes CborAdapter a good fit for large state files such as
+/// histories or caches. Properties are declared the same way as in @@JsonAdapter, using
+/// @@JsonObject$ for sub-objects.
+///
+/// The file is decoded directly into the adapter's properties without building an intermediate
+/// document, so large lists of @@JsonObject$s are loaded one object at a time.
+///
+/// ### Example
+/// ```qml
+/// @@FileView {
+///   path: "/path/to/history.cbor"
+///   onAdapterUpdated: writeAdapter()
+///
+///   CborAdapter {
+///     property list<JsonObject> entries
+///     property int lastId: 0
+///   }
+/// }
+/// ```
+class CborAdapter: public JsonAdapter {
+	Q_OBJECT;
+	QML_ELEMENT;
+
+public:
+	void deserializeAdapter(const QByteArray& data) override;
+	[[nodiscard]] QByteArray serializeAdapter() override;
+
+private:
+	void readRec(QCborStreamReader& reader, QObject* obj, const QMetaObject* base);
+	void readProperty(QCborStreamReader& reader, QObject* obj, const QMetaProperty& prop);
+	void writeRec(QCborStreamWriter& writer, const QObject* obj, const QMetaObject* base) const;
+};
+
+} // namespace qs::io
@@ -0,0 +1,293 @@
+#include "commandsource.hpp"
+#include <algorithm>
+#include <utility>
+
+#include <qbytearray.h>
+#include <qcontainerfwd.h>
+#include <qhash.h>
+#include <qjsonarray.h>
+#include <qjsondocument.h>
+#include <qjsonobject.h>
+#include <qlist.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qobject.h>
+#include <qprocess.h>
+#include <qtypes.h>
+#include <qvariant.h>
+
+#include "../core/logcat.hpp"
+#include "processcore.hpp"
+
+namespace {
+QS_LOGGING_CATEGORY(logCommandSource, "quickshell.io.commandsource", QtWarningMsg);
+
+// How long an entry without sources is kept at least, so its output survives reloads.
+constexpr qint32 ENTRY_RETAIN_MS = 5000;
+
+QHash<QString, CommandSourceEntry*>& entries() {
+	static auto* entries = new QHash<QString, CommandSourceEntry*>(); // NOLINT
+	return *entries;
+}
+
+} // namespace
+
+CommandSourceEntry::CommandSourceEntry(QString key, qs::io::process::ProcessContext context)
+    : key(std::move(key))
+    , context(std::move(context)) {
+	this->timer.setSingleShot(true);
+	this->expiryTimer.setSingleShot(true);
+	QObject::connect(&this->timer, &QTimer::timeout, this, &CommandSourceEntry::refresh);
+	QObject::connect(&this->expiryTimer, &QTimer::timeout, this, &CommandSourceEntry::onExpired);
+}
+
+QString CommandSourceEntry::keyFor(const qs::io::process::ProcessContext& context) {
+	// Separators that cannot appear in arguments or environment variables.
+	auto key = context.command.join(QChar(1));
+	key += QChar(2) + context.workingDirectory;
+	key += QChar(2) + QString(context.clearEnvironment ? "1" : "0");
+
+	auto names = context.environment.keys();
+	names.sort();
+
+	for (const auto& name: names) {
+		auto value = context.environment.value(name);
+		if (!value.isValid()) continue;
+
+		key += QChar(2) + name;
+		if (!value.isNull()) key += '=' + value.toString();
+	}
+
+	return key;
+}
+
+CommandSourceEntry* CommandSourceEntry::acquire(CommandSource* source) {
+	auto key = CommandSourceEntry::keyFor(source->context());
+	auto*& entry = entries()[key];
+
+	if (!entry) {
+		qCDebug(logCommandSource) << "Creating shared command" << source->context().command;
+		entry = new CommandSourceEntry(key, source->context());
+	}
+
+	entry->sources.append(source);
+	entry->expiryTimer.stop();
+	entry->reschedule();
+
+	if (!entry->isFresh(source->interval())) entry->refresh();
+
+	return entry;
+}
+
+void CommandSourceEntry::release(CommandSource* source) {
+	this->sources.removeOne(source);
+	if (!this->sources.isEmpty()) {
+		this->reschedule();
+		return;
+	}
+
+	// Keep the output around for as long as it may be reused.
+	this->timer.stop();
+	this->expiryTimer.start(std::max(this->interval, ENTRY_RETAIN_MS));
+}
+
+void CommandSourceEntry::onExpired() {
+	// Destroying a running QProcess kills it and blocks until it exits, so expiry is
+	// postponed until the run finishes.
+	if (this->process) return;
+
+	qCDebug(logCommandSource) << "Removing unused shared command" << this->context.command;
+	entries().remove(this->key);
+	this->deleteLater();
+}
+
+void CommandSourceEntry::reschedule() {
+	auto interval = 0;
+	for (auto* source: this->sources) {
+		if (source->interval() > 0 && (interval == 0 || source->interval() < interval)) {
+			interval = source->interval();
+		}
+	}
+
+	this->interval = interval;
+
+	if (interval == 0) {
+		this->timer.stop();
+	} else if (!this->process) {
+		// The next run is scheduled when the current one finishes.
+		auto elapsed = this->mHasResult ? this->age.elapsed() : interval;
+		this->timer.start(static_cast<qint32>(std::max(interval - elapsed, static_cast<qint64>(0))));
+	}
+}
+
+bool CommandSourceEntry::isFresh(qint32 maxAge) const {
+	if (!this->mHasResult) return false;
+	return maxAge <= 0 || this->age.elapsed() < maxAge;
+}
+
+void CommandSourceEntry::refresh() {
+	if (this->process) return;
+
+	this->timer.stop();
+	this->process = new QProcess(this);
+
+	qs::io::process::setupProcessEnvironment(
+	    this->process,
+	    this->context.clearEnvironment,
+	    this->context.environment
+	);
+
+	if (!this->context.workingDirectory.isEmpty()) {
+		this->process->setWorkingDirectory(this->context.workingDirectory);
+	}
+
+	this->process->setStandardInputFile(QProcess::nullDevice());
+	this->process->setStandardErrorFile(QProcess::nullDevice());
+
+	QObject::connect(this->process, &QProcess::finished, this, &CommandSourceEntry::onFinished);
+	QObject::connect(
+	    this->process,
+	    &QProcess::errorOccurred,
+	    this,
+	    &CommandSourceEntry::onErrorOccurred
+	);
+
+	this->process->start(this->context.command.first(), this->context.command.sliced(1));
+	this->notifyRunningChanged();
+}
+
+void CommandSourceEntry::onFinished(qint32 exitCode, QProcess::ExitStatus /*exitStatus*/) {
+	this->finishRun(this->process->readAllStandardOutput(), exitCode);
+}
+
+void CommandSourceEntry::onErrorOccurred(QProcess::ProcessError error) {
+	// other cases are followed by finished
+	if (error != QProcess::FailedToStart) return;
+
+	qCWarning(logCommandSource) << "Failed to start command" << this->context.command;
+	this->finishRun(QByteArray(), -1);
+}
+
+void CommandSourceEntry::finishRun(QByteArray output, qint32 exitCode) {
+	this->process->deleteLater();
+	this->process = nullptr;
+
+	this->mHasResult = true;
+	this->age.start();
+	this->output = std::move(output);
+	this->mText = QString::fromUtf8(this->output);
+	this->mExitCode = exitCode;
+	this->jsonParsed = false;
+	this->mJson = QVariant();
+
+	this->reschedule();
+
+	// Sources may be destroyed or change their command from their handlers.
+	for (auto* source: QList(this->sources)) {
+		if (this->sources.contains(source)) emit source->updated();
+	}
+
+	this->notifyRunningChanged();
+
+	// The entry expired while the command was running.
+	if (this->sources.isEmpty() && !this->expiryTimer.isActive()) this->onExpired();
+}
+
+void CommandSourceEntry::notifyRunningChanged() {
+	for (auto* source: QList(this->sources)) {
+		if (this->sources.contains(source)) emit source->runningChanged();
+	}
+}
+
+QVariant CommandSourceEntry::json() {
+	if (!this->jsonParsed) {
+		this->jsonParsed = true;
+
+		auto json = QJsonDocument::fromJson(this->output);
+		if (json.isArray()) this->mJson = QVariant::fromValue(json.array());
+		else if (json.isObject()) this->mJson = QVariant::fromValue(json.object());
+	}
+
+	return this->mJson;
+}
+
+CommandSource::~CommandSource() {
+	if (this->entry) this->entry->release(this);
+}
+
+void CommandSource::onPostReload() { this->updateEntry(); }
+
+void CommandSource::updateEntry() {
+	if (!this->isPostReload) return;
+
+	auto active = this->mEnabled && !this->mContext.command.isEmpty();
+
+	if (this->entry) {
+		if (active && CommandSourceEntry::keyFor(this->mContext) == this->entry->cacheKey()) {
+			this->entry->reschedule();
+			return;
+		}
+
+		this->entry->release(this);
+		this->entry = nullptr;
+	}
+
+	if (active) this->entry = CommandSourceEntry::acquire(this);
+
+	emit this->updated();
+	emit this->runningChanged();
+}
+
+void CommandSource::refresh() {
+	if (this->entry) this->entry->refresh();
+}
+
+void CommandSource::setCommand(QList<QString> command) {
+	if (command == this->mContext.command) return;
+	this->mContext.command = std::move(command);
+	emit this->commandChanged();
+	this->updateEntry();
+}
+
+void CommandSource::setWorkingDirectory(QString workingDirectory) {
+	if (workingDirectory == this->mContext.workingDirectory) return;
+	this->mContext.workingDirectory = std::move(workingDirectory);
+	emit this->workingDirectoryChanged();
+	this->updateEntry();
+}
+
+void CommandSource::setEnvironment(QVariantHash environment) {
+	if (environment == this->mContext.environment) return;
+	this->mContext.environment = std::move(environment);
+	emit this->environmentChanged();
+	this->updateEntry();
+}
+
+void CommandSource::setEnvironmentCleared(bool cleared) {
+	if (cleared == this->mContext.clearEnvironment) return;
+	this->mContext.clearEnvironment = cleared;
+	emit this->environmentClearChanged();
+	this->updateEntry();
+}
+
+void CommandSource::setInterval(qint32 interval) {
+	if (interval == this->mInterval) return;
+	this->mInterval = interval;
+	emit this->intervalChanged();
+	this->updateEntry();
+}
+
+void CommandSource::setEnabled(bool enabled) {
+	if (enabled == this->mEnabled) return;
+	this->mEnabled = enabled;
+	emit this->enabledChanged();
+	this->updateEntry();
+}
+
+bool CommandSource::isRunning() const { return this->entry && this->entry->isRunning(); }
+
+QString CommandSource::text() const { return this->entry ? this->entry->text() : QString(); }
+
+QVariant CommandSource::json() const { return this->entry ? this->entry->json() : QVariant(); }
+
+qint32 CommandSource::exitCode() const { return this->entry ? this->entry->exitCode() : 0; }
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <qbytearray.h>
+#include <qcontainerfwd.h>
+#include <qelapsedtimer.h>
+#include <qhash.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qprocess.h>
+#include <qqmlintegration.h>
+#include <qtclasshelpermacros.h>
+#include <qtimer.h>
+#include <qtmetamacros.h>
+#include <qtypes.h>
+#include <qvariant.h>
+
+#include "../core/reload.hpp"
+#include "processcore.hpp"
+
+class CommandSource;
+
+// A command run on behalf of every CommandSource with the same command, environment
+// and working directory, sharing a single schedule and result between them.
+class CommandSourceEntry: public QObject {
+	Q_OBJECT;
+
+public:
+	CommandSourceEntry(QString key, qs::io::process::ProcessContext context);
+
+	static CommandSourceEntry* acquire(CommandSource* source);
+	void release(CommandSource* source);
+
+	// Runs the command, unless it is already running.
+	void refresh();
+	// Updates the schedule after the interval of a source changes.
+	void reschedule();
+
+	[[nodiscard]] bool isRunning() const { return this->process != nullptr; }
+	[[nodiscard]] bool hasResult() const { return this->mHasResult; }
+	// If there is a result younger than maxAge, or any result if maxAge is not positive.
+	[[nodiscard]] bool isFresh(qint32 maxAge) const;
+
+	[[nodiscard]] const QString& text() const { return this->mText; }
+	[[nodiscard]] QVariant json();
+	[[nodiscard]] qint32 exitCode() const { return this->mExitCode; }
+
+	[[nodiscard]] const QString& cacheKey() const { return this->key; }
+	static QString keyFor(const qs::io::process::ProcessContext& context);
+
+private slots:
+	void onFinished(qint32 exitCode, QProcess::ExitStatus exitStatus);
+	void onErrorOccurred(QProcess::ProcessError error);
+	void onExpired();
+
+private:
+	void finishRun(QByteArray output, qint32 exitCode);
+	void notifyRunningChanged();
+
+	QString key;
+	qs::io::process::ProcessContext context;
+	QList<CommandSource*> sources;
+	QProcess* process = nullptr;
+	QTimer timer;
+	QTimer expiryTimer;
+	QElapsedTimer age;
+	qint32 interval = 0;
+
+	bool mHasResult = false;
+	QByteArray output;
+	QString mText;
+	qint32 mExitCode = 0;
+	bool jsonParsed = false;
+	QVariant mJson;
+};
+
+///! Shared, periodically refreshed command output.
+/// Runs a command on a schedule and exposes its output, like a @@Process with a
+/// @@StdioCollector restarted by a `Timer`, but shared with every other CommandSource
+/// in the shell running the same command.
+///
+/// CommandSources with the same @@command, @@environment, @@clearEnvironment and
+/// @@workingDirectory run the command once for all of them, as often as the shortest
+/// @@interval between them requires, and share its output. A new run is not started
+/// while the previous one is still running.
+///
+/// Output younger than a CommandSource's @@interval is reused when it is created,
+/// including across shell reloads, instead of running the command again.
+///
+/// #### Example
+/// ```qml
+/// CommandSource {
+///   id: volume
+///   command: [ "wpctl", "get-volume", "@DEFAULT_AUDIO_SINK@" ]
+///   interval: 2000
+/// }
+///
+/// Text { text: volume.text }
+/// ```
+class CommandSource: public PostReloadHook {
+	Q_OBJECT;
+	// clang-format off
+	/// The command to run. See @@Process.command.
+	Q_PROPERTY(QList<QString> command READ command WRITE setCommand NOTIFY commandChanged);
+	/// The working directory of the command. See @@Process.workingDirectory.
+	Q_PROPERTY(QString workingDirectory READ workingDirectory WRITE setWorkingDirectory NOTIFY workingDirectoryChanged);
+	/// Changes to the environment of the command. See @@Process.environment.
+	Q_PROPERTY(QVariantHash environment READ environment WRITE setEnvironment NOTIFY environmentChanged);
+	/// If the environment should be cleared before applying @@environment.
+	/// See @@Process.clearEnvironment.
+	Q_PROPERTY(bool clearEnvironment READ environmentCleared WRITE setEnvironmentCleared NOTIFY environmentClearChanged);
+	/// How often the command should be run in milliseconds, and how old its output may be.
+	///
+	/// If 0 (the default), the command is only run once, when no output is available,
+	/// and when @@refresh() is called.
+	Q_PROPERTY(qint32 interval READ interval WRITE setInterval NOTIFY intervalChanged);
+	/// If false, the command is not run for this source. Defaults to true.
+	Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged);
+	/// If the command is currently running.
+	Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged);
+	/// The stdout of the last completed run of the command.
+	Q_PROPERTY(QString text READ text NOTIFY updated);
+	/// The stdout of the last completed run parsed as a JSON object or array,
+	/// or `undefined` if it is not valid JSON.
+	///
+	/// The output is parsed once, and the result is shared with other CommandSources
+	/// running the same command.
+	Q_PROPERTY(QVariant json READ json NOTIFY updated);
+	/// The exit code of the last completed run of the command.
+	Q_PROPERTY(qint32 exitCode READ exitCode NOTIFY updated);
+	// clang-format on
+	QML_ELEMENT;
+
+public:
+	explicit CommandSource(QObject* parent = nullptr): PostReloadHook(parent) {}
+	~CommandSource() override;
+	Q_DISABLE_COPY_MOVE(CommandSource);
+
+	void onPostReload() override;
+
+	/// Runs the command now, unless it is already running.
+	Q_INVOKABLE void refresh();
+
+	[[nodiscard]] QList<QString> command() const { return this->mContext.command; }
+	void setCommand(QList<QString> command);
+
+	[[nodiscard]] QString workingDirectory() const { return this->mContext.workingDirectory; }
+	void setWorkingDirectory(QString workingDirectory);
+
+	[[nodiscard]] QVariantHash environment() const { return this->mContext.environment; }
+	void setEnvironment(QVariantHash environment);
+
+	[[nodiscard]] bool environmentCleared() const { return this->mContext.clearEnvironment; }
+	void setEnvironmentCleared(bool cleared);
+
+	[[nodiscard]] qint32 interval() const { return this->mInterval; }
+	void setInterval(qint32 interval);
+
+	[[nodiscard]] bool enabled() const { return this->mEnabled; }
+	void setEnabled(bool enabled);
+
+	[[nodiscard]] bool isRunning() const;
+	[[nodiscard]] QString text() const;
+	[[nodiscard]] QVariant json() const;
+	[[nodiscard]] qint32 exitCode() const;
+
+	[[nodiscard]] const qs::io::process::ProcessContext& context() const { return this->mContext; }
+
+signals:
+	/// Emitted when the command finishes running and new output is available.
+	void updated();
+	void commandChanged();
+	void workingDirectoryChanged();
+	void environmentChanged();
+	void environmentClearChanged();
+	void intervalChanged();
+	void enabledChanged();
+	void runningChanged();
+
+private:
+	void updateEntry();
+
+	qs::io::process::ProcessContext mContext;
+	qint32 mInterval = 0;
+	bool mEnabled = true;
+	CommandSourceEntry* entry = nullptr;
+};
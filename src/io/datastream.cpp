@@ -1,11 +1,29 @@
 #include "datastream.hpp"
 #include <algorithm>
+#include <cstring>
 #include <utility>
 
+#include <qatomic.h>
+#include <qbytearray.h>
+#include <qbytearrayview.h>
+#include <qjsonarray.h>
+#include <qjsondocument.h>
+#include <qjsonobject.h>
+#include <qlist.h>
 #include <qlocalsocket.h>
+#include <qnamespace.h>
 #include <qobject.h>
+#include <qthreadpool.h>
+#include <qtimer.h>
 #include <qtmetamacros.h>
 #include <qtypes.h>
+#include <qvariant.h>
+
+namespace {
+
+constexpr qint32 STDIO_NOTIFY_INTERVAL_MS = 50;
+
+} // namespace
 
 DataStreamParser* DataStream::reader() const { return this->mReader; }
 
@@ -40,14 +58,31 @@ void DataStream::onBytesAvailable() {
 	this->mReader->parseBytes(buf, this->buffer);
 }
 
+namespace {
+
+qsizetype findMarker(const QByteArray& data, qsizetype from, const QByteArray& marker) {
+	const auto* begin = data.constData();
+	const void* found = nullptr;
+
+	if (marker.length() == 1) {
+		found = std::memchr(begin + from, marker.at(0), data.length() - from);
+	} else {
+		found = memmem(begin + from, data.length() - from, marker.constData(), marker.length());
+	}
+
+	return found ? static_cast<const char*>(found) - begin : -1;
+}
+
+} // namespace
+
 void SplitParser::parseBytes(QByteArray& incoming, QByteArray& buffer) {
 	if (this->mSplitMarker.isEmpty()) {
-		if (!buffer.isEmpty()) {
-			emit this->read(QString(buffer));
-			buffer.clear();
-		}
+		auto records = QList<QString>();
+		if (!buffer.isEmpty()) records.append(QString(buffer));
+		if (&incoming != &buffer) records.append(QString(incoming));
 
-		emit this->read(QString(incoming));
+		buffer.clear();
+		this->emitRecords(records);
 		return;
 	}
 
@@ -60,46 +95,42 @@ void SplitParser::parseBytes(QByteArray& incoming, QByteArray& buffer) {
 	auto marker = this->mSplitMarker.toUtf8();
 	auto mlen = marker.length();
 
-	auto blen = buffer.size();
-	auto ilen = incoming.size();
+	// The buffer was already searched, so only its last bytes can begin a marker that the
+	// incoming data completes.
+	qsizetype from = 0;
+	if (&incoming != &buffer) {
+		from = std::max(buffer.length() - (mlen - 1), static_cast<qsizetype>(0));
+		buffer.append(incoming);
+	}
 
-	qsizetype start = &incoming == &buffer ? 0 : -blen;
-	for (auto readi = -std::min(blen, mlen - 1); readi <= ilen - mlen; readi++) {
-		for (auto marki = 0; marki < mlen; marki++) {
-			qint8 byte; // NOLINT
-			if (readi + marki < 0) byte = buffer[blen + readi + marki];
-			else byte = incoming[readi + marki];
+	auto records = QList<QString>();
+	qsizetype start = 0;
 
-			if (byte != marker[marki]) goto fail;
-		}
+	for (auto index = findMarker(buffer, from, marker); index != -1;
+	     index = findMarker(buffer, start, marker))
+	{
+		records.append(QString::fromUtf8(buffer.constData() + start, index - start));
+		start = index + mlen;
+	}
 
-		{
-			QByteArray slice;
-			if (start < 0) slice = buffer.sliced(0, std::min(blen, blen + readi));
-			if (readi > 0) {
-				auto sstart = std::max(static_cast<qsizetype>(0), start);
-				slice.append(incoming.sliced(sstart, readi - sstart));
-			}
-			readi += mlen;
-			start = readi;
-			emit this->read(QString(slice));
-		}
+	buffer.remove(0, start);
+	this->emitRecords(records);
+}
 
-	fail:;
-	}
+void SplitParser::emitRecords(const QList<QString>& records) {
+	if (records.isEmpty()) return;
 
-	if (start < 0) {
-		buffer.append(incoming);
+	if (this->mBatched) {
+		emit this->readBatch(records);
 	} else {
-		// Will break the init case if inlined. Must be before clear.
-		auto slice = incoming.sliced(start);
-		buffer.clear();
-		buffer.insert(0, slice);
+		for (const auto& record: records) {
+			emit this->read(record);
+		}
 	}
 }
 
 void SplitParser::streamEnded(QByteArray& buffer) {
-	if (!buffer.isEmpty()) emit this->read(QString(buffer));
+	if (!buffer.isEmpty()) this->emitRecords({QString(buffer)});
 }
 
 QString SplitParser::splitMarker() const { return this->mSplitMarker; }
@@ -112,26 +143,289 @@ void SplitParser::setSplitMarker(QString marker) {
 	emit this->splitMarkerChanged();
 }
 
+void SplitParser::setBatched(bool batched) {
+	if (batched == this->mBatched) return;
+	this->mBatched = batched;
+	emit this->batchedChanged();
+}
+
+StdioCollector::StdioCollector(QObject* parent): DataStreamParser(parent) {
+	this->notifyTimer.setSingleShot(true);
+	this->notifyTimer.setInterval(STDIO_NOTIFY_INTERVAL_MS);
+	QObject::connect(&this->notifyTimer, &QTimer::timeout, this, &StdioCollector::onNotifyTimeout);
+}
+
+void StdioCollector::beginStream() {
+	if (!this->streamDone) return;
+
+	this->streamDone = false;
+	this->collected.clear();
+	this->setTruncated(false);
+}
+
 void StdioCollector::parseBytes(QByteArray& incoming, QByteArray& buffer) {
-	buffer.append(incoming);
+	this->beginStream();
 
-	if (!this->mWaitForEnd) {
-		this->mData = buffer;
-		emit this->dataChanged();
+	// The stream's buffer only holds data from before this collector was attached.
+	if (!buffer.isEmpty()) {
+		this->append(buffer);
+		buffer.clear();
 	}
+
+	this->append(incoming);
+
+	if (!this->mWaitForEnd) this->notifyChanged();
 }
 
 void StdioCollector::streamEnded(QByteArray& buffer) {
-	if (this->mWaitForEnd) {
-		this->mData = buffer;
+	// Streams without any output never reach parseBytes.
+	this->beginStream();
+
+	if (!buffer.isEmpty()) {
+		this->append(buffer);
+		buffer.clear();
+	}
+
+	this->mData = this->collected;
+	this->streamDone = true;
+
+	this->notifyTimer.stop();
+	if (this->mWaitForEnd || this->changePending) {
+		this->changePending = false;
 		emit this->dataChanged();
 	}
 
 	emit this->streamFinished();
 }
 
+QByteArray StdioCollector::data() const {
+	return this->mWaitForEnd ? this->mData : this->collected;
+}
+
+void StdioCollector::append(QByteArrayView data) {
+	if (data.isEmpty()) return;
+
+	if (this->mMaxBytes <= 0) {
+		this->collected.append(data);
+		return;
+	}
+
+	auto max = static_cast<qsizetype>(this->mMaxBytes);
+
+	if (!this->mKeepTail) {
+		auto space = std::max(max - this->collected.length(), static_cast<qsizetype>(0));
+		if (data.length() > space) this->setTruncated(true);
+		this->collected.append(data.first(std::min(space, data.length())));
+	} else if (data.length() >= max) {
+		if (data.length() > max || !this->collected.isEmpty()) this->setTruncated(true);
+		this->collected = data.last(max).toByteArray();
+	} else {
+		auto overflow = this->collected.length() + data.length() - max;
+
+		// Removing from the front only moves the start of the array, and the space is
+		// reclaimed when it next grows.
+		if (overflow > 0) {
+			this->collected.remove(0, overflow);
+			this->setTruncated(true);
+		}
+
+		this->collected.append(data);
+	}
+}
+
+void StdioCollector::notifyChanged() {
+	if (this->notifyTimer.isActive()) {
+		this->changePending = true;
+		return;
+	}
+
+	emit this->dataChanged();
+	this->notifyTimer.start();
+}
+
+void StdioCollector::onNotifyTimeout() {
+	if (!this->changePending) return;
+
+	this->changePending = false;
+	emit this->dataChanged();
+	this->notifyTimer.start();
+}
+
 void StdioCollector::setWaitForEnd(bool waitForEnd) {
 	if (waitForEnd == this->mWaitForEnd) return;
 	this->mWaitForEnd = waitForEnd;
 	emit this->waitForEndChanged();
+	emit this->dataChanged();
+}
+
+void StdioCollector::setMaxBytes(qint32 maxBytes) {
+	if (maxBytes == this->mMaxBytes) return;
+	this->mMaxBytes = maxBytes;
+	emit this->maxBytesChanged();
+}
+
+void StdioCollector::setKeepTail(bool keepTail) {
+	if (keepTail == this->mKeepTail) return;
+	this->mKeepTail = keepTail;
+	emit this->keepTailChanged();
+}
+
+void StdioCollector::setTruncated(bool truncated) {
+	if (truncated == this->mTruncated) return;
+	this->mTruncated = truncated;
+	emit this->truncatedChanged();
+}
+
+JsonLinesOperation::JsonLinesOperation(QByteArray data): data(std::move(data)) {
+	this->setAutoDelete(false);
+}
+
+void JsonLinesOperation::run() {
+	this->lines = JsonLinesParser::parseLines(this->data, this->shouldCancel);
+	QMetaObject::invokeMethod(this, &JsonLinesOperation::finished, Qt::QueuedConnection);
+}
+
+void JsonLinesOperation::tryCancel() { this->shouldCancel.storeRelease(true); }
+
+void JsonLinesOperation::finished() {
+	if (!this->shouldCancel.loadAcquire()) emit this->done(this->lines);
+	delete this;
+}
+
+JsonLinesParser::~JsonLinesParser() {
+	if (this->liveOperation) {
+		this->liveOperation->tryCancel();
+		QObject::disconnect(this->liveOperation, nullptr, this, nullptr);
+	}
+}
+
+void JsonLinesParser::parseBytes(QByteArray& incoming, QByteArray& buffer) {
+	if (&incoming != &buffer) {
+		// Avoid copying through the buffer when it holds nothing from a previous read.
+		if (buffer.isEmpty()) {
+			auto end = incoming.lastIndexOf('\n');
+			if (end == -1) {
+				buffer = incoming;
+				return;
+			}
+
+			this->parseComplete(incoming.first(end + 1));
+			buffer = incoming.sliced(end + 1);
+			return;
+		}
+
+		buffer.append(incoming);
+	}
+
+	auto end = buffer.lastIndexOf('\n');
+	if (end == -1) return;
+
+	auto complete = buffer.first(end + 1);
+	buffer.remove(0, end + 1);
+	this->parseComplete(std::move(complete));
+}
+
+void JsonLinesParser::streamEnded(QByteArray& buffer) {
+	if (buffer.isEmpty()) return;
+
+	this->parseComplete(std::move(buffer));
+	buffer.clear();
+}
+
+void JsonLinesParser::parseComplete(QByteArray data) {
+	// Lines are queued behind a live operation even if no longer threaded to keep them in order.
+	if (!this->mThreaded && !this->liveOperation) {
+		this->emitLines(JsonLinesParser::parseLines(data));
+		return;
+	}
+
+	this->pendingData.append(data);
+	if (!this->liveOperation) this->startOperation();
+}
+
+void JsonLinesParser::startOperation() {
+	this->liveOperation = new JsonLinesOperation(std::move(this->pendingData));
+	this->pendingData.clear();
+
+	QObject::connect(
+	    this->liveOperation,
+	    &JsonLinesOperation::done,
+	    this,
+	    &JsonLinesParser::onOperationDone
+	);
+
+	QThreadPool::globalInstance()->start(this->liveOperation);
+}
+
+void JsonLinesParser::onOperationDone(const QList<JsonLine>& lines) {
+	this->liveOperation = nullptr;
+	if (!this->pendingData.isEmpty()) this->startOperation();
+
+	this->emitLines(lines);
+}
+
+void JsonLinesParser::emitLines(const QList<JsonLine>& lines) {
+	auto batch = QVariantList();
+
+	for (const auto& line: lines) {
+		if (!line.error.isNull()) {
+			// Keep errors ordered relative to the objects around them.
+			if (!batch.isEmpty()) {
+				emit this->objectsRead(batch);
+				batch.clear();
+			}
+
+			emit this->parseFailed(line.text, line.error);
+		} else if (this->mBatched) {
+			batch.append(line.value);
+		} else {
+			emit this->objectRead(line.value);
+		}
+	}
+
+	if (!batch.isEmpty()) emit this->objectsRead(batch);
+}
+
+QList<JsonLine>
+JsonLinesParser::parseLines(QByteArrayView data, const QAtomicInteger<bool>& shouldCancel) {
+	auto lines = QList<JsonLine>();
+
+	const auto* begin = data.data();
+	const auto* end = data.data() + data.size();
+
+	while (begin != end && !shouldCancel.loadRelaxed()) {
+		const auto* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+		const auto* lineEnd = newline ? newline : end;
+
+		auto line = QByteArrayView(begin, lineEnd).trimmed();
+		begin = newline ? newline + 1 : end;
+
+		if (line.isEmpty()) continue;
+
+		// Parsed straight out of the stream's buffer without copying the line.
+		QJsonParseError error; // NOLINT (misc-include-cleaner)
+		auto json = QJsonDocument::fromJson(QByteArray::fromRawData(line.data(), line.size()), &error);
+
+		if (error.error != QJsonParseError::NoError) {
+			lines.append({.error = error.errorString(), .text = QString::fromUtf8(line)});
+		} else if (json.isArray()) {
+			lines.append({.value = QVariant::fromValue(json.array())});
+		} else {
+			lines.append({.value = QVariant::fromValue(json.object())});
+		}
+	}
+
+	return lines;
+}
+
+void JsonLinesParser::setThreaded(bool threaded) {
+	if (threaded == this->mThreaded) return;
+	this->mThreaded = threaded;
+	emit this->threadedChanged();
+}
+
+void JsonLinesParser::setBatched(bool batched) {
+	if (batched == this->mBatched) return;
+	this->mBatched = batched;
+	emit this->batchedChanged();
 }
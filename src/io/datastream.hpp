@@ -1,10 +1,16 @@
 #pragma once
 
+#include <qatomic.h>
 #include <qbytearray.h>
+#include <qbytearrayview.h>
 #include <qcontainerfwd.h>
+#include <qlist.h>
 #include <qlocalsocket.h>
 #include <qobject.h>
 #include <qqmlintegration.h>
+#include <qrunnable.h>
+#include <qstring.h>
+#include <qtimer.h>
 #include <qtmetamacros.h>
 #include <qvariant.h>
 
@@ -71,6 +77,11 @@ class SplitParser: public DataStreamParser {
 	/// If the delimiter is empty read lengths may be arbitrary (whatever is returned by the
 	/// underlying read call.)
 	Q_PROPERTY(QString splitMarker READ splitMarker WRITE setSplitMarker NOTIFY splitMarkerChanged);
+	/// If true, every chunk parsed from one read of the stream is delivered together through
+	/// @@readBatch(s) instead of one at a time through @@DataStreamParser.read(s). Defaults to false.
+	///
+	/// Batching reduces the cost of signal handlers for streams which write many lines at once.
+	Q_PROPERTY(bool batched READ batched WRITE setBatched NOTIFY batchedChanged);
 	QML_ELEMENT;
 
 public:
@@ -82,12 +93,21 @@ public:
 	[[nodiscard]] QString splitMarker() const;
 	void setSplitMarker(QString marker);
 
+	[[nodiscard]] bool batched() const { return this->mBatched; }
+	void setBatched(bool batched);
+
 signals:
+	/// Emitted with every delimited chunk from one read of the stream if @@batched is true.
+	void readBatch(QList<QString> data);
 	void splitMarkerChanged();
+	void batchedChanged();
 
 private:
+	void emitRecords(const QList<QString>& records);
+
 	QString mSplitMarker = "\n";
 	bool mSplitMarkerChanged = false;
+	bool mBatched = false;
 };
 
 ///! DataStreamParser that collects all output into a buffer
@@ -104,26 +124,177 @@ class StdioCollector: public DataStreamParser {
 	/// [ArrayBuffer]: https://developer.mozilla.org/en-US/docs/Web/JavaScript/Reference/Global_Objects/ArrayBuffer
 	Q_PROPERTY(QByteArray data READ data NOTIFY dataChanged);
 	/// If true, @@text and @@data will not be updated until the stream ends. Defaults to true.
+	///
+	/// If false, @@text and @@data are updated as data is read, at most 20 times a second.
 	Q_PROPERTY(bool waitForEnd READ waitForEnd WRITE setWaitForEnd NOTIFY waitForEndChanged);
+	/// The maximum number of bytes to collect, or 0 for no limit. Defaults to 0.
+	///
+	/// Once the limit is reached, data past it is discarded, or the oldest data if @@keepTail
+	/// is true, and @@truncated becomes true. Setting a limit is recommended for commands
+	/// which may write large amounts of output, such as `journalctl`.
+	Q_PROPERTY(qint32 maxBytes READ maxBytes WRITE setMaxBytes NOTIFY maxBytesChanged);
+	/// If true, the last @@maxBytes bytes of the stream are kept instead of the first.
+	/// Defaults to false.
+	Q_PROPERTY(bool keepTail READ keepTail WRITE setKeepTail NOTIFY keepTailChanged);
+	/// If data was discarded because of @@maxBytes since the stream started.
+	Q_PROPERTY(bool truncated READ truncated NOTIFY truncatedChanged);
 
 public:
-	explicit StdioCollector(QObject* parent = nullptr): DataStreamParser(parent) {}
+	explicit StdioCollector(QObject* parent = nullptr);
 
 	void parseBytes(QByteArray& incoming, QByteArray& buffer) override;
 	void streamEnded(QByteArray& buffer) override;
 
-	[[nodiscard]] QString text() const { return this->mData; }
-	[[nodiscard]] QByteArray data() const { return this->mData; }
+	[[nodiscard]] QString text() const { return this->data(); }
+	[[nodiscard]] QByteArray data() const;
 
 	[[nodiscard]] bool waitForEnd() const { return this->mWaitForEnd; }
 	void setWaitForEnd(bool waitForEnd);
 
+	[[nodiscard]] qint32 maxBytes() const { return this->mMaxBytes; }
+	void setMaxBytes(qint32 maxBytes);
+
+	[[nodiscard]] bool keepTail() const { return this->mKeepTail; }
+	void setKeepTail(bool keepTail);
+
+	[[nodiscard]] bool truncated() const { return this->mTruncated; }
+
 signals:
 	void waitForEndChanged();
 	void dataChanged();
 	void streamFinished();
+	void maxBytesChanged();
+	void keepTailChanged();
+	void truncatedChanged();
+
+private slots:
+	void onNotifyTimeout();
 
 private:
+	// Clears the data of the last finished stream once another one starts.
+	void beginStream();
+	void append(QByteArrayView data);
+	void notifyChanged();
+	void setTruncated(bool truncated);
+
 	bool mWaitForEnd = true;
+	qint32 mMaxBytes = 0;
+	bool mKeepTail = false;
+	bool mTruncated = false;
+	// Data of the current stream. Kept here instead of the stream's buffer so appending to it
+	// never copies a buffer that was shared with QML.
+	QByteArray collected;
+	// The data of the last finished stream.
 	QByteArray mData;
+	bool streamDone = false;
+	QTimer notifyTimer;
+	bool changePending = false;
+};
+
+// The result of parsing one line of a JSON lines stream.
+struct JsonLine {
+	QVariant value;
+	// Set if the line could not be parsed.
+	QString error;
+	QString text;
+};
+
+class JsonLinesOperation
+    : public QObject
+    , public QRunnable {
+	Q_OBJECT;
+
+public:
+	explicit JsonLinesOperation(QByteArray data);
+
+	void run() override;
+	void tryCancel();
+
+signals:
+	void done(const QList<JsonLine>& lines);
+
+private slots:
+	void finished();
+
+private:
+	QAtomicInteger<bool> shouldCancel = false;
+	QByteArray data;
+	QList<JsonLine> lines;
+};
+
+///! DataStreamParser for JSON lines streams.
+/// DataStreamParser for streams of newline delimited JSON, such as event streams from
+/// compositor tools and monitoring daemons. Each line is parsed as a JSON object or array
+/// in C++ and delivered as a javascript value through @@objectRead(s), which avoids
+/// creating a string and calling `JSON.parse` for every line.
+///
+/// Empty lines are skipped, and lines that fail to parse are reported through @@parseFailed(s).
+/// @@DataStreamParser.read(s) is not emitted.
+///
+/// #### Example
+/// ```qml
+/// Process {
+///   command: [ "swaymsg", "-t", "subscribe", "-m", "[\"window\"]" ]
+///   running: true
+///
+///   stdout: JsonLinesParser {
+///     onObjectRead: event => console.log(event.change, event.container.name)
+///   }
+/// }
+/// ```
+class JsonLinesParser: public DataStreamParser {
+	Q_OBJECT;
+	/// If true, lines are parsed on a background thread. Defaults to false.
+	///
+	/// Objects are still delivered in order on the main thread. This is useful for streams with
+	/// large or very frequent objects, where parsing would otherwise stall the interface.
+	Q_PROPERTY(bool threaded READ threaded WRITE setThreaded NOTIFY threadedChanged);
+	/// If true, all objects parsed from one read of the stream are delivered together
+	/// through @@objectsRead(s) instead of one at a time through @@objectRead(s). Defaults to false.
+	///
+	/// Batching reduces the cost of signal handlers for streams which write many lines at once.
+	Q_PROPERTY(bool batched READ batched WRITE setBatched NOTIFY batchedChanged);
+	QML_ELEMENT;
+
+public:
+	explicit JsonLinesParser(QObject* parent = nullptr): DataStreamParser(parent) {}
+	~JsonLinesParser() override;
+	Q_DISABLE_COPY_MOVE(JsonLinesParser);
+
+	void parseBytes(QByteArray& incoming, QByteArray& buffer) override;
+	void streamEnded(QByteArray& buffer) override;
+
+	[[nodiscard]] bool threaded() const { return this->mThreaded; }
+	void setThreaded(bool threaded);
+
+	[[nodiscard]] bool batched() const { return this->mBatched; }
+	void setBatched(bool batched);
+
+	// Parses each non empty line of data. Lines after a cancellation are skipped.
+	static QList<JsonLine>
+	parseLines(QByteArrayView data, const QAtomicInteger<bool>& shouldCancel = false);
+
+signals:
+	/// Emitted for each object or array read from the stream, unless @@batched is true.
+	void objectRead(QVariant object);
+	/// Emitted with every object or array parsed from one read of the stream if @@batched is true.
+	void objectsRead(QVariantList objects);
+	/// Emitted when a line of the stream is not valid JSON.
+	void parseFailed(QString line, QString error);
+	void threadedChanged();
+	void batchedChanged();
+
+private slots:
+	void onOperationDone(const QList<JsonLine>& lines);
+
+private:
+	void parseComplete(QByteArray data);
+	void startOperation();
+	void emitLines(const QList<JsonLine>& lines);
+
+	bool mThreaded = false;
+	bool mBatched = false;
+	JsonLinesOperation* liveOperation = nullptr;
+	// Complete lines waiting for the live operation to finish.
+	QByteArray pendingData;
 };
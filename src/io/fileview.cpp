@@ -1,4 +1,5 @@
 #include "fileview.hpp"
+#include <algorithm>
 #include <array>
 #include <utility>
 
@@ -6,19 +7,26 @@
 #include <qdir.h>
 #include <qfiledevice.h>
 #include <qfileinfo.h>
-#include <qfilesystemwatcher.h>
+#include <qlist.h>
 #include <qlogging.h>
 #include <qloggingcategory.h>
 #include <qmutex.h>
 #include <qnamespace.h>
 #include <qobject.h>
 #include <qobjectdefs.h>
+#include <qpointer.h>
 #include <qqmlinfo.h>
 #include <qsavefile.h>
 #include <qscopedpointer.h>
+#include <qset.h>
+#include <qsharedpointer.h>
+#include <qstringlist.h>
 #include <qthreadpool.h>
+#include <qtimer.h>
 #include <qtmetamacros.h>
 #include <qtypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "../core/logcat.hpp"
 #include "../core/util.hpp"
@@ -27,8 +35,20 @@ namespace qs::io {
 
 namespace {
 QS_LOGGING_CATEGORY(logFileView, "quickshell.io.fileview", QtWarningMsg);
+
+// Every live FileView, to flush delayed writes before a reload.
+QSet<FileView*>& fileViews() {
+	static auto* views = new QSet<FileView*>(); // NOLINT
+	return *views;
 }
 
+// Read granularity for tail reads past the size reported by stat.
+constexpr qint64 TAIL_READ_SIZE = 4096;
+
+// Smaller files are cheaper to copy than to map, matching glibc's default mmap threshold.
+constexpr qint64 MAP_MIN_SIZE = 128 * 1024;
+} // namespace
+
 QString FileViewError::toString(FileViewError::Enum value) {
 	switch (value) {
 	case Success: return "Success";
@@ -40,6 +60,31 @@ QString FileViewError::toString(FileViewError::Enum value) {
 	}
 }
 
+FileViewMapping::~FileViewMapping() { munmap(this->data, static_cast<size_t>(this->size)); }
+
+QSharedPointer<FileViewMapping> FileViewMapping::map(QFile& file) {
+	auto size = file.size();
+	auto* data = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, file.handle(), 0);
+
+	if (data == MAP_FAILED) { // NOLINT
+		qCDebug(logFileView) << "Could not map" << file.fileName() << "falling back to read()";
+		return nullptr;
+	}
+
+	// Start paging the file in on the reader thread instead of on first access.
+	posix_madvise(data, static_cast<size_t>(size), POSIX_MADV_WILLNEED);
+
+	return QSharedPointer<FileViewMapping>(new FileViewMapping(data, size));
+}
+
+QByteArray FileViewMapping::bytes() const {
+	return QByteArray::fromRawData(static_cast<const char*>(this->data), this->size);
+}
+
+FileViewData::FileViewData(QSharedPointer<FileViewMapping> mapping)
+    : data(mapping->bytes())
+    , mapping(std::move(mapping)) {}
+
 bool FileViewData::operator==(const FileViewData& other) const {
 	if (this->data == other.data && !this->data.isEmpty()) return true;
 	if (this->text == other.text && !this->text.isEmpty()) return true;
@@ -48,6 +93,14 @@ bool FileViewData::operator==(const FileViewData& other) const {
 
 bool FileViewData::isEmpty() const { return this->data.isEmpty() && this->text.isEmpty(); }
 
+bool FileViewData::isMapped() const { return this->mapping != nullptr; }
+
+void FileViewData::unmap() {
+	if (!this->mapping) return;
+	this->data = QByteArray(this->data.constData(), this->data.size());
+	this->mapping.reset();
+}
+
 FileViewData::operator const QString&() const {
 	if (this->text.isEmpty() && !this->data.isEmpty()) {
 		this->text = QString::fromUtf8(this->data);
@@ -149,7 +202,16 @@ void FileViewReader::read(
 
 	if (shouldCancel.loadAcquire()) return;
 
-	if (file.size() != 0) {
+	auto mapping = QSharedPointer<FileViewMapping>();
+	if (state.memoryMap && !state.tail && file.size() >= MAP_MIN_SIZE) {
+		mapping = FileViewMapping::map(file);
+	}
+
+	if (state.tail) {
+		if (!FileViewReader::readTail(view, state, file, shouldCancel)) return;
+	} else if (mapping) {
+		state.data = FileViewData(std::move(mapping));
+	} else if (file.size() != 0) {
 		auto data = QByteArray(file.size(), Qt::Uninitialized);
 		qint64 i = 0;
 
@@ -202,6 +264,69 @@ void FileViewReader::read(
 	}
 }
 
+bool FileViewReader::readTail(
+    FileView* view,
+    FileViewState& state,
+    QFile& file,
+    const QAtomicInteger<bool>& shouldCancel
+) {
+	struct stat info {};
+	if (fstat(file.handle(), &info) != 0) {
+		qmlWarning(view) << "Read of " << state.path << " failed: stat() failed.";
+		state.error = FileViewError::Unknown;
+		return false;
+	}
+
+	auto device = static_cast<quint64>(info.st_dev);
+	auto inode = static_cast<quint64>(info.st_ino);
+	auto size = static_cast<qint64>(info.st_size);
+
+	// A new inode means the file was replaced, and a smaller size means it was truncated.
+	// Zero sized files can't be told apart from truncated ones, so they are always read in full.
+	if (state.offset != 0
+	    && (device != state.device || inode != state.inode || size < state.offset || size == 0))
+	{
+		qCDebug(logFileView) << "Tail of" << state.path << "was truncated or replaced";
+		state.offset = 0;
+		state.rotated = true;
+	}
+
+	state.device = device;
+	state.inode = inode;
+
+	if (state.offset != 0 && !file.seek(state.offset)) {
+		qmlWarning(view) << "Read of " << state.path << " failed: seek() failed.";
+		state.error = FileViewError::Unknown;
+		return false;
+	}
+
+	// The file may still be growing, so read until EOF instead of up to the stat size.
+	auto data = QByteArray(std::max(size - state.offset, TAIL_READ_SIZE), Qt::Uninitialized);
+	qint64 i = 0;
+
+	while (true) {
+		if (shouldCancel.loadAcquire()) return false;
+		if (i == data.length()) data.resize(i + TAIL_READ_SIZE);
+
+		auto r = file.read(data.data() + i, data.length() - i); // NOLINT
+
+		if (r == -1) {
+			qmlWarning(view) << "Read of " << state.path << " failed: read() failed.";
+			state.error = FileViewError::Unknown;
+			return false;
+		} else if (r == 0) {
+			break;
+		}
+
+		i += r;
+	}
+
+	data.resize(i);
+	state.offset += i;
+	state.data = data;
+	return true;
+}
+
 void FileViewWriter::run() {
 	if (!this->shouldCancel.loadAcquire()) {
 		FileViewWriter::write(this->owner, this->state, this->doAtomicWrite, this->shouldCancel);
@@ -291,10 +416,38 @@ void FileViewWriter::write(
 	}
 }
 
+FileView::FileView(QObject* parent): QObject(parent) {
+	this->writeTimer.setSingleShot(true);
+	QObject::connect(&this->writeTimer, &QTimer::timeout, this, &FileView::onWriteTimeout);
+	fileViews().insert(this);
+}
+
 FileView::~FileView() {
+	fileViews().remove(this);
+
 	if (this->mAdapter) {
 		this->mAdapter->setFileView(nullptr);
 	}
+
+	// Delayed writes are written without emitting signals, as the view is being destroyed.
+	if (this->writeTimer.isActive() || this->writeQueued) {
+		if (this->liveWriter()) this->liveOperation->block();
+
+		auto state = FileViewState(this->targetPath);
+		state.data = this->writeData;
+		state.printErrors = this->bPrintErrors;
+		FileViewWriter::write(this, state, this->bAtomicWrites);
+	}
+}
+
+void FileView::flushPendingWrites() {
+	// Handlers of saved() may destroy other views.
+	auto views = QList<QPointer<FileView>>();
+	for (auto* view: fileViews()) views.append(view);
+
+	for (auto& view: views) {
+		if (view) view->flushWrites();
+	}
 }
 
 void FileView::loadAsync(bool doStringConversion) {
@@ -309,12 +462,14 @@ void FileView::loadAsync(bool doStringConversion) {
 		} else {
 			qCDebug(logFileView) << "Starting async load for" << this << "of" << this->targetPath;
 			auto* reader = new FileViewReader(this, doStringConversion);
-			reader->state.path = this->targetPath;
-			reader->state.printErrors = this->bPrintErrors;
+			reader->state = this->readState();
 			QObject::connect(reader, &FileViewOperation::done, this, &FileView::operationFinished);
 			QThreadPool::globalInstance()->start(reader); // takes ownership
 			this->liveOperation = reader;
 		}
+	} else if (this->mTail && this->liveReader()) {
+		// The running read may have already passed the newly appended data.
+		this->tailReadPending = true;
 	}
 }
 
@@ -322,12 +477,22 @@ void FileView::saveAsync() {
 	if (this->targetPath.isEmpty()) {
 		qmlWarning(this) << "Cannot write file, as no path has been specified.";
 		this->writeData = FileViewData();
+	} else if (auto* writer = this->liveWriter()) {
+		// Superseded by the new content, which is written once the running write stops.
+		// Non atomic writes are not canceled, as that would leave the file partially written.
+		qCDebug(logFileView) << "Queueing async save for" << this << "of" << this->targetPath;
+		if (writer->doAtomicWrite) writer->tryCancel();
+		this->writeQueued = true;
 	} else {
 		// cancel will blank the data if waiting
 		auto data = this->writeData;
 
+		this->writeQueued = false;
 		this->cancelAsync();
 
+		// The write truncates the file, which would invalidate a mapping of it.
+		if (!this->bAtomicWrites) this->state.data.unmap();
+
 		qCDebug(logFileView) << "Starting async save for" << this << "of" << this->targetPath;
 		auto* writer = new FileViewWriter(this, this->bAtomicWrites);
 		writer->state.path = this->targetPath;
@@ -347,6 +512,7 @@ void FileView::cancelAsync() {
 		qCDebug(logFileView) << "Disowning async read for" << this;
 		QObject::disconnect(this->liveOperation, nullptr, this, nullptr);
 		this->liveOperation = nullptr;
+		this->tailReadPending = false;
 	} else if (this->liveWriter()) {
 		// We don't want to start a read or write operation in the middle of a write.
 		// This really shouldn't block but it isn't worth fixing for now.
@@ -362,6 +528,13 @@ void FileView::operationFinished() {
 	}
 
 	qCDebug(logFileView) << "Async operation finished for" << this;
+
+	if (this->writeQueued && this->liveWriter()) {
+		this->liveOperation = nullptr;
+		this->saveAsync();
+		return;
+	}
+
 	this->writeData = FileViewData();
 	this->updateState(this->liveOperation->state);
 
@@ -374,14 +547,30 @@ void FileView::operationFinished() {
 	}
 
 	this->liveOperation = nullptr;
+
+	if (this->tailReadPending) {
+		this->tailReadPending = false;
+		this->loadAsync(false);
+	}
 }
 
-void FileView::reload() { this->updatePath(); }
+void FileView::reload() {
+	this->flushWrites();
+	this->updatePath();
+}
 
 bool FileView::waitForJob() {
 	if (this->liveOperation != nullptr) {
 		QObject::disconnect(this->liveOperation, nullptr, this, nullptr);
 		this->liveOperation->block();
+
+		if (this->writeQueued && this->liveWriter()) {
+			// The write was superseded, so write the newest content instead.
+			this->liveOperation = nullptr;
+			this->saveSync();
+			return true;
+		}
+
 		this->writeData = FileViewData();
 		this->updateState(this->liveOperation->state);
 
@@ -394,6 +583,12 @@ bool FileView::waitForJob() {
 		}
 
 		this->liveOperation = nullptr;
+
+		if (this->tailReadPending) {
+			this->tailReadPending = false;
+			this->loadAsync(false);
+		}
+
 		return true;
 	} else return false;
 }
@@ -403,8 +598,7 @@ void FileView::loadSync() {
 		auto state = FileViewState();
 		this->updateState(state);
 	} else if (!this->waitForJob()) {
-		auto state = FileViewState(this->targetPath);
-		state.printErrors = this->bPrintErrors;
+		auto state = this->readState();
 		FileViewReader::read(this, state, false);
 		this->updateState(state);
 
@@ -418,11 +612,16 @@ void FileView::saveSync() {
 		qmlWarning(this) << "Cannot write file, as no path has been specified.";
 		this->writeData = FileViewData();
 	} else {
+		// cancel will blank the data if waiting
+		auto data = this->writeData;
+		this->writeQueued = false;
+
 		// Both reads and writes will be outdated.
 		if (this->liveOperation) this->cancelAsync();
+		if (!this->bAtomicWrites) this->state.data.unmap();
 
 		auto state = FileViewState(this->targetPath);
-		state.data = this->writeData;
+		state.data = std::move(data);
 		state.printErrors = this->bPrintErrors;
 		FileViewWriter::write(this, state, this->bAtomicWrites);
 		this->writeData = FileViewData();
@@ -437,6 +636,10 @@ void FileView::updateState(FileViewState& newState) {
 	DEFINE_DROP_EMIT_IF(newState.path != this->state.path, this, pathChanged);
 	// assume if the path was changed the data also changed
 	auto dataChanged = pathChanged || newState.data != this->state.data;
+	// tail reads replace the data with each new chunk, which may match the last one
+	if (newState.tail) {
+		dataChanged = pathChanged || !newState.data.isEmpty() || !this->state.data.isEmpty();
+	}
 	// DEFINE_DROP_EMIT_IF(newState.exists != this->state.exists, this, existsChanged);
 
 	this->mPrepared = true;
@@ -458,6 +661,36 @@ void FileView::updateState(FileViewState& newState) {
 	);
 
 	if (dataChanged) this->emitDataChanged();
+	if (newState.tail) this->updateTail(newState);
+}
+
+void FileView::updateTail(FileViewState& newState) {
+	this->tailOffset = newState.offset;
+	this->tailDevice = newState.device;
+	this->tailInode = newState.inode;
+
+	if (newState.rotated) {
+		if (this->mParser) this->mParser->streamEnded(this->parserBuffer);
+		this->parserBuffer.clear();
+	}
+
+	QByteArray data = newState.data;
+	if (data.isEmpty()) return;
+
+	if (this->mParser) this->mParser->parseBytes(data, this->parserBuffer);
+	else this->parserBuffer.append(data);
+}
+
+void FileView::resetTail() {
+	if (this->mParser && !this->parserBuffer.isEmpty()) {
+		this->mParser->streamEnded(this->parserBuffer);
+	}
+
+	this->parserBuffer.clear();
+	this->tailOffset = 0;
+	this->tailDevice = 0;
+	this->tailInode = 0;
+	this->tailReadPending = false;
 }
 
 QString FileView::path() const { return this->state.path; }
@@ -466,6 +699,9 @@ void FileView::setPath(const QString& path) {
 	auto p = path.startsWith("file://") ? path.sliced(7) : path;
 	if (p == this->targetPath) return;
 
+	// Delayed writes belong to the old path.
+	this->flushWrites();
+
 	if (this->liveWriter()) {
 		this->waitForJob();
 	} else {
@@ -473,6 +709,7 @@ void FileView::setPath(const QString& path) {
 	}
 
 	this->targetPath = p;
+	if (this->mTail) this->resetTail();
 	this->updatePath();
 }
 
@@ -483,7 +720,8 @@ void FileView::updatePath() {
 		auto state = FileViewState();
 		this->updateState(state);
 	} else if (this->mPreload) {
-		this->loadAsync(true);
+		// Mapped files are only decoded if text() is used.
+		this->loadAsync(!this->bMemoryMap);
 	} else {
 		this->emitDataChanged();
 	}
@@ -492,49 +730,50 @@ void FileView::updatePath() {
 }
 
 void FileView::updateWatchedFiles() {
-	// If inotify events are sent to the watcher after deletion and deleteLater
-	// isn't used, a use after free in the QML engine will occur.
-	// Disconnect signals before nulling the pointer to prevent a race where an
-	// inotify event fires between deleteLater() and actual destruction, causing
-	// onWatchedFileChanged/onWatchedDirectoryChanged to dereference nullptr.
-	if (this->watcher) {
-		this->watcher->disconnect(this);
-		this->watcher->deleteLater();
-		this->watcher = nullptr;
-	}
-
-	if (!this->targetPath.isEmpty() && this->bWatchChanges) {
-		qCDebug(logFileView) << "Creating watcher for" << this << "at" << this->targetPath;
-		this->watcher = new QFileSystemWatcher(this);
-		this->watcher->addPath(this->targetPath);
+	if (this->targetPath.isEmpty() || !this->bWatchChanges) {
+		// The watch may be emitting the change that disabled watching.
+		// Disconnect signals before nulling the pointer so no further changes are delivered
+		// to onWatchedFileChanged/onWatchedDirectoryChanged before destruction.
+		if (this->watcher) {
+			this->watcher->disconnect(this);
+			this->watcher->removeAllPaths();
+			this->watcher->deleteLater();
+			this->watcher = nullptr;
+		}
 
-		auto dirPath = this->targetPath;
-		if (!dirPath.contains("/")) dirPath = "./" % dirPath;
+		return;
+	}
 
-		if (auto lastIndex = dirPath.lastIndexOf('/'); lastIndex != -1) {
-			dirPath = dirPath.sliced(0, lastIndex);
-			this->watcher->addPath(dirPath);
-		}
+	if (!this->watcher) {
+		this->watcher = new FileWatch(this);
 
-		QObject::connect(
-		    this->watcher,
-		    &QFileSystemWatcher::fileChanged,
-		    this,
-		    &FileView::onWatchedFileChanged
-		);
+		QObject::connect(this->watcher, &FileWatch::fileChanged, this, &FileView::onWatchedFileChanged);
 
 		QObject::connect(
 		    this->watcher,
-		    &QFileSystemWatcher::directoryChanged,
+		    &FileWatch::directoryChanged,
 		    this,
 		    &FileView::onWatchedDirectoryChanged
 		);
 	}
+
+	qCDebug(logFileView) << "Watching" << this->targetPath << "for" << this;
+	auto paths = QStringList(this->targetPath);
+
+	auto dirPath = this->targetPath;
+	if (!dirPath.contains("/")) dirPath = "./" % dirPath;
+
+	if (auto lastIndex = dirPath.lastIndexOf('/'); lastIndex != -1) {
+		paths.append(dirPath.sliced(0, lastIndex));
+	}
+
+	// Directories shared with the previous path stay watched.
+	this->watcher->setPaths(paths);
 }
 
 void FileView::onWatchedFileChanged() {
 	if (!this->watcher) return;
-	if (!this->watcher->files().contains(this->targetPath)) {
+	if (!this->watcher->isWatched(this->targetPath)) {
 		this->watcher->addPath(this->targetPath);
 	}
 
@@ -543,7 +782,7 @@ void FileView::onWatchedFileChanged() {
 
 void FileView::onWatchedDirectoryChanged() {
 	if (!this->watcher) return;
-	if (!this->watcher->files().contains(this->targetPath) && QFileInfo(this->targetPath).exists()) {
+	if (!this->watcher->isWatched(this->targetPath) && QFileInfo(this->targetPath).exists()) {
 		// the file was just created
 		this->watcher->addPath(this->targetPath);
 		emit this->fileChanged();
@@ -562,46 +801,100 @@ FileViewWriter* FileView::liveWriter() const {
 	return dynamic_cast<FileViewWriter*>(this->liveOperation);
 }
 
+FileViewState FileView::readState() const {
+	auto state = FileViewState(this->targetPath);
+	state.printErrors = this->bPrintErrors;
+	state.memoryMap = this->bMemoryMap;
+	state.tail = this->mTail;
+	state.offset = this->tailOffset;
+	state.device = this->tailDevice;
+	state.inode = this->tailInode;
+	return state;
+}
+
 const FileViewData& FileView::writeCmpData() const {
 	return this->writeData.isEmpty() ? this->state.data : this->writeData;
 }
 
-QByteArray FileView::data() {
-	auto guard = this->dataChangedEmitter.block();
-
+void FileView::prepareData(bool doStringConversion) {
 	if (!this->mPrepared) {
 		if (this->shouldBlockRead()) this->loadSync();
-		else this->loadAsync(false);
+		else this->loadAsync(doStringConversion);
 	}
+}
+
+QByteArray FileView::data() {
+	auto guard = this->dataChangedEmitter.block();
+	this->prepareData(false);
 
+	// The returned array may outlive the mapping.
+	this->state.data.unmap();
+	return this->state.data;
+}
+
+QByteArray FileView::adapterData() {
+	auto guard = this->dataChangedEmitter.block();
+	this->prepareData(false);
 	return this->state.data;
 }
 
 QString FileView::text() {
 	auto guard = this->textChangedEmitter.block();
-
-	if (!this->mPrepared) {
-		if (this->shouldBlockRead()) this->loadSync();
-		else this->loadAsync(true);
-	}
-
+	this->prepareData(true);
 	return this->state.data;
 }
 
 void FileView::setData(const QByteArray& data) {
+	if (this->mTail) {
+		qmlWarning(this) << "Cannot write file while tail is enabled.";
+		return;
+	}
+
 	if (this->writeCmpData().operator const QByteArray&() == data) return;
 	this->writeData = data;
-
-	if (this->bBlockWrites) this->saveSync();
-	else this->saveAsync();
+	this->queueWrite();
 }
 
 void FileView::setText(const QString& text) {
+	if (this->mTail) {
+		qmlWarning(this) << "Cannot write file while tail is enabled.";
+		return;
+	}
+
 	if (this->writeCmpData().operator const QString&() == text) return;
 	this->writeData = text;
+	this->queueWrite();
+}
 
-	if (this->bBlockWrites) this->saveSync();
-	else this->saveAsync();
+void FileView::queueWrite() {
+	if (this->bBlockWrites) {
+		this->writeTimer.stop();
+		this->saveSync();
+	} else if (this->bWriteDelay > 0) {
+		if (!this->writeTimer.isActive()) {
+			this->writeBurstTimer.start();
+			this->writeTimer.start(this->bWriteDelay);
+		} else {
+			// Restart the delay, without passing maxWriteDelay since the first pending write.
+			auto remaining = this->bMaxWriteDelay - this->writeBurstTimer.elapsed();
+			auto delay = std::clamp<qint64>(remaining, 0, this->bWriteDelay.value());
+			this->writeTimer.start(static_cast<qint32>(delay));
+		}
+	} else {
+		this->saveAsync();
+	}
+}
+
+void FileView::onWriteTimeout() { this->saveAsync(); }
+
+void FileView::flushWrites() {
+	if (this->writeTimer.isActive()) {
+		this->writeTimer.stop();
+		this->saveSync();
+	} else if (this->liveWriter()) {
+		// Also writes queued content.
+		this->waitForJob();
+	}
 }
 
 void FileView::emitDataChanged() {
@@ -615,6 +908,7 @@ DEFINE_MEMBER_GETSET(FileView, isLoadedOrAsync, setLoadedOrAsync);
 DEFINE_MEMBER_GET(FileView, shouldPreload);
 DEFINE_MEMBER_GET(FileView, blockLoading);
 DEFINE_MEMBER_GET(FileView, blockAllReads);
+DEFINE_MEMBER_GET(FileView, tail);
 
 void FileView::setPreload(bool preload) {
 	if (preload != this->mPreload) {
@@ -655,6 +949,23 @@ void FileView::setBlockAllReads(bool blockAllReads) {
 	}
 }
 
+void FileView::setTail(bool tail) {
+	if (tail == this->mTail) return;
+
+	if (this->liveWriter()) {
+		this->waitForJob();
+	} else {
+		this->cancelAsync();
+	}
+
+	this->mTail = tail;
+	this->resetTail();
+	emit this->tailChanged();
+
+	// the meaning of the loaded data changed
+	if (!this->targetPath.isEmpty()) this->updatePath();
+}
+
 FileViewAdapter* FileView::adapter() const { return this->mAdapter; }
 
 void FileView::setAdapter(FileViewAdapter* adapter) {
@@ -687,6 +998,33 @@ void FileView::writeAdapter() {
 
 void FileView::onAdapterDestroyed() { this->mAdapter = nullptr; }
 
+DataStreamParser* FileView::parser() const { return this->mParser; }
+
+void FileView::setParser(DataStreamParser* parser) {
+	if (parser == this->mParser) return;
+
+	if (this->mParser) {
+		QObject::disconnect(this->mParser, nullptr, this, nullptr);
+	}
+
+	this->mParser = parser;
+
+	if (parser) {
+		QObject::connect(parser, &QObject::destroyed, this, &FileView::onParserDestroyed);
+	}
+
+	emit this->parserChanged();
+
+	if (parser && !this->parserBuffer.isEmpty()) {
+		parser->parseBytes(this->parserBuffer, this->parserBuffer);
+	}
+}
+
+void FileView::onParserDestroyed() {
+	this->mParser = nullptr;
+	emit this->parserChanged();
+}
+
 void FileViewAdapter::setFileView(FileView* fileView) {
 	if (fileView == this->mFileView) return;
 
@@ -704,6 +1042,8 @@ void FileViewAdapter::setFileView(FileView* fileView) {
 	}
 }
 
-void FileViewAdapter::onDataChanged() { this->deserializeAdapter(this->mFileView->data()); }
+void FileViewAdapter::onDataChanged() {
+	this->deserializeAdapter(this->mFileView->adapterData());
+}
 
 } // namespace qs::io
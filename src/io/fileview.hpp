@@ -3,8 +3,10 @@
 #include <utility>
 
 #include <qatomic.h>
+#include <qbytearray.h>
 #include <qdebug.h>
-#include <qfilesystemwatcher.h>
+#include <qelapsedtimer.h>
+#include <qfile.h>
 #include <qlogging.h>
 #include <qmutex.h>
 #include <qobject.h>
@@ -13,12 +15,16 @@
 #include <qqmlintegration.h>
 #include <qqmlparserstatus.h>
 #include <qrunnable.h>
+#include <qsharedpointer.h>
 #include <qstringview.h>
 #include <qtclasshelpermacros.h>
+#include <qtimer.h>
 #include <qtmetamacros.h>
 
 #include "../core/doc.hpp"
+#include "../core/filewatch.hpp"
 #include "../core/util.hpp"
+#include "datastream.hpp"
 
 namespace qs::io {
 
@@ -46,20 +52,48 @@ public:
 	Q_INVOKABLE static QString toString(qs::io::FileViewError::Enum value);
 };
 
+// A read only private mapping of a file, unmapped when destroyed.
+class FileViewMapping {
+public:
+	~FileViewMapping();
+	Q_DISABLE_COPY_MOVE(FileViewMapping);
+
+	// Returns null if the file could not be mapped.
+	static QSharedPointer<FileViewMapping> map(QFile& file);
+
+	// References the mapping without copying it. Must not outlive the mapping.
+	[[nodiscard]] QByteArray bytes() const;
+
+private:
+	FileViewMapping(void* data, qsizetype size): data(data), size(size) {}
+
+	void* data;
+	qsizetype size;
+};
+
 struct FileViewData {
 	FileViewData() = default;
 	FileViewData(QString text): text(std::move(text)) {}
 	FileViewData(QByteArray data): data(std::move(data)) {}
+	// The mapping is kept alive for as long as the data or one of its copies exists.
+	FileViewData(QSharedPointer<FileViewMapping> mapping);
 
 	[[nodiscard]] bool operator==(const FileViewData& other) const;
 	[[nodiscard]] bool isEmpty() const;
+	[[nodiscard]] bool isMapped() const;
+
+	// Copies mapped data into memory owned by the data and releases the mapping.
+	// Byte arrays returned before unmapping still reference the mapping.
+	void unmap();
 
 	operator const QString&() const;
+	// May reference a mapping. Copies must not outlive the data unless unmapped.
 	operator const QByteArray&() const;
 
 private:
 	mutable QString text;
 	mutable QByteArray data;
+	QSharedPointer<FileViewMapping> mapping;
 };
 
 struct FileViewState {
@@ -70,7 +104,17 @@ struct FileViewState {
 	FileViewData data;
 	bool exists = false;
 	bool printErrors = true;
+	bool memoryMap = false;
 	FileViewError::Enum error = FileViewError::Success;
+
+	// Tail reads only read data past offset, and identify the file they started on
+	// by its device and inode. On completion data holds just the newly read bytes.
+	bool tail = false;
+	qint64 offset = 0;
+	quint64 device = 0;
+	quint64 inode = 0;
+	// Set by a tail read if the file was truncated or replaced and read from the start.
+	bool rotated = false;
 };
 
 class FileView;
@@ -121,6 +165,14 @@ public:
 	);
 
 	bool doStringConversion;
+
+private:
+	static bool readTail(
+	    FileView* view,
+	    FileViewState& state,
+	    QFile& file,
+	    const QAtomicInteger<bool>& shouldCancel
+	);
 };
 
 class FileViewWriter: public FileViewOperation {
@@ -205,9 +257,34 @@ class FileView: public QObject {
 	/// > [!NOTE] This works by creating another file with the desired content, and renaming
 	/// > it over the existing file if successful.
 	Q_PROPERTY(bool atomicWrites READ default WRITE default NOTIFY blockWritesChanged BINDABLE bindableAtomicWrites);
+	/// If above 0 (default 0), writes from @@setText(), @@setData() and @@writeAdapter() are delayed
+	/// until no other write has been requested for this many milliseconds, and only the newest content
+	/// is written. This is useful for files written in quick succession, such as a settings file
+	/// bound to a slider through a @@JsonAdapter.
+	///
+	/// A write started while another is running replaces it if @@atomicWrites is true,
+	/// or waits for it to finish otherwise.
+	///
+	/// Delayed writes are written immediately when @@path changes, @@reload() is called,
+	/// the shell is reloaded, or the FileView is destroyed.
+	Q_PROPERTY(qint32 writeDelay READ default WRITE default NOTIFY writeDelayChanged BINDABLE bindableWriteDelay);
+	/// The longest time in milliseconds a write may be delayed by @@writeDelay while more writes
+	/// keep being requested. Defaults to 1000.
+	Q_PROPERTY(qint32 maxWriteDelay READ default WRITE default NOTIFY maxWriteDelayChanged BINDABLE bindableMaxWriteDelay);
 	/// If true (default), read or write errors will be printed to the quickshell logs.
 	/// If false, all known errors will not be printed.
 	QSDOC_PROPERTY_OVERRIDE(bool printErrors READ default WRITE default NOTIFY printErrorsChanged);
+	/// If true (default false), large files are memory mapped instead of being copied into memory,
+	/// and text is only decoded from the mapping once @@text() is called. An @@adapter reads
+	/// its data directly from the mapping.
+	///
+	/// This reduces memory usage and load time for files of several megabytes, such as caches.
+	/// Files smaller than 128KiB are always read normally.
+	///
+	/// > [!WARNING] A mapped file must not be truncated while it is loaded, as reading past the new
+	/// > end of the file will crash. Appending to the file or replacing it, as done by @@atomicWrites,
+	/// > is safe. Writes from this FileView with @@atomicWrites disabled are handled automatically.
+	QSDOC_PROPERTY_OVERRIDE(bool memoryMap READ default WRITE default NOTIFY memoryMapChanged);
 	/// If true (defaule false), @@fileChanged() will be called whenever the content of the file
 	/// changes on disk, including when @@setText() or @@setData() are used.
 	///
@@ -228,6 +305,36 @@ class FileView: public QObject {
 	///
 	/// Currently the only adapter is @@JsonAdapter.
 	Q_PROPERTY(FileViewAdapter* adapter READ adapter WRITE setAdapter NOTIFY adapterChanged);
+	/// If true (default false), the file is treated as append-only, such as a log.
+	/// Only bytes added since the last read are read from the file, and @@text() and @@data()
+	/// return just those bytes instead of the whole file. The first read returns the existing
+	/// content of the file.
+	///
+	/// If the file shrinks or is replaced, such as by log rotation, it is read again from the start.
+	/// Files which report a size of zero, such as most files in `/proc`, are read in full each time.
+	///
+	/// Writing to the file is not possible while in tail mode.
+	///
+	/// > [!NOTE] To follow a log line by line, combine tail mode with a @@parser:
+	/// > ```qml
+	/// > FileView {
+	/// >   path: "/var/log/example.log"
+	/// >   tail: true
+	/// >   watchChanges: true
+	/// >   onFileChanged: this.reload()
+	/// >
+	/// >   parser: SplitParser {
+	/// >     onRead: line => console.log(line)
+	/// >   }
+	/// > }
+	/// > ```
+	QSDOC_PROPERTY_OVERRIDE(bool tail READ tail WRITE setTail NOTIFY tailChanged);
+	/// The parser newly read data is streamed into while @@tail is true.
+	///
+	/// Data that does not yet form a complete message, such as the end of an unfinished line,
+	/// is held until more data is appended. Data read while no parser is set is held
+	/// until one is set.
+	Q_PROPERTY(DataStreamParser* parser READ parser WRITE setParser NOTIFY parserChanged);
 
 	QSDOC_HIDE Q_PROPERTY(QString __path READ path WRITE setPath NOTIFY pathChanged);
 	QSDOC_HIDE Q_PROPERTY(QString __text READ text NOTIFY internalTextChanged);
@@ -242,13 +349,15 @@ class FileView: public QObject {
 	QSDOC_HIDE Q_PROPERTY(bool __blockLoading READ blockLoading WRITE setBlockLoading NOTIFY blockLoadingChanged);
 	QSDOC_HIDE Q_PROPERTY(bool __blockAllReads READ blockAllReads WRITE setBlockAllReads NOTIFY blockAllReadsChanged);
 	QSDOC_HIDE Q_PROPERTY(bool __printErrors READ default WRITE default NOTIFY printErrorsChanged BINDABLE bindablePrintErrors);
+	QSDOC_HIDE Q_PROPERTY(bool __tail READ tail WRITE setTail NOTIFY tailChanged);
+	QSDOC_HIDE Q_PROPERTY(bool __memoryMap READ default WRITE default NOTIFY memoryMapChanged BINDABLE bindableMemoryMap);
 	// clang-format on
 	Q_CLASSINFO("DefaultProperty", "adapter");
 	QML_NAMED_ELEMENT(FileViewInternal);
 	QSDOC_NAMED_ELEMENT(FileView);
 
 public:
-	explicit FileView(QObject* parent = nullptr): QObject(parent) {}
+	explicit FileView(QObject* parent = nullptr);
 	~FileView() override;
 	Q_DISABLE_COPY_MOVE(FileView);
 
@@ -299,6 +408,9 @@ public:
 	/// Write the content of the current @@adapter to the selected file.
 	Q_INVOKABLE void writeAdapter();
 
+	// Writes the delayed content of every FileView, blocking until it is written.
+	static void flushPendingWrites();
+
 	[[nodiscard]] QString path() const;
 	void setPath(const QString& path);
 
@@ -326,13 +438,19 @@ public:
 	// Const bindables functions silently do nothing on setValue.
 	[[nodiscard]] QBindable<bool> bindableBlockWrites() { return &this->bBlockWrites; }
 	[[nodiscard]] QBindable<bool> bindableAtomicWrites() { return &this->bAtomicWrites; }
+	[[nodiscard]] QBindable<qint32> bindableWriteDelay() { return &this->bWriteDelay; }
+	[[nodiscard]] QBindable<qint32> bindableMaxWriteDelay() { return &this->bMaxWriteDelay; }
 
 	[[nodiscard]] QBindable<bool> bindablePrintErrors() { return &this->bPrintErrors; }
 	[[nodiscard]] QBindable<bool> bindableWatchChanges() { return &this->bWatchChanges; }
+	[[nodiscard]] QBindable<bool> bindableMemoryMap() { return &this->bMemoryMap; }
 
 	[[nodiscard]] FileViewAdapter* adapter() const;
 	void setAdapter(FileViewAdapter* adapter);
 
+	[[nodiscard]] DataStreamParser* parser() const;
+	void setParser(DataStreamParser* parser);
+
 signals:
 	/// Emitted if the file was loaded successfully.
 	void loaded();
@@ -358,13 +476,20 @@ signals:
 	void blockAllReadsChanged();
 	void blockWritesChanged();
 	void atomicWritesChanged();
+	void writeDelayChanged();
+	void maxWriteDelayChanged();
 	void printErrorsChanged();
 	void watchChangesChanged();
 	void adapterChanged();
+	void tailChanged();
+	void parserChanged();
+	void memoryMapChanged();
 
 private slots:
 	void operationFinished();
 	void onAdapterDestroyed();
+	void onParserDestroyed();
+	void onWriteTimeout();
 
 private:
 	void loadAsync(bool doStringConversion);
@@ -372,13 +497,21 @@ private:
 	void cancelAsync();
 	void loadSync();
 	void saveSync();
+	void queueWrite();
+	void flushWrites();
+	void prepareData(bool doStringConversion);
+	// Data for adapters, which may reference a file mapping and must not be retained.
+	[[nodiscard]] QByteArray adapterData();
 	void updateState(FileViewState& newState);
+	void updateTail(FileViewState& newState);
+	void resetTail();
 	void updatePath();
 	void updateWatchedFiles();
 	void onWatchedFileChanged();
 	void onWatchedDirectoryChanged();
 
 	[[nodiscard]] bool shouldBlockRead() const;
+	[[nodiscard]] FileViewState readState() const;
 	[[nodiscard]] FileViewReader* liveReader() const;
 	[[nodiscard]] FileViewWriter* liveWriter() const;
 	[[nodiscard]] const FileViewData& writeCmpData() const;
@@ -397,9 +530,26 @@ private:
 	bool mLoadedOrAsync = false;
 	bool mBlockLoading = false;
 	bool mBlockAllReads = false;
+	bool mTail = false;
+
+	// Position of the last tail read, and data waiting for the rest of a message.
+	qint64 tailOffset = 0;
+	quint64 tailDevice = 0;
+	quint64 tailInode = 0;
+	QByteArray parserBuffer;
+	// A tail read was requested while one was running, and more data may have been appended.
+	bool tailReadPending = false;
+
+	// writeData is newer than the running write, and is written once it finishes.
+	bool writeQueued = false;
+	QTimer writeTimer;
+	QElapsedTimer writeBurstTimer;
 
 	FileViewAdapter* mAdapter = nullptr;
-	QFileSystemWatcher* watcher = nullptr;
+	DataStreamParser* mParser = nullptr;
+
+	friend class FileViewAdapter;
+	FileWatch* watcher = nullptr;
 
 	GuardedEmitter<&FileView::internalTextChanged> textChangedEmitter;
 	GuardedEmitter<&FileView::internalDataChanged> dataChangedEmitter;
@@ -417,12 +567,16 @@ public:
 	DECLARE_MEMBER_WITH_GET(FileView, shouldPreload, mPreload, preloadChanged);
 	DECLARE_MEMBER_WITH_GET(FileView, blockLoading, mBlockLoading, blockLoadingChanged);
 	DECLARE_MEMBER_WITH_GET(FileView, blockAllReads, mBlockAllReads, blockAllReadsChanged);
+	DECLARE_MEMBER_WITH_GET(FileView, tail, mTail, tailChanged);
 
 	// clang-format off
 	Q_OBJECT_BINDABLE_PROPERTY(FileView, bool, bBlockWrites, &FileView::blockWritesChanged);
 	Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(FileView, bool, bAtomicWrites, true, &FileView::atomicWritesChanged);
+	Q_OBJECT_BINDABLE_PROPERTY(FileView, qint32, bWriteDelay, &FileView::writeDelayChanged);
+	Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(FileView, qint32, bMaxWriteDelay, 1000, &FileView::maxWriteDelayChanged);
 	Q_OBJECT_BINDABLE_PROPERTY_WITH_ARGS(FileView, bool, bPrintErrors, true, &FileView::printErrorsChanged);
 	Q_OBJECT_BINDABLE_PROPERTY(FileView, bool, bWatchChanges, &FileView::watchChangesChanged);
+	Q_OBJECT_BINDABLE_PROPERTY(FileView, bool, bMemoryMap, &FileView::memoryMapChanged);
 	// clang-format on
 
 	QS_BINDING_SUBSCRIBE_METHOD(FileView, bWatchChanges, updateWatchedFiles, onValueChanged);
@@ -430,6 +584,7 @@ public:
 	void setPreload(bool preload);
 	void setBlockLoading(bool blockLoading);
 	void setBlockAllReads(bool blockAllReads);
+	void setTail(bool tail);
 };
 
 /// See @@FileView.adapter.
@@ -0,0 +1,15 @@
+#include "../core/plugin.hpp"
+#include "fileview.hpp"
+
+namespace {
+
+class IoPlugin: public QsEnginePlugin {
+	// Delayed writes must land before the new generation reads the files.
+	void constructGeneration(EngineGeneration& /*unused*/) override { // NOLINT
+		qs::io::FileView::flushPendingWrites();
+	}
+};
+
+QS_REGISTER_PLUGIN(IoPlugin);
+
+} // namespace
@@ -1,12 +1,16 @@
 #include "jsonadapter.hpp"
+#include <utility>
 
 #include <qcontainerfwd.h>
+#include <qhash.h>
 #include <qjsonarray.h>
 #include <qjsondocument.h>
 #include <qjsonobject.h>
 #include <qjsonvalue.h>
 #include <qjsvalue.h>
+#include <qlist.h>
 #include <qmetaobject.h>
+#include <qmetatype.h>
 #include <qnamespace.h>
 #include <qobject.h>
 #include <qobjectdefs.h>
@@ -14,6 +18,7 @@
 #include <qqmlengine.h>
 #include <qqmlinfo.h>
 #include <qqmllist.h>
+#include <qset.h>
 #include <qstringview.h>
 #include <qvariant.h>
 
@@ -38,12 +43,20 @@ void JsonAdapter::deserializeAdapter(const QByteArray& data) {
 		return;
 	}
 
+	this->beginDeserialize();
+	this->deserializeRec(json.object(), this, &JsonAdapter::staticMetaObject);
+	this->endDeserialize();
+}
+
+void JsonAdapter::beginDeserialize() {
 	this->changesBlocked = true;
 	this->oldCreatedObjects = this->createdObjects;
 	this->createdObjects.clear();
+	// Changes are not tracked while deserializing.
+	this->serializedObjects.clear();
+}
 
-	this->deserializeRec(json.object(), this, &JsonAdapter::staticMetaObject);
-
+void JsonAdapter::endDeserialize() {
 	for (auto* object: this->oldCreatedObjects) {
 		delete object; // FIXME: QMetaType::destroy?
 	}
@@ -54,6 +67,18 @@ void JsonAdapter::deserializeAdapter(const QByteArray& data) {
 	this->connectNotifiers();
 }
 
+JsonObject* JsonAdapter::deserializedObject(JsonObject* currentValue, const QMetaType& type) {
+	if (currentValue == nullptr) {
+		currentValue = static_cast<JsonObject*>(type.create());
+		currentValue->setParent(this);
+		this->createdObjects.push_back(currentValue);
+	} else if (this->oldCreatedObjects.removeOne(currentValue)) {
+		this->createdObjects.push_back(currentValue);
+	}
+
+	return currentValue;
+}
+
 void JsonAdapter::connectNotifiers() {
 	auto notifySlot = JsonAdapter::staticMetaObject.indexOfSlot("onPropertyChanged()");
 	this->connectNotifiersRec(notifySlot, this, &JsonAdapter::staticMetaObject);
@@ -62,26 +87,38 @@ void JsonAdapter::connectNotifiers() {
 void JsonAdapter::connectNotifiersRec(int notifySlot, QObject* obj, const QMetaObject* base) {
 	const auto* metaObject = obj->metaObject();
 
+	if (obj != this) {
+		QObject::connect(
+		    obj,
+		    &QObject::destroyed,
+		    this,
+		    &JsonAdapter::onObjectDestroyed,
+		    Qt::UniqueConnection
+		);
+	}
+
 	for (auto i = base->propertyOffset(); i != metaObject->propertyCount(); i++) {
 		const auto prop = metaObject->property(i);
 
 		if (prop.isReadable() && prop.hasNotifySignal()) {
 			QMetaObject::connect(obj, prop.notifySignalIndex(), this, notifySlot, Qt::UniqueConnection);
+			this->connectValueNotifiers(notifySlot, prop.read(obj));
+		}
+	}
+}
 
-			auto val = prop.read(obj);
-			if (val.canView<JsonObject*>()) {
-				auto* pobj = prop.read(obj).view<JsonObject*>();
-				if (pobj) this->connectNotifiersRec(notifySlot, pobj, &JsonObject::staticMetaObject);
-			} else if (val.canConvert<QQmlListProperty<JsonObject>>()) {
-				auto listVal = val.value<QQmlListProperty<JsonObject>>();
+void JsonAdapter::connectValueNotifiers(int notifySlot, const QVariant& value) {
+	if (value.canView<JsonObject*>()) {
+		auto* pobj = value.view<JsonObject*>();
+		if (pobj) this->connectNotifiersRec(notifySlot, pobj, &JsonObject::staticMetaObject);
+	} else if (value.canConvert<QQmlListProperty<JsonObject>>()) {
+		auto listVal = value.value<QQmlListProperty<JsonObject>>();
 
-				auto len = listVal.count(&listVal);
-				for (auto i = 0; i != len; i++) {
-					auto* pobj = listVal.at(&listVal, i);
+		auto len = listVal.count(&listVal);
+		for (auto i = 0; i != len; i++) {
+			auto* pobj = listVal.at(&listVal, i);
 
-					if (pobj) this->connectNotifiersRec(notifySlot, pobj, &JsonObject::staticMetaObject);
-				}
-			}
+			if (pobj) this->connectNotifiersRec(notifySlot, pobj, &JsonObject::staticMetaObject);
 		}
 	}
 }
@@ -89,29 +126,70 @@ void JsonAdapter::connectNotifiersRec(int notifySlot, QObject* obj, const QMetaO
 void JsonAdapter::onPropertyChanged() {
 	if (this->changesBlocked) return;
 
-	this->connectNotifiers();
+	auto* obj = this->sender();
+	this->markDirty(obj);
+
+	// Only the changed property can have added new objects to the tree.
+	auto signalIndex = this->senderSignalIndex();
+	const auto* metaObject = obj->metaObject();
+	const auto* base = obj == this ? &JsonAdapter::staticMetaObject : &JsonObject::staticMetaObject;
+	auto notifySlot = JsonAdapter::staticMetaObject.indexOfSlot("onPropertyChanged()");
+
+	for (auto i = base->propertyOffset(); i != metaObject->propertyCount(); i++) {
+		const auto prop = metaObject->property(i);
+
+		if (prop.notifySignalIndex() == signalIndex && prop.isReadable()) {
+			this->connectValueNotifiers(notifySlot, prop.read(obj));
+		}
+	}
+
 	this->adapterUpdated();
 }
 
+void JsonAdapter::onObjectDestroyed(QObject* object) {
+	this->markDirty(object);
+	this->serializedObjects.remove(object);
+}
+
+void JsonAdapter::markDirty(const QObject* obj) {
+	auto it = this->serializedObjects.find(obj);
+	// Ancestors of dirty objects are already dirty.
+	if (it == this->serializedObjects.end() || it->dirty) return;
+
+	it->dirty = true;
+	for (const auto* parent: std::as_const(it->parents)) this->markDirty(parent);
+}
+
 QByteArray JsonAdapter::serializeAdapter() {
 	return QJsonDocument(this->serializeRec(this, &JsonAdapter::staticMetaObject))
 	    .toJson(QJsonDocument::Indented);
 }
 
-QJsonObject JsonAdapter::serializeRec(const QObject* obj, const QMetaObject* base) const {
+QJsonObject JsonAdapter::serializeRec(const QObject* obj, const QMetaObject* base) {
+	if (auto it = this->serializedObjects.constFind(obj);
+	    it != this->serializedObjects.constEnd() && !it->dirty && !it->hasVar)
+	{
+		return it->json;
+	}
+
 	QJsonObject json;
+	QList<const QObject*> children;
+	auto hasVar = false;
 	const auto* metaObject = obj->metaObject();
 
 	for (auto i = base->propertyOffset(); i != metaObject->propertyCount(); i++) {
 		const auto prop = metaObject->property(i);
 
 		if (prop.isReadable() && prop.hasNotifySignal()) {
+			if (prop.metaType() == QMetaType::fromType<QVariant>()) hasVar = true;
+
 			auto val = prop.read(obj);
 			if (val.canView<JsonObject*>()) {
 				auto* pobj = val.view<JsonObject*>();
 
 				if (pobj) {
 					json.insert(prop.name(), this->serializeRec(pobj, &JsonObject::staticMetaObject));
+					children.append(pobj);
 				} else {
 					json.insert(prop.name(), QJsonValue::Null);
 				}
@@ -125,6 +203,7 @@ QJsonObject JsonAdapter::serializeRec(const QObject* obj, const QMetaObject* bas
 
 					if (pobj) {
 						array.push_back(this->serializeRec(pobj, &JsonObject::staticMetaObject));
+						children.append(pobj);
 					} else {
 						array.push_back(QJsonValue::Null);
 					}
@@ -142,6 +221,30 @@ QJsonObject JsonAdapter::serializeRec(const QObject* obj, const QMetaObject* bas
 		}
 	}
 
+	for (const auto* child: children) {
+		auto& childEntry = this->serializedObjects[child];
+		if (!childEntry.parents.contains(obj)) childEntry.parents.append(obj);
+		hasVar |= childEntry.hasVar;
+	}
+
+	auto& entry = this->serializedObjects[obj];
+
+	// Removed children no longer dirty this object.
+	if (!entry.children.isEmpty()) {
+		auto current = QSet<const QObject*>(children.begin(), children.end());
+
+		for (const auto* child: std::as_const(entry.children)) {
+			if (current.contains(child)) continue;
+
+			auto childIt = this->serializedObjects.find(child);
+			if (childIt != this->serializedObjects.end()) childIt->parents.removeOne(obj);
+		}
+	}
+
+	entry.json = json;
+	entry.children = std::move(children);
+	entry.dirty = false;
+	entry.hasVar = hasVar;
 	return json;
 }
 
@@ -171,16 +274,9 @@ void JsonAdapter::deserializeRec(const QJsonObject& json, QObject* obj, const QM
 					auto* currentValue = prop.read(obj).view<JsonObject*>();
 					auto isNew = currentValue == nullptr;
 
-					if (isNew) {
-						// metaObject->metaType removes the pointer
-						currentValue =
-						    static_cast<JsonObject*>(prop.metaType().metaObject()->metaType().create());
-
-						currentValue->setParent(this);
-						this->createdObjects.push_back(currentValue);
-					} else if (this->oldCreatedObjects.removeOne(currentValue)) {
-						this->createdObjects.push_back(currentValue);
-					}
+					// metaObject->metaType removes the pointer
+					currentValue =
+					    this->deserializedObject(currentValue, prop.metaType().metaObject()->metaType());
 
 					this->deserializeRec(jval.toObject(), currentValue, &JsonObject::staticMetaObject);
 
@@ -210,17 +306,11 @@ void JsonAdapter::deserializeRec(const QJsonObject& json, QObject* obj, const QM
 
 						const auto& jsonValue = array.at(i);
 						if (jsonValue.isObject()) {
-							if (isNew) {
-								// FIXME: should be the type inside the QQmlListProperty but how can we get that?
-								currentValue = static_cast<JsonObject*>(QMetaType::fromType<JsonObject>().create());
-								currentValue->setParent(this);
-								this->createdObjects.push_back(currentValue);
-							} else {
-								currentValue = lp.at(&lp, i);
-								if (this->oldCreatedObjects.removeOne(currentValue)) {
-									this->createdObjects.push_back(currentValue);
-								}
-							}
+							// FIXME: should be the type inside the QQmlListProperty but how can we get that?
+							currentValue = this->deserializedObject(
+							    isNew ? nullptr : lp.at(&lp, i),
+							    QMetaType::fromType<JsonObject>()
+							);
 
 							this->deserializeRec(
 							    jsonValue.toObject(),
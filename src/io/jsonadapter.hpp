@@ -1,15 +1,18 @@
 #pragma once
 
+#include <qhash.h>
 #include <qjsondocument.h>
 #include <qjsonobject.h>
 #include <qjsonvalue.h>
 #include <qjsvalue.h>
 #include <qlist.h>
+#include <qmetatype.h>
 #include <qobjectdefs.h>
 #include <qqmlintegration.h>
 #include <qqmlparserstatus.h>
 #include <qstringview.h>
 #include <qtmetamacros.h>
+#include <qvariant.h>
 
 #include "fileview.hpp"
 
@@ -100,18 +103,44 @@ public:
 	void deserializeAdapter(const QByteArray& data) override;
 	[[nodiscard]] QByteArray serializeAdapter() override;
 
+protected:
+	// Blocks change notifications and tracks which objects deserialization still uses.
+	// Objects created by a previous deserialization and not reused are deleted at the end.
+	void beginDeserialize();
+	void endDeserialize();
+
+	// Returns currentValue if set, otherwise a new object of the given type owned by the adapter.
+	JsonObject* deserializedObject(JsonObject* currentValue, const QMetaType& type);
+
 private slots:
 	void onPropertyChanged();
+	void onObjectDestroyed(QObject* object);
 
 private:
+	// The last serialized state of the adapter or a JsonObject, reused until it
+	// or one of its descendants changes.
+	struct SerializedObject {
+		QJsonObject json;
+		QList<const QObject*> children;
+		// Objects whose serialization includes this one, which are marked dirty with it.
+		QList<const QObject*> parents;
+		bool dirty = false;
+		// var properties can be modified in place without a notification, so objects
+		// containing one in their subtree are always serialized again.
+		bool hasVar = false;
+	};
+
 	void connectNotifiers();
 	void connectNotifiersRec(int notifySlot, QObject* obj, const QMetaObject* base);
+	void connectValueNotifiers(int notifySlot, const QVariant& value);
 	void deserializeRec(const QJsonObject& json, QObject* obj, const QMetaObject* base);
-	[[nodiscard]] QJsonObject serializeRec(const QObject* obj, const QMetaObject* base) const;
+	[[nodiscard]] QJsonObject serializeRec(const QObject* obj, const QMetaObject* base);
+	void markDirty(const QObject* obj);
 
 	bool changesBlocked = false;
 	QList<JsonObject*> createdObjects;
 	QList<JsonObject*> oldCreatedObjects;
+	QHash<const QObject*, SerializedObject> serializedObjects;
 };
 
 } // namespace qs::io
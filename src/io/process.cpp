@@ -241,20 +241,12 @@ void Process::startDetached() {
 		return;
 	}
 
-	auto& cmd = this->mCommand.first();
-	auto args = this->mCommand.sliced(1);
-
-	QProcess process;
-
-	this->setupEnvironment(&process);
-	process.setProgram(cmd);
-	process.setArguments(args);
-
-	process.setStandardInputFile(QProcess::nullDevice());
-	process.setStandardOutputFile(QProcess::nullDevice());
-	process.setStandardErrorFile(QProcess::nullDevice());
+	auto context = qs::io::process::ProcessContext(this->mCommand);
+	context.setEnvironment(this->mEnvironment);
+	context.setClearEnvironment(this->mClearEnvironment);
+	context.setWorkingDirectory(this->mWorkingDirectory);
 
-	process.startDetached();
+	qs::io::process::spawnDetached(context);
 }
 
 void Process::setupEnvironment(QProcess* process) {
@@ -1,19 +1,109 @@
 #include "processcore.hpp"
+#include <csignal>
+#include <thread>
 
+#include <fcntl.h>
+#include <qbytearray.h>
 #include <qcontainerfwd.h>
+#include <qcoreapplication.h>
+#include <qfile.h>
 #include <qhash.h>
+#include <qlist.h>
+#include <qlogging.h>
+#include <qloggingcategory.h>
+#include <qobject.h>
 #include <qprocess.h>
+#include <qsocketnotifier.h>
 #include <qvariant.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#ifdef __FreeBSD__
+#include <sys/param.h>
+#endif
 
 #include "../core/common.hpp"
+#include "../core/logcat.hpp"
+
+// posix_spawn_file_actions_addchdir_np is available from glibc 2.29 and FreeBSD 13.1.
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 29)
+#define QS_SPAWN_ADDCHDIR
+#endif
+#elif defined(__FreeBSD__) && __FreeBSD_version >= 1301000
+#define QS_SPAWN_ADDCHDIR
+#endif
 
 namespace qs::io::process {
 
-void setupProcessEnvironment(
-    QProcess* process,
-    bool clear,
-    const QHash<QString, QVariant>& envChanges
-) {
+namespace {
+QS_LOGGING_CATEGORY(logProcess, "quickshell.io.process", QtWarningMsg);
+
+// Reaps a detached process once it exits, without blocking the event loop.
+void reapOnExit(pid_t pid) {
+#ifdef __linux__
+	auto pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+	auto pidfd = -1;
+#endif
+
+	if (pidfd == -1) {
+		// pidfd_open is not available before linux 5.3, or outside of linux.
+		std::thread([pid]() { waitpid(pid, nullptr, 0); }).detach();
+		return;
+	}
+
+	// Owned by the application so pending reaps are cleaned up on exit. The pidfd is closed
+	// once the notifier is destroyed, so it is never watching a closed or reused fd.
+	auto* notifier = new QSocketNotifier(pidfd, QSocketNotifier::Read, QCoreApplication::instance());
+	QObject::connect(notifier, &QObject::destroyed, notifier, [pidfd]() { close(pidfd); });
+
+	QObject::connect(notifier, &QSocketNotifier::activated, notifier, [=]() {
+		notifier->setEnabled(false);
+		waitpid(pid, nullptr, WNOHANG);
+		notifier->deleteLater();
+	});
+}
+
+// Starts the process with QProcess::startDetached where posix_spawn cannot set it up.
+bool startDetachedFallback(const ProcessContext& context) {
+	auto process = QProcess();
+	setupProcessEnvironment(&process, context.clearEnvironment, context.environment);
+	process.setWorkingDirectory(context.workingDirectory);
+	process.setProgram(context.command.first());
+	process.setArguments(context.command.sliced(1));
+	process.setStandardInputFile(QProcess::nullDevice());
+
+	if (context.unbindStdout) {
+		process.setStandardOutputFile(QProcess::nullDevice());
+		process.setStandardErrorFile(QProcess::nullDevice());
+	}
+
+	if (!process.startDetached()) {
+		qCWarning(logProcess) << "Failed to start process" << context.command << ":"
+		                      << process.errorString();
+		return false;
+	}
+
+	return true;
+}
+
+QList<char*> pointers(QList<QByteArray>& strings) {
+	auto pointers = QList<char*>();
+	pointers.reserve(strings.length() + 1);
+	for (auto& string: strings) pointers.append(string.data());
+	pointers.append(nullptr);
+	return pointers;
+}
+
+} // namespace
+
+QProcessEnvironment processEnvironment(bool clear, const QHash<QString, QVariant>& envChanges) {
 	const auto& sysenv = qs::Common::INITIAL_ENVIRONMENT;
 	auto env = clear ? QProcessEnvironment() : sysenv;
 
@@ -31,7 +121,91 @@ void setupProcessEnvironment(
 		}
 	}
 
-	process->setProcessEnvironment(env);
+	return env;
+}
+
+void setupProcessEnvironment(
+    QProcess* process,
+    bool clear,
+    const QHash<QString, QVariant>& envChanges
+) {
+	process->setProcessEnvironment(processEnvironment(clear, envChanges));
+}
+
+bool spawnDetached(const ProcessContext& context) {
+	if (context.command.isEmpty()) return false;
+
+#ifndef QS_SPAWN_ADDCHDIR
+	if (!context.workingDirectory.isEmpty()) return startDetachedFallback(context);
+#endif
+
+	auto args = QList<QByteArray>();
+	for (const auto& arg: context.command) args.append(QFile::encodeName(arg));
+
+	auto environment = processEnvironment(context.clearEnvironment, context.environment);
+	auto env = QList<QByteArray>();
+	for (const auto& var: environment.toStringList()) env.append(QFile::encodeName(var));
+
+	auto argv = pointers(args);
+	auto envp = pointers(env);
+	auto workingDirectory = QFile::encodeName(context.workingDirectory);
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+	if (context.unbindStdout) {
+		posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+		posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+	}
+
+#ifdef QS_SPAWN_ADDCHDIR
+	if (!workingDirectory.isEmpty()
+	    && posix_spawn_file_actions_addchdir_np(&actions, workingDirectory.constData()) != 0)
+	{
+		posix_spawn_file_actions_destroy(&actions);
+		return startDetachedFallback(context);
+	}
+#endif
+
+	// Don't leak signal state from the shell into the process.
+	posix_spawnattr_t attrs;
+	posix_spawnattr_init(&attrs);
+
+	sigset_t mask;
+	sigemptyset(&mask);
+	posix_spawnattr_setsigmask(&attrs, &mask);
+
+	sigset_t defaults;
+	sigfillset(&defaults);
+	posix_spawnattr_setsigdefault(&attrs, &defaults);
+
+	// Start a new session like QProcess::startDetached, so signals sent to the shell's
+	// terminal or process group don't reach the process.
+	short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+	flags |= POSIX_SPAWN_SETSID;
+#else
+	flags |= POSIX_SPAWN_SETPGROUP;
+	posix_spawnattr_setpgroup(&attrs, 0);
+#endif
+
+	posix_spawnattr_setflags(&attrs, flags);
+
+	pid_t pid = 0;
+	auto result = posix_spawnp(&pid, argv.first(), &actions, &attrs, argv.data(), envp.data());
+
+	posix_spawnattr_destroy(&attrs);
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (result != 0) {
+		qCWarning(logProcess) << "Failed to start process" << context.command << ":"
+		                      << qt_error_string(result);
+		return false;
+	}
+
+	reapOnExit(pid);
+	return true;
 }
 
 } // namespace qs::io::process
@@ -60,10 +60,21 @@ public:
 	bool unbindStdout : 1 = true;
 };
 
+QProcessEnvironment processEnvironment(bool clear, const QHash<QString, QVariant>& envChanges);
+
 void setupProcessEnvironment(
     QProcess* process,
     bool clear,
     const QHash<QString, QVariant>& envChanges
 );
 
+// Starts a process which is not tracked after it starts, with stdin bound to /dev/null.
+//
+// Unlike QProcess::startDetached, which forks the shell, the process is created with
+// posix_spawn, which does not copy the shell's page tables, so starting it does not get
+// slower as the shell's memory use grows. The process is reaped once it exits.
+//
+// Like QProcess::startDetached, the process is started in a new session.
+bool spawnDetached(const ProcessContext& context);
+
 } // namespace qs::io::process
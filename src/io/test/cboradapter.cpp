@@ -0,0 +1,145 @@
+#include "cboradapter.hpp"
+
+#include <qbytearray.h>
+#include <qcborvalue.h>
+#include <qjsondocument.h>
+#include <qjsonobject.h>
+#include <qjsonvalue.h>
+#include <qlist.h>
+#include <qlogging.h>
+#include <qregularexpression.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qtypes.h>
+
+#include "../jsonadapter.hpp"
+
+using namespace qs::io;
+
+namespace {
+
+constexpr qsizetype BENCHMARK_ENTRIES = 5000;
+
+void addEntries(TestState* state, qsizetype count) {
+	for (qsizetype i = 0; i != count; i++) {
+		auto* entry = new TestEntry();
+		entry->setParent(state);
+		entry->text = QStringLiteral("Notification number %1").arg(i);
+		entry->time = 1700000000000 + i * 1000;
+		entry->tags = {"app", "normal"};
+		state->entryList.append(entry);
+	}
+}
+
+TestEntry* entryAt(TestState* state, qsizetype i) {
+	return qobject_cast<TestEntry*>(state->entryList.at(i));
+}
+
+} // namespace
+
+void TestCborAdapter::roundTrip() {
+	auto source = CborTestAdapter();
+	source.state->name = "history";
+	addEntries(source.state, 3);
+	entryAt(source.state, 1)->text = "changed";
+
+	auto data = source.serializeAdapter();
+
+	// existing list members are reused, and ones past the end of the array are removed
+	auto target = CborTestAdapter();
+	addEntries(target.state, 4);
+
+	target.deserializeAdapter(data);
+	QCOMPARE(target.state->name, QStringLiteral("history"));
+	QCOMPARE(target.state->entryList.length(), 3);
+	QCOMPARE(entryAt(target.state, 0)->text, QStringLiteral("Notification number 0"));
+	QCOMPARE(entryAt(target.state, 1)->text, QStringLiteral("changed"));
+	QCOMPARE(entryAt(target.state, 2)->time, qint64(1700000002000));
+	QCOMPARE(entryAt(target.state, 2)->tags, QList<QString>({"app", "normal"}));
+
+	QCOMPARE(target.serializeAdapter(), data);
+}
+
+void TestCborAdapter::jsonCompatible() {
+	auto json = JsonTestAdapter();
+	json.state->name = "history";
+	addEntries(json.state, 10);
+
+	auto cbor = CborTestAdapter();
+	cbor.state->name = "history";
+	addEntries(cbor.state, 10);
+
+	auto jsonData = json.serializeAdapter();
+	auto cborData = cbor.serializeAdapter();
+
+	auto decoded = QCborValue::fromCbor(cborData).toJsonValue().toObject();
+	QVERIFY(decoded == QJsonDocument::fromJson(jsonData).object());
+	QCOMPARE_LT(cborData.length(), jsonData.length());
+}
+
+void TestCborAdapter::invalid() {
+	auto source = CborTestAdapter();
+	source.state->name = "history";
+	addEntries(source.state, 3);
+	auto data = source.serializeAdapter();
+
+	auto target = CborTestAdapter();
+	target.state->name = "unchanged";
+
+	QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Failed to deserialize cbor"));
+	target.deserializeAdapter(data.first(data.length() - 4));
+	QCOMPARE(target.state->name, QStringLiteral("unchanged"));
+	QCOMPARE(target.state->entryList.length(), 0);
+
+	QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Failed to deserialize cbor: not a map"));
+	target.deserializeAdapter(QCborValue(42).toCbor());
+	QCOMPARE(target.state->name, QStringLiteral("unchanged"));
+}
+
+void TestCborAdapter::benchmarkJsonLoad() {
+	auto source = JsonTestAdapter();
+	addEntries(source.state, BENCHMARK_ENTRIES);
+	auto data = source.serializeAdapter();
+
+	auto target = JsonTestAdapter();
+	addEntries(target.state, BENCHMARK_ENTRIES);
+
+	QBENCHMARK { target.deserializeAdapter(data); }
+}
+
+void TestCborAdapter::benchmarkCborLoad() {
+	auto source = CborTestAdapter();
+	addEntries(source.state, BENCHMARK_ENTRIES);
+	auto data = source.serializeAdapter();
+
+	auto target = CborTestAdapter();
+	addEntries(target.state, BENCHMARK_ENTRIES);
+
+	QBENCHMARK { target.deserializeAdapter(data); }
+}
+
+// Loading first keeps JsonAdapter from reusing the previous serialization.
+void TestCborAdapter::benchmarkJsonRoundTrip() {
+	auto adapter = JsonTestAdapter();
+	addEntries(adapter.state, BENCHMARK_ENTRIES);
+	auto data = adapter.serializeAdapter();
+
+	QBENCHMARK {
+		adapter.deserializeAdapter(data);
+		QCOMPARE(adapter.serializeAdapter(), data);
+	}
+}
+
+void TestCborAdapter::benchmarkCborRoundTrip() {
+	auto adapter = CborTestAdapter();
+	addEntries(adapter.state, BENCHMARK_ENTRIES);
+	auto data = adapter.serializeAdapter();
+
+	QBENCHMARK {
+		adapter.deserializeAdapter(data);
+		QCOMPARE(adapter.serializeAdapter(), data);
+	}
+}
+
+QTEST_MAIN(TestCborAdapter);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <qlist.h>
+#include <qobject.h>
+#include <qqmllist.h>
+#include <qtmetamacros.h>
+#include <qtypes.h>
+
+#include "../cboradapter.hpp"
+#include "../jsonadapter.hpp"
+
+class TestEntry: public qs::io::JsonObject {
+	Q_OBJECT;
+	Q_PROPERTY(QString text MEMBER text NOTIFY textChanged);
+	Q_PROPERTY(qint64 time MEMBER time NOTIFY timeChanged);
+	Q_PROPERTY(QList<QString> tags MEMBER tags NOTIFY tagsChanged);
+
+public:
+	QString text;
+	qint64 time = 0;
+	QList<QString> tags;
+
+signals:
+	void textChanged();
+	void timeChanged();
+	void tagsChanged();
+};
+
+class TestState: public qs::io::JsonObject {
+	Q_OBJECT;
+	Q_PROPERTY(QString name MEMBER name NOTIFY nameChanged);
+	Q_PROPERTY(QQmlListProperty<qs::io::JsonObject> entries READ entries NOTIFY entriesChanged);
+
+public:
+	QQmlListProperty<qs::io::JsonObject> entries() { return {this, &this->entryList}; }
+
+	QString name;
+	QList<qs::io::JsonObject*> entryList;
+
+signals:
+	void nameChanged();
+	void entriesChanged();
+};
+
+class JsonTestAdapter: public qs::io::JsonAdapter {
+	Q_OBJECT;
+	Q_PROPERTY(TestState* state MEMBER state NOTIFY stateChanged);
+
+public:
+	JsonTestAdapter() { this->state->setParent(this); }
+
+	TestState* state = new TestState();
+
+signals:
+	void stateChanged();
+};
+
+class CborTestAdapter: public qs::io::CborAdapter {
+	Q_OBJECT;
+	Q_PROPERTY(TestState* state MEMBER state NOTIFY stateChanged);
+
+public:
+	CborTestAdapter() { this->state->setParent(this); }
+
+	TestState* state = new TestState();
+
+signals:
+	void stateChanged();
+};
+
+class TestCborAdapter: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void roundTrip();
+	static void jsonCompatible();
+	static void invalid();
+	static void benchmarkJsonLoad();
+	static void benchmarkCborLoad();
+	static void benchmarkJsonRoundTrip();
+	static void benchmarkCborRoundTrip();
+};
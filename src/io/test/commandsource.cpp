@@ -0,0 +1,159 @@
+#include "commandsource.hpp"
+
+#include <qfile.h>
+#include <qjsonobject.h>
+#include <qlist.h>
+#include <qsignalspy.h>
+#include <qtemporarydir.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../commandsource.hpp"
+
+namespace {
+
+// A command which appends a line to a file every time it runs, then prints the run count.
+QList<QString> countingCommand(const QString& path, const QString& extra = QString()) {
+	return {
+	    "sh",
+	    "-c",
+	    QStringLiteral("%1echo >> '%2'; wc -l < '%2'").arg(extra, path),
+	};
+}
+
+qsizetype runCount(const QString& path) {
+	auto file = QFile(path);
+	if (!file.open(QFile::ReadOnly)) return 0;
+	return file.readAll().count('\n');
+}
+
+} // namespace
+
+void TestCommandSource::startAfterReload() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("runs");
+
+	auto source = CommandSource();
+	auto spy = QSignalSpy(&source, &CommandSource::updated);
+	source.setCommand(countingCommand(path));
+
+	QVERIFY(!source.isRunning());
+	QCOMPARE(runCount(path), 0);
+
+	source.postReload();
+
+	QVERIFY(source.isRunning());
+	QVERIFY(spy.wait(1000));
+	QCOMPARE(source.text().trimmed(), QStringLiteral("1"));
+	QCOMPARE(source.exitCode(), 0);
+}
+
+void TestCommandSource::shared() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("runs");
+
+	auto a = CommandSource();
+	auto b = CommandSource();
+	auto spyA = QSignalSpy(&a, &CommandSource::updated);
+	auto spyB = QSignalSpy(&b, &CommandSource::updated);
+
+	a.setCommand(countingCommand(path));
+	b.setCommand(countingCommand(path));
+	a.postReload();
+	b.postReload();
+	spyA.clear();
+	spyB.clear();
+
+	QVERIFY(spyA.wait(1000));
+	QCOMPARE(spyB.count(), 1);
+	QCOMPARE(runCount(path), 1);
+	QCOMPARE(b.text(), a.text());
+
+	// a different environment is a different command
+	auto c = CommandSource();
+	auto spyC = QSignalSpy(&c, &CommandSource::updated);
+	c.setCommand(countingCommand(path));
+	c.setEnvironment({{"QS_TEST", "1"}});
+	c.postReload();
+
+	QVERIFY(spyC.wait(1000));
+	QCOMPARE(runCount(path), 2);
+}
+
+void TestCommandSource::reuseFresh() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("runs");
+
+	{
+		auto source = CommandSource();
+		auto spy = QSignalSpy(&source, &CommandSource::updated);
+		source.setCommand(countingCommand(path));
+		source.setInterval(10000);
+		source.postReload();
+		QVERIFY(spy.wait(1000));
+	}
+
+	// output younger than the interval is reused after the first source is gone
+	auto source = CommandSource();
+	auto spy = QSignalSpy(&source, &CommandSource::updated);
+	source.setCommand(countingCommand(path));
+	source.setInterval(10000);
+	source.postReload();
+
+	QCOMPARE(spy.count(), 1);
+	// the reused output is available immediately
+	QVERIFY(!source.isRunning());
+	QCOMPARE(source.text().trimmed(), QStringLiteral("1"));
+	QCOMPARE(runCount(path), 1);
+
+	// but not if it is older than a new source accepts
+	auto fast = CommandSource();
+	auto fastSpy = QSignalSpy(&fast, &CommandSource::updated);
+	fast.setCommand(countingCommand(path));
+	fast.setInterval(1);
+	QTest::qWait(5);
+	fast.postReload();
+
+	QVERIFY(fast.isRunning());
+	QVERIFY(fastSpy.wait(1000));
+	QCOMPARE(runCount(path), 2);
+}
+
+void TestCommandSource::inFlight() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("runs");
+
+	auto source = CommandSource();
+	auto spy = QSignalSpy(&source, &CommandSource::updated);
+	source.setCommand(countingCommand(path, "sleep 0.2; "));
+	source.setInterval(10);
+	source.postReload();
+	spy.clear();
+
+	QVERIFY(source.isRunning());
+	source.refresh();
+	source.refresh();
+
+	QVERIFY(spy.wait(1000));
+	QCOMPARE(spy.count(), 1);
+	QCOMPARE(runCount(path), 1);
+
+	source.setEnabled(false);
+	QVERIFY(!source.isRunning());
+}
+
+void TestCommandSource::json() {
+	auto source = CommandSource();
+	auto spy = QSignalSpy(&source, &CommandSource::updated);
+	source.setCommand({"echo", R"({"a": 1})"});
+	source.postReload();
+
+	QVERIFY(spy.wait(1000));
+	QCOMPARE(source.json().toJsonObject().value("a").toInt(), 1);
+
+	source.setCommand({"echo", "not json"});
+	QVERIFY(spy.wait(1000));
+	QVERIFY(!source.json().isValid());
+}
+
+QTEST_MAIN(TestCommandSource);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtmetamacros.h>
+
+class TestCommandSource: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void startAfterReload();
+	static void shared();
+	static void reuseFresh();
+	static void inFlight();
+	static void json();
+};
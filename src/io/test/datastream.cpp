@@ -1,4 +1,5 @@
 #include "datastream.hpp"
+#include <algorithm>
 
 #include <qbytearray.h>
 #include <qlist.h>
@@ -7,9 +8,16 @@
 #include <qsignalspy.h>
 #include <qtest.h>
 #include <qtestcase.h>
+#include <qtypes.h>
 
 #include "../datastream.hpp"
 
+namespace {
+
+constexpr qsizetype BENCHMARK_CHUNK_SIZE = 64 * 1024;
+
+} // namespace
+
 void TestSplitParser::splits_data() { // NOLINT
 	QTest::addColumn<QString>("mark");
 	QTest::addColumn<QString>("buffer");   // max that can go in the buffer
@@ -38,6 +46,10 @@ void TestSplitParser::splits_data() { // NOLINT
 	QTest::addRow("longsplit-incomplete") << "123"
 		<< "foo12" << "3bar123baz"
 		<< QList<QString>({ "foo", "bar" }) << "baz";
+
+	QTest::addRow("longsplit-overlap") << "--"
+		<< "a-" << "--b---c"
+		<< QList<QString>({ "a", "-b" }) << "-c";
 	// clang-format on
 	// NOLINTEND
 }
@@ -103,4 +115,72 @@ void TestSplitParser::initBuffer() { // NOLINT
 	QCOMPARE(buf, "baz");
 }
 
+void TestSplitParser::batched() {
+	auto parser = SplitParser();
+	auto readSpy = QSignalSpy(&parser, &DataStreamParser::read);
+	auto batchSpy = QSignalSpy(&parser, &SplitParser::readBatch);
+
+	parser.setBatched(true);
+
+	auto buffer = QByteArray();
+	auto incoming = QByteArray("foo\nbar\nba");
+	parser.parseBytes(incoming, buffer);
+
+	incoming = "z\n";
+	parser.parseBytes(incoming, buffer);
+
+	incoming = "end";
+	parser.parseBytes(incoming, buffer);
+	parser.streamEnded(buffer);
+
+	QCOMPARE(readSpy.length(), 0);
+	QCOMPARE(batchSpy.length(), 3);
+	QCOMPARE(batchSpy.at(0).at(0).value<QList<QString>>(), QList<QString>({"foo", "bar"}));
+	QCOMPARE(batchSpy.at(1).at(0).value<QList<QString>>(), QList<QString>({"baz"}));
+	QCOMPARE(batchSpy.at(2).at(0).value<QList<QString>>(), QList<QString>({"end"}));
+}
+
+void TestSplitParser::benchmark_data() { // NOLINT
+	QTest::addColumn<QString>("mark");
+	QTest::addColumn<bool>("batched");
+
+	QTest::addRow("newline") << "\n" << false;
+	QTest::addRow("newline-batched") << "\n" << true;
+	QTest::addRow("crlf") << "\r\n" << false;
+}
+
+void TestSplitParser::benchmark() { // NOLINT
+	// NOLINTBEGIN
+	QFETCH(QString, mark);
+	QFETCH(bool, batched);
+	// NOLINTEND
+
+	// About 4MiB of journal like lines, read in 64KiB chunks like a pipe.
+	auto line = QByteArray("Oct 18 12:00:00 host service[1234]: a log message of typical length ");
+	line.append(mark.toUtf8());
+	auto data = line.repeated(4 * 1024 * 1024 / line.length());
+
+	auto parser = SplitParser();
+	parser.setSplitMarker(mark);
+	parser.setBatched(batched);
+
+	qsizetype records = 0;
+	QObject::connect(&parser, &DataStreamParser::read, [&]() { records++; });
+	QObject::connect(&parser, &SplitParser::readBatch, [&](const QList<QString>& batch) {
+		records += batch.length();
+	});
+
+	QBENCHMARK {
+		records = 0;
+		auto buffer = QByteArray();
+
+		for (qsizetype i = 0; i < data.length(); i += BENCHMARK_CHUNK_SIZE) {
+			auto incoming = data.sliced(i, std::min(BENCHMARK_CHUNK_SIZE, data.length() - i));
+			parser.parseBytes(incoming, buffer);
+		}
+
+		QCOMPARE(records, data.length() / line.length());
+	}
+}
+
 QTEST_MAIN(TestSplitParser);
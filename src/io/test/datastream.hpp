@@ -10,4 +10,7 @@ private slots:
 	void splits_data(); // NOLINT
 	void splits();
 	void initBuffer();
+	static void batched();
+	void benchmark_data(); // NOLINT
+	void benchmark();
 };
@@ -0,0 +1,184 @@
+#include "fileview.hpp"
+
+#include <qbytearray.h>
+#include <qfile.h>
+#include <qlist.h>
+#include <qsignalspy.h>
+#include <qtemporarydir.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qtypes.h>
+
+#include "../datastream.hpp"
+#include "../fileview.hpp"
+
+using namespace qs::io;
+
+namespace {
+
+void writeFile(const QString& path, const QByteArray& data, bool append = false) {
+	auto file = QFile(path);
+	QVERIFY(file.open(append ? QFile::Append : QFile::WriteOnly));
+	QCOMPARE(file.write(data), data.length());
+}
+
+QByteArray readTail(FileViewState& state) {
+	state.data = FileViewData();
+	state.rotated = false;
+	FileViewReader::read(nullptr, state, false);
+	return state.data;
+}
+
+} // namespace
+
+void TestFileView::tailRead() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("log");
+	writeFile(path, "foo\n");
+
+	auto state = FileViewState(path);
+	state.tail = true;
+
+	QCOMPARE(readTail(state), QByteArray("foo\n"));
+	QCOMPARE(state.offset, qint64(4));
+	QVERIFY(!state.rotated);
+
+	writeFile(path, "bar\nbaz", true);
+	QCOMPARE(readTail(state), QByteArray("bar\nbaz"));
+	QCOMPARE(state.offset, qint64(11));
+
+	QCOMPARE(readTail(state), QByteArray(""));
+	QCOMPARE(state.offset, qint64(11));
+	QVERIFY(!state.rotated);
+
+	// truncated
+	writeFile(path, "x");
+	QCOMPARE(readTail(state), QByteArray("x"));
+	QCOMPARE(state.offset, qint64(1));
+	QVERIFY(state.rotated);
+}
+
+void TestFileView::tailRotation() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("log");
+	writeFile(path, "old\n");
+
+	auto state = FileViewState(path);
+	state.tail = true;
+	QCOMPARE(readTail(state), QByteArray("old\n"));
+
+	// replaced by a longer file, which a size check alone would miss
+	QVERIFY(QFile::rename(path, dir.filePath("log.1")));
+	writeFile(path, "newer\n");
+
+	QCOMPARE(readTail(state), QByteArray("newer\n"));
+	QCOMPARE(state.offset, qint64(6));
+	QVERIFY(state.rotated);
+
+	QVERIFY(QFile::remove(path));
+	QCOMPARE(readTail(state), QByteArray(""));
+	QCOMPARE(state.error, FileViewError::FileNotFound);
+}
+
+void TestFileView::tailParser() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("log");
+	writeFile(path, "one\ntw");
+
+	auto view = FileView();
+	auto parser = SplitParser();
+	auto spy = QSignalSpy(&parser, &SplitParser::read);
+
+	view.setPreload(false);
+	view.setBlockAllReads(true);
+	view.setTail(true);
+	view.setParser(&parser);
+	view.setPath(path);
+
+	QCOMPARE(view.data(), QByteArray("one\ntw"));
+	QCOMPARE(spy.count(), 1);
+	QCOMPARE(spy.at(0).at(0).toString(), QString("one"));
+
+	writeFile(path, "o\nthree\n", true);
+	view.reload();
+
+	QCOMPARE(view.data(), QByteArray("o\nthree\n"));
+	QCOMPARE(spy.count(), 3);
+	QCOMPARE(spy.at(1).at(0).toString(), QString("two"));
+	QCOMPARE(spy.at(2).at(0).toString(), QString("three"));
+
+	// writes would desync the offset
+	view.setText("four\n");
+	QCOMPARE(QFile(path).size(), qint64(14));
+}
+
+void TestFileView::mapped() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("cache.json");
+	auto content = QByteArray(256 * 1024, 'a');
+	writeFile(path, content);
+
+	auto state = FileViewState(path);
+	state.memoryMap = true;
+	FileViewReader::read(nullptr, state, false);
+
+	QVERIFY(state.data.isMapped());
+	QCOMPARE(state.data.operator const QByteArray&(), content);
+	QCOMPARE(state.data.operator const QString&(), QString(content));
+
+	auto copy = state.data;
+	state.data.unmap();
+	QVERIFY(!state.data.isMapped());
+	QVERIFY(copy.isMapped());
+	QCOMPARE(state.data.operator const QByteArray&(), content);
+
+	// small files are copied
+	auto smallPath = dir.filePath("small.json");
+	writeFile(smallPath, "{}");
+	auto small = FileViewState(smallPath);
+	small.memoryMap = true;
+	FileViewReader::read(nullptr, small, false);
+	QVERIFY(!small.data.isMapped());
+	QCOMPARE(small.data.operator const QByteArray&(), QByteArray("{}"));
+}
+
+void TestFileView::delayedWrites() {
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("settings.json");
+
+	auto readFile = [&]() {
+		auto file = QFile(path);
+		if (!file.open(QFile::ReadOnly)) return QByteArray();
+		return file.readAll();
+	};
+
+	{
+		auto view = FileView();
+		auto spy = QSignalSpy(&view, &FileView::saved);
+		view.setPreload(false);
+		view.setPath(path);
+		view.bindableWriteDelay().setValue(50);
+
+		// only the newest content is written
+		view.setText("a");
+		view.setText("b");
+		view.setText("c");
+		QCOMPARE(readFile(), QByteArray());
+
+		QVERIFY(spy.wait(1000));
+		QCOMPARE(spy.count(), 1);
+		QCOMPARE(readFile(), QByteArray("c"));
+
+		view.setText("d");
+		FileView::flushPendingWrites();
+		QCOMPARE(readFile(), QByteArray("d"));
+		QCOMPARE(spy.count(), 2);
+
+		view.setText("e");
+	}
+
+	// written on destruction
+	QCOMPARE(readFile(), QByteArray("e"));
+}
+
+QTEST_MAIN(TestFileView);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtmetamacros.h>
+
+class TestFileView: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void tailRead();
+	static void tailRotation();
+	static void tailParser();
+	static void mapped();
+	static void delayedWrites();
+};
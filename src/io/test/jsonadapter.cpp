@@ -0,0 +1,183 @@
+#include "jsonadapter.hpp"
+
+#include <qjsengine.h>
+#include <qjsonarray.h>
+#include <qjsondocument.h>
+#include <qjsonobject.h>
+#include <qjsvalue.h>
+#include <qobject.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qtypes.h>
+#include <qvariant.h>
+
+namespace {
+
+constexpr qsizetype BENCHMARK_ENTRIES = 5000;
+
+QJsonObject serialize(TestNodeAdapter& adapter) {
+	return QJsonDocument::fromJson(adapter.serializeAdapter()).object();
+}
+
+TestNode* addItem(TestNode* node, const QString& text) {
+	auto* item = new TestNode();
+	item->setParent(node);
+	item->text = text;
+	node->itemList.append(item);
+	return item;
+}
+
+} // namespace
+
+void TestJsonAdapter::cacheReuse() {
+	auto adapter = TestNodeAdapter();
+	adapter.root->text = "root";
+	adapter.other->text = "other";
+	adapter.componentComplete();
+
+	auto json = serialize(adapter);
+	QCOMPARE(json.value("root").toObject().value("text").toString(), "root");
+
+	// changes without a notification are only visible if the object is serialized again
+	adapter.root->text = "silent";
+	adapter.other->text = "changed";
+	emit adapter.other->textChanged();
+
+	json = serialize(adapter);
+	QCOMPARE(json.value("root").toObject().value("text").toString(), "root");
+	QCOMPARE(json.value("other").toObject().value("text").toString(), "changed");
+
+	emit adapter.root->textChanged();
+	json = serialize(adapter);
+	QCOMPARE(json.value("root").toObject().value("text").toString(), "silent");
+}
+
+void TestJsonAdapter::nestedChange() {
+	auto adapter = TestNodeAdapter();
+	auto* child = new TestNode();
+	child->setParent(adapter.root);
+	adapter.root->child = child;
+	auto* item = addItem(child, "a");
+	adapter.componentComplete();
+
+	auto json = serialize(adapter);
+	auto itemJson = [&]() {
+		return json.value("root")
+		    .toObject()
+		    .value("child")
+		    .toObject()
+		    .value("items")
+		    .toArray()
+		    .at(0)
+		    .toObject();
+	};
+
+	QCOMPARE(itemJson().value("text").toString(), "a");
+
+	item->text = "b";
+	emit item->textChanged();
+	json = serialize(adapter);
+	QCOMPARE(itemJson().value("text").toString(), "b");
+
+	// a replaced subtree is serialized, and changes to it are tracked
+	auto* newChild = new TestNode();
+	newChild->setParent(adapter.root);
+	adapter.root->child = newChild;
+	auto* newItem = addItem(newChild, "c");
+	emit adapter.root->childChanged();
+
+	json = serialize(adapter);
+	QCOMPARE(itemJson().value("text").toString(), "c");
+
+	newItem->text = "d";
+	emit newItem->textChanged();
+	json = serialize(adapter);
+	QCOMPARE(itemJson().value("text").toString(), "d");
+}
+
+void TestJsonAdapter::listMembership() {
+	auto adapter = TestNodeAdapter();
+	addItem(adapter.root, "a");
+	adapter.componentComplete();
+
+	auto items = [&]() {
+		return serialize(adapter).value("root").toObject().value("items").toArray();
+	};
+
+	QCOMPARE(items().count(), 1);
+
+	auto* added = addItem(adapter.root, "b");
+	emit adapter.root->itemsChanged();
+	QCOMPARE(items().count(), 2);
+	QCOMPARE(items().at(1).toObject().value("text").toString(), "b");
+
+	added->text = "c";
+	emit added->textChanged();
+	QCOMPARE(items().at(1).toObject().value("text").toString(), "c");
+
+	adapter.root->itemList.removeOne(added);
+	emit adapter.root->itemsChanged();
+	QCOMPARE(items().count(), 1);
+
+	// destroyed objects drop their cached state
+	delete added;
+	QCOMPARE(items().count(), 1);
+	QCOMPARE(items().at(0).toObject().value("text").toString(), "a");
+}
+
+void TestJsonAdapter::varMutation() {
+	auto engine = QJSEngine();
+	auto value = engine.newObject();
+	value.setProperty("a", "b");
+
+	auto adapter = TestNodeAdapter();
+	adapter.varNode->data = QVariant::fromValue(value);
+	adapter.componentComplete();
+
+	auto data = [&]() { return serialize(adapter).value("varNode").toObject().value("data"); };
+	QCOMPARE(data().toObject().value("a").toString(), "b");
+
+	// var contents can be modified in place without a notification
+	value.setProperty("a", "c");
+	QCOMPARE(data().toObject().value("a").toString(), "c");
+}
+
+void TestJsonAdapter::benchmarkSerializeChange() {
+	auto adapter = TestNodeAdapter();
+	for (qsizetype i = 0; i != BENCHMARK_ENTRIES; i++) {
+		addItem(adapter.root, QStringLiteral("Entry number %1").arg(i));
+	}
+
+	adapter.componentComplete();
+	adapter.serializeAdapter();
+
+	// only the changed entry and its ancestors are serialized again
+	auto* item = qobject_cast<TestNode*>(adapter.root->itemList.at(BENCHMARK_ENTRIES / 2));
+
+	QBENCHMARK {
+		item->text += 'a';
+		emit item->textChanged();
+		adapter.serializeAdapter();
+	}
+}
+
+void TestJsonAdapter::benchmarkSerializeAll() {
+	auto adapter = TestNodeAdapter();
+	for (qsizetype i = 0; i != BENCHMARK_ENTRIES; i++) {
+		addItem(adapter.root, QStringLiteral("Entry number %1").arg(i));
+	}
+
+	adapter.componentComplete();
+	adapter.serializeAdapter();
+
+	QBENCHMARK {
+		for (auto* item: adapter.root->itemList) {
+			emit qobject_cast<TestNode*>(item)->textChanged();
+		}
+
+		adapter.serializeAdapter();
+	}
+}
+
+QTEST_MAIN(TestJsonAdapter);
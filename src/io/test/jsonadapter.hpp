@@ -0,0 +1,75 @@
+#pragma once
+
+#include <qlist.h>
+#include <qobject.h>
+#include <qqmllist.h>
+#include <qtmetamacros.h>
+#include <qvariant.h>
+
+#include "../jsonadapter.hpp"
+
+class TestNode: public qs::io::JsonObject {
+	Q_OBJECT;
+	Q_PROPERTY(QString text MEMBER text NOTIFY textChanged);
+	Q_PROPERTY(TestNode* child MEMBER child NOTIFY childChanged);
+	Q_PROPERTY(QQmlListProperty<qs::io::JsonObject> items READ items NOTIFY itemsChanged);
+
+public:
+	QQmlListProperty<qs::io::JsonObject> items() { return {this, &this->itemList}; }
+
+	QString text;
+	TestNode* child = nullptr;
+	QList<qs::io::JsonObject*> itemList;
+
+signals:
+	void textChanged();
+	void childChanged();
+	void itemsChanged();
+};
+
+// Holds a var property in a nested object, which the adapter cannot track changes to.
+class TestVarNode: public qs::io::JsonObject {
+	Q_OBJECT;
+	Q_PROPERTY(QVariant data MEMBER data NOTIFY dataChanged);
+
+public:
+	QVariant data;
+
+signals:
+	void dataChanged();
+};
+
+class TestNodeAdapter: public qs::io::JsonAdapter {
+	Q_OBJECT;
+	Q_PROPERTY(TestNode* root MEMBER root NOTIFY rootChanged);
+	Q_PROPERTY(TestNode* other MEMBER other NOTIFY otherChanged);
+	Q_PROPERTY(TestVarNode* varNode MEMBER varNode NOTIFY varNodeChanged);
+
+public:
+	TestNodeAdapter() {
+		this->root->setParent(this);
+		this->other->setParent(this);
+		this->varNode->setParent(this);
+	}
+
+	TestNode* root = new TestNode();
+	TestNode* other = new TestNode();
+	TestVarNode* varNode = new TestVarNode();
+
+signals:
+	void rootChanged();
+	void otherChanged();
+	void varNodeChanged();
+};
+
+class TestJsonAdapter: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void cacheReuse();
+	static void nestedChange();
+	static void listMembership();
+	static void varMutation();
+	static void benchmarkSerializeChange();
+	static void benchmarkSerializeAll();
+};
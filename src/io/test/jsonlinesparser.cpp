@@ -0,0 +1,80 @@
+#include "jsonlinesparser.hpp"
+
+#include <qbytearray.h>
+#include <qjsonarray.h>
+#include <qjsonobject.h>
+#include <qlist.h>
+#include <qsignalspy.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qvariant.h>
+
+#include "../datastream.hpp"
+
+void TestJsonLinesParser::chunks() {
+	auto parser = JsonLinesParser();
+	auto spy = QSignalSpy(&parser, &JsonLinesParser::objectRead);
+	auto buffer = QByteArray();
+
+	auto incoming = QByteArray("{\"a\": 1}\r\n\n[1, 2");
+	parser.parseBytes(incoming, buffer);
+	QCOMPARE(spy.length(), 1);
+	QCOMPARE(buffer, "[1, 2");
+
+	incoming = ", 3]\n{\"b\"";
+	parser.parseBytes(incoming, buffer);
+	QCOMPARE(spy.length(), 2);
+	QCOMPARE(buffer, "{\"b\"");
+
+	// the last line does not need a trailing newline
+	incoming = ": true}";
+	parser.parseBytes(incoming, buffer);
+	QCOMPARE(spy.length(), 2);
+	parser.streamEnded(buffer);
+	QCOMPARE(spy.length(), 3);
+	QVERIFY(buffer.isEmpty());
+
+	QCOMPARE(spy.at(0).at(0).value<QJsonObject>(), QJsonObject({{"a", 1}}));
+	QCOMPARE(spy.at(1).at(0).value<QJsonArray>(), QJsonArray({1, 2, 3}));
+	QCOMPARE(spy.at(2).at(0).value<QJsonObject>(), QJsonObject({{"b", true}}));
+}
+
+void TestJsonLinesParser::errors() {
+	auto parser = JsonLinesParser();
+	parser.setBatched(true);
+
+	auto order = QList<QString>();
+	QObject::connect(&parser, &JsonLinesParser::objectsRead, [&](const QVariantList& objects) {
+		order.append(QStringLiteral("objects %1").arg(objects.length()));
+	});
+	QObject::connect(&parser, &JsonLinesParser::parseFailed, [&](const QString& line) {
+		order.append(QStringLiteral("error %1").arg(line));
+	});
+
+	auto buffer = QByteArray();
+	auto incoming = QByteArray("{\"a\": 1}\n{}\nnot json\n{\"b\": 2}\n");
+	parser.parseBytes(incoming, buffer);
+
+	QCOMPARE(order, QList<QString>({"objects 2", "error not json", "objects 1"}));
+}
+
+void TestJsonLinesParser::threaded() {
+	auto parser = JsonLinesParser();
+	parser.setThreaded(true);
+	auto spy = QSignalSpy(&parser, &JsonLinesParser::objectRead);
+	auto buffer = QByteArray();
+
+	for (auto i = 0; i != 100; i++) {
+		auto incoming = QStringLiteral("{\"i\": %1}\n").arg(i).toUtf8();
+		parser.parseBytes(incoming, buffer);
+	}
+
+	QTRY_COMPARE(spy.length(), 100);
+
+	for (auto i = 0; i != 100; i++) {
+		QCOMPARE(spy.at(i).at(0).value<QJsonObject>().value("i").toInt(), i);
+	}
+}
+
+QTEST_MAIN(TestJsonLinesParser);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtmetamacros.h>
+
+class TestJsonLinesParser: public QObject {
+	Q_OBJECT;
+
+private slots:
+	static void chunks();
+	static void errors();
+	static void threaded();
+};
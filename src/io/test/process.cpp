@@ -1,11 +1,34 @@
 #include "process.hpp"
 
+#include <qbytearray.h>
+#include <qfile.h>
 #include <qlist.h>
+#include <qlogging.h>
+#include <qprocess.h>
+#include <qregularexpression.h>
 #include <qsignalspy.h>
+#include <qstring.h>
+#include <qtemporarydir.h>
 #include <qtest.h>
 #include <qtestcase.h>
+#include <qtypes.h>
+#include <spawn.h>
+#include <unistd.h>
 
 #include "../process.hpp"
+#include "../processcore.hpp"
+
+using namespace qs::io::process;
+
+namespace {
+
+QByteArray readFile(const QString& path) {
+	auto file = QFile(path);
+	if (!file.open(QFile::ReadOnly)) return QByteArray();
+	return file.readAll();
+}
+
+} // namespace
 
 void TestProcess::startAfterReload() {
 	auto process = Process();
@@ -44,4 +67,68 @@ void TestProcess::testExec() {
 	QVERIFY(process.isRunning());
 }
 
+void TestProcess::spawnDetached() {
+	auto dir = QTemporaryDir();
+
+	auto context = ProcessContext({"sh", "-c", "echo \"$TEST_VAR\" > out"});
+	context.setEnvironment({{"TEST_VAR", "value"}});
+	context.setWorkingDirectory(dir.path());
+
+	QVERIFY(qs::io::process::spawnDetached(context));
+	QTRY_COMPARE(readFile(dir.filePath("out")), "value\n");
+
+	QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Failed to start process"));
+	QVERIFY(!qs::io::process::spawnDetached(ProcessContext({"/nonexistent/command"})));
+}
+
+void TestProcess::spawnSession() {
+#ifdef __linux__
+	auto dir = QTemporaryDir();
+	auto path = dir.filePath("stat");
+
+	// fields 5 and 6 of /proc/pid/stat are the process group and session
+	auto context = ProcessContext({"sh", "-c", QStringLiteral("cat /proc/$$/stat > '%1'").arg(path)});
+	QVERIFY(qs::io::process::spawnDetached(context));
+	QTRY_VERIFY(readFile(path).endsWith('\n'));
+
+	auto fields = readFile(path).split(' ');
+	QCOMPARE_NE(fields.at(4).toLongLong(), getpgrp());
+#ifdef POSIX_SPAWN_SETSID
+	QCOMPARE_NE(fields.at(5).toLongLong(), getsid(0));
+#endif
+#else
+	QSKIP("Reads /proc/pid/stat");
+#endif
+}
+
+void TestProcess::benchmarkSpawn_data() { // NOLINT
+	QTest::addColumn<bool>("qprocess");
+	QTest::addColumn<qsizetype>("rss");
+
+	QTest::addRow("spawn") << false << qsizetype(0);
+	QTest::addRow("qprocess") << true << qsizetype(0);
+	QTest::addRow("spawn-256MiB") << false << qsizetype(256) * 1024 * 1024;
+	QTest::addRow("qprocess-256MiB") << true << qsizetype(256) * 1024 * 1024;
+}
+
+// Measures how long starting a detached process blocks the caller with a given amount of
+// extra resident memory, which fork has to copy the page tables of.
+void TestProcess::benchmarkSpawn() {
+	// NOLINTBEGIN
+	QFETCH(bool, qprocess);
+	QFETCH(qsizetype, rss);
+	// NOLINTEND
+
+	auto memory = QByteArray(rss, 'x');
+
+	QBENCHMARK {
+		if (qprocess) QVERIFY(QProcess::startDetached("true", {}));
+		else QVERIFY(qs::io::process::spawnDetached(ProcessContext({"true"})));
+	}
+
+	// let exited processes be reaped
+	QTest::qWait(100);
+	QCOMPARE(memory.length(), rss);
+}
+
 QTEST_MAIN(TestProcess);
@@ -9,4 +9,8 @@ class TestProcess: public QObject {
 private slots:
 	static void startAfterReload();
 	static void testExec();
+	static void spawnDetached();
+	static void spawnSession();
+	static void benchmarkSpawn_data(); // NOLINT
+	static void benchmarkSpawn();
 };
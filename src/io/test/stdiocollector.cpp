@@ -0,0 +1,111 @@
+#include "stdiocollector.hpp"
+
+#include <qbytearray.h>
+#include <qsignalspy.h>
+#include <qtest.h>
+#include <qtestcase.h>
+
+#include "../datastream.hpp"
+
+namespace {
+
+void feed(StdioCollector& collector, QByteArray& buffer, const QByteArray& data) {
+	auto incoming = data;
+	collector.parseBytes(incoming, buffer);
+}
+
+} // namespace
+
+void TestStdioCollector::collects() {
+	auto collector = StdioCollector();
+	auto spy = QSignalSpy(&collector, &StdioCollector::dataChanged);
+
+	// data read before the collector was attached is kept
+	auto buffer = QByteArray("foo");
+	feed(collector, buffer, "bar");
+	feed(collector, buffer, "baz");
+	QVERIFY(buffer.isEmpty());
+	QCOMPARE(collector.data(), "");
+	QCOMPARE(spy.length(), 0);
+
+	collector.streamEnded(buffer);
+	QCOMPARE(collector.data(), "foobarbaz");
+	QCOMPARE(collector.text(), "foobarbaz");
+	QCOMPARE(spy.length(), 1);
+
+	// the previous result is kept until the next stream ends
+	feed(collector, buffer, "next");
+	QCOMPARE(collector.data(), "foobarbaz");
+	collector.streamEnded(buffer);
+	QCOMPARE(collector.data(), "next");
+
+	// a stream without any output does not keep the previous result
+	collector.streamEnded(buffer);
+	QCOMPARE(collector.data(), "");
+}
+
+void TestStdioCollector::maxBytes() {
+	auto collector = StdioCollector();
+	collector.setMaxBytes(5);
+	auto buffer = QByteArray();
+
+	feed(collector, buffer, "abc");
+	feed(collector, buffer, "defg");
+	feed(collector, buffer, "hij");
+	collector.streamEnded(buffer);
+
+	QCOMPARE(collector.data(), "abcde");
+	QVERIFY(collector.truncated());
+
+	feed(collector, buffer, "abc");
+	collector.streamEnded(buffer);
+
+	QCOMPARE(collector.data(), "abc");
+	QVERIFY(!collector.truncated());
+}
+
+void TestStdioCollector::keepTail() {
+	auto collector = StdioCollector();
+	collector.setMaxBytes(5);
+	collector.setKeepTail(true);
+	auto buffer = QByteArray();
+
+	feed(collector, buffer, "abc");
+	feed(collector, buffer, "de");
+	QVERIFY(!collector.truncated());
+
+	feed(collector, buffer, "fg");
+	QVERIFY(collector.truncated());
+
+	feed(collector, buffer, "hijklmn");
+	collector.streamEnded(buffer);
+
+	QCOMPARE(collector.data(), "jklmn");
+}
+
+void TestStdioCollector::throttled() {
+	auto collector = StdioCollector();
+	collector.setWaitForEnd(false);
+	auto spy = QSignalSpy(&collector, &StdioCollector::dataChanged);
+	auto buffer = QByteArray();
+
+	feed(collector, buffer, "a");
+	QCOMPARE(spy.length(), 1);
+	QCOMPARE(collector.data(), "a");
+
+	for (auto i = 0; i != 100; i++) {
+		feed(collector, buffer, "b");
+	}
+
+	// later changes are delivered together once the interval passes
+	QCOMPARE(spy.length(), 1);
+	QCOMPARE(collector.data().length(), 101);
+	QTRY_COMPARE(spy.length(), 2);
+
+	feed(collector, buffer, "c");
+	collector.streamEnded(buffer);
+	QCOMPARE(spy.length(), 3);
+	QCOMPARE(collector.data().length(), 102);
+}
+
+QTEST_MAIN(TestStdioCollector);
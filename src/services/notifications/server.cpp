@@ -64,7 +64,7 @@ NotificationServer* NotificationServer::instance() {
 
 void NotificationServer::switchGeneration(bool reEmit, const std::function<void()>& clearHook) {
 	auto notifications = this->mNotifications.valueList();
-	this->mNotifications.valueList().clear();
+	this->mNotifications.clear();
 	this->idMap.clear();
 
 	clearHook();
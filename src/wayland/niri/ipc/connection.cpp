@@ -10,7 +10,6 @@
 #include <qlogging.h>
 #include <qloggingcategory.h>
 #include <qobject.h>
-#include <qprocess.h>
 #include <qproperty.h>
 #include <qtenvironmentvariables.h>
 #include <qtmetamacros.h>
@@ -18,6 +17,7 @@
 
 #include "../../../core/logcat.hpp"
 #include "../../../core/model.hpp"
+#include "../../../io/processcore.hpp"
 #include "output.hpp"
 #include "window.hpp"
 #include "workspace.hpp"
@@ -411,7 +411,9 @@ void NiriIpc::dispatch(const QStringList& args) {
 	command.append(args);
 
 	qCDebug(logNiriIpc) << "Dispatching:" << command.join(" ");
-	QProcess::startDetached(command.first(), command.mid(1));
+	auto context = qs::io::process::ProcessContext(command);
+	context.setUnbindStdout(false);
+	qs::io::process::spawnDetached(context);
 }
 
 ObjectModel<NiriOutput>* NiriIpc::outputs() { return &this->mOutputs; }